@@ -0,0 +1,221 @@
+#include "config_reload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+static int64_t clock_ns(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) {
+        return std::string();
+    }
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+std::string Config::get(const std::string& key, const std::string& def) const {
+    std::map<std::string, std::string>::const_iterator it = values.find(key);
+    return it == values.end() ? def : it->second;
+}
+
+int64_t Config::get_int(const std::string& key, int64_t def) const {
+    std::map<std::string, std::string>::const_iterator it = values.find(key);
+    return it == values.end() ? def : strtoll(it->second.c_str(), NULL, 10);
+}
+
+double Config::get_double(const std::string& key, double def) const {
+    std::map<std::string, std::string>::const_iterator it = values.find(key);
+    return it == values.end() ? def : strtod(it->second.c_str(), NULL);
+}
+
+int parse_config(const std::string& path, Config* out, std::string* err) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        *err = path + ": " + strerror(errno);
+        return -1;
+    }
+    char* line = NULL;
+    size_t cap = 0;
+    int lineno = 0;
+    int rc = 0;
+    while (getline(&line, &cap, fp) >= 0) {
+        ++lineno;
+        std::string s = trim(line);
+        if (s.empty() || s[0] == '#') {
+            continue;
+        }
+        size_t eq = s.find('=');
+        std::string key = eq == std::string::npos ? std::string() : trim(s.substr(0, eq));
+        if (key.empty()) {
+            *err = path + ":" + std::to_string(lineno) + ": 需要 key = value";
+            rc = -1;
+            break;
+        }
+        out->values[key] = trim(s.substr(eq + 1));
+    }
+    if (rc == 0 && ferror(fp)) {
+        *err = path + ": 读取失败";
+        rc = -1;
+    }
+    free(line);
+    fclose(fp);
+    out->path = path;
+    return rc;
+}
+
+ConfigStore::ConfigStore(Config* initial)
+    : current_(initial != NULL ? initial : new Config()),
+      epoch_(1),
+      nreaders_(0),
+      publishes_(0),
+      grace_ns_total_(0),
+      grace_ns_max_(0) {}
+
+ConfigStore::~ConfigStore() { delete current_.load(); }
+
+ConfigStore::Reader* ConfigStore::register_reader() {
+    for (int i = 0; i < kMaxReaders; ++i) {
+        bool expected = false;
+        if (readers_[i].used.compare_exchange_strong(expected, true)) {
+            // 先扩大扫描范围再上线：反过来的话，publish() 可能按旧的 nreaders_ 扫描、漏掉这个刚上线的读者，
+            // 把它已经能读到的快照删掉。上线之前 seen 为 0，被扫到也只会当作离线跳过
+            int n = nreaders_.load();
+            while (n < i + 1 && !nreaders_.compare_exchange_weak(n, i + 1)) {
+            }
+            online(&readers_[i]);
+            return &readers_[i];
+        }
+    }
+    return NULL;
+}
+
+void ConfigStore::unregister_reader(Reader* r) {
+    r->seen.store(0, std::memory_order_release);
+    r->used.store(false, std::memory_order_release);
+}
+
+void ConfigStore::online(Reader* r) {
+    r->seen.store(epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+    // 和 publish() 里的 fence 配对：要么写者扫描时看到我们在线，要么我们接下来读到的已经是新指针
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ConfigStore::synchronize(uint64_t target) {
+    int n = nreaders_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        Reader& r = readers_[i];
+        int spins = 0;
+        for (;;) {
+            uint64_t seen = r.seen.load(std::memory_order_acquire);
+            if (seen == 0 || seen >= target || !r.used.load(std::memory_order_acquire)) {
+                break;
+            }
+            // 读者一般几微秒内就会经过静止点；等久了就让出 CPU，单核上尤其需要
+            if (++spins < 100) {
+                sched_yield();
+            } else {
+                timespec ts = {0, 50000};
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+}
+
+void ConfigStore::publish(Config* next) {
+    std::lock_guard<std::mutex> lock(write_mu_);
+    const Config* old = current_.exchange(next);
+    uint64_t target = epoch_.fetch_add(1) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t start = clock_ns(CLOCK_MONOTONIC);
+    synchronize(target);
+    int64_t waited = clock_ns(CLOCK_MONOTONIC) - start;
+    delete old;
+    ++publishes_;
+    grace_ns_total_ += waited;
+    if (waited > grace_ns_max_) {
+        grace_ns_max_ = waited;
+    }
+}
+
+ConfigReloader::ConfigReloader(ConfigStore* store, const std::string& path, DoneFn done)
+    : store_(store),
+      path_(path),
+      done_(done),
+      pending_(false),
+      stopping_(false),
+      next_generation_(1),
+      loads_(0),
+      failures_(0) {}
+
+ConfigReloader::~ConfigReloader() { stop(); }
+
+void ConfigReloader::start() { thread_ = std::thread(&ConfigReloader::run, this); }
+
+void ConfigReloader::request() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void ConfigReloader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+int ConfigReloader::load_now(std::string* err) {
+    int64_t parse_ns = 0;
+    return reload(err, &parse_ns);
+}
+
+int ConfigReloader::reload(std::string* err, int64_t* parse_ns) {
+    int64_t start = clock_ns(CLOCK_MONOTONIC);
+    std::unique_ptr<Config> cfg(new Config());
+    int rc = parse_config(path_, cfg.get(), err);
+    *parse_ns = clock_ns(CLOCK_MONOTONIC) - start;
+    if (rc < 0) {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    cfg->generation = next_generation_++;
+    cfg->loaded_at = clock_ns(CLOCK_REALTIME);
+    store_->publish(cfg.release());
+    loads_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+void ConfigReloader::run() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this]() { return pending_ || stopping_; });
+            if (stopping_) {
+                return;
+            }
+            pending_ = false;
+        }
+        std::string err;
+        int64_t parse_ns = 0;
+        int rc = reload(&err, &parse_ns);
+        if (done_) {
+            // 新快照刚发布、只有本线程在 publish，这里读 current() 不会被回收
+            done_(rc == 0 ? store_->current() : NULL, err, parse_ns);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef DAEMONIZE_CONFIG_RELOAD_H
+#define DAEMONIZE_CONFIG_RELOAD_H
+
+/**
+ * 配置热加载：SIGUSR1 触发，后台线程解析，解析成功后以不可变快照的形式原子替换
+ *
+ *  - Config 发布之后不再修改，读者拿到指针就可以随便读，不需要加锁
+ *  - ConfigStore 用 QSBR（quiescent-state-based reclamation）回收旧快照：
+ *      读者线程先 register_reader()，在两次请求之间调用 quiescent() 表示"不再持有之前读到的指针"；
+ *      睡在 epoll_wait 之类的地方之前 offline()，醒来后 online()，离线的读者不会拖住回收
+ *      写者 publish() 交换指针后推进全局 epoch，等所有在线读者都报告过新 epoch 才删除旧快照
+ *    读路径是一次 acquire load，quiescent() 是一次 load + 一次 store，都在读者自己的缓存行上
+ *  - ConfigReloader 的后台线程负责读文件、解析、publish() 和等待宽限期，
+ *    主循环收到 SIGUSR1 只是 request() 一下；解析失败时保留旧配置
+ *
+ * 配置文件格式：每行 key = value，# 开头为注释，空行忽略
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct Config {
+    uint64_t generation;  // 第几次成功加载，从 1 开始
+    int64_t loaded_at;    // CLOCK_REALTIME 纳秒
+    std::string path;
+    std::map<std::string, std::string> values;
+
+    Config() : generation(0), loaded_at(0) {}
+
+    std::string get(const std::string& key, const std::string& def = std::string()) const;
+    int64_t get_int(const std::string& key, int64_t def) const;
+    double get_double(const std::string& key, double def) const;
+};
+
+/** 解析 path 指向的配置文件；失败时返回 -1，err 里是原因（带行号） */
+int parse_config(const std::string& path, Config* out, std::string* err);
+
+class ConfigStore {
+public:
+    /** 每个读者线程一个，独占一条缓存行 */
+    struct alignas(64) Reader {
+        std::atomic<uint64_t> seen;  // 最近一次报告的 epoch，0 表示离线
+        std::atomic<bool> used;
+
+        Reader() : seen(0), used(false) {}
+    };
+
+    /** initial 可以为 NULL，此时 current() 返回一个空配置 */
+    explicit ConfigStore(Config* initial = NULL);
+    ~ConfigStore();
+
+    /** 读者线程调用一次；返回的 Reader 处于在线状态 */
+    Reader* register_reader();
+    /** 线程退出前调用，之后 Reader 不能再用 */
+    void unregister_reader(Reader* r);
+
+    /** 读者在两次 quiescent() 之间可以一直使用 current() 返回的指针 */
+    const Config* current() const { return current_.load(std::memory_order_acquire); }
+
+    void quiescent(Reader* r) { r->seen.store(epoch_.load(std::memory_order_acquire), std::memory_order_release); }
+    void offline(Reader* r) { r->seen.store(0, std::memory_order_release); }
+    void online(Reader* r);
+
+    /**
+     * 替换当前配置并等待宽限期结束后删除旧配置。会阻塞到所有在线读者都经过一次 quiescent()，
+     * 所以不要在读者线程上调用（除非它已经 offline()）。
+     */
+    void publish(Config* next);
+
+    /** publish 次数和宽限期等待时间的累计值 */
+    uint64_t publishes() const { return publishes_; }
+    int64_t grace_ns_total() const { return grace_ns_total_; }
+    int64_t grace_ns_max() const { return grace_ns_max_; }
+
+private:
+    ConfigStore(const ConfigStore&);
+    ConfigStore& operator=(const ConfigStore&);
+
+    void synchronize(uint64_t target);
+
+    static const int kMaxReaders = 256;
+
+    std::atomic<const Config*> current_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<int> nreaders_;
+    Reader readers_[kMaxReaders];
+    std::mutex write_mu_;
+    uint64_t publishes_;
+    int64_t grace_ns_total_;
+    int64_t grace_ns_max_;
+};
+
+/** 后台重新加载线程 */
+class ConfigReloader {
+public:
+    /**
+     * 每次加载结束（成功或失败）在后台线程上回调：成功时 cfg 是新发布的快照，err 为空；
+     * 失败时 cfg 为 NULL。parse_ns 是读文件 + 解析的耗时。
+     */
+    typedef std::function<void(const Config* cfg, const std::string& err, int64_t parse_ns)> DoneFn;
+
+    ConfigReloader(ConfigStore* store, const std::string& path, DoneFn done = DoneFn());
+    ~ConfigReloader();
+
+    /** 启动后台线程；不会立即加载 */
+    void start();
+
+    /** 请求重新加载，只做一次通知，可以在任何线程调用；后台线程忙时的多次请求合并成一次 */
+    void request();
+
+    /** 在调用线程上同步加载一次，只能在 start() 之前用（启动时的首次加载），返回 0 或 -1 */
+    int load_now(std::string* err);
+
+    void stop();
+
+    uint64_t loads() const { return loads_.load(std::memory_order_relaxed); }
+    uint64_t failures() const { return failures_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    int reload(std::string* err, int64_t* parse_ns);
+
+    ConfigStore* store_;
+    std::string path_;
+    DoneFn done_;
+    std::thread thread_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool pending_;
+    bool stopping_;
+    uint64_t next_generation_;
+    std::atomic<uint64_t> loads_;
+    std::atomic<uint64_t> failures_;
+};
+
+#endif  // DAEMONIZE_CONFIG_RELOAD_H
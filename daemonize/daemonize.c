@@ -1,3 +1,5 @@
+#include "daemonize.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -11,7 +13,7 @@
  * 将当前进程转换为守护进程
  * 返回值：成功返回0，失败返回-1
  */
-int daemonize() {
+int daemonize(void) {
     pid_t pid;
     
     // 第一次 fork - 创建子进程
@@ -90,56 +92,3 @@ int daemonize() {
     
     return 0;
 }
-
-/**
- * 信号处理函数
- */
-void signal_handler(int sig) {
-    switch (sig) {
-        case SIGTERM:
-            // 优雅退出
-            exit(0);
-            break;
-        case SIGUSR1:
-            // 用户自定义信号，可以用于重新加载配置等
-            break;
-        default:
-            break;
-    }
-}
-
-/**
- * 设置信号处理
- */
-void setup_signals() {
-    signal(SIGTERM, signal_handler);  // 终止信号
-    signal(SIGUSR1, signal_handler);  // 用户信号1
-    signal(SIGPIPE, SIG_IGN);         // 忽略管道破裂信号
-}
-
-int main() {
-    printf("开始创建守护进程...\n");
-    
-    if (daemonize() < 0) {
-        fprintf(stderr, "守护进程创建失败\n");
-        return -1;
-    }
-    
-    // 守护进程成功创建后，设置信号处理
-    setup_signals();
-    
-    // 守护进程的主要工作循环
-    // 注意：此时标准输出已经重定向到 /dev/null，printf 不会显示
-    while (1) {
-        // 这里可以添加守护进程的实际工作
-        // 例如：
-        // - 监控系统状态
-        // - 处理网络请求
-        // - 执行定时任务
-        // - 写入日志文件等
-        
-        sleep(30);  // 每30秒执行一次循环
-    }
-    
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef DAEMONIZE_DAEMONIZE_H
+#define DAEMONIZE_DAEMONIZE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 将当前进程转换为守护进程（两次 fork + setsid，标准输入输出重定向到 /dev/null）
+ * 返回值：成功返回0，失败返回-1
+ */
+int daemonize(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* DAEMONIZE_DAEMONIZE_H */
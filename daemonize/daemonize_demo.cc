@@ -0,0 +1,406 @@
+/**
+ * 守护进程示例：daemonize() 之后进入 epoll 主循环，周期任务由 timerfd 调度器驱动
+ *
+ * 用法: daemonize_demo [-f] [-l logfile] [-d seconds] [-c config] [-p port] [-b backlog] [-g grace_ms] [-w workers]
+ *                      [-m metrics] [-T]
+ *   -f  前台运行（不调用 daemonize），结束时把任务统计和排空结果打印到 stdout
+ *   -l  日志文件，默认 /tmp/daemonize_demo.log（守护进程的 stdout 是 /dev/null）
+ *   -d  运行多少秒后退出，默认 0 表示一直运行
+ *   -c  配置文件，kill -USR1 或 -HUP 后在后台线程重新加载；用到的 key：
+ *         log_level = debug|info|warn|error
+ *         loadavg_warn = 1 分钟负载超过它时记 WARN
+ *   -p  在 127.0.0.1:port 上提供请求服务（协议见 drain_server.h），默认不开
+ *   -b  监听队列长度，默认 1024
+ *   -g  SIGTERM 后排空的截止时间，默认 5000ms
+ *   -T  测试用：允许用 SIGUSR2 暂停/恢复 accept（见下），drain_stress 用它保证排空时监听队列非空
+ *   -w  请求服务的工作线程数，默认 4
+ *   -m  把指标放到共享内存段里（见 metrics.h），用 metrics_cat 查看：
+ *         以 '/' 开头时是 shm_open 的名字，如 -m /daemonize_demo，metrics_cat /daemonize_demo；
+ *         否则用 memfd，日志里记下 metrics_cat 要用的 /proc/<pid>/fd/<fd> 路径
+ *
+ * 信号全部经 signalfd 进入主循环，没有异步信号处理函数：
+ *   SIGTERM/SIGINT  进入排空：不再接受新请求，已接受的请求做完，截止时间到了还没做完的放弃；
+ *                   排空期间再收到一次则立即放弃。之后停掉调度器和加载线程，
+ *                   把任务统计和排空结果写进日志并刷盘再返回
+ *   SIGUSR1/SIGHUP  重新加载配置
+ *   SIGUSR2         只在 -T 时有效，否则记日志后忽略：在暂停和恢复 accept 之间切换，
+ *                   暂停期间新连接留在监听队列里，恢复或排空时再收进来；
+ *                   前台运行时往 stdout 打一行 "accept paused" 或 "accept resumed"
+ *   SIGCHLD         回收所有已退出的子进程（多个 SIGCHLD 可能合并成一个）
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/statvfs.h>
+#include <string>
+
+#include "async_logger.h"
+#include "config_reload.h"
+#include "daemonize.h"
+#include "drain_server.h"
+#include "metrics.h"
+#include "scheduler.h"
+#include "signal_fd.h"
+
+static const int64_t kSecond = 1000000000LL;
+
+// 共享内存里的指标，下标和名字表一一对应
+enum {
+    kMetricWakeups,
+    kMetricSignals,
+    kMetricReloads,
+    kMetricReloadFailures,
+    kMetricConnections,
+    kMetricRequests,
+    kMetricCompleted,
+    kMetricRejected,
+    kMetricAbandoned,
+};
+enum { kMetricLoopBusy };
+
+/** DrainServer 自己维护累计值，主循环每轮把增量搬进指标段 */
+static void publish_drain_stats(const DrainStats& now, DrainStats* last, MetricsThread* m) {
+    if (now.connections != last->connections) m->add(kMetricConnections, now.connections - last->connections);
+    if (now.requests != last->requests) m->add(kMetricRequests, now.requests - last->requests);
+    if (now.completed != last->completed) m->add(kMetricCompleted, now.completed - last->completed);
+    if (now.rejected != last->rejected) m->add(kMetricRejected, now.rejected - last->rejected);
+    if (now.abandoned != last->abandoned) m->add(kMetricAbandoned, now.abandoned - last->abandoned);
+    *last = now;
+}
+
+/**
+ * 设置信号处理：要接管的信号全部屏蔽，之后经 signalfd 交给主循环。
+ * 要在创建任何线程之前调用，新线程继承屏蔽字，信号不会被投递到别的线程上
+ */
+int setup_signals(SignalFd* sigs) {
+    signal(SIGPIPE, SIG_IGN);  // 忽略管道破裂信号
+    return sigs->block({SIGTERM, SIGINT, SIGHUP, SIGUSR1, SIGUSR2, SIGCHLD});
+}
+
+static LogLevel parse_level(const std::string& s, LogLevel def) {
+    if (s == "debug") return kLogDebug;
+    if (s == "info") return kLogInfo;
+    if (s == "warn") return kLogWarn;
+    if (s == "error") return kLogError;
+    return def;
+}
+
+/** 把各任务的执行时间/迟到统计写进日志；任务名的字符串和任务一样一直存在，日志只保存指针是安全的 */
+static void report_jobs(const Scheduler& sched, AsyncLogger* log) {
+    sched.for_each_stats([log](const JobStats& s) {
+        ALOG_INFO(*log, "job %s runs %llu skipped %llu late_p99 %llu us run_p99 %llu us", s.name.c_str(),
+                  (unsigned long long)s.runs, (unsigned long long)s.skipped,
+                  (unsigned long long)(s.lateness.percentile(99) / 1000),
+                  (unsigned long long)(s.run_time.percentile(99) / 1000));
+    });
+}
+
+/**
+ * 守护进程的周期任务，替代原来 while (1) { sleep(30); } 的空循环：
+ *  - heartbeat  每 30s 记一次心跳
+ *  - loadavg    每 5s 采样系统负载，加 500ms 抖动；超过配置的阈值记 WARN
+ *  - disk       每 60s 检查根分区剩余空间；statvfs 可能卡在慢文件系统上，放到工作线程
+ *  - report     每 60s 把各任务的执行时间/迟到统计写进日志
+ */
+static void add_jobs(Scheduler* sched, AsyncLogger* log, const ConfigStore* config, int64_t started) {
+    // 内联任务在主循环线程上执行，主循环是 config 的读者，一轮事件处理完才报告静止点
+    sched->add_periodic("heartbeat", 30 * kSecond, [log, config, started]() {
+        ALOG_INFO(*log, "heartbeat, uptime %lld s, config generation %llu",
+                  (long long)((Scheduler::now_ns() - started) / kSecond),
+                  (unsigned long long)config->current()->generation);
+    });
+    sched->add_periodic(
+        "loadavg", 5 * kSecond,
+        [log, config]() {
+            double load[3];
+            if (getloadavg(load, 3) != 3) {
+                return;
+            }
+            if (load[0] > config->current()->get_double("loadavg_warn", 1e9)) {
+                ALOG_WARN(*log, "loadavg %.2f %.2f %.2f", load[0], load[1], load[2]);
+            } else {
+                ALOG_INFO(*log, "loadavg %.2f %.2f %.2f", load[0], load[1], load[2]);
+            }
+        },
+        kSecond / 2);
+    sched->add_periodic(
+        "disk", 60 * kSecond,
+        [log]() {
+            struct statvfs st;
+            if (statvfs("/", &st) == 0) {
+                ALOG_INFO(*log, "disk / free %llu MB", (unsigned long long)st.f_bavail * st.f_frsize >> 20);
+            }
+        },
+        0, true);
+    sched->add_periodic("report", 60 * kSecond, [sched, log]() { report_jobs(*sched, log); });
+}
+
+int main(int argc, char** argv) {
+    bool foreground = false;
+    const char* log_path = "/tmp/daemonize_demo.log";
+    const char* config_path = NULL;
+    const char* metrics_name = NULL;
+    int seconds = 0;
+    int port = -1;
+    int backlog = 1024;
+    bool test_hooks = false;
+    int64_t grace_ms = 5000;
+    int workers = 4;
+    int opt;
+    while ((opt = getopt(argc, argv, "fl:d:c:p:b:g:w:m:T")) != -1) {
+        switch (opt) {
+            case 'f': foreground = true; break;
+            case 'l': log_path = optarg; break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'c': config_path = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'b': backlog = atoi(optarg); break;
+            case 'g': grace_ms = atoll(optarg); break;
+            case 'w': workers = atoi(optarg); break;
+            case 'm': metrics_name = optarg; break;
+            case 'T': test_hooks = true; break;
+            default:
+                fprintf(stderr,
+                        "用法: %s [-f] [-l logfile] [-d seconds] [-c config] [-p port] [-b backlog] [-g grace_ms] [-w workers] "
+                        "[-m metrics] [-T]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    // 监听套接字在 daemonize 之前创建：端口被占用之类的错误还能在终端上看到
+    DrainServer server(workers);
+    if (port >= 0 && server.listen("127.0.0.1", port, backlog) < 0) {
+        perror("listen");
+        return 1;
+    }
+    if (port >= 0 && foreground) {
+        printf("listening on 127.0.0.1:%d\n", server.port());
+        fflush(stdout);
+    }
+
+    if (!foreground) {
+        printf("开始创建守护进程...\n");
+        if (daemonize() < 0) {
+            fprintf(stderr, "守护进程创建失败\n");
+            return -1;
+        }
+    }
+
+    // 守护进程成功创建后，设置信号处理
+    SignalFd sigs;
+    if (setup_signals(&sigs) < 0) {
+        return -1;
+    }
+
+    // 日志的后台线程、调度器的工作线程和配置加载线程都要在 fork 之后创建
+    // 注意：此时标准输出已经重定向到 /dev/null，printf 不会显示
+    AsyncLogger log;
+    if (log.open(log_path) < 0) {
+        return -1;
+    }
+
+    // memfd 的路径里有 pid，段要在 daemonize 之后创建；主循环线程和配置加载线程各占一个槽
+    Metrics metrics({"loop_wakeups", "signals", "config_reloads", "config_reload_failures", "connections", "requests",
+                     "completed", "rejected", "abandoned"},
+                    {"loop_busy_ns"}, 4);
+    MetricsThread* mt = NULL;
+    if (metrics_name != NULL) {
+        if (metrics.create(metrics_name) < 0) {
+            ALOG_ERROR(log, "create metrics segment %s failed, errno %d", metrics_name, errno);
+            log.close();
+            return -1;
+        }
+        mt = metrics.attach("main");
+        ALOG_INFO(log, "metrics at %s", metrics.path().c_str());
+    }
+
+    // 首次加载在主线程同步完成，配置有错直接退出；之后的重新加载失败只记日志、沿用旧配置
+    ConfigStore config;
+    ConfigReloader reloader(&config, config_path != NULL ? config_path : "",
+                            [&log, &metrics, mt](const Config* cfg, const std::string& err, int64_t parse_ns) {
+                                // 回调在加载线程上执行，第一次用时给它分一个槽
+                                MetricsThread* m = mt != NULL ? metrics.local() : NULL;
+                                if (m != NULL) {
+                                    m->add(cfg != NULL ? kMetricReloads : kMetricReloadFailures);
+                                }
+                                if (cfg == NULL) {
+                                    ALOG_ERROR(log, "config reload failed, keeping old config: %s", err.c_str());
+                                    // 日志只保存字符串指针，err 在回调返回后就没了
+                                    log.flush();
+                                    return;
+                                }
+                                log.set_level(parse_level(cfg->get("log_level"), kLogDebug));
+                                ALOG_INFO(log, "config reloaded, generation %llu, %zu keys, parse %lld us",
+                                          (unsigned long long)cfg->generation, cfg->values.size(),
+                                          (long long)(parse_ns / 1000));
+                            });
+    if (config_path != NULL) {
+        std::string err;
+        if (reloader.load_now(&err) < 0) {
+            ALOG_ERROR(log, "load config: %s", err.c_str());
+            log.close();
+            return -1;
+        }
+        log.set_level(parse_level(config.current()->get("log_level"), kLogDebug));
+        reloader.start();
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    Scheduler sched(2);
+    if (ep < 0 || sched.init(ep) < 0) {
+        ALOG_ERROR(log, "scheduler init failed, errno %d", errno);
+        return -1;
+    }
+
+    if (port >= 0 && server.init(ep) < 0) {
+        ALOG_ERROR(log, "request server init failed, errno %d", errno);
+        return -1;
+    }
+
+    bool running = true;
+    bool force = false;
+    int64_t drain_deadline = 0;
+    auto begin_shutdown = [&]() {
+        running = false;
+        drain_deadline = Scheduler::now_ns() + grace_ms * 1000000LL;
+        server.begin_drain();
+    };
+    int rc = sigs.init(ep, [&](const signalfd_siginfo& si) {
+        if (mt != NULL) {
+            mt->add(kMetricSignals);
+        }
+        switch (si.ssi_signo) {
+            case SIGTERM:
+            case SIGINT:
+                if (!running) {
+                    ALOG_WARN(log, "signal %u from pid %d during drain, abandoning", si.ssi_signo, (int)si.ssi_pid);
+                    force = true;
+                    break;
+                }
+                ALOG_INFO(log, "signal %u from pid %d, draining %zu in-flight requests, deadline %lld ms",
+                          si.ssi_signo, (int)si.ssi_pid, server.in_flight(), (long long)grace_ms);
+                begin_shutdown();
+                break;
+            case SIGUSR1:
+            case SIGHUP:
+                if (config_path == NULL) {
+                    ALOG_WARN(log, "signal %u from pid %d ignored, no config file", si.ssi_signo, (int)si.ssi_pid);
+                } else {
+                    ALOG_INFO(log, "signal %u from pid %d, reloading config", si.ssi_signo, (int)si.ssi_pid);
+                    reloader.request();
+                }
+                break;
+            case SIGUSR2:
+                if (!test_hooks) {
+                    ALOG_WARN(log, "signal %u from pid %d ignored, test hooks not enabled (-T)", si.ssi_signo,
+                              (int)si.ssi_pid);
+                    break;
+                }
+                if (server.accept_paused()) {
+                    server.resume_accept();
+                } else {
+                    server.pause_accept();
+                }
+                ALOG_INFO(log, "signal %u from pid %d, accept %s", si.ssi_signo, (int)si.ssi_pid,
+                          server.accept_paused() ? "paused" : "resumed");
+                if (foreground) {
+                    printf("accept %s\n", server.accept_paused() ? "paused" : "resumed");
+                    fflush(stdout);
+                }
+                break;
+            case SIGCHLD:
+                SignalFd::reap_children([&log](pid_t pid, int status) {
+                    ALOG_INFO(log, "child %d exited, status 0x%x", (int)pid, status);
+                });
+                break;
+            default:
+                break;
+        }
+    });
+    if (rc < 0) {
+        ALOG_ERROR(log, "signalfd init failed, errno %d", errno);
+        return -1;
+    }
+
+    int64_t started = Scheduler::now_ns();
+    add_jobs(&sched, &log, &config, started);
+    if (seconds > 0) {
+        sched.add_oneshot("exit", seconds * kSecond, [&running, &begin_shutdown]() {
+            if (running) {
+                begin_shutdown();
+            }
+        });
+    }
+    ALOG_INFO(log, "daemon started, pid %d", (int)getpid());
+
+    // 守护进程的主要工作循环：没有任务到期时一直睡在 epoll_wait 里。
+    // 收到 SIGTERM 后继续跑，直到请求排空、截止时间到或者再收到一次 SIGTERM。
+    // 主循环是配置的读者：睡眠期间离线，每轮事件处理完报告一次静止点
+    ConfigStore::Reader* reader = config.register_reader();
+    DrainStats last_drain;
+    epoll_event events[16];
+    for (;;) {
+        int timeout = -1;
+        if (!running) {
+            int64_t left = drain_deadline - Scheduler::now_ns();
+            if (force || server.drained() || port < 0 || left <= 0) {
+                break;
+            }
+            timeout = (int)((left + 999999) / 1000000);
+        }
+        config.offline(reader);
+        int n = epoll_wait(ep, events, 16, timeout);
+        config.online(reader);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int64_t woke = mt != NULL ? Scheduler::now_ns() : 0;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (!sigs.handle(fd) && !server.handle(fd)) {
+                sched.handle(fd);
+            }
+        }
+        if (mt != NULL) {
+            mt->add(kMetricWakeups);
+            mt->record(kMetricLoopBusy, Scheduler::now_ns() - woke);
+            publish_drain_stats(server.stats(), &last_drain, mt);
+        }
+        config.quiescent(reader);
+    }
+    config.unregister_reader(reader);
+
+    if (port >= 0 && !server.drained()) {
+        server.begin_drain();
+        server.abandon();
+    }
+    if (mt != NULL) {
+        publish_drain_stats(server.stats(), &last_drain, mt);
+    }
+    sched.stop();
+    reloader.stop();
+
+    // 退出前把指标写进日志，再等日志全部落盘
+    report_jobs(sched, &log);
+    const DrainStats& ds = server.stats();
+    ALOG_INFO(log, "drain: requests %llu completed %llu drained %llu rejected %llu abandoned %llu",
+              (unsigned long long)ds.requests, (unsigned long long)ds.completed, (unsigned long long)ds.drained,
+              (unsigned long long)ds.rejected, (unsigned long long)ds.abandoned);
+    ALOG_INFO(log, "daemon exiting");
+    if (foreground) {
+        sched.print_stats(stdout);
+        printf("drain: connections=%llu late_accepts=%llu requests=%llu completed=%llu drained=%llu rejected=%llu "
+               "abandoned=%llu\n",
+               (unsigned long long)ds.connections, (unsigned long long)ds.late_accepts,
+               (unsigned long long)ds.requests, (unsigned long long)ds.completed, (unsigned long long)ds.drained,
+               (unsigned long long)ds.rejected, (unsigned long long)ds.abandoned);
+    }
+    log.close();
+    close(ep);
+    return 0;
+}
@@ -0,0 +1,375 @@
+#include "drain_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+DrainServer::DrainServer(int workers)
+    : epfd_(-1),
+      listen_fd_(-1),
+      done_fd_(-1),
+      port_(0),
+      nworkers_(workers > 0 ? workers : 1),
+      draining_(false),
+      accept_paused_(false),
+      abandoned_(false),
+      next_serial_(1),
+      in_flight_(0),
+      stopping_(false) {}
+
+DrainServer::~DrainServer() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+    while (!conns_.empty()) {
+        close_conn(conns_.begin()->first);
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+    if (done_fd_ >= 0) {
+        close(done_fd_);
+    }
+}
+
+int DrainServer::listen(const std::string& host, int port, int backlog) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+        bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd_, backlog) < 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return -1;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, (sockaddr*)&addr, &len);
+    port_ = ntohs(addr.sin_port);
+    return 0;
+}
+
+int DrainServer::init(int epfd) {
+    epfd_ = epfd;
+    done_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (done_fd_ < 0 || listen_fd_ < 0) {
+        return -1;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd_, &ev) < 0) {
+        return -1;
+    }
+    ev.data.fd = done_fd_;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, done_fd_, &ev) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < nworkers_; ++i) {
+        workers_.push_back(std::thread(&DrainServer::worker_loop, this));
+    }
+    return 0;
+}
+
+bool DrainServer::handle(int fd) {
+    if (fd == done_fd_) {
+        uint64_t n;
+        ssize_t r = read(done_fd_, &n, sizeof(n));
+        (void)r;
+        complete();
+        return true;
+    }
+    if (fd == listen_fd_ && listen_fd_ >= 0) {
+        accept_all();
+        return true;
+    }
+    std::map<int, Conn>::iterator it = conns_.find(fd);
+    if (it == conns_.end()) {
+        return false;
+    }
+    if (it->second.want_write && !flush(fd, &it->second)) {
+        return true;
+    }
+    if (it->second.read_closed) {
+        maybe_close(fd, &it->second);
+        return true;
+    }
+    on_readable(fd);
+    return true;
+}
+
+void DrainServer::accept_all() {
+    int c;
+    while ((c = accept4(listen_fd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        Conn& conn = conns_[c];
+        conn.serial = next_serial_++;
+        conn.pending = 0;
+        conn.bye_sent = false;
+        conn.want_write = false;
+        conn.read_closed = false;
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = c;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, c, &ev);
+        ++stats_.connections;
+        if (draining_) {
+            ++stats_.late_accepts;
+            maybe_bye(c, &conn);
+        }
+    }
+}
+
+void DrainServer::on_readable(int fd) {
+    Conn* c = &conns_[fd];
+    char buf[4096];
+    bool eof = false;
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            c->in.append(buf, n);
+            continue;
+        }
+        if (n == 0) {
+            eof = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN) {
+            break;
+        }
+        // 出错的连接回复也发不出去；已经交给工作线程的请求完成时发现连接不在了，只计数不回复
+        close_conn(fd);
+        return;
+    }
+    if (!process_lines(fd, c) || !eof) {
+        return;
+    }
+    // 对端半关闭：EOF 之前读到的请求还要回复，只是不再读；套接字一直可读，要把 EPOLLIN 摘掉
+    c->read_closed = true;
+    update_events(fd, *c);
+    maybe_close(fd, c);
+}
+
+bool DrainServer::process_lines(int fd, Conn* c) {
+    size_t pos = 0, end;
+    std::vector<Task> tasks;
+    while ((end = c->in.find('\n', pos)) != std::string::npos) {
+        std::string line = c->in.substr(pos, end - pos);
+        pos = end + 1;
+        char* rest = NULL;
+        uint64_t id = strtoull(line.c_str(), &rest, 10);
+        int64_t work_us = strtoll(rest, NULL, 10);
+        if (draining_) {
+            // 排空期间不再接受新请求，但要明确告诉客户端
+            ++stats_.rejected;
+            c->out += "reject " + std::to_string(id) + "\n";
+            continue;
+        }
+        Task t = {fd, c->serial, id, work_us};
+        tasks.push_back(t);
+        ++c->pending;
+        ++in_flight_;
+        ++stats_.requests;
+    }
+    c->in.erase(0, pos);
+    if (!tasks.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            queue_.insert(queue_.end(), tasks.begin(), tasks.end());
+        }
+        cv_.notify_all();
+    }
+    if (!c->out.empty()) {
+        return flush(fd, c);
+    }
+    return true;
+}
+
+void DrainServer::complete() {
+    std::vector<Task> done;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        done.swap(done_);
+    }
+    if (abandoned_) {
+        // abandon() 已经把它们计入 abandoned
+        return;
+    }
+    for (size_t i = 0; i < done.size(); ++i) {
+        const Task& t = done[i];
+        --in_flight_;
+        ++stats_.completed;
+        if (draining_) {
+            ++stats_.drained;
+        }
+        std::map<int, Conn>::iterator it = conns_.find(t.fd);
+        if (it == conns_.end() || it->second.serial != t.serial) {
+            continue;
+        }
+        Conn* c = &it->second;
+        --c->pending;
+        c->out += "ok " + std::to_string(t.id) + "\n";
+        if (flush(t.fd, c) && maybe_bye(t.fd, c)) {
+            maybe_close(t.fd, c);
+        }
+    }
+}
+
+bool DrainServer::maybe_bye(int fd, Conn* c) {
+    if (!draining_ || c->pending > 0 || c->bye_sent) {
+        return true;
+    }
+    c->bye_sent = true;
+    c->out += "bye\n";
+    return flush(fd, c);
+}
+
+bool DrainServer::flush(int fd, Conn* c) {
+    while (!c->out.empty()) {
+        ssize_t n = send(fd, c->out.data(), c->out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            close_conn(fd);
+            return false;
+        }
+        c->out.erase(0, n);
+    }
+    bool want = !c->out.empty();
+    if (want != c->want_write) {
+        c->want_write = want;
+        update_events(fd, *c);
+    }
+    return true;
+}
+
+bool DrainServer::maybe_close(int fd, Conn* c) {
+    if (!c->read_closed || c->pending > 0 || !c->out.empty()) {
+        return true;
+    }
+    close_conn(fd);
+    return false;
+}
+
+void DrainServer::update_events(int fd, const Conn& c) {
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (c.read_closed ? 0u : (uint32_t)EPOLLIN) | (c.want_write ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.fd = fd;
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void DrainServer::close_conn(int fd) {
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    conns_.erase(fd);
+}
+
+void DrainServer::pause_accept() {
+    if (listen_fd_ >= 0 && !accept_paused_ && epoll_ctl(epfd_, EPOLL_CTL_DEL, listen_fd_, NULL) == 0) {
+        accept_paused_ = true;
+    }
+}
+
+void DrainServer::resume_accept() {
+    if (listen_fd_ < 0 || !accept_paused_) {
+        return;
+    }
+    // 水平触发：队列里攒下的连接在下一轮 epoll_wait 就会被收进来
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, listen_fd_, &ev) == 0) {
+        accept_paused_ = false;
+    }
+}
+
+void DrainServer::begin_drain() {
+    if (draining_) {
+        return;
+    }
+    draining_ = true;
+    // 已经完成握手、还在监听队列里的连接先收进来，再关监听套接字，否则它们会被 RST
+    if (listen_fd_ >= 0) {
+        accept_all();
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, listen_fd_, NULL);
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    std::vector<int> fds;
+    for (std::map<int, Conn>::iterator it = conns_.begin(); it != conns_.end(); ++it) {
+        fds.push_back(it->first);
+    }
+    for (size_t i = 0; i < fds.size(); ++i) {
+        std::map<int, Conn>::iterator it = conns_.find(fds[i]);
+        if (it != conns_.end()) {
+            maybe_bye(fds[i], &it->second);
+        }
+    }
+}
+
+bool DrainServer::drained() const { return draining_ && in_flight_ == 0 && conns_.empty(); }
+
+void DrainServer::abandon() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        queue_.clear();
+        done_.clear();
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    stats_.abandoned += in_flight_;
+    in_flight_ = 0;
+    abandoned_ = true;
+    while (!conns_.empty()) {
+        close_conn(conns_.begin()->first);
+    }
+}
+
+void DrainServer::worker_loop() {
+    for (;;) {
+        Task t;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            t = queue_.front();
+            queue_.pop_front();
+        }
+        if (t.work_us > 0) {
+            usleep((useconds_t)t.work_us);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            done_.push_back(t);
+        }
+        uint64_t one = 1;
+        ssize_t n = write(done_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
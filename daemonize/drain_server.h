@@ -0,0 +1,135 @@
+#ifndef DAEMONIZE_DRAIN_SERVER_H
+#define DAEMONIZE_DRAIN_SERVER_H
+
+/**
+ * 守护进程里的请求服务，支持 SIGTERM 时的优雅排空
+ *
+ * 协议是文本行：客户端发 "<id> <work_us>\n"，服务端交给工作线程睡 work_us 微秒（模拟处理），
+ * 完成后回 "ok <id>\n"。和 Scheduler/SignalFd 一样挂在主循环上：init(epfd) 注册，handle(fd) 处理。
+ *
+ * 排空（begin_drain）：
+ *  1. 先把监听队列里已经完成握手的连接全部 accept 进来，再关掉监听套接字：
+ *     客户端眼里已经连上的连接不会被内核 RST 掉，之后的新连接直接被拒绝
+ *  2. 已经读到的请求照常执行并回复；连接上没有未完成的请求时发一行 "bye\n"，
+ *     之后再读到的请求回 "reject <id>\n"（明确拒绝，不会石沉大海），等客户端关闭连接
+ *  3. 所有请求完成、所有连接关闭后 drained() 为真
+ * 客户端半关闭（shutdown(SHUT_WR)）时只停止读：已经读到的请求照常执行，回复全部发完后再关闭连接。
+ * 截止时间到了还没排空就 abandon()：丢掉队列里还没开始的请求，关闭所有连接，
+ * 这些请求和正在执行的请求都计入 abandoned。
+ *
+ * 除工作线程内部外，所有接口只能在主循环线程调用。
+ */
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DrainStats {
+    uint64_t connections;  // accept 的连接数（含排空开始时从监听队列里取出的）
+    uint64_t requests;     // 读到并接受的请求
+    uint64_t completed;    // 回复了 ok 的请求
+    uint64_t drained;      // 其中在排空开始时已经接受、排空期间完成的
+    uint64_t rejected;     // 排空期间读到、回复了 reject 的请求
+    uint64_t abandoned;    // 截止时间到时还没完成的请求
+    uint64_t late_accepts; // 排空开始时从监听队列里取出的连接
+
+    DrainStats()
+        : connections(0), requests(0), completed(0), drained(0), rejected(0), abandoned(0), late_accepts(0) {}
+};
+
+class DrainServer {
+public:
+    explicit DrainServer(int workers = 4);
+    ~DrainServer();
+
+    /** 创建监听套接字；port 为 0 时由内核分配，之后用 port() 取。失败返回 -1 */
+    int listen(const std::string& host, int port, int backlog = 1024);
+    int port() const { return port_; }
+
+    /** 注册监听套接字和完成通知的 eventfd 并启动工作线程 */
+    int init(int epfd);
+
+    /** 主循环拿到的 fd 属于本服务时处理它并返回 true */
+    bool handle(int fd);
+
+    /**
+     * 暂停 accept，新连接留在监听队列里（最多 backlog 个），resume_accept 或 begin_drain 时再收进来。
+     * 给压力测试制造排空时监听队列非空的情况用
+     */
+    void pause_accept();
+    void resume_accept();
+    bool accept_paused() const { return accept_paused_; }
+
+    void begin_drain();
+    bool draining() const { return draining_; }
+
+    /** 排空开始后，所有请求都已完成、所有连接都已关闭 */
+    bool drained() const;
+
+    /** 当前已接受但还没回复的请求数 */
+    size_t in_flight() const { return in_flight_; }
+
+    /** 截止时间到：放弃剩下的请求并关闭所有连接，工作线程跑完手上的请求后退出 */
+    void abandon();
+
+    const DrainStats& stats() const { return stats_; }
+
+private:
+    DrainServer(const DrainServer&);
+    DrainServer& operator=(const DrainServer&);
+
+    struct Conn {
+        uint64_t serial;    // 区分复用的 fd
+        std::string in;
+        std::string out;
+        int pending;        // 已接受还没回复的请求数
+        bool bye_sent;
+        bool want_write;
+        bool read_closed;   // 对端已经半关闭，不再读；回复发完就关闭
+    };
+
+    struct Task {
+        int fd;
+        uint64_t serial;
+        uint64_t id;
+        int64_t work_us;
+    };
+
+    void accept_all();
+    void on_readable(int fd);
+    bool process_lines(int fd, Conn* c);
+    void complete();
+    bool maybe_bye(int fd, Conn* c);
+    bool flush(int fd, Conn* c);
+    bool maybe_close(int fd, Conn* c);
+    void update_events(int fd, const Conn& c);
+    void close_conn(int fd);
+    void worker_loop();
+
+    int epfd_;
+    int listen_fd_;
+    int done_fd_;
+    int port_;
+    int nworkers_;
+    bool draining_;
+    bool accept_paused_;
+    bool abandoned_;
+    uint64_t next_serial_;
+    size_t in_flight_;
+    std::map<int, Conn> conns_;
+    DrainStats stats_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Task> queue_;
+    std::vector<Task> done_;
+    bool stopping_;
+};
+
+#endif  // DAEMONIZE_DRAIN_SERVER_H
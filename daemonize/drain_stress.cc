@@ -0,0 +1,348 @@
+/**
+ * SIGTERM 优雅排空的压力测试：daemonize_demo 在持续负载下收到 SIGTERM，检查已接受的请求一个不丢
+ *
+ * 用法: drain_stress [-c conns] [-w work_us] [-d seconds] [-W server_workers]
+ *
+ * 服务端是同目录下的 daemonize_demo（-f -p 0），由本程序 fork + exec 启动，从它的 stdout 读端口和排空结果。
+ * 客户端在一个 epoll 里维护 conns 条闭环连接，每条连接发 "<id> <work_us>" 等回复；
+ * 每 10 个请求关掉重连一次，第 10 个请求发出后就半关闭（shutdown(SHUT_WR)），服务端要把回复发完再关。
+ * 服务端带 -T 启动，SIGTERM 之前先发 SIGUSR2 让它暂停 accept（监听队列只有 64），再连上 8 条发完请求就半关闭的连接，
+ * 保证排空开始时监听队列里有刚完成握手的连接。
+ *
+ * 两轮：
+ *   graceful  截止时间 10s，远大于排队时间。要求：
+ *             客户端没有丢失的请求（发出后连接断开却没收到 ok/reject），late_accepts 至少是 8，
+ *             客户端收到的 ok 数 = 服务端接受的请求数 = 服务端完成数，abandoned = 0
+ *   deadline  截止时间 50ms，请求耗时 200ms，来不及排空。要求：
+ *             abandoned > 0，late_accepts 至少是 8，且服务端 requests = completed + abandoned（每个接受的请求都有去处）
+ * 全部通过退出码为 0。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+static const int kLateConns = 8;
+static const int kBacklog = 64;
+
+static int64_t now_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static std::string sibling_path(const char* name) {
+    char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0) {
+        return name;
+    }
+    exe[n] = '\0';
+    std::string dir(exe);
+    return dir.substr(0, dir.rfind('/') + 1) + name;
+}
+
+struct ClientStats {
+    uint64_t sent;
+    uint64_t ok;
+    uint64_t rejected;
+    uint64_t lost;     // 发出后连接断开，没收到回复
+    uint64_t refused;  // SIGTERM 之后重连被拒绝
+    uint64_t connects;
+
+    ClientStats() : sent(0), ok(0), rejected(0), lost(0), refused(0), connects(0) {}
+};
+
+struct Client {
+    int fd;
+    uint64_t outstanding;  // 0 表示没有未回复的请求
+    int served;            // 这条连接上收到的回复数，到 10 就重连
+    bool bye;
+    bool shut;             // 已经半关闭，收到回复后不再发
+    std::string in;
+};
+
+class LoadRunner {
+public:
+    LoadRunner(int port, int work_us) : port_(port), work_us_(work_us), next_id_(1), stopping_(false) {
+        ep_ = epoll_create1(EPOLL_CLOEXEC);
+    }
+    ~LoadRunner() { close(ep_); }
+
+    void open(Client* c) {
+        c->fd = -1;
+        c->outstanding = 0;
+        c->served = 0;
+        c->bye = false;
+        c->shut = false;
+        c->in.clear();
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port_);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            ++stats_.refused;
+            return;
+        }
+        ++stats_.connects;
+        c->fd = fd;
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev);
+        send_next(c);
+    }
+
+    void send_next(Client* c) {
+        c->outstanding = next_id_++;
+        std::string line = std::to_string(c->outstanding) + " " + std::to_string(work_us_) + "\n";
+        // 请求很小，阻塞套接字一次就能写完；对端已经关闭时算在 lost 里
+        send(c->fd, line.data(), line.size(), MSG_NOSIGNAL);
+        ++stats_.sent;
+        if (c->served == 9) {
+            half_close(c);
+        }
+    }
+
+    /** 请求发完就半关闭：服务端读到 EOF 后还要把回复发回来 */
+    void half_close(Client* c) {
+        shutdown(c->fd, SHUT_WR);
+        c->shut = true;
+    }
+
+    void drop(Client* c) {
+        epoll_ctl(ep_, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+    }
+
+    /** 处理一条连接上到达的数据，返回 false 表示连接已关闭 */
+    bool on_readable(Client* c) {
+        char buf[4096];
+        ssize_t n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return true;
+        }
+        if (n <= 0) {
+            if (c->outstanding != 0) {
+                ++stats_.lost;
+            }
+            drop(c);
+            return false;
+        }
+        c->in.append(buf, n);
+        size_t pos = 0, end;
+        while ((end = c->in.find('\n', pos)) != std::string::npos) {
+            std::string line = c->in.substr(pos, end - pos);
+            pos = end + 1;
+            if (line == "bye") {
+                c->bye = true;
+            } else if (line.compare(0, 3, "ok ") == 0) {
+                ++stats_.ok;
+                c->outstanding = 0;
+                ++c->served;
+            } else if (line.compare(0, 7, "reject ") == 0) {
+                ++stats_.rejected;
+                c->outstanding = 0;
+            }
+        }
+        c->in.erase(0, pos);
+        if (c->outstanding != 0) {
+            return true;
+        }
+        if (c->bye) {
+            drop(c);
+            return false;
+        }
+        if (c->served >= 10 || c->shut) {
+            drop(c);
+            if (!stopping_) {
+                open(c);
+            }
+            return c->fd >= 0;
+        }
+        send_next(c);
+        return true;
+    }
+
+    /** 跑到 until_ms，或者 stop 之后所有连接都关闭 */
+    void run(std::vector<Client>& clients, int64_t until_ms) {
+        epoll_event events[256];
+        while (now_ms() < until_ms) {
+            int n = epoll_wait(ep_, events, 256, 10);
+            for (int i = 0; i < n; ++i) {
+                on_readable(static_cast<Client*>(events[i].data.ptr));
+            }
+            if (stopping_) {
+                bool any = false;
+                for (size_t i = 0; i < clients.size(); ++i) {
+                    any |= clients[i].fd >= 0;
+                }
+                if (!any) {
+                    return;
+                }
+            }
+        }
+    }
+
+    void stop() { stopping_ = true; }
+    const ClientStats& stats() const { return stats_; }
+
+private:
+    int ep_;
+    int port_;
+    int work_us_;
+    uint64_t next_id_;
+    bool stopping_;
+    ClientStats stats_;
+};
+
+struct ServerDrain {
+    unsigned long long connections, late_accepts, requests, completed, drained, rejected, abandoned;
+};
+
+static bool run_round(const char* name, const std::string& server, int conns, int work_us, int seconds,
+                      int workers, int grace_ms, bool expect_abandon) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        std::string g = std::to_string(grace_ms), w = std::to_string(workers);
+        std::string b = std::to_string(kBacklog);
+        execl(server.c_str(), server.c_str(), "-f", "-l", "/dev/null", "-p", "0", "-T", "-b", b.c_str(), "-g",
+              g.c_str(), "-w", w.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    FILE* out = fdopen(pipefd[0], "r");
+    char line[512];
+    int port = 0;
+    if (fgets(line, sizeof(line), out) == NULL || sscanf(line, "listening on 127.0.0.1:%d", &port) != 1) {
+        fprintf(stderr, "%s: 服务端没有启动\n", name);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return false;
+    }
+
+    LoadRunner load(port, work_us);
+    // 后面 kLateConns 个在暂停 accept 之后才连；epoll 里存的是指针，vector 不能再扩容
+    std::vector<Client> clients(conns + kLateConns);
+    for (int i = 0; i < conns + kLateConns; ++i) {
+        clients[i].fd = -1;
+    }
+    for (int i = 0; i < conns; ++i) {
+        load.open(&clients[i]);
+    }
+    load.run(clients, now_ms() + seconds * 1000);
+    kill(pid, SIGUSR2);
+    bool paused = false;
+    while (!paused && fgets(line, sizeof(line), out) != NULL) {
+        paused = strcmp(line, "accept paused\n") == 0;
+    }
+    if (!paused) {
+        fprintf(stderr, "%s: 服务端没有暂停 accept\n", name);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        fclose(out);
+        return false;
+    }
+    // 监听队列还有空位，connect 在握手完成后就返回，连接留在队列里等 begin_drain
+    for (int i = conns; i < conns + kLateConns; ++i) {
+        load.open(&clients[i]);
+        if (clients[i].fd >= 0) {
+            load.half_close(&clients[i]);
+        }
+    }
+    int64_t term_at = now_ms();
+    kill(pid, SIGTERM);
+    // SIGTERM 之后还有 100ms 继续重连，打到正在关闭的监听套接字上
+    load.run(clients, term_at + 100);
+    load.stop();
+    load.run(clients, term_at + grace_ms + 5000);
+    int64_t client_done = now_ms() - term_at;
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    int64_t server_done = now_ms() - term_at;
+    ServerDrain sd;
+    memset(&sd, 0, sizeof(sd));
+    bool found = false;
+    while (fgets(line, sizeof(line), out) != NULL) {
+        if (sscanf(line,
+                   "drain: connections=%llu late_accepts=%llu requests=%llu completed=%llu drained=%llu "
+                   "rejected=%llu abandoned=%llu",
+                   &sd.connections, &sd.late_accepts, &sd.requests, &sd.completed, &sd.drained, &sd.rejected,
+                   &sd.abandoned) == 7) {
+            found = true;
+        }
+    }
+    fclose(out);
+
+    const ClientStats& cs = load.stats();
+    printf("%s: 截止 %d ms, 请求耗时 %d us, %d 连接, SIGTERM 后客户端 %lld ms 收尾、服务端 %lld ms 退出\n", name,
+           grace_ms, work_us, conns, (long long)client_done, (long long)server_done);
+    printf("  客户端: connects %llu sent %llu ok %llu reject %llu lost %llu refused %llu\n",
+           (unsigned long long)cs.connects, (unsigned long long)cs.sent, (unsigned long long)cs.ok,
+           (unsigned long long)cs.rejected, (unsigned long long)cs.lost, (unsigned long long)cs.refused);
+    printf("  服务端: connections %llu late_accepts %llu requests %llu completed %llu drained %llu rejected %llu "
+           "abandoned %llu, 退出码 %d\n",
+           sd.connections, sd.late_accepts, sd.requests, sd.completed, sd.drained, sd.rejected, sd.abandoned,
+           WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    bool ok = found && WIFEXITED(status) && WEXITSTATUS(status) == 0 && sd.requests == sd.completed + sd.abandoned &&
+              sd.late_accepts >= (unsigned long long)kLateConns;
+    if (expect_abandon) {
+        ok &= sd.abandoned > 0;
+    } else {
+        ok &= cs.lost == 0 && sd.abandoned == 0 && cs.ok == sd.requests && cs.rejected == sd.rejected;
+    }
+    printf("  %s\n", ok ? "PASS" : "FAIL");
+    fflush(stdout);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int conns = 64;
+    int work_us = 2000;
+    int seconds = 2;
+    int workers = 4;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:w:d:W:")) != -1) {
+        switch (opt) {
+            case 'c': conns = atoi(optarg); break;
+            case 'w': work_us = atoi(optarg); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'W': workers = atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-c conns] [-w work_us] [-d seconds] [-W server_workers]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (conns < 1 || seconds < 1) {
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    std::string server = sibling_path("daemonize_demo");
+    bool ok = run_round("graceful", server, conns, work_us, seconds, workers, 10000, false);
+    ok &= run_round("deadline", server, conns, 200000, 1, workers, 50, true);
+    return ok ? 0 : 1;
+}
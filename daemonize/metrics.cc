@@ -0,0 +1,277 @@
+#include "metrics.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <new>
+
+static size_t align_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+static size_t slot_size(size_t counters, size_t histograms) {
+    return align_up(sizeof(MetricsSlotHeader) + 8 * counters + 8 * histograms * (kMetricsHistBuckets + 2), 64);
+}
+
+Metrics::Metrics(const std::vector<std::string>& counters, const std::vector<std::string>& histograms,
+                 int max_threads)
+    : counters_(counters),
+      histograms_(histograms),
+      max_threads_(max_threads > 0 ? max_threads : 1),
+      fd_(-1),
+      unlink_(false),
+      base_(NULL),
+      size_(0),
+      header_(NULL) {}
+
+Metrics::~Metrics() {
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        delete threads_[i];
+    }
+    if (base_ != NULL) {
+        munmap(base_, size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    if (unlink_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+int Metrics::create(const std::string& name) {
+    size_t names_offset = align_up(sizeof(MetricsHeader), 64);
+    size_t slots_offset = align_up(names_offset + kMetricsNameLen * (counters_.size() + histograms_.size()), 64);
+    size_t slot = slot_size(counters_.size(), histograms_.size());
+    size_ = slots_offset + slot * max_threads_;
+
+    name_ = name;
+    if (!name.empty() && name[0] == '/') {
+        // 上次异常退出留下的同名段直接覆盖：读者按 pid 和 created_ns 区分
+        fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        unlink_ = fd_ >= 0;
+        path_ = "/dev/shm" + name;
+    } else {
+        fd_ = memfd_create(name.c_str(), MFD_CLOEXEC);
+        path_ = "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(fd_);
+    }
+    if (fd_ < 0 || ftruncate(fd_, (off_t)size_) < 0) {
+        return -1;
+    }
+    void* p = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+    base_ = static_cast<char*>(p);
+
+    // ftruncate 出来的内存全是 0，只需要填头部和名字表
+    header_ = new (base_) MetricsHeader();
+    header_->magic = kMetricsMagic;
+    header_->version_major = kMetricsVersionMajor;
+    header_->version_minor = kMetricsVersionMinor;
+    header_->header_size = sizeof(MetricsHeader);
+    header_->name_len = kMetricsNameLen;
+    header_->counters = (uint32_t)counters_.size();
+    header_->histograms = (uint32_t)histograms_.size();
+    header_->hist_buckets = kMetricsHistBuckets;
+    header_->max_slots = (uint32_t)max_threads_;
+    header_->slot_size = (uint32_t)slot;
+    header_->names_offset = names_offset;
+    header_->slots_offset = slots_offset;
+    header_->total_size = size_;
+    header_->pid = getpid();
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    header_->created_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    char* names = base_ + names_offset;
+    for (size_t i = 0; i < counters_.size() + histograms_.size(); ++i) {
+        const std::string& n = i < counters_.size() ? counters_[i] : histograms_[i - counters_.size()];
+        strncpy(names + i * kMetricsNameLen, n.c_str(), kMetricsNameLen - 1);
+    }
+    header_->ready.store(1, std::memory_order_release);
+    return 0;
+}
+
+MetricsThread* Metrics::attach(const char* name) {
+    if (header_ == NULL) {
+        return NULL;
+    }
+    uint32_t i = header_->slots_used.load(std::memory_order_relaxed);
+    do {
+        if (i >= header_->max_slots) {
+            return NULL;
+        }
+    } while (!header_->slots_used.compare_exchange_weak(i, i + 1, std::memory_order_relaxed));
+
+    // 读者可能看到一个已经分配、名字还没填好的槽，计数全是 0，不影响求和
+    char* base = base_ + header_->slots_offset + (size_t)i * header_->slot_size;
+    MetricsSlotHeader* sh = reinterpret_cast<MetricsSlotHeader*>(base);
+    sh->tid = (int32_t)syscall(SYS_gettid);
+    strncpy(sh->name, name, sizeof(sh->name) - 1);
+
+    MetricsThread* t = new MetricsThread();
+    t->seq_ = &sh->seq;
+    t->local_seq_ = 0;
+    t->counters_ = reinterpret_cast<std::atomic<uint64_t>*>(base + sizeof(MetricsSlotHeader));
+    t->hist_ = t->counters_ + counters_.size();
+    // attach 可能在多个线程上同时发生，句柄表只在析构时用
+    std::lock_guard<std::mutex> lock(mu_);
+    threads_.push_back(t);
+    return t;
+}
+
+MetricsThread* Metrics::local() {
+    static thread_local MetricsThread* t = NULL;
+    if (t == NULL) {
+        char name[16] = {0};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        t = attach(name);
+    }
+    return t;
+}
+
+uint64_t MetricsHistogram::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(count * p / 100.0);
+    if (target >= count) {
+        target = count - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen > target) {
+            return i == 0 ? 0 : i >= 63 ? UINT64_MAX : (1ULL << i) - 1;
+        }
+    }
+    return UINT64_MAX;
+}
+
+MetricsReader::MetricsReader() : base_(NULL), size_(0), header_(NULL) {}
+
+MetricsReader::~MetricsReader() {
+    if (base_ != NULL) {
+        munmap(const_cast<char*>(base_), size_);
+    }
+}
+
+int MetricsReader::open(const std::string& path, std::string* err) {
+    bool shm = !path.empty() && path[0] == '/' && path.find('/', 1) == std::string::npos;
+    int fd = shm ? shm_open(path.c_str(), O_RDONLY | O_CLOEXEC, 0) : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *err = path + ": " + strerror(errno);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(MetricsHeader)) {
+        *err = path + ": 不是指标段（太小）";
+        close(fd);
+        return -1;
+    }
+    // 只读映射：读者不可能写坏写者的数据
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        *err = path + ": mmap: " + strerror(errno);
+        return -1;
+    }
+    base_ = static_cast<const char*>(p);
+    size_ = st.st_size;
+    header_ = reinterpret_cast<const MetricsHeader*>(base_);
+
+    const MetricsHeader& h = *header_;
+    if (h.magic != kMetricsMagic || h.ready.load(std::memory_order_acquire) != 1) {
+        *err = path + ": 不是指标段或者还没初始化完";
+        return -1;
+    }
+    if (h.version_major != kMetricsVersionMajor) {
+        *err = path + ": 布局主版本 " + std::to_string(h.version_major) + "，这个读者只认 " +
+               std::to_string(kMetricsVersionMajor);
+        return -1;
+    }
+    // 次版本号更高的段只会在末尾多出字段，按头部里的偏移和大小寻址就能读
+    size_t need_slot = sizeof(MetricsSlotHeader) + 8 * (size_t)h.counters +
+                       8 * (size_t)h.histograms * (h.hist_buckets + 2);
+    if (h.hist_buckets != kMetricsHistBuckets || h.slot_size < need_slot || h.total_size > size_ ||
+        h.names_offset + (uint64_t)h.name_len * (h.counters + h.histograms) > h.slots_offset ||
+        h.slots_offset + (uint64_t)h.slot_size * h.max_slots > h.total_size) {
+        *err = path + ": 头部里的大小不一致";
+        return -1;
+    }
+    return 0;
+}
+
+void MetricsReader::snapshot(MetricsSnapshot* out) const {
+    const int kMaxAttempts = 100000;
+    const MetricsHeader& h = *header_;
+    size_t nc = h.counters, nh = h.histograms;
+    out->counter_names.clear();
+    out->histogram_names.clear();
+    for (size_t i = 0; i < nc + nh; ++i) {
+        const char* n = base_ + h.names_offset + i * h.name_len;
+        std::string name(n, strnlen(n, h.name_len));
+        (i < nc ? out->counter_names : out->histogram_names).push_back(name);
+    }
+    out->counters.assign(nc, 0);
+    out->histograms.assign(nh, MetricsHistogram());
+    out->thread_names.clear();
+    out->thread_ids.clear();
+    out->thread_counters.clear();
+    out->retries = 0;
+    out->torn = 0;
+
+    uint32_t used = h.slots_used.load(std::memory_order_acquire);
+    if (used > h.max_slots) {
+        used = h.max_slots;
+    }
+    size_t nvals = nc + nh * (h.hist_buckets + 2);
+    std::vector<uint64_t> vals(nvals);
+    for (uint32_t s = 0; s < used; ++s) {
+        const char* base = base_ + h.slots_offset + (size_t)s * h.slot_size;
+        const MetricsSlotHeader* sh = reinterpret_cast<const MetricsSlotHeader*>(base);
+        const std::atomic<uint64_t>* src = reinterpret_cast<const std::atomic<uint64_t>*>(base + sizeof(*sh));
+        for (int attempt = 1;; ++attempt) {
+            // seq 是奇数时也要拷一遍：放弃重读时用的是这个槽自己最后一次的值，而不是 vals 里上一个槽的
+            uint32_t s1 = sh->seq.load(std::memory_order_acquire);
+            for (size_t i = 0; i < nvals; ++i) {
+                vals[i] = src[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((s1 & 1) == 0 && sh->seq.load(std::memory_order_relaxed) == s1) {
+                break;
+            }
+            ++out->retries;
+            if (attempt >= kMaxAttempts) {
+                // 写者在更新中途死掉了（seq 停在奇数），用这个槽最后一次读到的值；
+                // 单个计数器的读写不会被拆开，不一致的只有写者死掉时正在改的那一组
+                ++out->torn;
+                break;
+            }
+            if (attempt % 64 == 0) {
+                sched_yield();  // 写者可能在更新中途被切走，CPU 少的时候让它先跑完
+            }
+        }
+        out->thread_names.push_back(std::string(sh->name, strnlen(sh->name, sizeof(sh->name))));
+        out->thread_ids.push_back(sh->tid);
+        out->thread_counters.push_back(std::vector<uint64_t>(vals.begin(), vals.begin() + nc));
+        for (size_t i = 0; i < nc; ++i) {
+            out->counters[i] += vals[i];
+        }
+        for (size_t j = 0; j < nh; ++j) {
+            const uint64_t* v = &vals[nc + j * (h.hist_buckets + 2)];
+            MetricsHistogram& mh = out->histograms[j];
+            mh.count += v[0];
+            mh.sum += v[1];
+            for (uint32_t b = 0; b < h.hist_buckets; ++b) {
+                mh.buckets[b] += v[2 + b];
+            }
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#ifndef DAEMONIZE_METRICS_H
+#define DAEMONIZE_METRICS_H
+
+/**
+ * 放在共享内存里的指标：守护进程只管往自己的内存里加数，外部工具 mmap 同一段内存直接读，
+ * 抓取不需要守护进程配合，也不经过任何系统调用
+ *
+ *  - 段的来源二选一：名字以 '/' 开头用 shm_open（/dev/shm 下可见，进程退出时 unlink），
+ *    否则用 memfd_create，外部工具通过 /proc/<pid>/fd/<fd> 打开（path() 给出完整路径）
+ *  - 布局带版本号：头部记录各区的偏移和大小，读者按头部里的值而不是自己编译进去的结构体大小寻址；
+ *    主版本号不同就拒绝读，次版本号只在末尾追加字段
+ *      [MetricsHeader][名字表: 计数器名..., 直方图名...][线程槽 0][线程槽 1]...
+ *  - 每个写线程一个线程槽，按缓存行对齐，计数器和直方图都在自己的槽里，线程之间没有共享写：
+ *    加一次计数是一次普通的 load + store，不需要 lock 前缀的原子指令
+ *  - 每个槽一个序列锁（seqlock）：写之前 seq 变奇数，写完变偶数；读者看到奇数或前后 seq 不一致就重读，
+ *    所以直方图的 count/sum/桶总是同一时刻的值。写者从不等待读者
+ *  - 直方图是 64 个 log2 桶：值 v 落在第 64 - clz(v) 个桶里（0 在第 0 个桶，>= 2^62 都在最后一个桶），
+ *    另记 count 和 sum
+ *  - 线程槽只分配不回收，线程数上限在构造时给定
+ *
+ * 写线程先 attach() 或 local() 拿到自己的 MetricsThread，之后只在这个线程上调用它的方法。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static const uint32_t kMetricsMagic = 0x4d545253;  // "MTRS"
+static const uint16_t kMetricsVersionMajor = 1;
+static const uint16_t kMetricsVersionMinor = 0;
+static const int kMetricsNameLen = 48;
+static const int kMetricsHistBuckets = 64;
+
+/** 段头部，写者在段初始化完成后才把 ready 置 1 */
+struct MetricsHeader {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint32_t header_size;
+    uint32_t name_len;
+    uint32_t counters;
+    uint32_t histograms;
+    uint32_t hist_buckets;
+    uint32_t max_slots;
+    uint32_t slot_size;
+    uint32_t reserved;
+    uint64_t names_offset;
+    uint64_t slots_offset;
+    uint64_t total_size;
+    int64_t pid;
+    int64_t created_ns;  // CLOCK_REALTIME
+    std::atomic<uint32_t> slots_used;
+    std::atomic<uint32_t> ready;
+};
+
+/** 线程槽的开头，计数器从 sizeof(MetricsSlotHeader) 开始，随后是各直方图的 count, sum, 桶 */
+struct MetricsSlotHeader {
+    std::atomic<uint32_t> seq;
+    int32_t tid;
+    char name[24];
+};
+
+class Metrics;
+
+/** 一个写线程的句柄，只能在 attach 它的线程上使用 */
+class MetricsThread {
+public:
+    void add(int counter, uint64_t n = 1) {
+        begin();
+        bump(&counters_[counter], n);
+        end();
+    }
+
+    void record(int histogram, uint64_t value) {
+        std::atomic<uint64_t>* h = hist_ + (size_t)histogram * (kMetricsHistBuckets + 2);
+        begin();
+        bump(&h[0], 1);
+        bump(&h[1], value);
+        bump(&h[2 + bucket_of(value)], 1);
+        end();
+    }
+
+    /** 第 i 个桶（1 <= i < 63）是 [2^(i-1), 2^i)，最后一个桶收下所有 >= 2^62 的值 */
+    static int bucket_of(uint64_t v) { return v == 0 ? 0 : (v >> 62) != 0 ? 63 : 64 - __builtin_clzll(v); }
+
+private:
+    friend class Metrics;
+
+    // 只有本线程写这个槽，读-改-写不需要原子指令；用 atomic 的 relaxed 读写只是为了不被拆开
+    static void bump(std::atomic<uint64_t>* v, uint64_t n) {
+        v->store(v->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    void begin() {
+        seq_->store(++local_seq_, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void end() { seq_->store(++local_seq_, std::memory_order_release); }
+
+    std::atomic<uint32_t>* seq_;
+    uint32_t local_seq_;
+    std::atomic<uint64_t>* counters_;
+    std::atomic<uint64_t>* hist_;
+};
+
+class Metrics {
+public:
+    /** 指标的名字在构造时定下来，之后按下标访问 */
+    Metrics(const std::vector<std::string>& counters, const std::vector<std::string>& histograms,
+            int max_threads = 64);
+    ~Metrics();
+
+    /** 创建并映射共享内存段；失败返回 -1 */
+    int create(const std::string& name);
+
+    /** 外部工具打开这个段用的路径 */
+    const std::string& path() const { return path_; }
+
+    /** 为当前线程分配一个槽，name 会截断到 23 字节；槽用完时返回 NULL */
+    MetricsThread* attach(const char* name);
+
+    /** 当前线程的槽，第一次调用时用线程名 attach；一个进程里只应有一个 Metrics 用这个接口 */
+    MetricsThread* local();
+
+    int counter_count() const { return (int)counters_.size(); }
+    int histogram_count() const { return (int)histograms_.size(); }
+
+private:
+    Metrics(const Metrics&);
+    Metrics& operator=(const Metrics&);
+
+    std::vector<std::string> counters_;
+    std::vector<std::string> histograms_;
+    int max_threads_;
+    int fd_;
+    bool unlink_;
+    std::string name_;
+    std::string path_;
+    char* base_;
+    size_t size_;
+    MetricsHeader* header_;
+    std::mutex mu_;
+    std::vector<MetricsThread*> threads_;
+};
+
+struct MetricsHistogram {
+    uint64_t count;
+    uint64_t sum;
+    std::vector<uint64_t> buckets;
+
+    MetricsHistogram() : count(0), sum(0), buckets(kMetricsHistBuckets, 0) {}
+
+    /** 按桶估算的百分位，取桶的上界 */
+    uint64_t percentile(double p) const;
+};
+
+/** 一次读到的一致快照：每个槽内部是同一时刻的值，各槽之间不要求同一时刻 */
+struct MetricsSnapshot {
+    std::vector<std::string> counter_names;
+    std::vector<std::string> histogram_names;
+    std::vector<uint64_t> counters;           // 所有线程槽的和
+    std::vector<MetricsHistogram> histograms;
+    std::vector<std::string> thread_names;
+    std::vector<int> thread_ids;
+    std::vector<std::vector<uint64_t>> thread_counters;  // 按槽分开的计数器
+    uint64_t retries;  // 读到写到一半的槽而重读的次数
+    uint64_t torn;     // 重读太多次放弃的槽（写者在更新中途退出），这些槽的值可能不一致
+};
+
+class MetricsReader {
+public:
+    MetricsReader();
+    ~MetricsReader();
+
+    /** 打开 Metrics::path() 给出的路径，或者 shm_open 的名字（以 '/' 开头且不含别的 '/'）；失败时 err 里是原因 */
+    int open(const std::string& path, std::string* err);
+
+    int64_t pid() const { return header_->pid; }
+    int64_t created_ns() const { return header_->created_ns; }
+    uint16_t version_minor() const { return header_->version_minor; }
+
+    void snapshot(MetricsSnapshot* out) const;
+
+private:
+    MetricsReader(const MetricsReader&);
+    MetricsReader& operator=(const MetricsReader&);
+
+    const char* base_;
+    size_t size_;
+    const MetricsHeader* header_;
+};
+
+#endif  // DAEMONIZE_METRICS_H
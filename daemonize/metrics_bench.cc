@@ -0,0 +1,217 @@
+/**
+ * 计数器自增的开销：1 到 64 个线程同时加，比较几种做法
+ *
+ * 用法: metrics_bench [-t max_threads] [-n ops_per_thread] [-s scrape_us]
+ *
+ *   atomic    所有线程对同一个 std::atomic 做 fetch_add：一条缓存行在核之间来回搬
+ *   padded    每线程一个独占缓存行的 atomic，fetch_add（lock 前缀，但没有共享）
+ *   metrics   Metrics 的线程槽：普通 load + store，外加序列锁的两次 store
+ *   +scrape   同 metrics，另有一个线程每 scrape_us 用 MetricsReader 读一次快照，看抓取对写者的影响
+ *   hist      MetricsThread::record()：count、sum、桶三次加，一次序列锁
+ *
+ * ns/op 是所有线程的 CPU 时间之和除以总次数（线程数超过 CPU 数时墙钟时间会被排队放大，CPU 时间不会）；
+ * Mops/s 是总次数除以墙钟时间。metrics 和 hist 两种做法最后从共享内存读回总数核对，不一致退出码为 1。
+ *
+ * 开始前先检查写者死在更新中途的情况：把第二个槽的 seq 改成奇数，快照要把它记为 torn，
+ * 并且这个槽用的是它自己的值（不能把前一个槽的值再加一遍）。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+static int64_t clock_ns(clockid_t id) {
+    timespec ts;
+    clock_gettime(id, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct alignas(64) PaddedCounter {
+    std::atomic<uint64_t> v;
+};
+
+enum Mode { kAtomic, kPadded, kMetrics, kScrape, kHist };
+static const char* kModeNames[] = {"atomic", "padded", "metrics", "+scrape", "hist"};
+
+struct Result {
+    double ns_per_op;
+    double mops;
+    uint64_t scrapes;
+    uint64_t retries;
+    bool ok;
+};
+
+/** 两个槽：a 加 5 次并记一个直方图值，b 加 7 次；从外面把 b 的 seq 改成奇数，模拟 b 的写者在更新中途退出 */
+static bool check_torn_slot() {
+    Metrics metrics({"ops"}, {"value"}, 2);
+    if (metrics.create("metrics_bench_torn") < 0) {
+        return false;
+    }
+    MetricsThread* a = metrics.attach("a");
+    a->add(0, 5);
+    a->record(0, 100);
+    metrics.attach("b")->add(0, 7);
+
+    int fd = open(metrics.path().c_str(), O_RDWR | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        return false;
+    }
+    char* base = (char*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    const MetricsHeader* h = reinterpret_cast<const MetricsHeader*>(base);
+    MetricsSlotHeader* b = reinterpret_cast<MetricsSlotHeader*>(base + h->slots_offset + h->slot_size);
+    b->seq.fetch_add(1);
+
+    MetricsReader reader;
+    std::string err;
+    MetricsSnapshot snap;
+    bool ok = reader.open(metrics.path(), &err) == 0;
+    if (ok) {
+        reader.snapshot(&snap);
+        ok = snap.torn == 1 && snap.counters[0] == 12 && snap.histograms[0].count == 1 &&
+             snap.thread_counters.size() == 2 && snap.thread_counters[1][0] == 7;
+        printf("写者死在更新中途: torn %llu, ops %llu（应为 12）, value.count %llu（应为 1）, %s\n",
+               (unsigned long long)snap.torn, (unsigned long long)snap.counters[0],
+               (unsigned long long)snap.histograms[0].count, ok ? "ok" : "FAIL");
+    } else {
+        fprintf(stderr, "打开 %s 失败: %s\n", metrics.path().c_str(), err.c_str());
+    }
+    munmap(base, st.st_size);
+    return ok;
+}
+
+static Result run(Mode mode, int threads, long ops, int scrape_us) {
+    // 每轮一个新段：读回的总数只包含这一轮
+    Metrics metrics({"ops"}, {"value"}, threads + 1);
+    metrics.create("metrics_bench");
+    std::atomic<uint64_t> shared(0);
+    std::vector<PaddedCounter> padded(threads);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false), done(false);
+    std::vector<int64_t> cpu(threads, 0);
+
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t) {
+        ts.push_back(std::thread([&, t]() {
+            MetricsThread* m = metrics.attach("bench");
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            int64_t c0 = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+            switch (mode) {
+                case kAtomic:
+                    for (long i = 0; i < ops; ++i) shared.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                case kPadded:
+                    for (long i = 0; i < ops; ++i) padded[t].v.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                case kMetrics:
+                case kScrape:
+                    for (long i = 0; i < ops; ++i) m->add(0);
+                    break;
+                case kHist:
+                    for (long i = 0; i < ops; ++i) m->record(0, (uint64_t)i);
+                    break;
+            }
+            cpu[t] = clock_ns(CLOCK_THREAD_CPUTIME_ID) - c0;
+        }));
+    }
+
+    MetricsReader reader;
+    std::string err;
+    reader.open(metrics.path(), &err);
+    Result r = {0, 0, 0, 0, true};
+    std::thread scraper;
+    if (mode == kScrape) {
+        scraper = std::thread([&]() {
+            MetricsSnapshot snap;
+            while (!done.load(std::memory_order_acquire)) {
+                reader.snapshot(&snap);
+                ++r.scrapes;
+                r.retries += snap.retries;
+                usleep(scrape_us);
+            }
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    int64_t w0 = clock_ns(CLOCK_MONOTONIC);
+    go.store(true, std::memory_order_release);
+    for (int t = 0; t < threads; ++t) {
+        ts[t].join();
+    }
+    int64_t wall = clock_ns(CLOCK_MONOTONIC) - w0;
+    done.store(true, std::memory_order_release);
+    if (scraper.joinable()) {
+        scraper.join();
+    }
+
+    int64_t cpu_total = 0;
+    for (int t = 0; t < threads; ++t) {
+        cpu_total += cpu[t];
+    }
+    double total = (double)threads * ops;
+    r.ns_per_op = cpu_total / total;
+    r.mops = total / (wall / 1e3);
+    if (mode == kMetrics || mode == kScrape || mode == kHist) {
+        MetricsSnapshot snap;
+        reader.snapshot(&snap);
+        uint64_t got = mode == kHist ? snap.histograms[0].count : snap.counters[0];
+        r.ok = got == (uint64_t)threads * ops && snap.torn == 0;
+        if (!r.ok) {
+            fprintf(stderr, "%s %d 线程: 读回 %llu, 应为 %llu\n", kModeNames[mode], threads, (unsigned long long)got,
+                    (unsigned long long)threads * ops);
+        }
+    }
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int max_threads = 64;
+    long ops = 5000000;
+    int scrape_us = 1000;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:s:")) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'n': ops = atol(optarg); break;
+            case 's': scrape_us = atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-t max_threads] [-n ops_per_thread] [-s scrape_us]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (max_threads < 1 || ops < 1) {
+        return 1;
+    }
+    printf("CPU %u 个, 每线程 %ld 次, 抓取间隔 %d us\n", std::thread::hardware_concurrency(), ops, scrape_us);
+    bool ok = check_torn_slot();
+    printf("%8s %8s %10s %10s %10s %10s\n", "mode", "threads", "ns/op", "Mops/s", "scrapes", "retries");
+    for (int t = 1; t <= max_threads; t *= 2) {
+        for (int m = kAtomic; m <= kHist; ++m) {
+            Result r = run((Mode)m, t, ops, scrape_us);
+            ok &= r.ok;
+            printf("%8s %8d %10.2f %10.1f", kModeNames[m], t, r.ns_per_op, r.mops);
+            if (m == kScrape) {
+                printf(" %10llu %10llu", (unsigned long long)r.scrapes, (unsigned long long)r.retries);
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    return ok ? 0 : 1;
+}
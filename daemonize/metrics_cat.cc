@@ -0,0 +1,100 @@
+/**
+ * 读共享内存指标段的命令行工具：只读 mmap 之后按序列锁读快照，守护进程那边感觉不到有人在读
+ *
+ * 用法: metrics_cat [-i interval_ms] [-n count] [-t] segment
+ *   segment  shm_open 的名字（如 /daemonize_demo）或者 Metrics::path() 给出的路径（如 /proc/<pid>/fd/<fd>）
+ *   -i  每隔 interval_ms 读一次，计数器另外输出这段时间的速率；默认只读一次
+ *   -n  读多少次后退出，默认 -i 时一直读
+ *   -t  按线程列出计数器
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+
+#include "metrics.h"
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void print(const MetricsReader& reader, const MetricsSnapshot& snap, const MetricsSnapshot* prev,
+                  double secs, bool per_thread) {
+    bool alive = kill((pid_t)reader.pid(), 0) == 0;
+    printf("pid %lld (%s), layout 1.%u, %zu 个线程槽, 重读 %llu 次%s\n", (long long)reader.pid(),
+           alive ? "运行中" : "已退出", reader.version_minor(), snap.thread_names.size(),
+           (unsigned long long)snap.retries, snap.torn > 0 ? "，有写到一半的槽" : "");
+    for (size_t i = 0; i < snap.counters.size(); ++i) {
+        printf("  %-28s %14llu", snap.counter_names[i].c_str(), (unsigned long long)snap.counters[i]);
+        if (prev != NULL && secs > 0) {
+            printf("  %12.1f/s", (snap.counters[i] - prev->counters[i]) / secs);
+        }
+        printf("\n");
+    }
+    for (size_t i = 0; i < snap.histograms.size(); ++i) {
+        const MetricsHistogram& h = snap.histograms[i];
+        printf("  %-28s n=%llu avg=%.1f p50<=%llu p99<=%llu p99.9<=%llu\n", snap.histogram_names[i].c_str(),
+               (unsigned long long)h.count, h.count > 0 ? (double)h.sum / h.count : 0.0,
+               (unsigned long long)h.percentile(50), (unsigned long long)h.percentile(99),
+               (unsigned long long)h.percentile(99.9));
+    }
+    if (per_thread) {
+        for (size_t t = 0; t < snap.thread_names.size(); ++t) {
+            printf("  [%d %s]", snap.thread_ids[t], snap.thread_names[t].c_str());
+            for (size_t i = 0; i < snap.counters.size(); ++i) {
+                if (snap.thread_counters[t][i] != 0) {
+                    printf(" %s=%llu", snap.counter_names[i].c_str(), (unsigned long long)snap.thread_counters[t][i]);
+                }
+            }
+            printf("\n");
+        }
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    int interval_ms = 0;
+    long count = -1;
+    bool per_thread = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:t")) != -1) {
+        switch (opt) {
+            case 'i': interval_ms = atoi(optarg); break;
+            case 'n': count = atol(optarg); break;
+            case 't': per_thread = true; break;
+            default:
+                fprintf(stderr, "用法: %s [-i interval_ms] [-n count] [-t] segment\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "用法: %s [-i interval_ms] [-n count] [-t] segment\n", argv[0]);
+        return 1;
+    }
+    MetricsReader reader;
+    std::string err;
+    if (reader.open(argv[optind], &err) < 0) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    if (interval_ms <= 0) {
+        count = 1;
+    }
+    MetricsSnapshot snap, prev;
+    int64_t prev_at = 0;
+    for (long i = 0; count < 0 || i < count; ++i) {
+        if (i > 0) {
+            usleep(interval_ms * 1000);
+        }
+        int64_t at = now_ns();
+        reader.snapshot(&snap);
+        print(reader, snap, i > 0 ? &prev : NULL, (at - prev_at) / 1e9, per_thread);
+        prev = snap;
+        prev_at = at;
+    }
+    return 0;
+}
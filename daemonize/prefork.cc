@@ -0,0 +1,578 @@
+#include "prefork.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+/** 旧 master exec 新 master 时用这个环境变量告诉它 socketpair 的 fd */
+static const char kHandoffEnv[] = "PREFORK_HANDOFF_FD";
+static const uint32_t kHandoffMagic = 0x50464b31;  // "PFK1"
+static const int kMaxHandoffFds = 256;
+static const uint64_t kMaxHandoffState = 1 << 20;  // export_state 只是几个计数，1MB 以上当作消息损坏
+
+/** 交接消息头，和监听套接字一起用一次 sendmsg 发出，后面紧跟 state_len 字节的状态 */
+struct HandoffHeader {
+    uint32_t magic;
+    uint32_t nfds;
+    int32_t port;
+    uint32_t reserved;
+    uint64_t state_len;
+};
+
+static bool write_all(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static int64_t monotonic_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool read_line(const std::string& path, char* buf, size_t len) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    return ok;
+}
+
+/** cgroup v2：从自己的 cgroup 往上逐级读 cpu.max，取最小的限制 */
+static int cgroup_v2_limit(const std::string& rel) {
+    int limit = 0;
+    std::string path = rel;
+    for (;;) {
+        char buf[128];
+        std::string dir = "/sys/fs/cgroup" + (path == "/" ? std::string() : path);
+        if (read_line(dir + "/cpu.max", buf, sizeof(buf))) {
+            long long quota, period;
+            if (strncmp(buf, "max", 3) != 0 && sscanf(buf, "%lld %lld", &quota, &period) == 2 && quota > 0 &&
+                period > 0) {
+                int n = (int)((quota + period - 1) / period);
+                if (limit == 0 || n < limit) {
+                    limit = n;
+                }
+            }
+        }
+        if (path.empty() || path == "/") {
+            break;
+        }
+        size_t slash = path.rfind('/');
+        path = slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+    }
+    return limit;
+}
+
+/** cgroup v1：cpu 控制器挂载点下（容器里通常就是挂载点本身）的 cfs_quota_us / cfs_period_us */
+static int cgroup_v1_limit(const std::string& rel) {
+    static const char* kMounts[] = {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"};
+    for (size_t i = 0; i < sizeof(kMounts) / sizeof(kMounts[0]); ++i) {
+        std::string dirs[] = {std::string(kMounts[i]) + rel, kMounts[i]};
+        for (size_t j = 0; j < 2; ++j) {
+            char q[64], p[64];
+            if (read_line(dirs[j] + "/cpu.cfs_quota_us", q, sizeof(q)) &&
+                read_line(dirs[j] + "/cpu.cfs_period_us", p, sizeof(p))) {
+                long long quota = atoll(q), period = atoll(p);
+                return quota > 0 && period > 0 ? (int)((quota + period - 1) / period) : 0;
+            }
+        }
+    }
+    return 0;
+}
+
+int cgroup_cpu_limit() {
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    if (f == NULL) {
+        return 0;
+    }
+    // 每行 "层级:控制器列表:路径"；v2 的层级是 0、控制器为空
+    char line[512];
+    std::string v2, v1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+        char* c1 = strchr(line, ':');
+        char* c2 = c1 != NULL ? strchr(c1 + 1, ':') : NULL;
+        if (c2 == NULL) {
+            continue;
+        }
+        std::string controllers(c1 + 1, c2);
+        if (strncmp(line, "0::", 3) == 0) {
+            v2 = c2 + 1;
+        } else if (("," + controllers + ",").find(",cpu,") != std::string::npos) {
+            v1 = c2 + 1;
+        }
+    }
+    fclose(f);
+    if (!v1.empty()) {
+        return cgroup_v1_limit(v1);
+    }
+    return v2.empty() ? 0 : cgroup_v2_limit(v2);
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; ++i) {
+            if (CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+    return cpus;
+}
+
+int default_worker_count() {
+    int n = (int)allowed_cpus().size();
+    if (n <= 0) {
+        n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    int limit = cgroup_cpu_limit();
+    if (limit > 0 && limit < n) {
+        n = limit;
+    }
+    return n > 0 ? n : 1;
+}
+
+static int create_listener(const char* host, int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "socket 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        fprintf(stderr, "SO_REUSEPORT 失败: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "无效地址 %s\n", host);
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, backlog) < 0) {
+        fprintf(stderr, "监听 %s:%d 失败: %s\n", host, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+PreforkMaster::PreforkMaster(const PreforkOptions& opts)
+    : opts_(opts), port_(opts.port), handoff_fd_(-1), inherited_(false) {
+    memset(&stats_, 0, sizeof(stats_));
+    init_slots(opts.workers > 0 ? opts.workers : default_worker_count());
+}
+
+void PreforkMaster::init_slots(int n) {
+    slots_.clear();
+    std::vector<int> cpus = allowed_cpus();
+    for (int i = 0; i < n; ++i) {
+        Slot s;
+        s.listen_fd = -1;
+        s.cpu = opts_.pin_cpu && !cpus.empty() ? cpus[i % cpus.size()] : -1;
+        s.pid = 0;
+        s.generation = 0;
+        s.failures = 0;
+        s.started_ms = 0;
+        s.restart_at = 0;
+        slots_.push_back(s);
+    }
+}
+
+PreforkMaster::~PreforkMaster() {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].listen_fd >= 0) {
+            close(slots_[i].listen_fd);
+        }
+    }
+    if (handoff_fd_ >= 0) {
+        close(handoff_fd_);
+    }
+}
+
+int PreforkMaster::receive_handoff(int fd) {
+    HandoffHeader h;
+    iovec iov = {&h, sizeof(h)};
+    char control[CMSG_SPACE(sizeof(int) * kMaxHandoffFds)];
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+    // 消息头不对也可能已经收到了 fd（MSG_CTRUNC 时放不下的那些内核已经关掉），出错时都要关掉，
+    // 否则调用方放弃交接以后这个进程还拿着旧 master 的监听套接字
+    cmsghdr* c = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    const int* fds = NULL;
+    size_t nfds = 0;
+    if (c != NULL && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+        fds = (const int*)CMSG_DATA(c);
+        nfds = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    }
+    if (n != (ssize_t)sizeof(h) || h.magic != kHandoffMagic || fds == NULL || (msg.msg_flags & MSG_CTRUNC) ||
+        h.nfds == 0 || nfds != h.nfds || h.state_len > kMaxHandoffState) {
+        fprintf(stderr, "从旧 master 接收监听套接字失败\n");
+        for (size_t i = 0; i < nfds; ++i) {
+            close(fds[i]);
+        }
+        return -1;
+    }
+    init_slots((int)h.nfds);
+    for (uint32_t i = 0; i < h.nfds; ++i) {
+        slots_[i].listen_fd = fds[i];
+    }
+    port_ = h.port;
+    state_.resize(h.state_len);
+    if (h.state_len > 0 && !read_all(fd, &state_[0], h.state_len)) {
+        fprintf(stderr, "从旧 master 接收状态失败\n");
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            close(slots_[i].listen_fd);
+            slots_[i].listen_fd = -1;
+        }
+        state_.clear();
+        return -1;
+    }
+    return 0;
+}
+
+int PreforkMaster::listen() {
+    const char* env = getenv(kHandoffEnv);
+    if (env != NULL) {
+        handoff_fd_ = atoi(env);
+        unsetenv(kHandoffEnv);
+        // 之后再 fork 的 worker 和下一次升级都不需要继承它
+        fcntl(handoff_fd_, F_SETFD, FD_CLOEXEC);
+        if (receive_handoff(handoff_fd_) < 0) {
+            return -1;
+        }
+        inherited_ = true;
+        return 0;
+    }
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        int fd = create_listener(opts_.host.c_str(), port_, opts_.backlog);
+        if (fd < 0) {
+            return -1;
+        }
+        if (port_ == 0) {
+            // 第一个监听套接字拿到内核分配的端口，其余的绑定同一个端口
+            sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+            getsockname(fd, (sockaddr*)&addr, &len);
+            port_ = ntohs(addr.sin_port);
+        }
+        slots_[i].listen_fd = fd;
+    }
+    return 0;
+}
+
+void PreforkMaster::spawn(size_t i, const WorkerMain& main) {
+    Slot& s = slots_[i];
+    s.restart_at = 0;
+    fflush(NULL);  // 否则 stdio 里没写出的内容会被 worker 退出时再写一遍
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "fork worker %zu 失败: %s\n", i, strerror(errno));
+        s.restart_at = monotonic_ms() + opts_.backoff_max_ms;
+        return;
+    }
+    if (pid == 0) {
+        // worker：恢复默认的信号处理，只保留自己槽位的监听套接字
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        sigset_t set;
+        sigemptyset(&set);
+        sigprocmask(SIG_SETMASK, &set, NULL);
+        for (size_t j = 0; j < slots_.size(); ++j) {
+            if (j != i) {
+                close(slots_[j].listen_fd);
+            }
+        }
+        if (handoff_fd_ >= 0) {
+            close(handoff_fd_);
+        }
+        if (s.cpu >= 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(s.cpu, &cpus);
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+        }
+        WorkerContext ctx;
+        ctx.index = (int)i;
+        ctx.listen_fd = s.listen_fd;
+        ctx.cpu = s.cpu;
+        ctx.generation = s.generation;
+        exit(main(ctx));
+    }
+    s.pid = pid;
+    s.started_ms = monotonic_ms();
+    ++s.generation;
+    ++stats_.spawned;
+}
+
+/** 一个 SIGCHLD 可能对应多个退出的子进程，循环到没有为止 */
+void PreforkMaster::reap(bool stopping) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        size_t i = 0;
+        while (i < slots_.size() && slots_[i].pid != pid) {
+            ++i;
+        }
+        if (i == slots_.size()) {
+            continue;  // 不是 worker（例如 worker 之外的子进程）
+        }
+        Slot& s = slots_[i];
+        s.pid = 0;
+        ++stats_.exited;
+        bool crashed = WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) != 0);
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr, "worker %zu (pid %d) 被信号 %d 终止\n", i, (int)pid, WTERMSIG(status));
+        } else if (crashed) {
+            fprintf(stderr, "worker %zu (pid %d) 退出码 %d\n", i, (int)pid, WEXITSTATUS(status));
+        }
+        if (stopping) {
+            continue;
+        }
+        stats_.crashed += crashed;
+        int64_t now = monotonic_ms();
+        if (now - s.started_ms < opts_.min_uptime_ms) {
+            ++s.failures;
+        } else {
+            s.failures = 0;
+        }
+        int64_t delay = 0;
+        if (s.failures > 0) {
+            delay = opts_.backoff_min_ms;
+            for (int k = 1; k < s.failures && delay < opts_.backoff_max_ms; ++k) {
+                delay *= 2;
+            }
+            if (delay > opts_.backoff_max_ms) {
+                delay = opts_.backoff_max_ms;
+            }
+            fprintf(stderr, "worker %zu 连续 %d 次启动后很快退出，%lld ms 后重启\n", i, s.failures, (long long)delay);
+        }
+        s.restart_at = now + delay;
+        ++stats_.restarts;
+    }
+}
+
+void PreforkMaster::signal_all(int sig) {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].pid > 0) {
+            kill(slots_[i].pid, sig);
+        }
+    }
+}
+
+int PreforkMaster::live() const {
+    int n = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        n += slots_[i].pid > 0;
+    }
+    return n;
+}
+
+bool PreforkMaster::start_upgrade(const sigset_t& old_mask) {
+    if (opts_.exec_argv.empty()) {
+        fprintf(stderr, "没有配置 exec_argv，忽略升级请求\n");
+        return false;
+    }
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+        fprintf(stderr, "socketpair 失败: %s\n", strerror(errno));
+        return false;
+    }
+    std::string state = opts_.export_state ? opts_.export_state() : std::string();
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "fork 新 master 失败: %s\n", strerror(errno));
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // 新 master：恢复 run() 之前的信号状态；dup 出来的 fd 没有 CLOEXEC，能跨过 exec
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        int fd = dup(sv[1]);
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", fd);
+        setenv(kHandoffEnv, buf, 1);
+        std::vector<char*> argv;
+        for (size_t i = 0; i < opts_.exec_argv.size(); ++i) {
+            argv.push_back(const_cast<char*>(opts_.exec_argv[i].c_str()));
+        }
+        argv.push_back(NULL);
+        execv(argv[0], argv.data());
+        fprintf(stderr, "exec %s 失败: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    close(sv[1]);
+
+    HandoffHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = kHandoffMagic;
+    h.nfds = (uint32_t)slots_.size();
+    h.port = port_;
+    h.state_len = state.size();
+    iovec iov = {&h, sizeof(h)};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * slots_.size()));
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int) * slots_.size());
+    int* fds = (int*)CMSG_DATA(c);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        fds[i] = slots_[i].listen_fd;
+    }
+    bool ok = sendmsg(sv[0], &msg, MSG_NOSIGNAL) == (ssize_t)sizeof(h) &&
+              write_all(sv[0], state.data(), state.size());
+
+    // 等新 master 就绪；这段时间旧 worker 照常服务，它们的 SIGCHLD 挂起着，之后再回收
+    char ready = 0;
+    if (ok) {
+        pollfd p = {sv[0], POLLIN, 0};
+        ok = poll(&p, 1, (int)opts_.upgrade_timeout_ms) == 1 && read(sv[0], &ready, 1) == 1 && ready == 'R';
+    }
+    close(sv[0]);
+    if (!ok) {
+        fprintf(stderr, "新 master (pid %d) 没有就绪，放弃升级\n", (int)pid);
+        kill(pid, SIGKILL);
+        return false;
+    }
+    fprintf(stderr, "新 master (pid %d) 已就绪，旧 worker 开始排空\n", (int)pid);
+    ++stats_.handoffs;
+    return true;
+}
+
+int PreforkMaster::run(const WorkerMain& main) {
+    // 先屏蔽再 fork，worker 退出得再早，SIGCHLD 也只会挂起等 sigtimedwait 取走
+    sigset_t set, old;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &set, &old);
+
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        spawn(i, main);
+    }
+    if (handoff_fd_ >= 0) {
+        // 升级启动：worker 都 fork 出来了，通知旧 master 让旧 worker 排空
+        char ready = 'R';
+        if (write(handoff_fd_, &ready, 1) != 1) {
+            fprintf(stderr, "通知旧 master 失败: %s\n", strerror(errno));
+        }
+        close(handoff_fd_);
+        handoff_fd_ = -1;
+    }
+    bool stopping = false;
+    int64_t kill_at = 0;
+    for (;;) {
+        int64_t now = monotonic_ms();
+        if (stopping && live() == 0) {
+            break;
+        }
+        int64_t wake = 0;  // 下一个需要主动处理的时间点，0 表示没有
+        if (!stopping) {
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                Slot& s = slots_[i];
+                if (s.pid == 0 && s.restart_at > 0) {
+                    if (s.restart_at <= now) {
+                        spawn(i, main);
+                    }
+                    if (s.restart_at > 0 && (wake == 0 || s.restart_at < wake)) {
+                        wake = s.restart_at;  // spawn 失败时会重新设置 restart_at
+                    }
+                }
+            }
+        } else {
+            if (now >= kill_at) {
+                signal_all(SIGKILL);
+                kill_at = now + opts_.stop_timeout_ms;
+            }
+            wake = kill_at;
+        }
+
+        siginfo_t info;
+        int sig;
+        if (wake > 0) {
+            int64_t ms = wake > now ? wake - now : 0;
+            timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000 * 1000000)};
+            sig = sigtimedwait(&set, &info, &ts);
+        } else {
+            sig = sigwaitinfo(&set, &info);
+        }
+        if (sig == SIGCHLD) {
+            reap(stopping);
+        } else if (stopping) {
+            continue;
+        } else if (sig == SIGTERM || sig == SIGINT || (sig == SIGUSR2 && start_upgrade(old))) {
+            // 升级成功后旧 worker 和 SIGTERM 时一样排空退出，新 master 不受影响
+            stopping = true;
+            signal_all(SIGTERM);
+            kill_at = monotonic_ms() + opts_.stop_timeout_ms;
+        }
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return 0;
+}
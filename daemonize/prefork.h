@@ -0,0 +1,143 @@
+#ifndef DAEMONIZE_PREFORK_H
+#define DAEMONIZE_PREFORK_H
+
+/**
+ * 预先 fork 的 master/worker 进程模型
+ *
+ *  - master 为每个 worker 槽位创建一个 SO_REUSEPORT 监听套接字并一直持有：
+ *    worker 崩溃重启后接手同一个套接字，已经在它 accept 队列里的连接不会丢
+ *  - worker 数默认取 min(可用 CPU 数, cgroup CPU 配额向上取整)，容器里不会按宿主机核数开进程
+ *  - 可选把第 i 个 worker 绑到可用 CPU 列表的第 i 个（超出时取模）
+ *  - master 屏蔽 SIGCHLD/SIGTERM/SIGINT，用 sigtimedwait 同步等待；收到 SIGCHLD 后
+ *    waitpid(-1, ..., WNOHANG) 循环回收所有退出的 worker（多个 SIGCHLD 可能合并成一个）
+ *  - worker 在 min_uptime_ms 内退出算启动失败，重启间隔从 backoff_min_ms 开始翻倍，
+ *    最多 backoff_max_ms；正常运行一段时间后再退出则立即重启并清零退避
+ *  - SIGTERM/SIGINT：转发 SIGTERM 给所有 worker，等它们退出（超过 stop_timeout_ms 发 SIGKILL）
+ *  - SIGUSR2：平滑升级。fork + exec exec_argv（新版本的二进制），经 socketpair 用 SCM_RIGHTS
+ *    把各槽位的监听套接字交给新 master，后面跟着 export_state() 导出的状态（比如预热好的缓存）。
+ *    新 master 拿到的是同一批套接字，accept 队列是共享的，升级期间不会有连接被拒绝或 RST；
+ *    它启动完自己的 worker 后回一个字节，旧 master 收到后按 SIGTERM 的流程让旧 worker 排空退出。
+ *    新 master 在 upgrade_timeout_ms 内没有就绪（启动失败、崩溃）就放弃升级，旧 master 照常运行
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct PreforkOptions {
+    int workers;  // <= 0 时取 default_worker_count()
+    bool pin_cpu;
+    std::string host;
+    int port;  // 0 表示由内核分配，listen() 之后用 port() 取
+    int backlog;
+    int64_t min_uptime_ms;
+    int64_t backoff_min_ms;
+    int64_t backoff_max_ms;
+    int64_t stop_timeout_ms;
+    std::vector<std::string> exec_argv;  // 升级时 exec 的命令行，argv[0] 必须是绝对路径；为空时忽略 SIGUSR2
+    int64_t upgrade_timeout_ms;
+    std::function<std::string()> export_state;  // 可选：升级时交给新 master 的状态
+
+    PreforkOptions()
+        : workers(0),
+          pin_cpu(true),
+          host("0.0.0.0"),
+          port(8080),
+          backlog(1024),
+          min_uptime_ms(1000),
+          backoff_min_ms(100),
+          backoff_max_ms(10000),
+          stop_timeout_ms(5000),
+          upgrade_timeout_ms(5000) {}
+};
+
+struct WorkerContext {
+    int index;      // 槽位号 0..workers-1
+    int listen_fd;  // 本槽位的 SO_REUSEPORT 监听套接字（非阻塞）
+    int cpu;        // 绑定的 CPU，没有绑定为 -1
+    int generation; // 本槽位第几次启动，从 0 开始
+};
+
+/** 在 worker 进程里执行，返回值作为进程退出码 */
+typedef std::function<int(const WorkerContext&)> WorkerMain;
+
+struct PreforkStats {
+    uint64_t spawned;   // fork 成功的次数（含首次启动）
+    uint64_t exited;    // 回收的 worker 数
+    uint64_t crashed;   // 其中被信号杀死或退出码非 0 的
+    uint64_t restarts;  // 重启次数
+    uint64_t handoffs;  // 成功交给新 master 的次数（0 或 1，之后本 master 就退出了）
+};
+
+/** 当前进程 cgroup 的 CPU 配额（v2 cpu.max / v1 cfs_quota_us），向上取整；没有限制返回 0 */
+int cgroup_cpu_limit();
+
+/** 可用 CPU 列表（sched_getaffinity） */
+std::vector<int> allowed_cpus();
+
+/** min(可用 CPU 数, cgroup 配额)，至少为 1 */
+int default_worker_count();
+
+class PreforkMaster {
+public:
+    explicit PreforkMaster(const PreforkOptions& opts);
+    ~PreforkMaster();
+
+    /**
+     * 为每个槽位创建监听套接字；失败返回 -1。
+     * 由旧 master 在升级时 exec 起来时改为从旧 master 接收套接字和状态，槽位数以收到的套接字数为准
+     */
+    int listen();
+
+    /**
+     * listen() 是否从旧 master 接手了监听套接字（此时不应再 daemonize）。
+     * 交接用的环境变量在 listen() 里就清掉了，只能在 listen() 之后问本对象
+     */
+    bool inherited() const { return inherited_; }
+    int port() const { return port_; }
+    int workers() const { return (int)slots_.size(); }
+    /** 旧 master 用 export_state 交过来的状态，非升级启动时为空 */
+    const std::string& inherited_state() const { return state_; }
+
+    /**
+     * 启动 worker 并监督它们，直到收到 SIGTERM/SIGINT 且所有 worker 都退出后返回 0。
+     * 调用前要先 listen()。
+     */
+    int run(const WorkerMain& main);
+
+    const PreforkStats& stats() const { return stats_; }
+
+private:
+    PreforkMaster(const PreforkMaster&);
+    PreforkMaster& operator=(const PreforkMaster&);
+
+    struct Slot {
+        int listen_fd;
+        int cpu;
+        pid_t pid;           // 0 表示当前没有进程
+        int generation;
+        int failures;        // 连续启动失败次数
+        int64_t started_ms;
+        int64_t restart_at;  // 等待重启的时间点，0 表示不需要
+    };
+
+    void init_slots(int n);
+    int receive_handoff(int fd);
+    bool start_upgrade(const sigset_t& old_mask);
+    void spawn(size_t i, const WorkerMain& main);
+    void reap(bool stopping);
+    void signal_all(int sig);
+    int live() const;
+
+    PreforkOptions opts_;
+    int port_;
+    std::vector<Slot> slots_;
+    PreforkStats stats_;
+    int handoff_fd_;  // 新 master：到旧 master 的连接，worker 都启动后回复就绪
+    bool inherited_;
+    std::string state_;
+};
+
+#endif  // DAEMONIZE_PREFORK_H
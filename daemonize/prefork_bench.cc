@@ -0,0 +1,206 @@
+/**
+ * prefork_server 的扩展性压测：worker 数 1, 2, 4 ... 各跑一轮，看吞吐是否随 worker 数增长
+ *
+ * 用法: prefork_bench [-n max_workers] [-c conns] [-t client_threads] [-d seconds] [-w work_us] [-x crash_after]
+ *   -n  默认 max(4, default_worker_count())
+ *   -w  传给服务端的每请求忙等时间，默认 20us，让服务端成为瓶颈
+ *   -x  最后再用 max_workers 跑一轮，每个 worker 处理这么多请求后崩溃，看重启期间的吞吐和错误数；
+ *       默认按上一轮的吞吐估算成每个 worker 运行约 1.5s 后崩溃（超过 min_uptime，不触发退避）；-1 不跑。
+ *       这一轮至少跑 4s，保证每个 worker 能崩溃两次；一次重启都没有时这一行没有意义，退出码为 1
+ *   客户端连接出错后立即重连，崩溃的 worker 重启前新连接在 master 持有的监听队列里排队
+ *
+ * 服务端是同目录下的 prefork_server，由本程序 fork + exec 启动，结束时发 SIGTERM，
+ * 从它的 stdout 读回 master 的统计（重启次数）。客户端用 epoll/ 下的闭环压测客户端。
+ * 客户端和服务端在同一台机器上，CPU 数不多时客户端本身会抢走一部分 CPU。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <string>
+
+#include "load_client.h"
+#include "prefork.h"
+
+static std::string sibling_path(const char* name) {
+    char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0) {
+        return name;
+    }
+    exe[n] = '\0';
+    std::string dir(exe);
+    return dir.substr(0, dir.rfind('/') + 1) + name;
+}
+
+/** 让内核分配一个空闲端口（关闭后立即交给服务端使用） */
+static int pick_port() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0 && getsockname(fd, (sockaddr*)&addr, &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+static bool wait_ready(int port) {
+    for (int i = 0; i < 500; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bool ok = connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+        close(fd);
+        if (ok) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+// 默认每个 worker 运行约 1.5s 后崩溃，要超过 PreforkOptions::min_uptime_ms（1s），否则会触发退避
+static const double kCrashUptimeS = 1.5;
+static const int kCrashMinSeconds = 4;
+
+struct ServerRun {
+    LoadResult load;
+    unsigned long long restarts;
+};
+
+static bool run_one(const std::string& server, int workers, int work_us, long crash_after, LoadConfig cfg,
+                    ServerRun* out) {
+    int port = pick_port();
+    int pipefd[2];
+    if (port < 0 || pipe(pipefd) < 0) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        // worker 崩溃和重启的提示不混进压测输出
+        freopen("/dev/null", "w", stderr);
+        std::string p = std::to_string(port), n = std::to_string(workers), w = std::to_string(work_us),
+                    x = std::to_string(crash_after);
+        execl(server.c_str(), server.c_str(), "-H", "127.0.0.1", "-p", p.c_str(), "-n", n.c_str(), "-w", w.c_str(),
+              "-x", x.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    bool ok = pid > 0 && wait_ready(port);
+    if (ok) {
+        cfg.port = port;
+        run_load(cfg, &out->load);
+    }
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    char buf[256] = {0};
+    ssize_t n = read(pipefd[0], buf, sizeof(buf) - 1);
+    close(pipefd[0]);
+    out->restarts = 0;
+    const char* r = n > 0 ? strstr(buf, "restarts=") : NULL;
+    if (r != NULL) {
+        out->restarts = strtoull(r + 9, NULL, 10);
+    }
+    return ok;
+}
+
+static void print_row(const char* label, int workers, const ServerRun& r, double base) {
+    double rps = r.load.requests / r.load.elapsed_s;
+    printf("%-8s %7d %12.0f %8.2fx %10.1f %10.1f %8llu %8llu\n", label, workers, rps, base > 0 ? rps / base : 1.0,
+           r.load.latency.percentile(50) / 1000.0, r.load.latency.percentile(99) / 1000.0,
+           (unsigned long long)r.load.errors, r.restarts);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    int max_workers = default_worker_count() > 4 ? default_worker_count() : 4;
+    int work_us = 20;
+    long crash_after = 0;
+    LoadConfig cfg;
+    cfg.host = "127.0.0.1";
+    cfg.port = 0;
+    cfg.conns = 64;
+    cfg.threads = 2;
+    cfg.seconds = 3;
+    cfg.http = true;
+    cfg.size = 0;
+    cfg.reconnect = true;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:t:d:w:x:")) != -1) {
+        switch (opt) {
+            case 'n': max_workers = atoi(optarg); break;
+            case 'c': cfg.conns = atoi(optarg); break;
+            case 't': cfg.threads = atoi(optarg); break;
+            case 'd': cfg.seconds = atoi(optarg); break;
+            case 'w': work_us = atoi(optarg); break;
+            case 'x': crash_after = atol(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-n max_workers] [-c conns] [-t threads] [-d seconds] [-w work_us] [-x n]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.conns < cfg.threads) cfg.conns = cfg.threads;
+
+    std::string server = sibling_path("prefork_server");
+    printf("服务端 %s, 每请求忙等 %d us, %d 连接, %d 个客户端线程, 每轮 %ds\n", server.c_str(), work_us, cfg.conns,
+           cfg.threads, cfg.seconds);
+    printf("CPU %zu 个, cgroup 配额 %d, 默认 worker 数 %d\n", allowed_cpus().size(), cgroup_cpu_limit(),
+           default_worker_count());
+    printf("%-8s %7s %12s %9s %10s %10s %8s %8s\n", "run", "workers", "req/s", "speedup", "p50(us)", "p99(us)",
+           "errors", "restarts");
+    double base = 0, last = 0;
+    for (int w = 1; w <= max_workers; w *= 2) {
+        ServerRun r;
+        if (!run_one(server, w, work_us, 0, cfg, &r)) {
+            fprintf(stderr, "启动 %s 失败\n", server.c_str());
+            return 1;
+        }
+        if (w == 1) {
+            base = r.load.requests / r.load.elapsed_s;
+        }
+        last = r.load.requests / r.load.elapsed_s;
+        print_row("scale", w, r, base);
+    }
+    if (crash_after == 0) {
+        crash_after = (long)(last / max_workers * kCrashUptimeS) + 1;
+    }
+    if (crash_after > 0) {
+        // 每轮时间太短时 worker 还没处理够 crash_after 个请求就结束了，这一行什么也没测到
+        if (cfg.seconds < kCrashMinSeconds) {
+            cfg.seconds = kCrashMinSeconds;
+        }
+        ServerRun r;
+        if (!run_one(server, max_workers, work_us, crash_after, cfg, &r)) {
+            fprintf(stderr, "启动 %s 失败\n", server.c_str());
+            return 1;
+        }
+        print_row("crash", max_workers, r, base);
+        if (r.restarts == 0) {
+            fprintf(stderr, "crash: %ds 内没有 worker 处理满 %ld 个请求，没有发生重启\n", cfg.seconds, crash_after);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+/**
+ * 预先 fork 的 HTTP 服务：master 监督 N 个 worker，每个 worker 在自己的 SO_REUSEPORT 套接字上跑 epoll 循环，
+ * 对每个请求返回固定的 "hello, world"
+ *
+ * 用法: prefork_server [-H host] [-p port] [-n workers] [-w work_us] [-x crash_after] [-P] [-D]
+ *   -n  worker 数，默认 min(可用 CPU 数, cgroup CPU 配额)
+ *   -w  每个请求额外忙等的微秒数，模拟 CPU 密集的处理
+ *   -x  每个 worker 处理这么多请求后 abort()，用来观察崩溃重启
+ *   -P  不绑核
+ *   -D  先 daemonize() 再启动 master
+ * master 启动时在 stdout 打印一行 "master pid=.. port=.. generation=.."，
+ * 退出时打印一行 "spawned=.. exited=.. crashed=.. restarts=.. handoffs=.."
+ *
+ * 平滑升级：替换磁盘上的二进制后 kill -USR2 <master pid>，master 以同样的命令行 exec 新二进制并把
+ * 监听套接字交过去（见 prefork.h）。交接的状态是升级代数 generation，新 master 在旧值上加 1。
+ * worker 收到 SIGTERM 后排空：不再 accept，每条连接上的下一个请求照常回复但带上 "Connection: close"
+ * 然后关闭；所有连接都关闭或者 4s 后退出。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <limits.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+
+#include "daemonize.h"
+#include "prefork.h"
+#include "signal_fd.h"
+
+static const char kResponse[] = "HTTP/1.1 200 OK\r\nContent-Length: 13\r\nConnection: keep-alive\r\n\r\nhello, world\n";
+static const char kResponseClose[] = "HTTP/1.1 200 OK\r\nContent-Length: 13\r\nConnection: close\r\n\r\nhello, world\n";
+static const int kDrainMs = 4000;  // 比 master 的 stop_timeout_ms 短，赶在 SIGKILL 之前自己退出
+
+static void busy_us(int us) {
+    timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000LL + (now.tv_nsec - start.tv_nsec) / 1000 < us);
+}
+
+static int64_t now_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/** worker 的事件循环：请求以 "\r\n\r\n" 结尾，流水线上的多个请求一次写回；SIGTERM 经 signalfd 进来后开始排空 */
+static int serve(const WorkerContext& ctx, int work_us, long crash_after) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    SignalFd sigs;
+    bool draining = false;
+    int64_t drain_deadline = 0;
+    sigs.block({SIGTERM});
+    sigs.init(ep, [&](const signalfd_siginfo&) {
+        if (!draining) {
+            draining = true;
+            drain_deadline = now_ms() + kDrainMs;
+            // 监听套接字和新 worker 共享，这里只是自己不再 accept；队列里的连接由新 worker 接走
+            epoll_ctl(ep, EPOLL_CTL_DEL, ctx.listen_fd, NULL);
+        }
+    });
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = ctx.listen_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, ctx.listen_fd, &ev);
+
+    std::vector<std::string> inbuf;
+    std::vector<char> open;
+    int nconns = 0;
+    std::string out;
+    char buf[16384];
+    long served = 0;
+    epoll_event events[256];
+    for (;;) {
+        int timeout = -1;
+        if (draining) {
+            int64_t left = drain_deadline - now_ms();
+            if (nconns == 0 || left <= 0) {
+                return 0;
+            }
+            timeout = (int)left;
+        }
+        int n = epoll_wait(ep, events, 256, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (sigs.handle(fd)) {
+                continue;
+            }
+            if (fd == ctx.listen_fd) {
+                int c;
+                while (!draining && (c = accept4(ctx.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    int on = 1;
+                    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                    ev.data.fd = c;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, c, &ev);
+                    if ((size_t)c >= inbuf.size()) {
+                        inbuf.resize(c + 1);
+                        open.resize(c + 1, 0);
+                    }
+                    open[c] = 1;
+                    ++nconns;
+                }
+                continue;
+            }
+            if ((size_t)fd >= open.size() || !open[fd]) {
+                continue;  // 同一批事件里已经关掉的连接
+            }
+            ssize_t got = recv(fd, buf, sizeof(buf), 0);
+            bool close_it = got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR);
+            std::string& in = inbuf[fd];
+            out.clear();
+            if (got > 0) {
+                in.append(buf, got);
+                size_t pos = 0, end;
+                while (!close_it && (end = in.find("\r\n\r\n", pos)) != std::string::npos) {
+                    if (work_us > 0) {
+                        busy_us(work_us);
+                    }
+                    pos = end + 4;
+                    if (draining) {
+                        // 排空：这个请求照常回复，告诉客户端连接要关了，之后不再读
+                        out.append(kResponseClose, sizeof(kResponseClose) - 1);
+                        close_it = true;
+                    } else {
+                        out.append(kResponse, sizeof(kResponse) - 1);
+                    }
+                    if (crash_after > 0 && ++served >= crash_after) {
+                        abort();
+                    }
+                }
+                in.erase(0, pos);
+            }
+            // 闭环客户端一问一答，响应总能一次写进发送缓冲区
+            if (!out.empty() && send(fd, out.data(), out.size(), MSG_NOSIGNAL) != (ssize_t)out.size()) {
+                close_it = true;
+            }
+            if (close_it) {
+                in.clear();
+                open[fd] = 0;
+                --nconns;
+                close(fd);
+            }
+        }
+    }
+}
+
+static std::string self_exe() {
+    char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0) {
+        return std::string();
+    }
+    exe[n] = '\0';
+    // 二进制被 rename 覆盖之后 readlink 会带上 " (deleted)"，启动时读出的路径指向替换后的新文件
+    return exe;
+}
+
+int main(int argc, char** argv) {
+    PreforkOptions opts;
+    int work_us = 0;
+    long crash_after = 0;
+    bool daemon = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:n:w:x:PD")) != -1) {
+        switch (opt) {
+            case 'H': opts.host = optarg; break;
+            case 'p': opts.port = atoi(optarg); break;
+            case 'n': opts.workers = atoi(optarg); break;
+            case 'w': work_us = atoi(optarg); break;
+            case 'x': crash_after = atol(optarg); break;
+            case 'P': opts.pin_cpu = false; break;
+            case 'D': daemon = true; break;
+            default:
+                fprintf(stderr, "用法: %s [-H host] [-p port] [-n workers] [-w work_us] [-x crash_after] [-P] [-D]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    // 升级时以同样的命令行 exec 新二进制；generation 随状态交接，每升级一次加 1
+    std::string exe = self_exe();
+    if (!exe.empty()) {
+        opts.exec_argv.push_back(exe);
+        for (int i = 1; i < argc; ++i) {
+            opts.exec_argv.push_back(argv[i]);
+        }
+    }
+    int generation = 0;
+    opts.export_state = [&generation]() { return "generation=" + std::to_string(generation); };
+
+    PreforkMaster master(opts);
+    if (master.listen() < 0) {
+        return 1;
+    }
+    bool inherited = master.inherited();
+    if (inherited) {
+        sscanf(master.inherited_state().c_str(), "generation=%d", &generation);
+        ++generation;
+    }
+    fprintf(stderr, "master pid %d 监听 %s:%d, %d 个 worker（CPU %zu 个, cgroup 配额 %d）%s\n", (int)getpid(),
+            opts.host.c_str(), master.port(), master.workers(), allowed_cpus().size(), cgroup_cpu_limit(),
+            inherited ? "，从旧 master 接手" : "");
+    // 监听套接字在 daemonize 之前创建：端口被占用之类的错误还能在终端上看到。
+    // 升级起来的新 master 是已经脱离终端的旧 master 的子进程，不再 daemonize
+    if (daemon && !inherited && daemonize() < 0) {
+        return 1;
+    }
+    printf("master pid=%d port=%d generation=%d\n", (int)getpid(), master.port(), generation);
+    fflush(stdout);
+    master.run([work_us, crash_after](const WorkerContext& ctx) { return serve(ctx, work_us, crash_after); });
+    const PreforkStats& st = master.stats();
+    printf("spawned=%llu exited=%llu crashed=%llu restarts=%llu handoffs=%llu\n", (unsigned long long)st.spawned,
+           (unsigned long long)st.exited, (unsigned long long)st.crashed, (unsigned long long)st.restarts,
+           (unsigned long long)st.handoffs);
+    return 0;
+}
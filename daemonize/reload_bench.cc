@@ -0,0 +1,258 @@
+/**
+ * 配置热加载期间的请求延迟：读者线程不停地处理"请求"（查配置 + 一点计算），
+ * 另一个线程按固定间隔给自己发 SIGUSR1，主循环经 signalfd 收到后触发重新加载
+ *
+ * 用法: reload_bench [-t reader_threads] [-d seconds] [-k config_keys] [-i reload_interval_ms]
+ *
+ * 三轮对比：
+ *   none    不重新加载，作为基线
+ *   rcu     ConfigReloader：后台线程解析，原子替换不可变快照，读者只有一次 load 和一次静止点 store
+ *   locked  常见的写法：读者每个请求拿读锁，重新加载时拿写锁就地清空并重新解析
+ * 输出每轮的请求数、延迟 p50/p99/p99.9/max、超过 1ms 的请求数，重新加载次数和平均解析时间。
+ * 单核机器上读者和解析线程分时运行，max 里会混进调度延迟，p99.9 更能看出加锁期间的停顿。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config_reload.h"
+#include "latency_histogram.h"
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 防止编译器把请求处理优化掉
+static std::atomic<uint64_t> g_sink(0);
+
+/** 一个"请求"：按请求号查一个路由配置，再把值哈希一下 */
+static uint64_t handle_request(const Config* cfg, uint64_t seq, int keys) {
+    std::string key = "route." + std::to_string(seq % keys);
+    std::map<std::string, std::string>::const_iterator it = cfg->values.find(key);
+    uint64_t h = cfg->generation;
+    if (it != cfg->values.end()) {
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            h = h * 131 + (unsigned char)it->second[i];
+        }
+    }
+    return h;
+}
+
+static void write_config(const std::string& path, int keys) {
+    FILE* fp = fopen(path.c_str(), "w");
+    if (fp == NULL) {
+        perror(path.c_str());
+        exit(1);
+    }
+    fprintf(fp, "# reload_bench 生成\nlog_level = info\n");
+    for (int i = 0; i < keys; ++i) {
+        fprintf(fp, "route.%d = upstream-%d.example.internal:%d\n", i, i % 97, 8000 + i % 1000);
+    }
+    fclose(fp);
+}
+
+enum Mode { kNone, kRcu, kLocked };
+
+struct Row {
+    uint64_t requests;
+    uint64_t reloads;
+    uint64_t stalls;  // 超过 1ms 的请求
+    int64_t parse_ns;
+    LatencyHistogram latency;
+
+    Row() : requests(0), reloads(0), stalls(0), parse_ns(0) {}
+};
+
+/** 传统做法的全局配置：读写锁保护，重新加载时就地重建 */
+struct LockedConfig {
+    std::shared_mutex mu;
+    Config cfg;
+};
+
+static void run(Mode mode, const std::string& path, int threads, int seconds, int keys, int interval_ms,
+                int sig_fd, Row* row) {
+    ConfigStore store;
+    LockedConfig locked;
+    std::atomic<int64_t> parse_total(0);
+    ConfigReloader reloader(&store, path, [&parse_total](const Config*, const std::string&, int64_t parse_ns) {
+        parse_total.fetch_add(parse_ns);
+    });
+    std::string err;
+    if (reloader.load_now(&err) < 0 || parse_config(path, &locked.cfg, &err) < 0) {
+        fprintf(stderr, "%s\n", err.c_str());
+        exit(1);
+    }
+    reloader.start();
+
+    std::atomic<bool> stop(false);
+    std::vector<LatencyHistogram*> hists;
+    std::vector<uint64_t> counts(threads, 0), stalls(threads, 0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < threads; ++t) {
+        hists.push_back(new LatencyHistogram());
+        readers.push_back(std::thread([&, t]() {
+            LatencyHistogram* h = hists[t];
+            ConfigStore::Reader* r = store.register_reader();
+            uint64_t seq = t, sink = 0, n = 0, slow = 0;
+            int64_t prev = now_ns();
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (mode == kLocked) {
+                    std::shared_lock<std::shared_mutex> lock(locked.mu);
+                    sink += handle_request(&locked.cfg, seq, keys);
+                } else {
+                    sink += handle_request(store.current(), seq, keys);
+                    store.quiescent(r);
+                }
+                seq += threads;
+                ++n;
+                int64_t now = now_ns();
+                h->record(now - prev);
+                slow += now - prev > 1000000 ? 1 : 0;
+                prev = now;
+            }
+            store.unregister_reader(r);
+            counts[t] = n;
+            stalls[t] = slow;
+            g_sink.fetch_add(sink, std::memory_order_relaxed);
+        }));
+    }
+
+    // 发信号的线程：SIGUSR1 已经在所有线程里屏蔽，只能经 signalfd 被主线程读到
+    std::thread sender([&]() {
+        if (mode == kNone) {
+            return;
+        }
+        while (!stop.load()) {
+            kill(getpid(), SIGUSR1);
+            usleep(interval_ms * 1000);
+        }
+    });
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = sig_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, sig_fd, &ev);
+    int64_t deadline = now_ns() + (int64_t)seconds * 1000000000LL;
+    int64_t locked_parse = 0;
+    uint64_t locked_reloads = 0;
+    while (now_ns() < deadline) {
+        epoll_event out;
+        if (epoll_wait(ep, &out, 1, 100) <= 0) {
+            continue;
+        }
+        signalfd_siginfo si;
+        bool got = false;
+        while (read(sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+            got = true;
+        }
+        if (!got) {
+            continue;
+        }
+        if (mode == kRcu) {
+            reloader.request();
+        } else if (mode == kLocked) {
+            // 简化成在主循环里做，和"收到信号后拿写锁重新读配置"的单线程守护进程一样
+            int64_t start = now_ns();
+            std::unique_lock<std::shared_mutex> lock(locked.mu);
+            locked.cfg.values.clear();
+            parse_config(path, &locked.cfg, &err);
+            ++locked.cfg.generation;
+            locked_parse += now_ns() - start;
+            ++locked_reloads;
+        }
+    }
+    stop.store(true);
+    sender.join();
+    for (int t = 0; t < threads; ++t) {
+        readers[t].join();
+        row->requests += counts[t];
+        row->stalls += stalls[t];
+        row->latency.merge(*hists[t]);
+        delete hists[t];
+    }
+    reloader.stop();
+    close(ep);
+    // 把迟到的信号读掉，别漏到下一轮
+    signalfd_siginfo si;
+    while (read(sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+    }
+    if (mode == kLocked) {
+        row->reloads = locked_reloads;
+        row->parse_ns = locked_parse;
+    } else {
+        // 第一次 load_now 不算
+        row->reloads = reloader.loads() - 1;
+        row->parse_ns = parse_total.load();
+    }
+}
+
+int main(int argc, char** argv) {
+    int threads = 2;
+    int seconds = 3;
+    int keys = 20000;
+    int interval_ms = 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:k:i:")) != -1) {
+        switch (opt) {
+            case 't': threads = atoi(optarg); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'k': keys = atoi(optarg); break;
+            case 'i': interval_ms = atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-t threads] [-d seconds] [-k keys] [-i interval_ms]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (threads < 1 || keys < 1 || interval_ms < 1) {
+        return 1;
+    }
+
+    // 在创建任何线程之前屏蔽 SIGUSR1
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    char path[] = "/tmp/reload_bench.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || sig_fd < 0) {
+        perror("setup");
+        return 1;
+    }
+    close(fd);
+    write_config(path, keys);
+
+    printf("%d 个读者线程, 配置 %d 个 key, 每 %d ms 一次 SIGUSR1, 每轮 %ds, CPU 数 %ld\n", threads, keys,
+           interval_ms, seconds, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-7s %12s %8s %10s | %9s %9s %9s %10s %8s\n", "mode", "requests", "reloads", "parse(ms)", "p50(us)",
+           "p99(us)", "p99.9(us)", "max(us)", ">1ms");
+    const char* names[] = {"none", "rcu", "locked"};
+    for (int m = kNone; m <= kLocked; ++m) {
+        Row row;
+        run((Mode)m, path, threads, seconds, keys, interval_ms, sig_fd, &row);
+        printf("%-7s %12llu %8llu %10.2f | %9.2f %9.2f %9.2f %10.1f %8llu\n", names[m], (unsigned long long)row.requests,
+               (unsigned long long)row.reloads, row.reloads > 0 ? row.parse_ns / 1e6 / row.reloads : 0.0,
+               row.latency.percentile(50) / 1000.0, row.latency.percentile(99) / 1000.0,
+               row.latency.percentile(99.9) / 1000.0, row.latency.max() / 1000.0, (unsigned long long)row.stalls);
+        fflush(stdout);
+    }
+    unlink(path);
+    close(sig_fd);
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * timerfd 调度器压测：大量不同周期的任务同时运行时的迟到时间、执行次数，以及和 sleep 循环的漂移对比
+ *
+ * 用法: sched_bench [-j jobs] [-d seconds] [-w workers] [-J jitter_us]
+ *   每 4 个任务里有 1 个放到工作线程，周期 (10 + i % 50) ms，睡 1ms 模拟耗时任务；
+ *   其余周期 (1 + i % 50) ms，在主循环里忙等 10us。工作线程不够用时会出现 overrun
+ *
+ * 输出：
+ *   - 内联任务 / 工作线程任务的迟到时间 p50/p99/max，执行次数和理论次数
+ *   - 主循环 epoll_wait 返回次数：到期时间相同的任务在一次唤醒里处理
+ *   - 10ms 周期下 "sleep(period) 再干活" 的循环和调度器在结束时各落后网格多少（漂移）
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <thread>
+
+#include "scheduler.h"
+
+static const int64_t kMs = 1000000LL;
+
+static void busy_wait(int64_t ns) {
+    int64_t end = Scheduler::now_ns() + ns;
+    while (Scheduler::now_ns() < end) {
+    }
+}
+
+/** 传统写法：干完活再睡一个周期，每轮都落后 "执行时间 + 唤醒延迟" */
+static void sleep_loop(int64_t period, int64_t seconds, uint64_t* runs, int64_t* drift) {
+    int64_t start = Scheduler::now_ns();
+    int64_t end = start + seconds * 1000 * kMs;
+    int64_t last = start;
+    uint64_t n = 0;
+    while ((last = Scheduler::now_ns()) < end) {
+        busy_wait(10000);
+        ++n;
+        usleep((useconds_t)(period / 1000));
+    }
+    *runs = n;
+    // 第 n 次本该在 start + n * period 开始
+    *drift = start + (int64_t)n * period - last;
+}
+
+int main(int argc, char** argv) {
+    int njobs = 200;
+    int seconds = 5;
+    int workers = 4;
+    int64_t jitter_ns = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:d:w:J:")) != -1) {
+        switch (opt) {
+            case 'j': njobs = atoi(optarg); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'w': workers = atoi(optarg); break;
+            case 'J': jitter_ns = atoll(optarg) * 1000; break;
+            default:
+                fprintf(stderr, "用法: %s [-j jobs] [-d seconds] [-w workers] [-J jitter_us]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (njobs < 1 || seconds < 1) {
+        return 1;
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    Scheduler sched(workers);
+    if (sched.init(ep) < 0) {
+        perror("scheduler init");
+        return 1;
+    }
+    double expected_inline = 0, expected_worker = 0;
+    for (int i = 0; i < njobs; ++i) {
+        bool on_worker = i % 4 == 0;
+        int64_t period = ((on_worker ? 10 : 1) + i % 50) * kMs;
+        char name[32];
+        snprintf(name, sizeof(name), "%s-%d", on_worker ? "worker" : "inline", i);
+        if (on_worker) {
+            sched.add_periodic(name, period, []() { usleep(1000); }, jitter_ns, true);
+            expected_worker += (double)seconds * 1000 * kMs / period;
+        } else {
+            sched.add_periodic(name, period, []() { busy_wait(10000); }, jitter_ns);
+            expected_inline += (double)seconds * 1000 * kMs / period;
+        }
+    }
+    // 10ms 周期的对照任务，结束时看它最后一次执行相对网格的位置
+    int64_t drift_start = Scheduler::now_ns();
+    int64_t drift_last = drift_start;
+    uint64_t drift_runs = 0;
+    sched.add_periodic("drift-10ms", 10 * kMs, [&drift_last, &drift_runs]() {
+        drift_last = Scheduler::now_ns();
+        busy_wait(10000);
+        ++drift_runs;
+    });
+
+    bool running = true;
+    sched.add_oneshot("exit", seconds * 1000 * kMs, [&running]() { running = false; });
+
+    uint64_t sleep_runs = 0;
+    int64_t sleep_drift = 0;
+    std::thread baseline(sleep_loop, 10 * kMs, (int64_t)seconds, &sleep_runs, &sleep_drift);
+
+    uint64_t wakeups = 0;
+    epoll_event events[16];
+    while (running) {
+        int n = epoll_wait(ep, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        ++wakeups;
+        for (int i = 0; i < n; ++i) {
+            sched.handle(events[i].data.fd);
+        }
+    }
+    sched.stop();
+    baseline.join();
+
+    JobStats inl, wrk;
+    sched.for_each_stats([&inl, &wrk](const JobStats& s) {
+        JobStats* dst = s.name.compare(0, 6, "worker") == 0 ? &wrk : s.name.compare(0, 6, "inline") == 0 ? &inl : NULL;
+        if (dst == NULL) {
+            return;
+        }
+        dst->runs += s.runs;
+        dst->skipped += s.skipped;
+        dst->overruns += s.overruns;
+        dst->lateness.merge(s.lateness);
+        dst->run_time.merge(s.run_time);
+    });
+
+    printf("%d 个任务, %d 个工作线程, 抖动 %lld us, 运行 %ds, CPU 数 %ld\n", njobs, workers,
+           (long long)(jitter_ns / 1000), seconds, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-8s %10s %10s %8s %8s | %10s %10s %10s\n", "kind", "runs", "expected", "skipped", "overrun", "late p50",
+           "late p99", "late max");
+    const JobStats* rows[] = {&inl, &wrk};
+    const char* names[] = {"inline", "worker"};
+    double expected[] = {expected_inline, expected_worker};
+    for (int i = 0; i < 2; ++i) {
+        printf("%-8s %10llu %10.0f %8llu %8llu | %10.1f %10.1f %10.1f\n", names[i],
+               (unsigned long long)rows[i]->runs, expected[i], (unsigned long long)rows[i]->skipped,
+               (unsigned long long)rows[i]->overruns, rows[i]->lateness.percentile(50) / 1000.0,
+               rows[i]->lateness.percentile(99) / 1000.0, rows[i]->lateness.max() / 1000.0);
+    }
+    printf("（迟到时间单位 us）主循环唤醒 %llu 次，执行任务 %llu 次\n", (unsigned long long)wakeups,
+           (unsigned long long)(inl.runs + wrk.runs + drift_runs));
+
+    // 调度器第一次执行在 start + period，第 n 次在 start + n * period
+    int64_t sched_drift = drift_start + (int64_t)drift_runs * 10 * kMs - drift_last;
+    printf("10ms 周期 %ds: 理论 %d 次 | sleep 循环 %llu 次，结束时落后网格 %.1f ms | 调度器 %llu 次，落后 %.3f ms\n",
+           seconds, seconds * 100, (unsigned long long)sleep_runs, -sleep_drift / 1e6, (unsigned long long)drift_runs,
+           -sched_drift / 1e6);
+    close(ep);
+    return 0;
+}
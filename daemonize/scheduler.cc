@@ -0,0 +1,319 @@
+#include "scheduler.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+Scheduler::Scheduler(int workers)
+    : epfd_(-1),
+      timer_fd_(-1),
+      done_fd_(-1),
+      armed_(0),
+      next_id_(1),
+      rng_(std::random_device()()),
+      nworkers_(workers > 0 ? workers : 0),
+      stopping_(false) {}
+
+Scheduler::~Scheduler() {
+    stop();
+    if (timer_fd_ >= 0) {
+        close(timer_fd_);
+    }
+    if (done_fd_ >= 0) {
+        close(done_fd_);
+    }
+}
+
+int64_t Scheduler::now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int Scheduler::init(int epfd) {
+    epfd_ = epfd;
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    done_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (timer_fd_ < 0 || done_fd_ < 0) {
+        return -1;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd_;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, timer_fd_, &ev) < 0) {
+        return -1;
+    }
+    ev.data.fd = done_fd_;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, done_fd_, &ev) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < nworkers_; ++i) {
+        workers_.push_back(std::thread(&Scheduler::worker_loop, this));
+    }
+    return 0;
+}
+
+bool Scheduler::handle(int fd) {
+    if (fd == timer_fd_) {
+        on_timer();
+        return true;
+    }
+    if (fd == done_fd_) {
+        on_done();
+        return true;
+    }
+    return false;
+}
+
+int Scheduler::add(const std::string& name, const JobOptions& opts, JobFn fn) {
+    std::unique_ptr<Job> job(new Job());
+    job->id = next_id_++;
+    job->opts = opts;
+    job->fn = fn;
+    job->running = false;
+    job->cancelled = false;
+    job->stats.name = name;
+    job->stats.period_ns = opts.period_ns;
+    int64_t delay = opts.delay_ns >= 0 ? opts.delay_ns : opts.period_ns;
+    job->nominal = now_ns() + delay;
+    job->due = job->nominal;
+    if (opts.jitter_ns > 0) {
+        job->due += (int64_t)(rng_() % (uint64_t)opts.jitter_ns);
+    }
+    heap_.push(Due{job->due, job->id});
+    int id = job->id;
+    jobs_[id] = std::move(job);
+    arm();
+    return id;
+}
+
+int Scheduler::add_periodic(const std::string& name, int64_t period_ns, JobFn fn, int64_t jitter_ns, bool on_worker) {
+    JobOptions opts;
+    opts.period_ns = period_ns;
+    opts.jitter_ns = jitter_ns;
+    opts.on_worker = on_worker;
+    return add(name, opts, fn);
+}
+
+int Scheduler::add_oneshot(const std::string& name, int64_t delay_ns, JobFn fn, bool on_worker) {
+    JobOptions opts;
+    opts.delay_ns = delay_ns;
+    opts.on_worker = on_worker;
+    return add(name, opts, fn);
+}
+
+void Scheduler::cancel(int id) {
+    std::map<int, std::unique_ptr<Job>>::iterator it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return;
+    }
+    it->second->cancelled = true;
+    if (!it->second->running) {
+        jobs_.erase(it);  // 堆里的条目找不到任务，弹出时丢弃
+    }
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        work_.clear();  // 还没开始的不再执行
+    }
+    cv_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+    workers_.clear();
+    on_done();  // 收掉已经跑完的，统计完整
+    if (timer_fd_ >= 0) {
+        itimerspec its;
+        memset(&its, 0, sizeof(its));
+        timerfd_settime(timer_fd_, 0, &its, NULL);
+        armed_ = 0;
+    }
+}
+
+void Scheduler::on_timer() {
+    uint64_t expirations;
+    while (read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+    }
+    armed_ = 0;
+    if (stopping_) {
+        return;
+    }
+    int64_t now = now_ns();
+    while (!heap_.empty() && heap_.top().due <= now) {
+        Due d = heap_.top();
+        heap_.pop();
+        std::map<int, std::unique_ptr<Job>>::iterator it = jobs_.find(d.id);
+        if (it == jobs_.end() || it->second->cancelled || it->second->due != d.due) {
+            continue;
+        }
+        dispatch(it->second.get(), now);
+        // 前面的内联任务可能跑了一段时间，后面的任务按新的时间判断是否到期
+        now = now_ns();
+    }
+    arm();
+}
+
+void Scheduler::dispatch(Job* job, int64_t now) {
+    int64_t due = job->due;
+    if (job->running) {
+        ++job->stats.overruns;
+        reschedule(job, now);
+        return;
+    }
+    if (job->opts.on_worker && nworkers_ > 0) {
+        job->running = true;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            work_.push_back(Work{job, due});
+        }
+        cv_.notify_one();
+        reschedule(job, now);
+        return;
+    }
+    int64_t start = now_ns();
+    job->running = true;
+    job->fn();
+    job->running = false;
+    int64_t end = now_ns();
+    ++job->stats.runs;
+    job->stats.lateness.record(start - due);
+    job->stats.run_time.record(end - start);
+    if (job->opts.period_ns > 0 && !job->cancelled) {
+        reschedule(job, end);
+    } else {
+        finish(job);
+    }
+}
+
+/** 在网格上推进到 now 之后的第一个截止时间；一次性任务不再排队 */
+void Scheduler::reschedule(Job* job, int64_t now) {
+    if (job->opts.period_ns <= 0) {
+        return;
+    }
+    int64_t period = job->opts.period_ns;
+    job->nominal += period;
+    if (job->nominal <= now) {
+        int64_t missed = (now - job->nominal) / period + 1;
+        job->stats.skipped += missed;
+        job->nominal += missed * period;
+    }
+    job->due = job->nominal;
+    if (job->opts.jitter_ns > 0) {
+        job->due += (int64_t)(rng_() % (uint64_t)job->opts.jitter_ns);
+    }
+    heap_.push(Due{job->due, job->id});
+}
+
+/** 一次性任务执行完、或被取消的任务最后一次执行完时移除 */
+void Scheduler::finish(Job* job) {
+    jobs_.erase(job->id);
+}
+
+void Scheduler::on_done() {
+    uint64_t v;
+    while (read(done_fd_, &v, sizeof(v)) < 0 && errno == EINTR) {
+    }
+    std::vector<Done> done;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        done.swap(done_);
+    }
+    for (size_t i = 0; i < done.size(); ++i) {
+        std::map<int, std::unique_ptr<Job>>::iterator it = jobs_.find(done[i].id);
+        if (it == jobs_.end()) {
+            continue;
+        }
+        Job* job = it->second.get();
+        job->running = false;
+        ++job->stats.runs;
+        job->stats.lateness.record(done[i].start - done[i].due);
+        job->stats.run_time.record(done[i].end - done[i].start);
+        if (job->cancelled || job->opts.period_ns <= 0) {
+            finish(job);
+        }
+    }
+}
+
+void Scheduler::arm() {
+    while (!heap_.empty()) {
+        const Due& d = heap_.top();
+        std::map<int, std::unique_ptr<Job>>::iterator it = jobs_.find(d.id);
+        if (it != jobs_.end() && !it->second->cancelled && it->second->due == d.due) {
+            break;
+        }
+        heap_.pop();
+    }
+    if (heap_.empty() || stopping_) {
+        return;  // 没有任务时让 timerfd 保持未触发，主循环不会被叫醒
+    }
+    int64_t due = heap_.top().due;
+    if (armed_ == due) {
+        return;
+    }
+    itimerspec its;
+    memset(&its, 0, sizeof(its));
+    // 0 表示解除定时器，已经到期的任务至少设 1ns 让它马上触发
+    its.it_value.tv_sec = due / 1000000000LL;
+    its.it_value.tv_nsec = due % 1000000000LL;
+    if (due <= 0) {
+        its.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, NULL);
+    armed_ = due;
+}
+
+void Scheduler::worker_loop() {
+    for (;;) {
+        Work w;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopping_ || !work_.empty(); });
+            if (work_.empty()) {
+                return;
+            }
+            w = work_.front();
+            work_.pop_front();
+        }
+        // 任务对象在 running 期间不会被主循环删除，这里可以安全访问
+        int64_t start = now_ns();
+        w.job->fn();
+        int64_t end = now_ns();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            done_.push_back(Done{w.job->id, w.due, start, end});
+        }
+        uint64_t one = 1;
+        ssize_t n = write(done_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void Scheduler::for_each_stats(const std::function<void(const JobStats&)>& fn) const {
+    for (std::map<int, std::unique_ptr<Job>>::const_iterator it = jobs_.begin(); it != jobs_.end(); ++it) {
+        fn(it->second->stats);
+    }
+}
+
+void Scheduler::print_stats(FILE* out) const {
+    fprintf(out, "%-16s %10s %8s %8s %8s | %10s %10s %10s | %10s %10s %10s\n", "job", "period(ms)", "runs",
+            "skipped", "overrun", "late p50", "late p99", "late max", "run p50", "run p99", "run max");
+    for_each_stats([out](const JobStats& s) {
+        fprintf(out, "%-16s %10.1f %8llu %8llu %8llu | %10.1f %10.1f %10.1f | %10.1f %10.1f %10.1f\n", s.name.c_str(),
+                s.period_ns / 1e6, (unsigned long long)s.runs, (unsigned long long)s.skipped,
+                (unsigned long long)s.overruns, s.lateness.percentile(50) / 1000.0,
+                s.lateness.percentile(99) / 1000.0, s.lateness.max() / 1000.0, s.run_time.percentile(50) / 1000.0,
+                s.run_time.percentile(99) / 1000.0, s.run_time.max() / 1000.0);
+    });
+    fprintf(out, "（时间单位 us）\n");
+}
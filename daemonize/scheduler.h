@@ -0,0 +1,147 @@
+#ifndef DAEMONIZE_SCHEDULER_H
+#define DAEMONIZE_SCHEDULER_H
+
+/**
+ * 基于 timerfd 的周期/一次性任务调度器，挂在守护进程自己的 epoll 主循环上
+ *
+ *  - 所有任务共用一个 timerfd，按最早的截止时间用 TFD_TIMER_ABSTIME 设成绝对时间；
+ *    没有任务到期时主循环不会被唤醒
+ *  - 周期任务的截止时间在固定网格上推进（nominal += period），执行快慢不会累积成漂移；
+ *    落后超过一个周期时跳过错过的几次（计入 skipped），不会补跑
+ *  - jitter 在每次截止时间上加 [0, jitter) 的随机量，把同周期任务的负载错开，网格本身不动
+ *  - on_worker 的任务交给工作线程池执行，完成后经 eventfd 通知主循环；
+ *    上一次还没跑完时本次跳过（计入 overruns），同一个任务不会并发执行
+ *  - 每个任务记录执行时间和迟到时间（实际开始 - 截止时间）直方图，单位纳秒
+ *
+ * 除了 worker 线程里执行的任务函数，所有接口都只能在主循环线程调用。
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.h"
+
+struct JobOptions {
+    int64_t period_ns;  // 0 表示一次性任务
+    int64_t delay_ns;   // 第一次执行距现在的时间；小于 0 时取 period_ns
+    int64_t jitter_ns;
+    bool on_worker;     // 在工作线程池里执行（耗时任务）
+
+    JobOptions() : period_ns(0), delay_ns(-1), jitter_ns(0), on_worker(false) {}
+};
+
+struct JobStats {
+    std::string name;
+    int64_t period_ns;
+    uint64_t runs;
+    uint64_t skipped;   // 主循环落后超过一个周期而跳过的次数
+    uint64_t overruns;  // 到期时上一次还没执行完而跳过的次数
+    LatencyHistogram lateness;
+    LatencyHistogram run_time;
+
+    JobStats() : period_ns(0), runs(0), skipped(0), overruns(0) {}
+};
+
+class Scheduler {
+public:
+    typedef std::function<void()> JobFn;
+
+    explicit Scheduler(int workers = 2);
+    ~Scheduler();
+
+    /** 创建 timerfd 和完成通知的 eventfd 并注册到 epfd（data.fd 为各自的 fd）；失败返回 -1 */
+    int init(int epfd);
+
+    /** 主循环拿到的 fd 属于调度器时处理它并返回 true */
+    bool handle(int fd);
+
+    /** 返回任务 id */
+    int add(const std::string& name, const JobOptions& opts, JobFn fn);
+    int add_periodic(const std::string& name, int64_t period_ns, JobFn fn, int64_t jitter_ns = 0,
+                     bool on_worker = false);
+    int add_oneshot(const std::string& name, int64_t delay_ns, JobFn fn, bool on_worker = false);
+
+    /** 取消后不再执行；正在工作线程里执行的那一次会跑完 */
+    void cancel(int id);
+
+    /** 等正在执行的任务完成并停止工作线程；之后不再执行任何任务 */
+    void stop();
+
+    size_t size() const { return jobs_.size(); }
+    /** 一次性任务执行完后就被移除，统计也随之消失 */
+    void for_each_stats(const std::function<void(const JobStats&)>& fn) const;
+    void print_stats(FILE* out) const;
+
+    static int64_t now_ns();
+
+private:
+    Scheduler(const Scheduler&);
+    Scheduler& operator=(const Scheduler&);
+
+    struct Job {
+        int id;
+        JobOptions opts;
+        JobFn fn;
+        int64_t nominal;  // 网格上的截止时间
+        int64_t due;      // 加上抖动后的截止时间
+        bool running;
+        bool cancelled;
+        JobStats stats;
+    };
+
+    struct Due {
+        int64_t due;
+        int id;
+        bool operator>(const Due& o) const { return due > o.due; }
+    };
+
+    struct Work {
+        Job* job;
+        int64_t due;
+    };
+
+    struct Done {
+        int id;
+        int64_t due;
+        int64_t start;
+        int64_t end;
+    };
+
+    void on_timer();
+    void on_done();
+    void dispatch(Job* job, int64_t now);
+    void reschedule(Job* job, int64_t now);
+    void finish(Job* job);
+    void arm();
+    void worker_loop();
+
+    int epfd_;
+    int timer_fd_;
+    int done_fd_;
+    int64_t armed_;  // timerfd 当前的截止时间，0 表示未设置
+    int next_id_;
+    std::map<int, std::unique_ptr<Job>> jobs_;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> heap_;  // 过期条目（due 不匹配）惰性丢弃
+    std::mt19937_64 rng_;
+
+    int nworkers_;
+    std::vector<std::thread> workers_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Work> work_;
+    std::vector<Done> done_;
+    bool stopping_;
+};
+
+#endif  // DAEMONIZE_SCHEDULER_H
@@ -0,0 +1,175 @@
+/**
+ * sign_daemon 压测：批大小 1~1024，统计吞吐（签名/秒）和每批往返延迟的 p50/p99
+ *
+ * 用法: sign_bench [-s sock] [-k key_id] [-x 十六进制密钥] [-m 消息长度] [-t 每档秒数] [-o sign|verify]
+ * 先启动守护进程，例如：
+ *   echo "1 000102030405060708090a0b0c0d0e0f" > /tmp/keys && chmod 600 /tmp/keys
+ *   ./sign_daemon -f -k /tmp/keys &
+ *   ./sign_bench -m 64 -x 000102030405060708090a0b0c0d0e0f
+ * 给了 -x 时，守护进程返回的每个 MAC 都和本地 Hmac<Sha256> 的结果逐字节比较（压测中也抽查），
+ * 否则只能检查签名/校验能否互相对上，算错的 MAC 发现不了。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hmac.h"
+#include "sign_protocol.h"
+
+using namespace std;
+
+static bool parse_hex(const char* hex, string* out) {
+    out->clear();
+    size_t n = strlen(hex);
+    if (n == 0 || n % 2 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i += 2) {
+        char byte[3] = {hex[i], hex[i + 1], 0};
+        char* end = NULL;
+        unsigned long v = strtoul(byte, &end, 16);
+        if (end != byte + 2) {
+            return false;
+        }
+        out->push_back((char)v);
+    }
+    return true;
+}
+
+/** 和本地计算的 HMAC-SHA256 逐条比较，返回第一条不一致的下标，全部一致返回 -1 */
+static long first_mismatch(const digest::Hmac<digest::Sha256>& local, const vector<string>& msgs,
+                           const vector<sign::Mac>& macs) {
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        digest::Hmac<digest::Sha256>::Result expect = local.sign(msgs[i]);
+        if (i >= macs.size() || memcmp(expect.data(), macs[i].data(), expect.size()) != 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    string sock_path = "/tmp/sign_daemon.sock";
+    uint32_t key_id = 1;
+    size_t msg_size = 64;
+    double seconds = 1.0;
+    bool verify = false;
+    string key;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:x:m:t:o:")) != -1) {
+        switch (opt) {
+            case 's': sock_path = optarg; break;
+            case 'k': key_id = (uint32_t)atoi(optarg); break;
+            case 'x':
+                if (!parse_hex(optarg, &key)) {
+                    fprintf(stderr, "-x 需要偶数位的十六进制密钥\n");
+                    return 1;
+                }
+                break;
+            case 'm': msg_size = (size_t)atoi(optarg); break;
+            case 't': seconds = atof(optarg); break;
+            case 'o': verify = strcmp(optarg, "verify") == 0; break;
+            default:
+                fprintf(stderr, "用法: %s [-s sock] [-k key_id] [-x hexkey] [-m size] [-t seconds] [-o sign|verify]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    sign::Client client;
+    if (!client.connect_to(sock_path)) {
+        fprintf(stderr, "连接 %s 失败: %s\n", sock_path.c_str(), strerror(errno));
+        return 1;
+    }
+
+    digest::Hmac<digest::Sha256> local(key);
+    bool check_mac = !key.empty();
+
+    // 正确性：签名后校验应全部通过，篡改一个字节后应失败；有密钥时 MAC 还要和本地结果一致。
+    // 只有 1 条时守护进程逐条计算，19 条时走多缓冲；消息长度跨过 SHA-256 的填充边界
+    static const size_t kCheckBatches[] = {1, 19};
+    for (size_t batch : kCheckBatches) {
+        vector<string> msgs;
+        for (size_t i = 0; i < batch; ++i) msgs.push_back(string(i * 37 + 55 / batch, (char)('a' + i)));
+        vector<sign::Mac> macs;
+        vector<uint8_t> ok;
+        if (!client.sign(key_id, msgs, &macs) || !client.verify(key_id, msgs, macs, &ok)) {
+            fprintf(stderr, "请求失败: status=%d errno=%s\n", client.last_status(), strerror(errno));
+            return 1;
+        }
+        long bad = check_mac ? first_mismatch(local, msgs, macs) : -1;
+        if (bad >= 0) {
+            fprintf(stderr, "第 %ld 条 MAC 与本地 HMAC-SHA256 不一致（批大小 %zu）\n", bad, batch);
+            return 1;
+        }
+        bool all = std::count(ok.begin(), ok.end(), 1) == (long)ok.size();
+        size_t tampered = batch / 2;
+        macs[tampered][0] ^= 1;
+        client.verify(key_id, msgs, macs, &ok);
+        if (!all || ok[tampered] != 0) {
+            fprintf(stderr, "签名/校验结果不一致\n");
+            return 1;
+        }
+    }
+
+    // 超过 kMaxBatch 的批在客户端就被拒绝，连接不受影响
+    vector<string> too_many(sign::kMaxBatch + 1, string(8, 'x'));
+    vector<sign::Mac> unused;
+    if (client.sign(key_id, too_many, &unused) || errno != E2BIG || !client.sign(key_id, vector<string>(1), &unused)) {
+        fprintf(stderr, "%zu 条的批没有在客户端被拒绝\n", too_many.size());
+        return 1;
+    }
+
+    printf("消息长度 %zu 字节, 操作 %s, 每档 %.1f 秒, MAC %s\n", msg_size, verify ? "verify" : "sign", seconds,
+           check_mac ? "已与本地 HMAC-SHA256 比对" : "未比对（没有 -x）");
+    printf("%8s %14s %12s %12s %12s\n", "batch", "签名/秒", "p50(us)", "p99(us)", "us/条");
+
+    typedef chrono::steady_clock Clock;
+    for (size_t batch = 1; batch <= sign::kMaxBatch; batch *= 2) {
+        vector<string> msgs(batch, string(msg_size, 'x'));
+        for (size_t i = 0; i < batch; ++i) {
+            memcpy(&msgs[i][0], &i, min(sizeof(i), msg_size));
+        }
+        vector<sign::Mac> macs;
+        vector<uint8_t> ok;
+        if (verify && !client.sign(key_id, msgs, &macs)) {
+            fprintf(stderr, "签名失败: %s\n", strerror(errno));
+            return 1;
+        }
+
+        vector<double> lat_us;
+        uint64_t done = 0;
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds));
+        Clock::time_point now = start;
+        while (now < deadline) {
+            Clock::time_point t0 = Clock::now();
+            bool good = verify ? client.verify(key_id, msgs, macs, &ok) : client.sign(key_id, msgs, &macs);
+            now = Clock::now();
+            if (!good) {
+                fprintf(stderr, "请求失败: %s\n", strerror(errno));
+                return 1;
+            }
+            lat_us.push_back(chrono::duration<double, micro>(now - t0).count());
+            done += batch;
+        }
+        long bad = check_mac && !verify ? first_mismatch(local, msgs, macs) : -1;
+        if (bad >= 0) {
+            fprintf(stderr, "批大小 %zu: 第 %ld 条 MAC 与本地 HMAC-SHA256 不一致\n", batch, bad);
+            return 1;
+        }
+        double elapsed = chrono::duration<double>(now - start).count();
+        sort(lat_us.begin(), lat_us.end());
+        double p50 = lat_us[lat_us.size() / 2];
+        double p99 = lat_us[min(lat_us.size() - 1, lat_us.size() * 99 / 100)];
+        printf("%8zu %14.0f %12.1f %12.1f %12.3f\n", batch, done / elapsed, p50, p99, elapsed * 1e6 / done);
+    }
+    return 0;
+}
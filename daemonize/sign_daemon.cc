@@ -0,0 +1,427 @@
+/**
+ * 本机签名服务：各进程不再各自持有密钥、各自调用 HMAC256EncodeNoHex，
+ * 而是通过 SOCK_SEQPACKET Unix 套接字把一批消息发给这个守护进程签名/校验。
+ *
+ *  - 密钥（以及由密钥导出的 ipad/opad 中间状态）放在 mlock 的匿名映射里，
+ *    不会被换出到 swap，也通过 MADV_DONTDUMP 排除在 core dump 之外
+ *  - 一个数据报就是一批请求，一次 recv/一次 send 摊薄系统调用开销
+ *  - 批量签名使用 8 路多缓冲 SHA-256（-e mb），也可以切回逐条计算（-e single）对比
+ *
+ * 用法: sign_daemon -k keyfile [-s /tmp/sign_daemon.sock] [-e mb|single] [-f]
+ *   keyfile 每行 "<key_id> <十六进制密钥>"，# 开头为注释
+ *   -f 前台运行（不调用 daemonize），方便压测和调试
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "daemonize.h"
+#include "sign_protocol.h"
+#include "hmac.h"
+#include "sha256_mb.h"
+
+/**
+ * 单个密钥在锁定内存中的全部状态
+ */
+struct KeyEntry {
+    KeyEntry(uint32_t key_id, const uint8_t* key, size_t len) : id(key_id), single(key, len), batch(key, len) {}
+
+    uint32_t id;
+    digest::Hmac<digest::Sha256> single;
+    digest::HmacSha256Batch batch;
+};
+
+/**
+ * 固定容量的密钥表，整块内存 mlock，析构时清零
+ */
+class LockedKeyStore {
+public:
+    LockedKeyStore() : mem_(NULL), bytes_(0), capacity_(0), size_(0) {}
+    ~LockedKeyStore() {
+        if (mem_ != NULL) {
+            for (size_t i = 0; i < size_; ++i) {
+                entries()[i].~KeyEntry();
+            }
+            explicit_bzero(mem_, bytes_);
+            munlock(mem_, bytes_);
+            munmap(mem_, bytes_);
+        }
+    }
+
+    bool init(size_t capacity) {
+        long page = sysconf(_SC_PAGESIZE);
+        bytes_ = (capacity * sizeof(KeyEntry) + page - 1) / page * page;
+        mem_ = mmap(NULL, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem_ == MAP_FAILED) {
+            mem_ = NULL;
+            fprintf(stderr, "mmap 失败: %s\n", strerror(errno));
+            return false;
+        }
+        if (mlock(mem_, bytes_) < 0) {
+            fprintf(stderr, "mlock 失败(检查 ulimit -l): %s\n", strerror(errno));
+            return false;
+        }
+        madvise(mem_, bytes_, MADV_DONTDUMP);
+        capacity_ = capacity;
+        return true;
+    }
+
+    /**
+     * fork 出来的子进程不继承内存锁（MADV_DONTDUMP 会继承），daemonize() 之后要在子进程里重新 mlock。
+     * 私有映射在 fork 后是写时复制的，mlock 会让子进程拿到自己的一份并锁住
+     */
+    bool relock() {
+        return mem_ == NULL || mlock(mem_, bytes_) == 0;
+    }
+
+    bool add(uint32_t id, const uint8_t* key, size_t len) {
+        if (size_ == capacity_ || find(id) != NULL) {
+            return false;
+        }
+        new (&entries()[size_]) KeyEntry(id, key, len);
+        ++size_;
+        return true;
+    }
+
+    const KeyEntry* find(uint32_t id) const {
+        for (size_t i = 0; i < size_; ++i) {
+            if (entries()[i].id == id) {
+                return &entries()[i];
+            }
+        }
+        return NULL;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    KeyEntry* entries() const { return static_cast<KeyEntry*>(mem_); }
+
+    void* mem_;
+    size_t bytes_;
+    size_t capacity_;
+    size_t size_;
+};
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * 读取密钥文件，明文密钥只在栈上短暂停留，用完即清零。
+ * 密钥超过 512 字节、十六进制位数为奇数或者后面跟着别的字符时整个文件作废，不做截断
+ */
+static int load_keys(const char* path, LockedKeyStore* store) {
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "打开密钥文件 %s 失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[1280];  // key_id + 1024 个十六进制字符 + 注释
+    uint8_t key[512];
+    int line_no = 0;
+    int ret = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        ++line_no;
+        if (strchr(line, '\n') == NULL && !feof(fp)) {
+            fprintf(stderr, "%s:%d: 行太长\n", path, line_no);
+            ret = -1;
+            break;
+        }
+        char* p = line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+        char* end = NULL;
+        unsigned long id = strtoul(p, &end, 10);
+        if (end == p) {
+            fprintf(stderr, "%s:%d: 缺少 key_id\n", path, line_no);
+            ret = -1;
+            break;
+        }
+        p = end;
+        while (*p == ' ' || *p == '\t') ++p;
+        size_t len = 0;
+        while (hex_value(p[0]) >= 0 && hex_value(p[1]) >= 0 && len < sizeof(key)) {
+            key[len++] = (uint8_t)(hex_value(p[0]) << 4 | hex_value(p[1]));
+            p += 2;
+        }
+        if (hex_value(p[0]) >= 0) {
+            fprintf(stderr, "%s:%d: %s\n", path, line_no,
+                    len == sizeof(key) ? "密钥超过 512 字节" : "十六进制位数为奇数");
+            ret = -1;
+            break;
+        }
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ++p;
+        if (*p != '\0' && *p != '#') {
+            fprintf(stderr, "%s:%d: 密钥后有多余字符\n", path, line_no);
+            ret = -1;
+            break;
+        }
+        if (len == 0 || !store->add((uint32_t)id, key, len)) {
+            fprintf(stderr, "%s:%d: 密钥为空、重复或超出容量\n", path, line_no);
+            ret = -1;
+            break;
+        }
+    }
+    explicit_bzero(line, sizeof(line));
+    explicit_bzero(key, sizeof(key));
+    fclose(fp);
+    return ret;
+}
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_stop(int) {
+    g_stop = 1;
+}
+
+/**
+ * 批处理器：解析一个请求数据报，生成一个响应数据报
+ */
+class BatchProcessor {
+public:
+    BatchProcessor(const LockedKeyStore& keys, bool multi_buffer) : keys_(keys), multi_buffer_(multi_buffer) {
+        ptrs_.reserve(sign::kMaxBatch);
+        lens_.reserve(sign::kMaxBatch);
+        expect_.reserve(sign::kMaxBatch);
+        macs_.resize(sign::kMaxBatch);
+    }
+
+    /** 返回响应长度 */
+    size_t process(const uint8_t* req, size_t len, uint8_t* resp) {
+        sign::ResponseHeader rh = {sign::kMagic, sign::kStatusOk, 0};
+        size_t resp_len = sizeof(rh);
+        sign::RequestHeader hdr;
+        const KeyEntry* key = NULL;
+
+        if (len < sizeof(hdr)) {
+            rh.status = sign::kStatusBadRequest;
+        } else {
+            memcpy(&hdr, req, sizeof(hdr));
+            key = keys_.find(hdr.key_id);
+            if (hdr.magic != sign::kMagic || (hdr.op != sign::kOpSign && hdr.op != sign::kOpVerify) ||
+                hdr.count > sign::kMaxBatch || !parse(hdr, req + sizeof(hdr), len - sizeof(hdr))) {
+                rh.status = sign::kStatusBadRequest;
+            } else if (key == NULL) {
+                rh.status = sign::kStatusUnknownKey;
+            }
+        }
+
+        if (rh.status == sign::kStatusOk) {
+            rh.count = hdr.count;
+            compute(*key);
+            if (hdr.op == sign::kOpSign) {
+                for (size_t i = 0; i < hdr.count; ++i) {
+                    memcpy(resp + resp_len, macs_[i].data(), sign::kMacSize);
+                    resp_len += sign::kMacSize;
+                }
+            } else {
+                for (size_t i = 0; i < hdr.count; ++i) {
+                    resp[resp_len++] = digest::constant_time_equal(macs_[i].data(), expect_[i], sign::kMacSize);
+                }
+            }
+        }
+        memcpy(resp, &rh, sizeof(rh));
+        return resp_len;
+    }
+
+private:
+    bool parse(const sign::RequestHeader& hdr, const uint8_t* p, size_t len) {
+        ptrs_.clear();
+        lens_.clear();
+        expect_.clear();
+        const uint8_t* end = p + len;
+        for (size_t i = 0; i < hdr.count; ++i) {
+            uint32_t n;
+            if ((size_t)(end - p) < sizeof(n)) return false;
+            memcpy(&n, p, sizeof(n));
+            p += sizeof(n);
+            if (hdr.op == sign::kOpVerify) {
+                if ((size_t)(end - p) < sign::kMacSize) return false;
+                expect_.push_back(p);
+                p += sign::kMacSize;
+            }
+            if ((size_t)(end - p) < n) return false;
+            ptrs_.push_back(p);
+            lens_.push_back(n);
+            p += n;
+        }
+        return p == end;
+    }
+
+    void compute(const KeyEntry& key) {
+        size_t n = ptrs_.size();
+        if (multi_buffer_ && n > 1) {
+            key.batch.sign(ptrs_.data(), lens_.data(), n, macs_.data());
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                macs_[i] = key.single.sign(ptrs_[i], lens_[i]);
+            }
+        }
+    }
+
+    const LockedKeyStore& keys_;
+    bool multi_buffer_;
+    std::vector<const uint8_t*> ptrs_;
+    std::vector<size_t> lens_;
+    std::vector<const uint8_t*> expect_;
+    std::vector<digest::HmacSha256Batch::Result> macs_;
+};
+
+static int create_listener(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "socket 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        fprintf(stderr, "绑定 %s 失败: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    // 只允许同一用户的进程访问
+    chmod(path, 0600);
+    return fd;
+}
+
+static int serve(int listen_fd, BatchProcessor* processor) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        return -1;
+    }
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, listen_fd, &ev);
+
+    std::vector<uint8_t> req(sign::kMaxPacket);
+    std::vector<uint8_t> resp(sizeof(sign::ResponseHeader) + sign::kMaxBatch * sign::kMacSize);
+    epoll_event events[64];
+    while (!g_stop) {
+        int n = epoll_wait(ep, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                int client;
+                while ((client = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    int buf = (int)sign::kMaxPacket;
+                    setsockopt(client, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+                    setsockopt(client, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+                    ev.events = EPOLLIN;
+                    ev.data.fd = client;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, client, &ev);
+                }
+                continue;
+            }
+
+            // 同一个连接上可能已经排了多个请求，一次唤醒尽量处理完
+            bool closed = false;
+            for (;;) {
+                ssize_t len = recv(fd, req.data(), req.size(), MSG_TRUNC);
+                if (len < 0) {
+                    closed = errno != EAGAIN && errno != EWOULDBLOCK;
+                    break;
+                }
+                if (len == 0 || (size_t)len > req.size()) {
+                    closed = true;  // 对端关闭，或请求超过 kMaxPacket 被截断
+                    break;
+                }
+                size_t resp_len = processor->process(req.data(), (size_t)len, resp.data());
+                // 一问一答的客户端不会把发送缓冲区塞满，塞满说明对端不读响应，直接断开
+                if (send(fd, resp.data(), resp_len, MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)resp_len) {
+                    closed = true;
+                    break;
+                }
+            }
+            if (closed) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, fd, NULL);
+                close(fd);
+            }
+        }
+    }
+    close(ep);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* sock_path = "/tmp/sign_daemon.sock";
+    const char* key_path = NULL;
+    bool foreground = false;
+    bool multi_buffer = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:e:f")) != -1) {
+        switch (opt) {
+            case 's': sock_path = optarg; break;
+            case 'k': key_path = optarg; break;
+            case 'e': multi_buffer = strcmp(optarg, "single") != 0; break;
+            case 'f': foreground = true; break;
+            default:
+                fprintf(stderr, "用法: %s -k keyfile [-s sock] [-e mb|single] [-f]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (key_path == NULL || sock_path[0] != '/') {
+        fprintf(stderr, "必须指定 -k keyfile，且套接字路径必须是绝对路径（daemonize 会 chdir 到 /）\n");
+        return 1;
+    }
+
+    LockedKeyStore keys;
+    if (!keys.init(256) || load_keys(key_path, &keys) < 0) {
+        return 1;
+    }
+    int listen_fd = create_listener(sock_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    printf("sign_daemon: %zu 个密钥, 监听 %s, 引擎 %s\n", keys.size(), sock_path, multi_buffer ? "mb" : "single");
+    fflush(stdout);
+
+    // 密钥在前台加载，出错能直接看到；daemonize() 两次 fork 之后锁要在最终的子进程里重新加
+    if (!foreground && daemonize() < 0) {
+        fprintf(stderr, "守护进程创建失败\n");
+        return 1;
+    }
+    if (!foreground && !keys.relock()) {
+        return 1;  // 不带着可能被换出的密钥运行
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;  // 不设置 SA_RESTART，让 epoll_wait 返回 EINTR
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    BatchProcessor processor(keys, multi_buffer);
+    serve(listen_fd, &processor);
+
+    close(listen_fd);
+    unlink(sock_path);
+    return 0;
+}
@@ -0,0 +1,179 @@
+#ifndef DAEMONIZE_SIGN_PROTOCOL_H
+#define DAEMONIZE_SIGN_PROTOCOL_H
+
+/**
+ * sign_daemon 的请求/响应格式与一个最简单的同步客户端
+ *
+ * 传输层是 SOCK_SEQPACKET 的 Unix 域套接字：一次 send 就是一个完整的批量请求，
+ * 内核保证消息边界，不需要自己做长度前缀和拆包。
+ *
+ * 请求:  RequestHeader + count 个条目
+ *        条目 = uint32_t len + [校验时: 32 字节 MAC] + len 字节消息（紧密排列）
+ * 响应:  ResponseHeader + 签名时 count*32 字节 MAC / 校验时 count 字节结果(1=通过)
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace sign {
+
+const uint32_t kMagic = 0x4e474953;  // "SIGN"
+const size_t kMacSize = 32;
+const size_t kMaxBatch = 1024;
+const size_t kMaxPacket = 4 << 20;
+
+enum Op {
+    kOpSign = 1,
+    kOpVerify = 2,
+};
+
+enum Status {
+    kStatusOk = 0,
+    kStatusBadRequest = 1,
+    kStatusUnknownKey = 2,
+};
+
+struct RequestHeader {
+    uint32_t magic;
+    uint16_t op;
+    uint16_t count;
+    uint32_t key_id;
+};
+
+struct ResponseHeader {
+    uint32_t magic;
+    uint16_t status;
+    uint16_t count;
+};
+
+typedef std::array<uint8_t, kMacSize> Mac;
+
+/**
+ * 同步客户端：一次请求对应一次应答，不做流水线。
+ * 守护进程一定会拒绝的请求（超过 kMaxBatch 条、超过 kMaxPacket 字节）在本地就返回 false，不发出去
+ */
+class Client {
+public:
+    Client() : fd_(-1) {}
+    ~Client() { close_fd(); }
+
+    bool connect_to(const std::string& path) {
+        close_fd();
+        fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        int buf = (int)kMaxPacket;
+        setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close_fd();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * 批量签名，失败返回 false（errno 或 last_status() 说明原因）；
+     * 批太大时 errno 为 E2BIG（条数超过 kMaxBatch）或 EMSGSIZE（请求超过 kMaxPacket）
+     */
+    bool sign(uint32_t key_id, const std::vector<std::string>& msgs, std::vector<Mac>* macs) {
+        if (!call(kOpSign, key_id, msgs, NULL, msgs.size() * kMacSize)) {
+            return false;
+        }
+        macs->resize(msgs.size());
+        for (size_t i = 0; i < msgs.size(); ++i) {
+            memcpy((*macs)[i].data(), &resp_[sizeof(ResponseHeader) + i * kMacSize], kMacSize);
+        }
+        return true;
+    }
+
+    /** 批量校验，ok[i] 为 1 表示第 i 条消息的 MAC 正确 */
+    bool verify(uint32_t key_id, const std::vector<std::string>& msgs, const std::vector<Mac>& macs,
+                std::vector<uint8_t>* ok) {
+        if (!call(kOpVerify, key_id, msgs, &macs, msgs.size())) {
+            return false;
+        }
+        ok->assign(resp_.begin() + sizeof(ResponseHeader), resp_.begin() + sizeof(ResponseHeader) + msgs.size());
+        return true;
+    }
+
+    int last_status() const { return status_; }
+
+private:
+    bool call(uint16_t op, uint32_t key_id, const std::vector<std::string>& msgs, const std::vector<Mac>* macs,
+              size_t body_size) {
+        // count 在协议里只有 16 位，先检查再截断，否则 65537 条会变成 1 条发出去
+        if (msgs.size() > kMaxBatch) {
+            errno = E2BIG;
+            return false;
+        }
+        if (macs != NULL && macs->size() < msgs.size()) {
+            errno = EINVAL;
+            return false;
+        }
+        size_t size = sizeof(RequestHeader);
+        for (size_t i = 0; i < msgs.size(); ++i) {
+            size += sizeof(uint32_t) + (macs != NULL ? kMacSize : 0) + msgs[i].size();
+        }
+        if (size > kMaxPacket) {
+            errno = EMSGSIZE;
+            return false;
+        }
+        RequestHeader hdr = {kMagic, op, (uint16_t)msgs.size(), key_id};
+        req_.reserve(size);
+        req_.assign((const uint8_t*)&hdr, (const uint8_t*)&hdr + sizeof(hdr));
+        for (size_t i = 0; i < msgs.size(); ++i) {
+            uint32_t len = (uint32_t)msgs[i].size();
+            req_.insert(req_.end(), (const uint8_t*)&len, (const uint8_t*)&len + sizeof(len));
+            if (macs != NULL) {
+                req_.insert(req_.end(), (*macs)[i].begin(), (*macs)[i].end());
+            }
+            req_.insert(req_.end(), msgs[i].begin(), msgs[i].end());
+        }
+        if (send(fd_, req_.data(), req_.size(), MSG_NOSIGNAL) != (ssize_t)req_.size()) {
+            return false;
+        }
+        resp_.resize(sizeof(ResponseHeader) + body_size);
+        ssize_t n = recv(fd_, resp_.data(), resp_.size(), 0);
+        if (n < (ssize_t)sizeof(ResponseHeader)) {
+            if (n >= 0) errno = EPROTO;
+            return false;
+        }
+        ResponseHeader rh;
+        memcpy(&rh, resp_.data(), sizeof(rh));
+        status_ = rh.status;
+        if (rh.magic != kMagic || rh.status != kStatusOk || (size_t)n != resp_.size()) {
+            errno = EPROTO;
+            return false;
+        }
+        return true;
+    }
+
+    void close_fd() {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    int fd_;
+    int status_ = kStatusOk;
+    std::vector<uint8_t> req_;
+    std::vector<uint8_t> resp_;
+};
+
+}  // namespace sign
+
+#endif  // DAEMONIZE_SIGN_PROTOCOL_H
@@ -0,0 +1,85 @@
+#include "signal_fd.h"
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+
+SignalFd::SignalFd() : fd_(-1), reads_(0), delivered_(0) { sigemptyset(&mask_); }
+
+SignalFd::~SignalFd() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+int SignalFd::block(std::initializer_list<int> sigs) {
+    for (int sig : sigs) {
+        sigaddset(&mask_, sig);
+    }
+    return pthread_sigmask(SIG_BLOCK, &mask_, NULL) == 0 ? 0 : -1;
+}
+
+int SignalFd::init(int epfd, Handler handler) {
+    handler_ = handler;
+    fd_ = signalfd(-1, &mask_, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd_ < 0) {
+        return -1;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd_;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd_, &ev);
+}
+
+bool SignalFd::handle(int fd) {
+    if (fd != fd_) {
+        return false;
+    }
+    signalfd_siginfo si[kBatch];
+    for (;;) {
+        ssize_t n = read(fd_, si, sizeof(si));
+        if (n < 0) {
+            // EAGAIN：已经读空
+            if (errno == EINTR) continue;
+            break;
+        }
+        ++reads_;
+        size_t count = (size_t)n / sizeof(si[0]);
+        for (size_t i = 0; i < count; ++i) {
+            ++delivered_;
+            handler_(si[i]);
+        }
+        if (count < (size_t)kBatch) {
+            break;
+        }
+    }
+    return true;
+}
+
+void SignalFd::unblock_in_child() const {
+    for (int sig = 1; sig < NSIG; ++sig) {
+        if (sigismember(&mask_, sig) == 1) {
+            signal(sig, SIG_DFL);
+        }
+    }
+    sigprocmask(SIG_UNBLOCK, &mask_, NULL);
+}
+
+int SignalFd::reap_children(const std::function<void(pid_t pid, int status)>& fn) {
+    int reaped = 0;
+    for (;;) {
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid <= 0) {
+            // 0：还有子进程在运行；-1/ECHILD：没有子进程了
+            break;
+        }
+        ++reaped;
+        fn(pid, status);
+    }
+    return reaped;
+}
@@ -0,0 +1,71 @@
+#ifndef DAEMONIZE_SIGNAL_FD_H
+#define DAEMONIZE_SIGNAL_FD_H
+
+/**
+ * 把信号变成 epoll 主循环里的普通事件
+ *
+ *  - block() 在进程（主线程）里屏蔽要接管的信号，必须在创建任何线程之前调用：
+ *    新线程继承屏蔽字，信号就不会被投递到某个工作线程上打断它，也不再有异步信号处理函数，
+ *    处理逻辑里可以随便用 malloc/日志/锁
+ *  - init(epfd) 创建非阻塞 signalfd 并注册到 epoll，handle(fd) 一次读出所有挂起的信号，
+ *    逐个回调（每次 read 最多取 kBatch 个 signalfd_siginfo）
+ *  - 普通信号（1-31）挂起期间再来只会合并成一个，回调次数 <= 发送次数：
+ *    SIGCHLD 不能按 "一个信号一个子进程" 处理，要用 reap_children() 循环 waitpid(WNOHANG) 直到没有为止
+ *  - 实时信号（SIGRTMIN 起）按 sigqueue 排队，不会合并，ssi_int/ssi_ptr 带着发送方的值
+ *  - fork 出来的子进程会继承屏蔽字，exec 之前要 unblock_in_child() 恢复
+ *
+ * 除 block()/unblock_in_child() 外，所有接口只能在主循环线程调用。
+ */
+
+#include <signal.h>
+#include <stdint.h>
+#include <sys/signalfd.h>
+#include <sys/types.h>
+#include <functional>
+#include <initializer_list>
+
+class SignalFd {
+public:
+    typedef std::function<void(const signalfd_siginfo& si)> Handler;
+
+    static const int kBatch = 32;
+
+    SignalFd();
+    ~SignalFd();
+
+    /** 屏蔽 sigs 并记下来给 init() 用；返回 -1 表示失败 */
+    int block(std::initializer_list<int> sigs);
+
+    /** 创建 signalfd 注册到 epfd（data.fd 为 signalfd），之后收到的信号交给 handler */
+    int init(int epfd, Handler handler);
+
+    /** 主循环拿到的 fd 是 signalfd 时读完所有挂起的信号并返回 true */
+    bool handle(int fd);
+
+    int fd() const { return fd_; }
+
+    /** read 的次数和读到的信号数 */
+    uint64_t reads() const { return reads_; }
+    uint64_t delivered() const { return delivered_; }
+
+    /** fork 之后、exec 之前在子进程里调用：恢复默认处理方式并解除屏蔽 */
+    void unblock_in_child() const;
+
+    /**
+     * 回收所有已经退出的子进程，每个调用一次 fn(pid, status)，返回回收数。
+     * 收到 SIGCHLD 时调用；合并掉的 SIGCHLD 对应的子进程也会在这里一起回收
+     */
+    static int reap_children(const std::function<void(pid_t pid, int status)>& fn);
+
+private:
+    SignalFd(const SignalFd&);
+    SignalFd& operator=(const SignalFd&);
+
+    sigset_t mask_;
+    int fd_;
+    Handler handler_;
+    uint64_t reads_;
+    uint64_t delivered_;
+};
+
+#endif  // DAEMONIZE_SIGNAL_FD_H
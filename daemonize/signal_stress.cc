@@ -0,0 +1,229 @@
+/**
+ * signalfd 主循环的信号压力测试：高频信号下既不丢也不错处理
+ *
+ * 用法: signal_stress [-n children] [-b burst] [-s senders] [-m per_sender]
+ *
+ * 三项检查，全部通过退出码为 0：
+ *   sigchld  分批 fork n 个立即退出的子进程（退出码 = 序号 & 0xff），SIGCHLD 大量合并；
+ *            每个子进程都必须被回收一次且退出码正确
+ *   rt       s 个发送进程各用 sigqueue 发 m 个 SIGRTMIN，值里带 (发送者, 序号)；
+ *            实时信号排队不合并，每个发送者的序号必须不丢、不重、按顺序到达。
+ *            挂起队列满（RLIMIT_SIGPENDING）时 sigqueue 返回 EAGAIN，发送方稍等重试
+ *   std      1 个发送进程连发 m 个 SIGUSR1，最后发一个 SIGUSR2 作结束标记；
+ *            普通信号会合并，只要求收到的 SIGUSR1 在 [1, m] 之间、结束标记一定收到
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <map>
+#include <vector>
+
+#include "signal_fd.h"
+
+static int64_t now_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/** 跑一轮主循环：timeout_ms 内处理到 done() 为真为止；timeout_ms 为 0 时只处理已经到达的事件 */
+template <typename Done>
+static bool pump(int ep, SignalFd* sigs, int timeout_ms, Done done) {
+    int64_t deadline = now_ms() + timeout_ms;
+    epoll_event events[8];
+    while (!done()) {
+        int64_t left = deadline - now_ms();
+        if (left < 0) {
+            left = 0;
+        }
+        int n = epoll_wait(ep, events, 8, (int)left);
+        for (int i = 0; i < n; ++i) {
+            sigs->handle(events[i].data.fd);
+        }
+        if (n <= 0 && left == 0) {
+            return done();
+        }
+    }
+    return true;
+}
+
+static bool check(const char* name, bool ok, const char* detail) {
+    printf("%-8s %s  %s\n", name, ok ? "PASS" : "FAIL", detail);
+    fflush(stdout);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int children = 5000;
+    int burst = 200;
+    int senders = 4;
+    int per_sender = 20000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:s:m:")) != -1) {
+        switch (opt) {
+            case 'n': children = atoi(optarg); break;
+            case 'b': burst = atoi(optarg); break;
+            case 's': senders = atoi(optarg); break;
+            case 'm': per_sender = atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-n children] [-b burst] [-s senders] [-m per_sender]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (children < 1 || burst < 1 || senders < 1 || senders > 255 || per_sender < 1 || per_sender >= (1 << 23)) {
+        return 1;
+    }
+
+    const int kRt = SIGRTMIN;
+    SignalFd sigs;
+    if (sigs.block({SIGCHLD, SIGUSR1, SIGUSR2, kRt}) < 0) {
+        perror("block");
+        return 1;
+    }
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+
+    // 处理函数按当前阶段分派，统计都放在这里
+    std::map<pid_t, int> expect_status;  // pid -> 期望的退出码，回收后删除
+    uint64_t chld_signals = 0, reaped = 0, wrong_status = 0, unknown = 0;
+    std::vector<int> next_seq(senders, 0);
+    uint64_t rt_received = 0, rt_out_of_order = 0;
+    uint64_t usr1 = 0;
+    bool usr2 = false;
+    int rc = sigs.init(ep, [&](const signalfd_siginfo& si) {
+        if (si.ssi_signo == SIGCHLD) {
+            ++chld_signals;
+            SignalFd::reap_children([&](pid_t pid, int status) {
+                ++reaped;
+                std::map<pid_t, int>::iterator it = expect_status.find(pid);
+                if (it == expect_status.end()) {
+                    ++unknown;  // 发送进程，另行等待
+                    return;
+                }
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != it->second) {
+                    ++wrong_status;
+                }
+                expect_status.erase(it);
+            });
+        } else if ((int)si.ssi_signo == kRt) {
+            ++rt_received;
+            int sender = si.ssi_int >> 23, seq = si.ssi_int & ((1 << 23) - 1);
+            if (sender < senders && seq == next_seq[sender]) {
+                ++next_seq[sender];
+            } else {
+                ++rt_out_of_order;
+            }
+        } else if (si.ssi_signo == SIGUSR1) {
+            ++usr1;
+        } else if (si.ssi_signo == SIGUSR2) {
+            usr2 = true;
+        }
+    });
+    if (ep < 0 || rc < 0) {
+        perror("signalfd");
+        return 1;
+    }
+    bool all_ok = true;
+    char detail[256];
+
+    // sigchld：一批批 fork，批与批之间只处理已经到达的事件，让 SIGCHLD 尽量合并
+    int64_t start = now_ms();
+    for (int i = 0; i < children; i += burst) {
+        for (int j = i; j < i + burst && j < children; ++j) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                _exit(j & 0xff);
+            }
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            expect_status[pid] = j & 0xff;
+        }
+        pump(ep, &sigs, 0, []() { return false; });
+    }
+    bool done = pump(ep, &sigs, 30000, [&]() { return expect_status.empty(); });
+    snprintf(detail, sizeof(detail), "%d 个子进程, 收到 SIGCHLD %llu 次, 回收 %llu, 退出码错误 %llu, 未知 %llu, %lld ms",
+             children, (unsigned long long)chld_signals, (unsigned long long)reaped, (unsigned long long)wrong_status,
+             (unsigned long long)unknown, (long long)(now_ms() - start));
+    all_ok &= check("sigchld", done && reaped == (uint64_t)children && wrong_status == 0 && unknown == 0, detail);
+
+    // rt：发送进程自己不处理信号，继承来的屏蔽字无所谓
+    start = now_ms();
+    pid_t parent = getpid();
+    std::vector<pid_t> pids;
+    uint64_t retries_total = 0;
+    int retry_pipe[2];
+    if (pipe(retry_pipe) < 0) {
+        return 1;
+    }
+    for (int s = 0; s < senders; ++s) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            uint32_t retries = 0;
+            for (int seq = 0; seq < per_sender; ++seq) {
+                sigval v;
+                v.sival_int = (s << 23) | seq;
+                while (sigqueue(parent, kRt, v) < 0) {
+                    if (errno != EAGAIN) {
+                        _exit(2);
+                    }
+                    ++retries;
+                    sched_yield();
+                }
+            }
+            ssize_t w = write(retry_pipe[1], &retries, sizeof(retries));
+            _exit(w == (ssize_t)sizeof(retries) ? 0 : 3);
+        }
+        pids.push_back(pid);
+    }
+    uint64_t rt_expected = (uint64_t)senders * per_sender;
+    done = pump(ep, &sigs, 60000, [&]() { return rt_received >= rt_expected; });
+    for (size_t i = 0; i < pids.size(); ++i) {
+        uint32_t retries = 0;
+        if (read(retry_pipe[0], &retries, sizeof(retries)) == (ssize_t)sizeof(retries)) {
+            retries_total += retries;
+        }
+    }
+    close(retry_pipe[0]);
+    close(retry_pipe[1]);
+    // 等 SIGCHLD 把发送进程回收掉
+    pump(ep, &sigs, 5000, [&]() { return unknown >= (uint64_t)senders; });
+    bool seq_ok = true;
+    for (int s = 0; s < senders; ++s) {
+        seq_ok &= next_seq[s] == per_sender;
+    }
+    double secs = (now_ms() - start) / 1000.0;
+    snprintf(detail, sizeof(detail), "%d 个发送者 x %d, 收到 %llu, 乱序/重复 %llu, 队列满重试 %llu 次, %.0f 个/s",
+             senders, per_sender, (unsigned long long)rt_received, (unsigned long long)rt_out_of_order,
+             (unsigned long long)retries_total, secs > 0 ? rt_received / secs : 0.0);
+    all_ok &= check("rt", done && seq_ok && rt_received == rt_expected && rt_out_of_order == 0, detail);
+
+    // std：普通信号合并，但结束标记之前发出的 SIGUSR1 至少有一个被看到
+    start = now_ms();
+    unknown = 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < per_sender; ++i) {
+            kill(parent, SIGUSR1);
+        }
+        kill(parent, SIGUSR2);
+        _exit(0);
+    }
+    done = pump(ep, &sigs, 30000, [&]() { return usr2 && unknown >= 1; });
+    snprintf(detail, sizeof(detail), "发送 SIGUSR1 %d 次, 收到 %llu 次（合并 %.1f%%）, 结束标记 %s, %lld ms", per_sender,
+             (unsigned long long)usr1, 100.0 * (per_sender - (double)usr1) / per_sender, usr2 ? "收到" : "丢失",
+             (long long)(now_ms() - start));
+    all_ok &= check("std", done && usr1 >= 1 && usr1 <= (uint64_t)per_sender, detail);
+
+    printf("signalfd read %llu 次, 读到信号 %llu 个\n", (unsigned long long)sigs.reads(),
+           (unsigned long long)sigs.delivered());
+    close(ep);
+    return all_ok ? 0 : 1;
+}
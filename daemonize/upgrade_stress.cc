@@ -0,0 +1,275 @@
+/**
+ * prefork_server 平滑升级的压力测试：持续负载下连续 SIGUSR2，检查一个请求都不失败
+ *
+ * 用法: upgrade_stress [-u upgrades] [-n workers] [-c conns] [-d seconds] [-w work_us]
+ *
+ * 服务端是同目录下的 prefork_server，由本程序 fork + exec 启动。升级时旧 master 以同样的路径 exec，
+ * 所以这里 "新二进制" 就是同一个文件，流程和替换文件后完全一样。新 master 是旧 master 的子进程，
+ * 旧 master 退出后它会被过继：本程序设成 child subreaper，最后能把所有 master 都收回来。
+ * 所有 master 共用本程序给的 stdout 管道，依次读到：
+ *   "master pid=.. port=.. generation=.."   每个 master 启动时一行
+ *   "spawned=.. ... handoffs=.."             每个 master 退出时一行
+ *
+ * 客户端用 epoll/ 下的闭环压测客户端（HTTP keep-alive，出错重连，按 10ms 一格记录完成数和最大延迟）。
+ * 负载期间均匀地发 upgrades 次 SIGUSR2，每次都等新 master 报到后再继续。
+ * 通过条件：客户端错误数为 0，每次升级都报到了代数加 1 的新 master，所有 master 的 handoffs 之和等于升级次数。
+ * 另外输出每次升级前后 [-50ms, +500ms] 内的最大延迟和最低吞吐，与第一次升级之前的稳态比较（升级的 "抖动"）。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "load_client.h"
+
+static const int kSlotMs = 10;
+
+static int64_t now_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static std::string sibling_path(const char* name) {
+    char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0) {
+        return name;
+    }
+    exe[n] = '\0';
+    std::string dir(exe);
+    return dir.substr(0, dir.rfind('/') + 1) + name;
+}
+
+/** 让内核分配一个空闲端口（关闭后立即交给服务端使用） */
+static int pick_port() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0 && getsockname(fd, (sockaddr*)&addr, &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+/** 服务端 stdout 的逐行读取，带超时：新 master 起不来时不能一直卡在 read 上 */
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    /** 读一行（不含换行）到 line；超时或管道关闭返回 false */
+    bool next(std::string* line, int timeout_ms) {
+        int64_t deadline = now_ms() + timeout_ms;
+        for (;;) {
+            size_t nl = buf_.find('\n');
+            if (nl != std::string::npos) {
+                line->assign(buf_, 0, nl);
+                buf_.erase(0, nl + 1);
+                return true;
+            }
+            int64_t left = deadline - now_ms();
+            if (left <= 0) {
+                return false;
+            }
+            pollfd p = {fd_, POLLIN, 0};
+            if (poll(&p, 1, (int)left) <= 0) {
+                continue;
+            }
+            char tmp[512];
+            ssize_t n = read(fd_, tmp, sizeof(tmp));
+            if (n <= 0) {
+                return false;
+            }
+            buf_.append(tmp, n);
+        }
+    }
+
+private:
+    int fd_;
+    std::string buf_;
+};
+
+struct MasterStats {
+    int masters;         // 读到的退出统计行数
+    unsigned long long handoffs;
+    unsigned long long crashed;
+
+    MasterStats() : masters(0), handoffs(0), crashed(0) {}
+};
+
+/** 读到一行 master 的退出统计就累加，读到 "master pid=" 就返回它的 pid 和代数 */
+static bool next_master(LineReader* out, int timeout_ms, MasterStats* ms, int* pid, int* generation) {
+    std::string line;
+    while (out->next(&line, timeout_ms)) {
+        int port;
+        if (sscanf(line.c_str(), "master pid=%d port=%d generation=%d", pid, &port, generation) == 3) {
+            return true;
+        }
+        const char* h = strstr(line.c_str(), "handoffs=");
+        const char* c = strstr(line.c_str(), "crashed=");
+        if (h != NULL) {
+            ++ms->masters;
+            ms->handoffs += strtoull(h + 9, NULL, 10);
+            ms->crashed += c != NULL ? strtoull(c + 8, NULL, 10) : 0;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    int upgrades = 2;
+    int workers = 2;
+    int work_us = 20;
+    LoadConfig cfg;
+    cfg.host = "127.0.0.1";
+    cfg.conns = 32;
+    cfg.threads = 1;
+    cfg.seconds = 6;
+    cfg.http = true;
+    cfg.reconnect = true;
+    cfg.slot_ms = kSlotMs;
+    int opt;
+    while ((opt = getopt(argc, argv, "u:n:c:d:w:")) != -1) {
+        switch (opt) {
+            case 'u': upgrades = atoi(optarg); break;
+            case 'n': workers = atoi(optarg); break;
+            case 'c': cfg.conns = atoi(optarg); break;
+            case 'd': cfg.seconds = atoi(optarg); break;
+            case 'w': work_us = atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-u upgrades] [-n workers] [-c conns] [-d seconds] [-w work_us]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (upgrades < 1 || workers < 1 || cfg.conns < 1 || cfg.seconds < 2) {
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    // 升级后的 master 是上一代 master 的子进程，上一代退出后过继到这里
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+
+    std::string server = sibling_path("prefork_server");
+    cfg.port = pick_port();
+    int pipefd[2];
+    if (cfg.port < 0 || pipe(pipefd) < 0) {
+        return 1;
+    }
+    pid_t first = fork();
+    if (first == 0) {
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        freopen("/dev/null", "w", stderr);
+        std::string p = std::to_string(cfg.port), n = std::to_string(workers), w = std::to_string(work_us);
+        execl(server.c_str(), server.c_str(), "-H", "127.0.0.1", "-p", p.c_str(), "-n", n.c_str(), "-w", w.c_str(),
+              (char*)NULL);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    LineReader out(pipefd[0]);
+    MasterStats ms;
+    int master = 0, generation = -1;
+    if (first < 0 || !next_master(&out, 5000, &ms, &master, &generation) || generation != 0) {
+        fprintf(stderr, "启动 %s 失败\n", server.c_str());
+        return 1;
+    }
+    printf("服务端 %s, %d 个 worker, 每请求忙等 %d us；%d 连接压 %ds, 期间升级 %d 次\n", server.c_str(), workers,
+           work_us, cfg.conns, cfg.seconds, upgrades);
+    printf("gen %d  master pid %d\n", generation, master);
+    fflush(stdout);
+
+    LoadResult load;
+    int64_t start = now_ms();
+    std::thread loader([&cfg, &load]() { run_load(cfg, &load); });
+
+    std::vector<int64_t> upgrade_at;  // 相对负载开始的毫秒数
+    bool handoffs_ok = true;
+    int64_t interval = cfg.seconds * 1000LL / (upgrades + 1);
+    for (int i = 1; i <= upgrades && handoffs_ok; ++i) {
+        int64_t at = start + interval * i;
+        while (now_ms() < at) {
+            usleep(1000);
+        }
+        upgrade_at.push_back(now_ms() - start);
+        kill(master, SIGUSR2);
+        int pid = 0, gen = -1;
+        int64_t t0 = now_ms();
+        if (!next_master(&out, 10000, &ms, &pid, &gen) || gen != generation + 1 || pid == master) {
+            fprintf(stderr, "第 %d 次升级没有新 master 报到\n", i);
+            handoffs_ok = false;
+            break;
+        }
+        printf("gen %d  master pid %d, SIGUSR2 后 %lld ms 报到\n", gen, pid, (long long)(now_ms() - t0));
+        fflush(stdout);
+        master = pid;
+        generation = gen;
+    }
+    loader.join();
+
+    kill(master, SIGTERM);
+    // 收尾：读完剩下的退出统计，再把 subreaper 名下的进程全部回收
+    int pid, gen;
+    next_master(&out, 10000, &ms, &pid, &gen);
+    close(pipefd[0]);
+    int reaped = 0;
+    while (waitpid(-1, NULL, 0) > 0) {
+        ++reaped;
+    }
+
+    printf("requests %llu, errors %llu, %.0f req/s, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           (unsigned long long)load.requests, (unsigned long long)load.errors, load.requests / load.elapsed_s,
+           load.latency.percentile(50) / 1000.0, load.latency.percentile(99) / 1000.0,
+           load.latency.max() / 1000.0);
+    printf("master 退出 %d 个（回收 %d 个进程）, handoffs %llu, worker 崩溃 %llu\n", ms.masters, reaped, ms.handoffs,
+           ms.crashed);
+
+    // 稳态：第一次升级之前（跳过开头 200ms 的预热）每格的最大延迟取中位数，完成数取平均
+    std::vector<uint64_t> base_max;
+    uint64_t base_reqs = 0;
+    size_t first_slot = 200 / kSlotMs;
+    size_t last_slot = upgrade_at.empty() ? 0 : (size_t)(upgrade_at[0] - 50) / kSlotMs;
+    for (size_t s = first_slot; s < last_slot && s < load.slot_requests.size(); ++s) {
+        base_max.push_back(load.slot_max_ns[s]);
+        base_reqs += load.slot_requests[s];
+    }
+    if (!base_max.empty()) {
+        std::sort(base_max.begin(), base_max.end());
+        printf("稳态: 每 %d ms 最大延迟中位数 %.1f us, 平均完成 %.0f 个\n", kSlotMs,
+               base_max[base_max.size() / 2] / 1000.0, (double)base_reqs / base_max.size());
+    }
+    for (size_t i = 0; i < upgrade_at.size(); ++i) {
+        size_t from = (size_t)std::max<int64_t>(0, upgrade_at[i] - 50) / kSlotMs;
+        size_t to = std::min(load.slot_requests.size(), (size_t)(upgrade_at[i] + 500) / kSlotMs);
+        uint64_t worst = 0, fewest = UINT64_MAX;
+        for (size_t s = from; s < to; ++s) {
+            worst = std::max(worst, load.slot_max_ns[s]);
+            fewest = std::min(fewest, load.slot_requests[s]);
+        }
+        printf("升级 %zu @%lld ms: 前后 [-50, +500] ms 内最大延迟 %.1f us, 每 %d ms 最少完成 %llu 个\n", i + 1,
+               (long long)upgrade_at[i], worst / 1000.0, kSlotMs, (unsigned long long)(to > from ? fewest : 0));
+    }
+
+    bool ok = handoffs_ok && load.errors == 0 && load.requests > 0 && ms.handoffs == (uint64_t)upgrades &&
+              generation == upgrades;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/**
+ * 事件批大小对分发吞吐的影响
+ *
+ * 用法: batch_bench [pairs=4096] [active=pairs] [events=1000000] [socketpair|pipe]
+ *   pairs   套接字对（或管道）个数，读端全部以水平触发注册到同一个 epoll
+ *   active  同时在传递的“令牌”个数，即任一时刻就绪的 fd 数
+ *   events  每个配置处理的事件数
+ *
+ * 每个就绪的读端：循环 read 直到 EAGAIN，再把令牌写进下一个对（间隔一个大质数步长，
+ * 避免相邻的连接状态落在相邻内存），于是 active 个 fd 始终就绪。
+ * 每个对的状态单独 new 出来并打乱分配顺序，模拟真实服务里分散在堆上的连接对象。
+ *
+ * 对 1..1024 的固定批大小和 EventBatch 的自适应批大小各跑一遍，分别开/关预取，输出
+ * 每秒事件数、每个事件摊到的 epoll_wait 次数和系统调用总数（epoll_wait + read + write）。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <vector>
+
+#include "event_batch.h"
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** 每个对的状态，大小和 Connection 相当（两个缓存行以上） */
+struct PairState {
+    int rfd;
+    int wfd;
+    PairState* next;  // 令牌下一步写到哪个对
+    uint64_t reads;
+    uint64_t bytes;
+    char scratch[104];
+};
+
+struct Counters {
+    uint64_t events;
+    uint64_t waits;
+    uint64_t syscalls;
+};
+
+static void set_nonblock(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/** 处理一个就绪的读端：读空，再把令牌转给下一个对 */
+static inline void handle(PairState* s, Counters& c) {
+    char buf[64];
+    for (;;) {
+        ssize_t n = read(s->rfd, buf, sizeof(buf));
+        ++c.syscalls;
+        if (n > 0) {
+            s->bytes += n;
+            if ((size_t)n < sizeof(buf)) {
+                break;  // 读到的比缓冲区少，已经读空，省掉一次返回 EAGAIN 的 read
+            }
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN) {
+            perror("read");
+            exit(1);
+        }
+        break;
+    }
+    ++s->reads;
+    char token = 1;
+    if (write(s->next->wfd, &token, 1) != 1) {
+        perror("write");
+        exit(1);
+    }
+    ++c.syscalls;
+}
+
+static Counters run(int ep, EventBatch& batch, bool prefetch, uint64_t target, double* seconds) {
+    Counters c;
+    memset(&c, 0, sizeof(c));
+    int64_t t0 = monotonic_ns();
+    while (c.events < target) {
+        int n = epoll_wait(ep, batch.data(), batch.size(), -1);
+        ++c.waits;
+        ++c.syscalls;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            exit(1);
+        }
+        batch.update(n);
+        if (prefetch) {
+            batch.prefetch(n, 2, [](const epoll_event&) { return false; });
+        }
+        for (int i = 0; i < n; ++i) {
+            handle(static_cast<PairState*>(batch[i].data.ptr), c);
+        }
+        c.events += n;
+    }
+    *seconds = (monotonic_ns() - t0) / 1e9;
+    return c;
+}
+
+int main(int argc, char* argv[]) {
+    int pairs = argc > 1 ? atoi(argv[1]) : 4096;
+    int active = argc > 2 ? atoi(argv[2]) : pairs;
+    uint64_t target = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000000;
+    bool use_pipe = argc > 4 && strcmp(argv[4], "pipe") == 0;
+    if (pairs <= 0 || active <= 0 || active > pairs) {
+        fprintf(stderr, "用法: %s [pairs] [active<=pairs] [events] [socketpair|pipe]\n", argv[0]);
+        return 1;
+    }
+
+    rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    if ((rlim_t)pairs * 2 + 16 > rl.rlim_cur) {
+        fprintf(stderr, "fd 上限 %llu 不够 %d 个对\n", (unsigned long long)rl.rlim_cur, pairs);
+        return 1;
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<PairState*> states(pairs);
+    std::vector<int> order(pairs);
+    for (int i = 0; i < pairs; ++i) {
+        order[i] = i;
+    }
+    srand(12345);
+    std::random_shuffle(order.begin(), order.end());
+    for (int i = 0; i < pairs; ++i) {
+        PairState* s = new PairState();
+        int fds[2];
+        int ret = use_pipe ? pipe2(fds, O_NONBLOCK | O_CLOEXEC) : socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        if (ret < 0) {
+            perror(use_pipe ? "pipe2" : "socketpair");
+            return 1;
+        }
+        s->rfd = fds[0];
+        s->wfd = fds[1];
+        set_nonblock(s->rfd);
+        set_nonblock(s->wfd);
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = s;
+        epoll_ctl(ep, EPOLL_CTL_ADD, s->rfd, &ev);
+        states[order[i]] = s;
+    }
+    const int kStride = 7919;
+    for (int i = 0; i < pairs; ++i) {
+        states[i]->next = states[(i + kStride) % pairs];
+    }
+    for (int i = 0; i < active; ++i) {
+        char token = 1;
+        if (write(states[(int64_t)i * pairs / active]->wfd, &token, 1) != 1) {
+            perror("write");
+            return 1;
+        }
+    }
+
+    printf("%d 个%s，%d 个同时就绪，每个配置 %llu 个事件\n", pairs, use_pipe ? "管道" : "套接字对", active,
+           (unsigned long long)target);
+    printf("%-10s | %12s %12s | %12s %12s %12s\n", "batch", "Mev/s", "Mev/s", "events/wait", "waits/ev",
+           "syscalls/ev");
+    printf("%-10s | %12s %12s |\n", "", "no prefetch", "prefetch");
+    static const int kBatches[] = {1, 4, 16, 64, 256, 1024, 0};
+    for (size_t b = 0; b < sizeof(kBatches) / sizeof(kBatches[0]); ++b) {
+        int size = kBatches[b];
+        double rate[2];
+        Counters c;
+        for (int p = 0; p < 2; ++p) {
+            // 0 表示自适应：上限 1024，从 64 开始按负载调整
+            EventBatch batch(size ? size : 1024, size ? size : 1);
+            double seconds;
+            run(ep, batch, false, target / 10, &seconds);  // 预热
+            c = run(ep, batch, p == 1, target, &seconds);
+            rate[p] = c.events / seconds / 1e6;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), size ? "%d" : "adaptive", size);
+        printf("%-10s | %12.3f %12.3f | %12.1f %12.4f %12.3f\n", name, rate[0], rate[1],
+               (double)c.events / c.waits, (double)c.waits / c.events, (double)c.syscalls / c.events);
+    }
+    return 0;
+}
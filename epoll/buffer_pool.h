@@ -0,0 +1,73 @@
+#ifndef EPOLL_BUFFER_POOL_H
+#define EPOLL_BUFFER_POOL_H
+
+/**
+ * 定长缓冲块池（单线程使用，每个 Reactor 一个，不需要加锁）
+ *
+ * 连接只在真正有数据要读写时才借一块，读写完立即归还，
+ * 十万个空闲连接也不会各自占着 16KB 的缓冲区。
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <vector>
+
+class BufferPool {
+public:
+    explicit BufferPool(size_t block_size = 16384, size_t max_free = 4096)
+        : block_size_(block_size), max_free_(max_free), in_use_(0) {}
+
+    ~BufferPool() {
+        for (size_t i = 0; i < free_.size(); ++i) {
+            free(free_[i]);
+        }
+    }
+
+    char* acquire() {
+        ++in_use_;
+        if (!free_.empty()) {
+            char* p = free_.back();
+            free_.pop_back();
+            return p;
+        }
+        return static_cast<char*>(malloc(block_size_));
+    }
+
+    void release(char* p) {
+        --in_use_;
+        if (free_.size() < max_free_) {
+            free_.push_back(p);
+        } else {
+            free(p);
+        }
+    }
+
+    size_t block_size() const { return block_size_; }
+    size_t in_use() const { return in_use_; }
+    size_t cached() const { return free_.size(); }
+
+private:
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+
+    size_t block_size_;
+    size_t max_free_;
+    size_t in_use_;
+    std::vector<char*> free_;
+};
+
+/**
+ * 从池里借来的一块缓冲区，[begin, end) 为有效数据
+ */
+struct IoBuffer {
+    char* data;
+    size_t begin;
+    size_t end;
+
+    IoBuffer() : data(NULL), begin(0), end(0) {}
+    size_t readable() const { return end - begin; }
+    char* read_ptr() const { return data + begin; }
+    char* write_ptr() const { return data + end; }
+};
+
+#endif  // EPOLL_BUFFER_POOL_H
@@ -0,0 +1,216 @@
+/**
+ * 协程版 echo 服务器（CoLoop）vs 回调版（Reactor + EchoHandler）
+ *
+ * 用法: co_bench [-c conns] [-t client_threads] [-d seconds] [-s size]
+ *
+ * 两个服务器各自跑在一个线程里，用同一个闭环客户端（load_client.h）压测，输出吞吐、延迟，
+ * 以及压测期间服务端线程每个请求的堆分配次数（替换全局 operator new 按线程计数，
+ * 计数通过向服务端投递任务在服务端线程里读取）。每个版本先预热一轮，让各种池子攒够对象。
+ *
+ * 协程版顺带跑一个每 100ms 醒一次的 sleep_for 协程，结束时打印它醒来的次数。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <new>
+#include <thread>
+
+#include "co_loop.h"
+#include "co_task.h"
+#include "load_client.h"
+#include "reactor.h"
+#include "reactor_handlers.h"
+
+static thread_local uint64_t t_allocs = 0;
+
+void* operator new(size_t size) {
+    ++t_allocs;
+    void* p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/** 投递到服务端线程，读取该线程的分配计数 */
+struct AllocProbe : TaskQueue::Task {
+    std::atomic<bool> done;
+    uint64_t allocs;
+    uint64_t frame_heap_allocs;
+
+    AllocProbe() : done(false), allocs(0), frame_heap_allocs(0) { run = on_run; }
+
+    static void on_run(TaskQueue::Task* task) {
+        AllocProbe* p = static_cast<AllocProbe*>(task);
+        p->allocs = t_allocs;
+        p->frame_heap_allocs = FramePool::heap_allocs();
+        p->done.store(true, std::memory_order_release);
+    }
+};
+
+template <typename Loop>
+static void probe(Loop* loop, AllocProbe* p) {
+    loop->post(p);
+    while (!p->done.load(std::memory_order_acquire)) {
+        usleep(1000);
+    }
+}
+
+static Task<void> echo_session(CoSocket sock) {
+    char buf[16384];
+    for (;;) {
+        ssize_t n = co_await async_read(sock, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        if (co_await async_write(sock, buf, n) < 0) {
+            break;
+        }
+    }
+}
+
+static Task<void> accept_loop(CoLoop* loop, CoSocket* listener) {
+    for (;;) {
+        int fd = co_await async_accept(*listener);
+        if (fd < 0) {
+            // fd 耗尽之类的错误：歇一会再试，不要空转
+            co_await sleep_for(*loop, 10 * 1000000LL);
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        spawn(echo_session(CoSocket(loop, fd)));
+    }
+}
+
+static Task<void> ticker(CoLoop* loop, uint64_t* ticks) {
+    for (;;) {
+        co_await sleep_for(*loop, 100 * 1000000LL);
+        ++*ticks;
+    }
+}
+
+struct Row {
+    LoadResult load;
+    uint64_t allocs;
+    uint64_t frame_heap_allocs;
+};
+
+static void print_row(const char* name, const Row& r) {
+    double rps = r.load.requests / r.load.elapsed_s;
+    printf("%-10s %12.0f %10.1f %10.1f %10.1f %12.4f %8llu\n", name, rps, r.load.latency.percentile(50) / 1000.0,
+           r.load.latency.percentile(99) / 1000.0, r.load.latency.percentile(99.9) / 1000.0,
+           r.load.requests ? (double)r.allocs / r.load.requests : 0, (unsigned long long)r.load.errors);
+}
+
+static int bench_callback(LoadConfig cfg, Row* row) {
+    EchoHandler echo;
+    ReactorOptions opts;
+    opts.threads = 1;
+    ReactorGroup group(&echo, opts);
+    if (group.start("127.0.0.1", 0) < 0) {
+        return -1;
+    }
+    cfg.port = group.port();
+    LoadResult warm;
+    run_load(cfg, &warm);
+
+    AllocProbe before, after;
+    probe(group.reactor(0), &before);
+    run_load(cfg, &row->load);
+    probe(group.reactor(0), &after);
+    group.stop();
+    row->allocs = after.allocs - before.allocs;
+    row->frame_heap_allocs = 0;
+    return 0;
+}
+
+static int bench_coroutine(LoadConfig cfg, Row* row, uint64_t* ticks) {
+    CoLoop loop;
+    if (loop.init() < 0) {
+        return -1;
+    }
+    int lfd = create_reuseport_listener("127.0.0.1", 0, 1024);
+    if (lfd < 0) {
+        return -1;
+    }
+    sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    getsockname(lfd, (sockaddr*)&addr, &alen);
+    cfg.port = ntohs(addr.sin_port);
+
+    // 监听套接字和所有协程都在循环线程里创建；stop() 之后仍挂起的协程（accept_loop、ticker）随进程退出
+    std::thread server([&loop, lfd, ticks]() {
+        CoSocket listener(&loop, lfd);
+        spawn(accept_loop(&loop, &listener));
+        spawn(ticker(&loop, ticks));
+        loop.run();
+    });
+    LoadResult warm;
+    run_load(cfg, &warm);
+
+    AllocProbe before, after;
+    probe(&loop, &before);
+    run_load(cfg, &row->load);
+    probe(&loop, &after);
+    loop.stop();
+    server.join();
+    row->allocs = after.allocs - before.allocs;
+    row->frame_heap_allocs = after.frame_heap_allocs - before.frame_heap_allocs;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig cfg;
+    cfg.host = "127.0.0.1";
+    cfg.port = 0;
+    cfg.conns = 64;
+    cfg.threads = 2;
+    cfg.seconds = 5;
+    cfg.http = false;
+    cfg.size = 64;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:d:s:")) != -1) {
+        switch (opt) {
+            case 'c': cfg.conns = atoi(optarg); break;
+            case 't': cfg.threads = atoi(optarg); break;
+            case 'd': cfg.seconds = atoi(optarg); break;
+            case 's': cfg.size = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "用法: %s [-c conns] [-t client_threads] [-d seconds] [-s size]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.conns < cfg.threads) cfg.conns = cfg.threads;
+    if (cfg.size == 0) cfg.size = 1;
+
+    printf("echo %zu 字节, %d 连接, %d 个客户端线程, 每轮 %ds（另有一轮预热）\n", cfg.size, cfg.conns,
+           cfg.threads, cfg.seconds);
+    printf("%-10s %12s %10s %10s %10s %12s %8s\n", "version", "req/s", "p50(us)", "p99(us)", "p99.9(us)",
+           "allocs/req", "errors");
+    Row cb;
+    if (bench_callback(cfg, &cb) < 0) {
+        return 1;
+    }
+    print_row("callback", cb);
+    Row co;
+    uint64_t ticks = 0;
+    if (bench_coroutine(cfg, &co, &ticks) < 0) {
+        return 1;
+    }
+    print_row("coroutine", co);
+    printf("协程帧在压测期间向堆申请 %llu 次；sleep_for(100ms) 协程醒来 %llu 次（约 %d 次为正常）\n",
+           (unsigned long long)co.frame_heap_allocs, (unsigned long long)ticks, cfg.seconds * 20);
+    return 0;
+}
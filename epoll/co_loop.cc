@@ -0,0 +1,200 @@
+#include "co_loop.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "epoll_compat.h"
+#include "timer_engine.h"
+
+CoLoop::CoLoop(int max_events)
+    : ep_(-1),
+      stopping_(false),
+      wheel_(1000000, TimerEngine::now_ns()),
+      now_(TimerEngine::now_ns()),
+      events_(max_events) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+CoLoop::~CoLoop() {
+    for (size_t i = 0; i < closing_.size(); ++i) {
+        delete closing_[i];
+    }
+    for (size_t i = 0; i < free_states_.size(); ++i) {
+        delete free_states_[i];
+    }
+    if (ep_ >= 0) {
+        ::close(ep_);
+    }
+}
+
+int CoLoop::init() {
+    ep_ = epoll_create1(EPOLL_CLOEXEC);
+    if (ep_ < 0) {
+        fprintf(stderr, "epoll_create1 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    return tasks_.init(ep_);
+}
+
+void CoLoop::stop() {
+    stopping_.store(true, std::memory_order_release);
+    tasks_.notify();
+}
+
+IoState* CoLoop::attach(int fd) {
+    IoState* st;
+    if (!free_states_.empty()) {
+        st = free_states_.back();
+        free_states_.pop_back();
+    } else {
+        st = new IoState();
+    }
+    st->fd = fd;
+    st->closed = false;
+    st->reader = NULL;
+    st->writer = NULL;
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = st;
+    if (epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        free_states_.push_back(st);
+        return NULL;
+    }
+    return st;
+}
+
+void CoLoop::detach(IoState* st) {
+    st->closed = true;
+    ::close(st->fd);  // 关闭即从 epoll 中移除
+    st->fd = -1;
+    closing_.push_back(st);
+}
+
+void CoLoop::run() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int64_t timeout_ns = wheel_.size() > 0 ? wheel_.next_timeout_ns(TimerEngine::now_ns()) : -1;
+        if (timeout_ns != 0 && !tasks_.prepare_sleep()) {
+            timeout_ns = 0;
+        }
+        int n = epoll_wait_ns(ep_, events_.data(), events_.size(), timeout_ns);
+        tasks_.finish_sleep();
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "epoll_wait 失败: %s\n", strerror(errno));
+            break;
+        }
+        ++stats_.wakeups;
+        stats_.events += n;
+        now_ = TimerEngine::now_ns();
+        events_.update(n);
+        events_.prefetch(n, 1, [](const epoll_event&) { return false; });
+        for (int i = 0; i < n; ++i) {
+            const epoll_event& ev = events_[i];
+            if (ev.data.ptr == &tasks_) {
+                tasks_.on_readable();
+                continue;
+            }
+            IoState* st = static_cast<IoState*>(ev.data.ptr);
+            if (!st->closed && st->reader && (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                std::coroutine_handle<> h = st->reader;
+                st->reader = NULL;
+                ++stats_.resumes;
+                h.resume();
+            }
+            if (!st->closed && st->writer && (ev.events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+                std::coroutine_handle<> h = st->writer;
+                st->writer = NULL;
+                ++stats_.resumes;
+                h.resume();
+            }
+        }
+        tasks_.run_pending();
+        if (wheel_.size() > 0) {
+            wheel_.advance(now_);
+        }
+        // 本批事件里可能还有指向刚关闭的 IoState 的条目，处理完才能复用
+        free_states_.insert(free_states_.end(), closing_.begin(), closing_.end());
+        closing_.clear();
+    }
+}
+
+CoSocket::CoSocket(CoLoop* loop, int fd) : loop_(loop), st_(NULL) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    st_ = loop->attach(fd);
+    if (st_ == NULL) {
+        ::close(fd);
+    }
+}
+
+CoSocket& CoSocket::operator=(CoSocket&& o) noexcept {
+    if (this != &o) {
+        close();
+        loop_ = o.loop_;
+        st_ = o.st_;
+        o.st_ = NULL;
+    }
+    return *this;
+}
+
+void CoSocket::close() {
+    if (st_ != NULL) {
+        loop_->detach(st_);
+        st_ = NULL;
+    }
+}
+
+Task<ssize_t> async_read(CoSocket& sock, void* buf, size_t len) {
+    for (;;) {
+        ssize_t n = ::read(sock.fd(), buf, len);
+        if (n >= 0 || (errno != EAGAIN && errno != EINTR)) {
+            co_return n;
+        }
+        if (errno == EAGAIN) {
+            co_await sock.readable();
+        }
+    }
+}
+
+Task<ssize_t> async_write(CoSocket& sock, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = ::send(sock.fd(), p + done, len - done, MSG_NOSIGNAL);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno == EAGAIN) {
+            co_await sock.writable();
+        } else if (n < 0 && errno != EINTR) {
+            co_return -1;
+        }
+    }
+    co_return (ssize_t)len;
+}
+
+Task<int> async_accept(CoSocket& listener) {
+    for (;;) {
+        int fd = accept4(listener.fd(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd >= 0 || (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)) {
+            co_return fd;
+        }
+        if (errno == EAGAIN) {
+            co_await listener.readable();
+        }
+    }
+}
+
+void SleepAwaiter::await_suspend(std::coroutine_handle<> h) noexcept {
+    timer_.callback = on_fire;
+    timer_.data = h.address();
+    loop_->wheel().schedule(&timer_, loop_->now() + ns_);
+}
+
+void SleepAwaiter::on_fire(WheelTimer* timer) {
+    std::coroutine_handle<>::from_address(timer->data).resume();
+}
@@ -0,0 +1,155 @@
+#ifndef EPOLL_CO_LOOP_H
+#define EPOLL_CO_LOOP_H
+
+/**
+ * 协程风格的事件循环（C++20）
+ *
+ * 和 Reactor 用同样的积木：EventBatch 成批取事件、TimingWheel 管超时、TaskQueue 跨线程唤醒，
+ * 区别是就绪事件不再回调 Handler，而是恢复挂起在这个 fd 上的协程：
+ *
+ *   Task<void> session(CoSocket sock) {
+ *       char buf[4096];
+ *       for (;;) {
+ *           ssize_t n = co_await async_read(sock, buf, sizeof(buf));
+ *           if (n <= 0) break;
+ *           if (co_await async_write(sock, buf, n) < 0) break;
+ *       }
+ *   }
+ *   spawn(session(CoSocket(&loop, fd)));
+ *
+ *  - fd 以边沿触发注册 EPOLLIN|EPOLLOUT 一次；读写先直接做系统调用，EAGAIN 时才挂起等事件
+ *  - 每个 fd 同一时刻最多一个读者、一个写者
+ *  - 协程帧、IoState 都从池里复用，稳态下每个请求没有堆分配
+ *  - CoSocket 只能在它所属的循环线程里使用；关闭时不能有其他协程还挂在它上面
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <coroutine>
+#include <vector>
+
+#include "co_task.h"
+#include "event_batch.h"
+#include "task_queue.h"
+#include "timing_wheel.h"
+
+struct IoState {
+    int fd;
+    bool closed;
+    std::coroutine_handle<> reader;  // 等 EPOLLIN 的协程
+    std::coroutine_handle<> writer;  // 等 EPOLLOUT 的协程
+};
+
+struct CoLoopStats {
+    uint64_t wakeups;  // epoll_wait 返回次数
+    uint64_t events;
+    uint64_t resumes;  // 因 I/O 事件恢复协程的次数
+};
+
+class CoLoop {
+public:
+    explicit CoLoop(int max_events = 1024);
+    ~CoLoop();
+
+    /** 成功返回0，失败返回-1 */
+    int init();
+
+    /** 运行到 stop() 为止 */
+    void run();
+
+    /** 可以从任意线程调用 */
+    void stop();
+
+    /** 从任意线程投递任务到循环线程执行 */
+    void post(TaskQueue::Task* task) { tasks_.post(task); }
+
+    /** 1ms 精度的时间轮，sleep_for 挂在上面 */
+    TimingWheel& wheel() { return wheel_; }
+    /** 本轮循环醒来时的 CLOCK_MONOTONIC 时间 */
+    int64_t now() const { return now_; }
+    const CoLoopStats& stats() const { return stats_; }
+
+    /** 以边沿触发注册 fd（必须已经是非阻塞的），失败返回 NULL */
+    IoState* attach(int fd);
+
+    /** 关闭 fd；IoState 等本轮事件处理完才回收 */
+    void detach(IoState* st);
+
+private:
+    CoLoop(const CoLoop&) = delete;
+    CoLoop& operator=(const CoLoop&) = delete;
+
+    int ep_;
+    std::atomic<bool> stopping_;
+    TaskQueue tasks_;
+    TimingWheel wheel_;
+    int64_t now_;
+    EventBatch events_;
+    CoLoopStats stats_;
+    std::vector<IoState*> closing_;
+    std::vector<IoState*> free_states_;
+};
+
+/** 挂起当前协程，直到 *slot 对应的事件就绪 */
+struct IoAwaiter {
+    std::coroutine_handle<>* slot;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept { *slot = h; }
+    void await_resume() const noexcept {}
+};
+
+/** 注册在 CoLoop 上的非阻塞套接字，只能移动，析构时关闭 */
+class CoSocket {
+public:
+    CoSocket() : loop_(NULL), st_(NULL) {}
+    /** 接管 fd，fd 会被设置为非阻塞 */
+    CoSocket(CoLoop* loop, int fd);
+    CoSocket(CoSocket&& o) noexcept : loop_(o.loop_), st_(o.st_) { o.st_ = NULL; }
+    CoSocket& operator=(CoSocket&& o) noexcept;
+    CoSocket(const CoSocket&) = delete;
+    CoSocket& operator=(const CoSocket&) = delete;
+    ~CoSocket() { close(); }
+
+    bool valid() const { return st_ != NULL; }
+    int fd() const { return st_ ? st_->fd : -1; }
+    CoLoop* loop() const { return loop_; }
+    void close();
+
+    IoAwaiter readable() { return IoAwaiter{&st_->reader}; }
+    IoAwaiter writable() { return IoAwaiter{&st_->writer}; }
+
+private:
+    CoLoop* loop_;
+    IoState* st_;
+};
+
+/** 读到数据返回字节数，对端关闭返回0，出错返回-1（errno） */
+Task<ssize_t> async_read(CoSocket& sock, void* buf, size_t len);
+
+/** 写完全部 len 字节才返回 len，出错返回-1（errno） */
+Task<ssize_t> async_write(CoSocket& sock, const void* buf, size_t len);
+
+/** 返回新连接的 fd（非阻塞、CLOEXEC），出错返回-1（errno） */
+Task<int> async_accept(CoSocket& listener);
+
+/** 在 loop 的时间轮上睡 ns 纳秒，精度 1ms */
+class SleepAwaiter {
+public:
+    SleepAwaiter(CoLoop* loop, int64_t ns) : loop_(loop), ns_(ns) {}
+    bool await_ready() const noexcept { return ns_ <= 0; }
+    void await_suspend(std::coroutine_handle<> h) noexcept;
+    void await_resume() const noexcept {}
+
+private:
+    static void on_fire(WheelTimer* timer);
+
+    CoLoop* loop_;
+    int64_t ns_;
+    WheelTimer timer_;  // 在协程帧里，挂起期间地址不变
+};
+
+inline SleepAwaiter sleep_for(CoLoop& loop, int64_t ns) { return SleepAwaiter(&loop, ns); }
+
+#endif  // EPOLL_CO_LOOP_H
@@ -0,0 +1,223 @@
+#ifndef EPOLL_CO_TASK_H
+#define EPOLL_CO_TASK_H
+
+/**
+ * C++20 协程的基础类型（需要 -std=c++20，只有协程相关的目标用到）
+ *
+ *  - FramePool：协程帧分配器。按 2 的幂分级（64B .. 64KB），每个线程一组空闲链表，
+ *    帧释放后挂回链表，稳态下创建/销毁协程不再碰堆；更大的帧直接走 ::operator new
+ *  - Task<T>：惰性启动的协程，co_await 时才开始执行，结束时对称转移回等待者（不加深调用栈）
+ *  - spawn(Task<void>)：在当前线程里立即启动一个任务，不等待它结束，结束后帧自动释放
+ *
+ * 协程帧在哪个线程创建就在哪个线程释放（一个连接的协程只在它所属的事件循环线程里跑）。
+ * 不使用异常：协程里抛出未捕获的异常直接 std::terminate。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <utility>
+
+class FramePool {
+public:
+    static const int kMinShift = 6;   // 64B
+    static const int kMaxShift = 16;  // 64KB
+    static const int kClasses = kMaxShift - kMinShift + 1;
+
+    static void* allocate(size_t size) {
+        int c = size_class(size);
+        if (c < 0) {
+            ++local().heap_allocs;
+            return ::operator new(size);
+        }
+        Pool& p = local();
+        FreeNode* node = p.free[c];
+        if (node != NULL) {
+            p.free[c] = node->next;
+            ++p.reuses;
+            return node;
+        }
+        ++p.heap_allocs;
+        return ::operator new((size_t)1 << (c + kMinShift));
+    }
+
+    static void deallocate(void* ptr, size_t size) {
+        int c = size_class(size);
+        if (c < 0) {
+            ::operator delete(ptr);
+            return;
+        }
+        FreeNode* node = static_cast<FreeNode*>(ptr);
+        Pool& p = local();
+        node->next = p.free[c];
+        p.free[c] = node;
+    }
+
+    /** 本线程向堆申请帧的次数；稳态下应当不再增长 */
+    static uint64_t heap_allocs() { return local().heap_allocs; }
+    /** 本线程从空闲链表复用帧的次数 */
+    static uint64_t reuses() { return local().reuses; }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct Pool {
+        FreeNode* free[kClasses];
+        uint64_t heap_allocs;
+        uint64_t reuses;
+        // 线程退出时把缓存的帧还给堆
+        ~Pool() {
+            for (int c = 0; c < kClasses; ++c) {
+                while (free[c] != NULL) {
+                    FreeNode* next = free[c]->next;
+                    ::operator delete(free[c]);
+                    free[c] = next;
+                }
+            }
+        }
+    };
+
+    static Pool& local() {
+        static thread_local Pool pool = {};
+        return pool;
+    }
+
+    static int size_class(size_t size) {
+        if (size > ((size_t)1 << kMaxShift)) {
+            return -1;
+        }
+        int c = 0;
+        while (((size_t)1 << (c + kMinShift)) < size) {
+            ++c;
+        }
+        return c;
+    }
+};
+
+/** 协程的 promise_type 继承它，帧就从 FramePool 分配 */
+struct PooledFrame {
+    static void* operator new(size_t size) { return FramePool::allocate(size); }
+    static void operator delete(void* ptr, size_t size) { FramePool::deallocate(ptr, size); }
+};
+
+template <typename T>
+class Task;
+
+namespace co_detail {
+
+struct PromiseBase : PooledFrame {
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    T value;
+    Task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+    T take() { return std::move(value); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void take() {}
+};
+
+}  // namespace co_detail
+
+template <typename T = void>
+class Task {
+public:
+    typedef co_detail::Promise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    Task() : handle_(NULL) {}
+    explicit Task(handle_type h) : handle_(h) {}
+    Task(Task&& o) noexcept : handle_(o.handle_) { o.handle_ = NULL; }
+    Task& operator=(Task&& o) noexcept {
+        if (this != &o) {
+            reset();
+            handle_ = o.handle_;
+            o.handle_ = NULL;
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { reset(); }
+
+    bool valid() const { return handle_ != NULL; }
+
+    struct Awaiter {
+        handle_type handle;
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> waiter) noexcept {
+            handle.promise().continuation = waiter;
+            return handle;  // 对称转移：直接切到被等待的协程
+        }
+        T await_resume() { return handle.promise().take(); }
+    };
+
+    Awaiter operator co_await() && noexcept { return Awaiter{handle_}; }
+    Awaiter operator co_await() & noexcept { return Awaiter{handle_}; }
+
+private:
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = NULL;
+        }
+    }
+
+    handle_type handle_;
+};
+
+namespace co_detail {
+
+template <typename T>
+inline Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T> >::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void> >::from_promise(*this));
+}
+
+/** spawn 用的外层协程：立即开始执行，结束时自己释放帧 */
+struct Detached {
+    struct promise_type : PooledFrame {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+}  // namespace co_detail
+
+/** 立即在当前线程启动 task，直到它第一次挂起才返回 */
+inline co_detail::Detached spawn(Task<void> task) {
+    co_await std::move(task);
+}
+
+#endif  // EPOLL_CO_TASK_H
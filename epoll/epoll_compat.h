@@ -0,0 +1,58 @@
+#ifndef EPOLL_EPOLL_COMPAT_H
+#define EPOLL_EPOLL_COMPAT_H
+
+/**
+ * 纳秒超时的 epoll 等待
+ *
+ * Linux 5.11 起提供 epoll_pwait2(timespec 超时)，glibc 2.35 才有包装函数，
+ * 这里直接走 syscall。内核不支持（ENOSYS）时记住结果，之后退化为
+ * epoll_wait，超时向上取整到毫秒。
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_epoll_pwait2
+#define SYS_epoll_pwait2 441  // 所有架构统一的调用号
+#endif
+
+/** epoll_pwait2 是否可用：1 可用，0 不可用，-1 尚未探测 */
+inline int& epoll_pwait2_state() {
+    static int state = -1;
+    return state;
+}
+
+inline bool epoll_pwait2_supported() {
+    int& state = epoll_pwait2_state();
+    if (state < 0) {
+        int ep = epoll_create1(EPOLL_CLOEXEC);
+        timespec ts = {0, 0};
+        epoll_event ev;
+        state = (syscall(SYS_epoll_pwait2, ep, &ev, 1, &ts, NULL, 0) >= 0 || errno != ENOSYS) ? 1 : 0;
+        close(ep);
+    }
+    return state == 1;
+}
+
+/**
+ * timeout_ns < 0 表示无限等待，返回值与 epoll_wait 相同
+ */
+inline int epoll_wait_ns(int ep, epoll_event* events, int max_events, int64_t timeout_ns) {
+    if (epoll_pwait2_supported()) {
+        if (timeout_ns < 0) {
+            return (int)syscall(SYS_epoll_pwait2, ep, events, max_events, NULL, NULL, 0);
+        }
+        timespec ts;
+        ts.tv_sec = timeout_ns / 1000000000LL;
+        ts.tv_nsec = timeout_ns % 1000000000LL;
+        return (int)syscall(SYS_epoll_pwait2, ep, events, max_events, &ts, NULL, 0);
+    }
+    int timeout_ms = timeout_ns < 0 ? -1 : (int)((timeout_ns + 999999) / 1000000);
+    return epoll_wait(ep, events, max_events, timeout_ms);
+}
+
+#endif  // EPOLL_EPOLL_COMPAT_H
@@ -7,43 +7,554 @@ min_epoll_wait_time = 1
 min_epoll_wait_time = 1
 [root@VM-73-4-tencentos build]# sudo sysctl -w min_epoll_wait_time=2
 min_epoll_wait_time = 2
+
+手工改 sysctl 的实验可以用 matrix 模式一次跑完：绑核/不绑核 × SCHED_OTHER/SCHED_FIFO ×
+PR_SET_TIMERSLACK × min_epoll_wait_time（内核有这个参数时）逐个组合测一遍，输出一张对比表
  * */
  #include <stdio.h>
+ #include <errno.h>
  #include <assert.h>
  #include <stdlib.h>
  #include <unistd.h>
+ #include <string.h>
+ #include <signal.h>
+ #include <time.h>
  #include <sys/time.h>
+ #include <sched.h>
  #include <sys/epoll.h>
+ #include <sys/eventfd.h>
+ #include <sys/prctl.h>
+ #include <sys/resource.h>
+ #include <algorithm>
+ #include <atomic>
+ #include <string>
+ #include <thread>
+ #include <vector>
+
+ #include "async_logger.h"
+ #include "cycle_clock.h"
+ #include "epoll_compat.h"
+ #include "latency_histogram.h"
+ #include "timer_engine.h"
+ #include "wait_strategy.h"
   
  int64_t get_current_time(){
      timeval now;
      int ret = gettimeofday(&now, NULL);
      assert(ret != -1);
+     (void)ret;  // Release 构建里 assert 为空
   
      return now.tv_sec * 1000 + now.tv_usec / 1000;
  }
   
+ /**
+  * 打印一组唤醒误差（实际等待 - 请求等待，单位 us）的统计
+  */
+ void print_error_stats(const char* name, std::vector<double>& errs){
+     std::sort(errs.begin(), errs.end());
+     double sum = 0;
+     for(size_t i = 0; i < errs.size(); ++i){
+         sum += errs[i];
+     }
+     size_t n = errs.size();
+     printf("%-10s samples=%zu avg=%.1f min=%.1f p50=%.1f p99=%.1f max=%.1f (us)\n", name, n, sum / n,
+            errs[0], errs[n / 2], errs[std::min(n - 1, n * 99 / 100)], errs[n - 1]);
+ }
+
+ /**
+  * 对比 epoll_wait 毫秒超时与 timerfd(TFD_TIMER_ABSTIME) 的唤醒误差
+  * epoll_wait 只能请求 ceil(interval / 1ms) 毫秒，误差按请求的 interval 计算
+  */
+ void compare_timerfd(int ep, int64_t interval_us, int samples){
+     std::vector<double> epoll_errs, timerfd_errs;
+     epoll_event events[1];
+
+     int timeout_ms = (int)((interval_us + 999) / 1000);
+     for(int i = 0; i < samples; ++i){
+         int64_t start = TimerEngine::now_ns();
+         if(epoll_wait(ep, events, 1, timeout_ms) == -1){
+             printf("wait epoll error!\n"); exit(-1);
+         }
+         epoll_errs.push_back((TimerEngine::now_ns() - start) / 1000.0 - interval_us);
+     }
+
+     TimerEngine timers;
+     if(timers.init(ep) != 0){
+         exit(-1);
+     }
+     for(int i = 0; i < samples; ++i){
+         int64_t deadline = TimerEngine::now_ns() + interval_us * 1000;
+         bool fired = false;
+         timers.add_at(deadline, [&]{
+             timerfd_errs.push_back((TimerEngine::now_ns() - deadline) / 1000.0);
+             fired = true;
+         });
+         while(!fired){
+             int n = epoll_wait(ep, events, 1, -1);
+             if(n == -1){
+                 printf("wait epoll error!\n"); exit(-1);
+             }
+             if(n == 1 && events[0].data.ptr == &timers){
+                 timers.on_readable();
+             }
+         }
+     }
+
+     printf("请求间隔 %lld us, epoll_wait 实际请求 %d ms\n", (long long)interval_us, timeout_ms);
+     print_error_stats("epoll_wait", epoll_errs);
+     print_error_stats("timerfd", timerfd_errs);
+ }
+
+ double percentile(const std::vector<double>& sorted, int p){
+     return sorted[std::min(sorted.size() - 1, sorted.size() * p / 100)];
+ }
+
+ /**
+  * 请求超时从 10us 扫到 10ms，对比 epoll_pwait2(纳秒) 与 epoll_wait(毫秒) 的实际睡眠时间
+  * epoll_pwait2 不可用时第一组会退化为 epoll_wait，结果中会注明
+  */
+ void sweep_timeouts(int ep, int samples){
+     static const int64_t kTimeoutsUs[] = {10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+     bool pwait2 = epoll_pwait2_supported();
+     epoll_event events[1];
+
+     printf("epoll_pwait2: %s\n", pwait2 ? "可用" : "不可用，回退到 epoll_wait 毫秒超时");
+     printf("%10s | %-32s | %-32s\n", "", pwait2 ? "epoll_pwait2 实际(us)" : "回退 epoll_wait 实际(us)",
+            "epoll_wait(ceil ms) 实际(us)");
+     printf("%10s | %10s %10s %10s | %10s %10s %10s\n", "请求(us)", "p50", "p99", "max", "p50", "p99", "max");
+     for(size_t t = 0; t < sizeof(kTimeoutsUs) / sizeof(kTimeoutsUs[0]); ++t){
+         int64_t req_us = kTimeoutsUs[t];
+         std::vector<double> ns_actual, ms_actual;
+         for(int i = 0; i < samples; ++i){
+             int64_t start = TimerEngine::now_ns();
+             if(epoll_wait_ns(ep, events, 1, req_us * 1000) == -1){
+                 printf("wait epoll error!\n"); exit(-1);
+             }
+             ns_actual.push_back((TimerEngine::now_ns() - start) / 1000.0);
+
+             start = TimerEngine::now_ns();
+             if(epoll_wait(ep, events, 1, (int)((req_us + 999) / 1000)) == -1){
+                 printf("wait epoll error!\n"); exit(-1);
+             }
+             ms_actual.push_back((TimerEngine::now_ns() - start) / 1000.0);
+         }
+         std::sort(ns_actual.begin(), ns_actual.end());
+         std::sort(ms_actual.begin(), ms_actual.end());
+         printf("%10lld | %10.1f %10.1f %10.1f | %10.1f %10.1f %10.1f\n", (long long)req_us,
+                percentile(ns_actual, 50), percentile(ns_actual, 99), ns_actual.back(),
+                percentile(ms_actual, 50), percentile(ms_actual, 99), ms_actual.back());
+     }
+ }
+
+ int64_t thread_cpu_ns(){
+     timespec ts;
+     clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+     return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+ }
+
+ /**
+  * 生产者线程按随机间隔(平均 interval_us)写 eventfd，消费者用指定策略等待，
+  * 统计从写入到消费者醒来的延迟，以及消费者线程消耗的 CPU 时间占墙上时间的比例
+  */
+ void bench_wait_strategy(int ep, WaitMode mode, int64_t interval_us, int samples){
+     int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+     epoll_event ev;
+     ev.events = EPOLLIN;
+     ev.data.fd = efd;
+     epoll_ctl(ep, EPOLL_CTL_ADD, efd, &ev);
+
+     std::atomic<int64_t> sent_ns(0);
+     std::atomic<bool> consumed(true);
+     std::thread producer([&]{
+         unsigned seed = 12345;
+         timespec next;
+         clock_gettime(CLOCK_MONOTONIC, &next);
+         for(int i = 0; i < samples; ++i){
+             int64_t gap_ns = (interval_us / 2 + rand_r(&seed) % (interval_us + 1)) * 1000;
+             next.tv_nsec += gap_ns;
+             while(next.tv_nsec >= 1000000000L){ next.tv_nsec -= 1000000000L; ++next.tv_sec; }
+             clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+             while(!consumed.load(std::memory_order_acquire)){
+                 std::this_thread::yield();
+             }
+             consumed.store(false, std::memory_order_relaxed);
+             sent_ns.store(TimerEngine::now_ns(), std::memory_order_release);
+             uint64_t one = 1;
+             if(write(efd, &one, sizeof(one)) != sizeof(one)){
+                 printf("write eventfd error!\n"); exit(-1);
+             }
+         }
+     });
+
+     WaitStrategy strategy(mode);
+     LatencyHistogram hist;
+     int64_t wall_start = TimerEngine::now_ns();
+     int64_t cpu_start = thread_cpu_ns();
+     epoll_event events[8];
+     for(int got = 0; got < samples;){
+         int n = strategy.wait(ep, events, 8, -1);
+         int64_t now = TimerEngine::now_ns();
+         for(int i = 0; i < n; ++i){
+             uint64_t value;
+             if(events[i].data.fd == efd && read(efd, &value, sizeof(value)) == sizeof(value)){
+                 hist.record(now - sent_ns.load(std::memory_order_acquire));
+                 consumed.store(true, std::memory_order_release);
+                 ++got;
+             }
+         }
+     }
+     double cpu_pct = 100.0 * (thread_cpu_ns() - cpu_start) / (TimerEngine::now_ns() - wall_start);
+     producer.join();
+     epoll_ctl(ep, EPOLL_CTL_DEL, efd, NULL);
+     close(efd);
+
+     const WaitStats& st = strategy.stats();
+     hist.print_summary(stdout, WaitStrategy::mode_name(mode), 1000.0, "us");
+     printf("%-12s cpu=%.1f%% spin_hits=%llu blocks=%llu near_misses=%llu window=%lldus grows=%llu shrinks=%llu\n",
+            "", cpu_pct, (unsigned long long)st.spin_hits, (unsigned long long)st.blocks,
+            (unsigned long long)st.near_misses, (long long)(strategy.spin_ns() / 1000),
+            (unsigned long long)st.grows, (unsigned long long)st.shrinks);
+ }
+
+ static volatile sig_atomic_t g_dump = 0;
+ static volatile sig_atomic_t g_stop = 0;
+
+ void on_signal(int sig){
+     if(sig == SIGUSR1){
+         g_dump = 1;
+     } else {
+         g_stop = 1;
+     }
+ }
+
+ void report(const LatencyHistogram& hist, const char* csv_path){
+     hist.print_summary(stdout, "epoll_wait", 1000.0, "us");
+     FILE* csv = csv_path ? fopen(csv_path, "w") : stdout;
+     if(csv == NULL){
+         printf("open %s error!\n", csv_path);
+         return;
+     }
+     hist.write_csv(csv, 1000.0);
+     if(csv != stdout){
+         fclose(csv);
+     }
+     fflush(stdout);
+ }
+
+ /**
+  * epoll_wait(ep, events, 1, 1) 的实际等待时间记录进直方图，循环内没有任何 I/O
+  * raw: CLOCK_MONOTONIC_RAW；tsc: rdtsc，启动时用 CLOCK_MONOTONIC_RAW 标定
+  * 给了 log_path 时每次迭代再写一条异步日志（热路径只写内存里的环，不影响测量）
+  */
+ void run_deviation_loop(int ep, int64_t iterations, bool use_tsc, const char* csv_path, const char* log_path){
+     struct sigaction sa;
+     memset(&sa, 0, sizeof(sa));
+     sa.sa_handler = on_signal;  // 不设置 SA_RESTART，信号会打断 epoll_wait
+     sigaction(SIGUSR1, &sa, NULL);
+     sigaction(SIGINT, &sa, NULL);
+     sigaction(SIGTERM, &sa, NULL);
+
+     double ns_per_tick = use_tsc ? CycleClock::calibrate_ns_per_tick() : 1.0;
+     printf("计时源 %s, ns/tick=%.4f, 迭代 %lld 次\n", use_tsc ? "tsc" : "CLOCK_MONOTONIC_RAW", ns_per_tick,
+            (long long)iterations);
+     fflush(stdout);
+
+     AsyncLogger log;
+     if(log_path != NULL && log.open(log_path) < 0){
+         printf("open %s error!\n", log_path); exit(-1);
+     }
+
+     LatencyHistogram hist;
+     epoll_event events[1];
+     for(int64_t i = 0; i < iterations && !g_stop; ++i){
+         uint64_t start = use_tsc ? CycleClock::ticks() : CycleClock::raw_ns();
+         // 此时的等待时间为max(min_epoll_wait_time, 1),内核参数优先
+         int ret = epoll_wait(ep, events, 1, 1);
+         uint64_t end = use_tsc ? CycleClock::ticks() : CycleClock::raw_ns();
+         if(ret == -1){
+             if(errno != EINTR){
+                 printf("wait epoll error!\n"); exit(-1);
+             }
+         } else {
+             uint64_t waited = use_tsc ? (uint64_t)((end - start) * ns_per_tick) : end - start;
+             hist.record(waited);
+             if(log_path != NULL){
+                 ALOG_INFO(log, "iter %lld waited %llu ns", (long long)i, (unsigned long long)waited);
+             }
+         }
+         if(g_dump){
+             g_dump = 0;
+             report(hist, csv_path);
+         }
+     }
+     report(hist, csv_path);
+ }
+
+ /** min_epoll_wait_time 是 tlinux 的私有参数，不同版本挂在不同目录下，找不到返回 NULL */
+ const char* find_min_epoll_wait_time(){
+     static const char* kPaths[] = {"/proc/sys/min_epoll_wait_time", "/proc/sys/kernel/min_epoll_wait_time",
+                                    "/proc/sys/fs/epoll/min_epoll_wait_time"};
+     for(size_t i = 0; i < sizeof(kPaths) / sizeof(kPaths[0]); ++i){
+         if(access(kPaths[i], R_OK) == 0){
+             return kPaths[i];
+         }
+     }
+     return NULL;
+ }
+
+ int read_sysctl(const char* path){
+     FILE* f = fopen(path, "r");
+     if(f == NULL){
+         return -1;
+     }
+     int v = -1;
+     if(fscanf(f, "%d", &v) != 1){
+         v = -1;
+     }
+     fclose(f);
+     return v;
+ }
+
+ int write_sysctl(const char* path, int value){
+     FILE* f = fopen(path, "w");
+     if(f == NULL){
+         return -1;
+     }
+     int ok = fprintf(f, "%d\n", value) > 0;
+     return fclose(f) == 0 && ok ? 0 : -1;
+ }
+
+ /** "50000,1000,1" -> {50000, 1000, 1} */
+ std::vector<long> parse_list(const char* s){
+     std::vector<long> out;
+     while(s != NULL && *s != '\0'){
+         char* end;
+         long v = strtol(s, &end, 10);
+         if(end == s){
+             break;
+         }
+         out.push_back(v);
+         s = *end == ',' ? end + 1 : end;
+     }
+     return out;
+ }
+
+ /**
+  * 请求 timeout_us 的 epoll_wait 重复 iterations 次，记录实际等待比请求多出的部分（ns）
+  * timeout_us 是整毫秒时走 epoll_wait（受 min_epoll_wait_time 影响的路径），否则走 epoll_wait_ns
+  */
+ void measure_deviation(int ep, int64_t iterations, int64_t timeout_us, LatencyHistogram& hist){
+     epoll_event events[1];
+     bool ms = timeout_us % 1000 == 0;
+     uint64_t req_ns = (uint64_t)timeout_us * 1000;
+     for(int64_t i = 0; i < iterations && !g_stop; ++i){
+         uint64_t start = CycleClock::raw_ns();
+         int ret = ms ? epoll_wait(ep, events, 1, (int)(timeout_us / 1000))
+                      : epoll_wait_ns(ep, events, 1, timeout_us * 1000);
+         uint64_t elapsed = CycleClock::raw_ns() - start;
+         if(ret == -1){
+             if(errno != EINTR){
+                 printf("wait epoll error!\n"); exit(-1);
+             }
+             continue;
+         }
+         hist.record(elapsed > req_ns ? elapsed - req_ns : 0);
+     }
+ }
+
+ struct MatrixRow {
+     std::string config;
+     LatencyHistogram hist;
+ };
+
+ /**
+  * 逐个组合跑 measure_deviation，最后输出一张表
+  *   cpu      pinned：绑到启动时所在的 CPU；floating：恢复启动时的亲和性掩码
+  *   policy   SCHED_OTHER / SCHED_FIFO(fifo_prio)，没有 CAP_SYS_NICE 时 FIFO 组合标记为跳过
+  *   slack    PR_SET_TIMERSLACK，表里显示 PR_GET_TIMERSLACK 读回的生效值（实时线程的 slack 恒为 0）
+  *   min_ewt  min_epoll_wait_time，需要 root；结束后恢复原值
+  */
+ void run_matrix(int ep, int64_t iterations, int64_t timeout_us, const std::vector<long>& slacks,
+                 std::vector<long> min_ewts, int fifo_prio){
+     struct sigaction sa;
+     memset(&sa, 0, sizeof(sa));
+     sa.sa_handler = on_signal;
+     sigaction(SIGINT, &sa, NULL);
+     sigaction(SIGTERM, &sa, NULL);
+
+     cpu_set_t floating;
+     sched_getaffinity(0, sizeof(floating), &floating);
+     int home_cpu = sched_getcpu();
+     long orig_slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+
+     const char* ewt_path = find_min_epoll_wait_time();
+     int orig_ewt = ewt_path ? read_sysctl(ewt_path) : -1;
+     if(ewt_path == NULL || min_ewts.empty()){
+         min_ewts.assign(1, -1);  // 只跑一组，表里显示 "-"
+     }
+     printf("每个组合 %lld 次，请求超时 %lld us（%s），home cpu=%d，默认 slack=%ld ns，min_epoll_wait_time: %s",
+            (long long)iterations, (long long)timeout_us, timeout_us % 1000 == 0 ? "epoll_wait" : "epoll_wait_ns",
+            home_cpu, orig_slack, ewt_path ? ewt_path : "内核不支持");
+     if(ewt_path){
+         printf(" = %d", orig_ewt);
+     }
+     printf("\n\n");
+     fflush(stdout);
+
+     std::vector<MatrixRow> rows;
+     for(size_t e = 0; e < min_ewts.size() && !g_stop; ++e){
+         if(min_ewts[e] >= 0 && write_sysctl(ewt_path, (int)min_ewts[e]) != 0){
+             printf("写 %s=%ld 失败: %s，跳过\n", ewt_path, min_ewts[e], strerror(errno));
+             continue;
+         }
+         for(int pinned = 0; pinned < 2 && !g_stop; ++pinned){
+             if(pinned){
+                 cpu_set_t one;
+                 CPU_ZERO(&one);
+                 CPU_SET(home_cpu, &one);
+                 sched_setaffinity(0, sizeof(one), &one);
+             } else {
+                 sched_setaffinity(0, sizeof(floating), &floating);
+             }
+             for(int fifo = 0; fifo < 2 && !g_stop; ++fifo){
+                 sched_param sp;
+                 sp.sched_priority = fifo ? fifo_prio : 0;
+                 if(sched_setscheduler(0, fifo ? SCHED_FIFO : SCHED_OTHER, &sp) != 0){
+                     printf("%s %s: sched_setscheduler 失败: %s，跳过\n", pinned ? "pinned" : "floating",
+                            fifo ? "SCHED_FIFO" : "SCHED_OTHER", strerror(errno));
+                     continue;
+                 }
+                 long last_slack = -1;
+                 for(size_t k = 0; k < slacks.size() && !g_stop; ++k){
+                     prctl(PR_SET_TIMERSLACK, slacks[k], 0, 0, 0);
+                     long slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+                     if(slack == last_slack){
+                         continue;  // 实时线程忽略 slack，同样的配置不重复测
+                     }
+                     last_slack = slack;
+                     char config[128];
+                     char ewt[24] = "-";
+                     if(min_ewts[e] >= 0){
+                         snprintf(ewt, sizeof(ewt), "%ld", min_ewts[e]);
+                     }
+                     snprintf(config, sizeof(config), "%-8s %-6s %9ld %7s", pinned ? "pinned" : "floating",
+                              fifo ? "FIFO" : "OTHER", slack, ewt);
+                     rows.push_back(MatrixRow());
+                     rows.back().config = config;
+                     measure_deviation(ep, iterations / 20 + 1, timeout_us, rows.back().hist);  // 预热
+                     rows.back().hist.reset();
+                     measure_deviation(ep, iterations, timeout_us, rows.back().hist);
+                     printf("  done: %s\n", config);
+                     fflush(stdout);
+                 }
+             }
+         }
+     }
+
+     // 恢复原来的设置
+     sched_param sp;
+     sp.sched_priority = 0;
+     sched_setscheduler(0, SCHED_OTHER, &sp);
+     sched_setaffinity(0, sizeof(floating), &floating);
+     prctl(PR_SET_TIMERSLACK, orig_slack, 0, 0, 0);
+     if(ewt_path && orig_ewt >= 0){
+         write_sysctl(ewt_path, orig_ewt);
+     }
+     if(rows.empty()){
+         return;
+     }
+
+     size_t best = 0;
+     printf("\n唤醒延迟 = 实际等待 - 请求 %lld us，单位 us\n", (long long)timeout_us);
+     printf("%-8s %-6s %9s %7s | %8s %8s %8s %8s %8s %8s\n", "cpu", "policy", "slack(ns)", "min_ewt", "n", "p50",
+            "p90", "p99", "p99.9", "max");
+     for(size_t i = 0; i < rows.size(); ++i){
+         const LatencyHistogram& h = rows[i].hist;
+         printf("%s | %8llu %8.1f %8.1f %8.1f %8.1f %8.1f\n", rows[i].config.c_str(), (unsigned long long)h.count(),
+                h.percentile(50) / 1000.0, h.percentile(90) / 1000.0, h.percentile(99) / 1000.0,
+                h.percentile(99.9) / 1000.0, h.max() / 1000.0);
+         if(h.percentile(99) < rows[best].hist.percentile(99)){
+             best = i;
+         }
+     }
+     printf("p99 最低: %s\n", rows[best].config.c_str());
+ }
+
  int main(int argc, char** argv){
      int ep = epoll_create(1024);
      if(ep == -1){
          printf("create epoll error!\n"); exit(-1);
      }
-     
-     for(int i = 0; i < 2 * 60 * 60 * 1000; i += 1){
-        timeval start;
-        gettimeofday(&start, NULL);
 
-         epoll_event events[1];
-         // 此时的等待时间为max(min_epoll_wait_time, 1),内核参数优先
-         if(epoll_wait(ep, events, 1, 1) == -1){
-             printf("wait epoll error!\n"); exit(-1);
+     // 用法: epoll_wait_deviation compare [interval_us=100] [samples=2000]
+     if(argc > 1 && strcmp(argv[1], "compare") == 0){
+         int64_t interval_us = argc > 2 ? atoll(argv[2]) : 100;
+         int samples = argc > 3 ? atoi(argv[3]) : 2000;
+         compare_timerfd(ep, interval_us, samples);
+         close(ep);
+         return 0;
+     }
+
+     // 用法: epoll_wait_deviation sweep [samples=200] [nopwait2]
+     if(argc > 1 && strcmp(argv[1], "sweep") == 0){
+         if(argc > 3 && strcmp(argv[3], "nopwait2") == 0){
+             epoll_pwait2_state() = 0;  // 强制走回退路径，验证老内核上的表现
          }
-         
-        timeval end;
-        gettimeofday(&end, NULL);
-         printf("begin=%llu, end=%llu, epoll wait =%llu (us)\n", start.tv_usec, end.tv_usec, end.tv_usec - start.tv_usec);
+         sweep_timeouts(ep, argc > 2 ? atoi(argv[2]) : 200);
+         close(ep);
+         return 0;
      }
      
+     // 用法: epoll_wait_deviation matrix [iterations=2000] [timeout_us=1000] [slacks=50000,1000,1]
+     //       [min_epoll_wait_time 取值=1,2] [fifo_prio=10]
+     if(argc > 1 && strcmp(argv[1], "matrix") == 0){
+         int64_t iterations = argc > 2 ? atoll(argv[2]) : 2000;
+         int64_t timeout_us = argc > 3 ? atoll(argv[3]) : 1000;
+         std::vector<long> slacks = parse_list(argc > 4 ? argv[4] : "50000,1000,1");
+         std::vector<long> min_ewts = parse_list(argc > 5 ? argv[5] : "1,2");
+         int fifo_prio = argc > 6 ? atoi(argv[6]) : 10;
+         if(iterations <= 0 || timeout_us <= 0 || slacks.empty()){
+             printf("参数错误\n");
+             return 1;
+         }
+         run_matrix(ep, iterations, timeout_us, slacks, min_ewts, fifo_prio);
+         close(ep);
+         return 0;
+     }
+
+     // 用法: epoll_wait_deviation spin [interval_us=200] [samples=5000]
+     if(argc > 1 && strcmp(argv[1], "spin") == 0){
+         int64_t interval_us = argc > 2 ? atoll(argv[2]) : 200;
+         int samples = argc > 3 ? atoi(argv[3]) : 5000;
+         printf("事件平均间隔 %lld us, 每种策略 %d 个事件\n", (long long)interval_us, samples);
+         bench_wait_strategy(ep, kWaitBlocking, interval_us, samples);
+         bench_wait_strategy(ep, kWaitBusyPoll, interval_us, samples);
+         bench_wait_strategy(ep, kWaitHybrid, interval_us, samples);
+         close(ep);
+         return 0;
+     }
+
+     // 用法: epoll_wait_deviation [loop] [iterations=7200000] [raw|tsc] [csv_path] [log_path]
+     // 运行中 kill -USR1 <pid> 打印当前统计，Ctrl-C / SIGTERM 提前结束并输出结果。
+     // loop 的超时固定是 1ms（测的就是 min_epoll_wait_time 对它的影响），第一个参数不是模式名时报错，
+     // 而不是把 "epoll_wait_deviation 5" 悄悄当成 1ms 跑
+     if(argc > 1 && strcmp(argv[1], "loop") != 0){
+         fprintf(stderr,
+                 "未知模式 %s\n"
+                 "用法: %s [loop] [iterations=7200000] [raw|tsc] [csv_path] [log_path]   超时固定 1ms\n"
+                 "      %s compare [interval_us=100] [samples=2000]\n"
+                 "      %s sweep [samples=200] [nopwait2]\n"
+                 "      %s matrix [iterations=2000] [timeout_us=1000] [slacks] [min_epoll_wait_time] [fifo_prio]\n"
+                 "      %s spin [interval_us=200] [samples=5000]\n",
+                 argv[1], argv[0], argv[0], argv[0], argv[0], argv[0]);
+         close(ep);
+         return 1;
+     }
+     int64_t iterations = argc > 2 ? atoll(argv[2]) : 2LL * 60 * 60 * 1000;
+     bool use_tsc = argc > 3 && strcmp(argv[3], "tsc") == 0;
+     const char* csv_path = argc > 4 && strcmp(argv[4], "-") != 0 ? argv[4] : NULL;
+     const char* log_path = argc > 5 ? argv[5] : NULL;
+     run_deviation_loop(ep, iterations, use_tsc, csv_path, log_path);
      close(ep);
      
      return 0;
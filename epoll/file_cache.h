@@ -0,0 +1,137 @@
+#ifndef EPOLL_FILE_CACHE_H
+#define EPOLL_FILE_CACHE_H
+
+/**
+ * 打开的文件描述符 + 大小的缓存（单线程使用，每个 Reactor 一个）
+ *
+ * 静态文件服务每个请求都 open + fstat + close 要三次系统调用，命中缓存时一次都不用。
+ *  - acquire(path) 返回带引用计数的条目，发送完成后 release；条目在被引用时不会关闭
+ *  - 超过 max_entries 时从 LRU 尾部淘汰没有被引用的条目，被引用的跳过；
+ *    全都被引用时暂时超出上限，等下一次 acquire 再淘汰
+ *  - invalidate 的条目如果正被引用，只从索引里摘掉，最后一个引用释放时再关闭
+ *  - 假定文件内容不变（发布后的静态资源）；文件被替换时调用 invalidate(path)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+class FileCache {
+public:
+    struct Entry {
+        int fd;
+        uint64_t size;
+        int refs;
+        bool indexed;  // 是否还在索引里，被淘汰/失效后为 false
+        FileCache* owner;
+        std::string path;
+        std::list<Entry*>::iterator lru;
+    };
+
+    explicit FileCache(size_t max_entries = 1024) : max_entries_(max_entries), hits_(0), misses_(0) {}
+
+    ~FileCache() {
+        for (std::list<Entry*>::iterator it = lru_.begin(); it != lru_.end(); ++it) {
+            ::close((*it)->fd);
+            delete *it;
+        }
+    }
+
+    /** 打开失败（不存在、不是普通文件）返回 NULL */
+    Entry* acquire(const std::string& path) {
+        std::unordered_map<std::string, Entry*>::iterator it = index_.find(path);
+        if (it != index_.end()) {
+            Entry* e = it->second;
+            lru_.splice(lru_.begin(), lru_, e->lru);
+            ++e->refs;
+            ++hits_;
+            return e;
+        }
+        ++misses_;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return NULL;
+        }
+        Entry* e = new Entry();
+        e->fd = fd;
+        e->size = (uint64_t)st.st_size;
+        e->refs = 1;
+        e->indexed = true;
+        e->owner = this;
+        e->path = path;
+        lru_.push_front(e);
+        e->lru = lru_.begin();
+        index_[path] = e;
+        evict();
+        return e;
+    }
+
+    void release(Entry* e) {
+        if (--e->refs == 0 && !e->indexed) {
+            ::close(e->fd);
+            delete e;
+        }
+    }
+
+    /** 可以直接作为 Connection::send_file 的 FileRelease，arg 是 Entry* */
+    static void release_entry(void* arg) {
+        Entry* e = static_cast<Entry*>(arg);
+        e->owner->release(e);
+    }
+
+    void invalidate(const std::string& path) {
+        std::unordered_map<std::string, Entry*>::iterator it = index_.find(path);
+        if (it != index_.end()) {
+            unlink_entry(it->second);
+        }
+    }
+
+    size_t size() const { return index_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    FileCache(const FileCache&);
+    FileCache& operator=(const FileCache&);
+
+    void evict() {
+        // 刚用过的条目在 LRU 头部，尾部通常就是没有引用的，很少需要往前找
+        std::list<Entry*>::iterator it = lru_.end();
+        while (index_.size() > max_entries_ && it != lru_.begin()) {
+            Entry* e = *--it;
+            if (e->refs == 0) {
+                ++it;  // unlink_entry 会删掉 e 所在的节点
+                unlink_entry(e);
+            }
+        }
+    }
+
+    /** 从索引和 LRU 中摘掉；没有引用就立即关闭，否则等最后一个 release */
+    void unlink_entry(Entry* e) {
+        index_.erase(e->path);
+        lru_.erase(e->lru);
+        e->indexed = false;
+        if (e->refs == 0) {
+            ::close(e->fd);
+            delete e;
+        }
+    }
+
+    size_t max_entries_;
+    std::list<Entry*> lru_;  // 最近使用的在前
+    std::unordered_map<std::string, Entry*> index_;
+    uint64_t hits_;
+    uint64_t misses_;
+};
+
+#endif  // EPOLL_FILE_CACHE_H
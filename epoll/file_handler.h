@@ -0,0 +1,207 @@
+#ifndef EPOLL_FILE_HANDLER_H
+#define EPOLL_FILE_HANDLER_H
+
+/**
+ * 静态文件服务的 Handler：只处理 "GET /path HTTP/1.x"，其余请求回 400/404
+ *
+ * 两种发送方式，方便对比：
+ *  - kFileSendfile：响应头用 send()，文件内容用 Connection::send_file()（sendfile，零拷贝），
+ *    整个文件一次挂到输出队列上，只占一个队列节点，不占缓冲区
+ *  - kFileReadWrite：pread 到每个 Reactor 的一块 256KB 临时缓冲区再 send()；
+ *    内核发送缓冲区满时停下，等 on_drain 再读下一块，内存占用有上限
+ *
+ * 文件描述符和大小由每个 Reactor 自己的 FileCache 缓存，命中时不再 open/fstat。
+ * 路径里带 ".." 的请求回 400。
+ * 注意 send()/close() 出错时会同步回调 on_close 释放 ConnState，之后不能再访问它。
+ * 一个连接上前一个文件还没发完时新到的请求留在输入缓冲区里，等下一批数据到来时再处理
+ * （闭环客户端不会遇到）。
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "file_cache.h"
+#include "reactor.h"
+
+enum FileSendMode {
+    kFileSendfile,
+    kFileReadWrite,
+};
+
+class StaticFileHandler : public Handler {
+public:
+    static const size_t kChunkSize = 256 * 1024;
+
+    /** reactors 是 ReactorGroup 的线程数，每个 Reactor 一份缓存（按 Reactor::id() 取） */
+    StaticFileHandler(const std::string& root, int reactors, FileSendMode mode, size_t cache_entries = 1024)
+        : root_(root), mode_(mode) {
+        for (int i = 0; i < reactors; ++i) {
+            locals_.push_back(new Local(cache_entries));
+        }
+    }
+
+    ~StaticFileHandler() {
+        for (size_t i = 0; i < locals_.size(); ++i) {
+            delete locals_[i];
+        }
+    }
+
+    void on_open(Connection* conn) { conn->context = new ConnState(); }
+
+    size_t on_data(Connection* conn, const char* data, size_t len) {
+        ConnState* st = static_cast<ConnState*>(conn->context);
+        size_t used = 0;
+        while (!conn->closed() && st->streaming == NULL) {
+            const char* end = find_header_end(data + used, len - used);
+            if (end == NULL) {
+                break;
+            }
+            handle_request(conn, st, data + used, end);
+            used = end - data;
+        }
+        return used;
+    }
+
+    void on_drain(Connection* conn) {
+        ConnState* st = static_cast<ConnState*>(conn->context);
+        if (st->streaming != NULL) {
+            pump(conn, st);
+        }
+    }
+
+    void on_close(Connection* conn) {
+        ConnState* st = static_cast<ConnState*>(conn->context);
+        if (st->streaming != NULL) {
+            local(conn)->cache.release(st->streaming);
+        }
+        delete st;
+        conn->context = NULL;
+    }
+
+    /** 所有 Reactor 的缓存命中/未命中次数之和；在 Reactor 线程都停止后调用 */
+    void cache_stats(uint64_t* hits, uint64_t* misses) const {
+        *hits = *misses = 0;
+        for (size_t i = 0; i < locals_.size(); ++i) {
+            *hits += locals_[i]->cache.hits();
+            *misses += locals_[i]->cache.misses();
+        }
+    }
+
+private:
+    struct Local {
+        FileCache cache;
+        std::vector<char> chunk;  // kFileReadWrite 的临时缓冲区
+
+        explicit Local(size_t entries) : cache(entries), chunk(kChunkSize) {}
+    };
+
+    struct ConnState {
+        FileCache::Entry* streaming;  // kFileReadWrite：正在发送的文件
+        uint64_t offset;
+
+        ConnState() : streaming(NULL), offset(0) {}
+    };
+
+    Local* local(Connection* conn) { return locals_[conn->reactor()->id()]; }
+
+    void handle_request(Connection* conn, ConnState* st, const char* req, const char* end) {
+        std::string path;
+        if (!parse_path(req, end, &path)) {
+            send_status(conn, "400 Bad Request");
+            return;
+        }
+        FileCache& cache = local(conn)->cache;
+        FileCache::Entry* e = cache.acquire(root_ + path);
+        if (e == NULL) {
+            send_status(conn, "404 Not Found");
+            return;
+        }
+        char head[160];
+        int n = snprintf(head, sizeof(head),
+                         "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: application/octet-stream\r\n"
+                         "Content-Length: %llu\r\n"
+                         "Connection: keep-alive\r\n\r\n",
+                         (unsigned long long)e->size);
+        conn->send(head, n);
+        if (conn->closed()) {
+            cache.release(e);
+            return;
+        }
+        if (mode_ == kFileSendfile) {
+            conn->send_file(e->fd, 0, e->size, FileCache::release_entry, e);
+            return;
+        }
+        st->streaming = e;
+        st->offset = 0;
+        pump(conn, st);
+    }
+
+    /** kFileReadWrite：一直读写到发完，或者内核缓冲区满（输出开始排队）为止 */
+    void pump(Connection* conn, ConnState* st) {
+        Local* l = local(conn);
+        FileCache::Entry* e = st->streaming;
+        while (st->offset < e->size && conn->pending_output() == 0) {
+            size_t want = e->size - st->offset < kChunkSize ? (size_t)(e->size - st->offset) : kChunkSize;
+            ssize_t n = pread(e->fd, l->chunk.data(), want, (off_t)st->offset);
+            if (n <= 0) {
+                conn->close();
+                return;  // on_close 里归还引用
+            }
+            conn->send(l->chunk.data(), n);
+            if (conn->closed()) {
+                return;
+            }
+            st->offset += n;
+        }
+        if (st->offset == e->size) {
+            l->cache.release(e);
+            st->streaming = NULL;
+        }
+    }
+
+    static void send_status(Connection* conn, const char* status) {
+        char resp[160];
+        int n = snprintf(resp, sizeof(resp), "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n",
+                         status);
+        conn->send(resp, n);
+    }
+
+    /** 从请求行取出路径，拒绝 ".." */
+    static bool parse_path(const char* req, const char* end, std::string* path) {
+        if (end - req < 14 || memcmp(req, "GET /", 5) != 0) {
+            return false;
+        }
+        const char* p = req + 4;
+        const char* q = p;
+        while (q < end && *q != ' ' && *q != '?' && *q != '\r') {
+            ++q;
+        }
+        path->assign(p, q - p);
+        return path->find("..") == std::string::npos;
+    }
+
+    /** 返回 "\r\n\r\n" 之后的位置，找不到返回 NULL */
+    static const char* find_header_end(const char* p, size_t len) {
+        if (len < 4) {
+            return NULL;
+        }
+        const char* last = p + len - 3;
+        for (const char* q = p; q < last; ++q) {
+            if (q[0] == '\r' && q[1] == '\n' && q[2] == '\r' && q[3] == '\n') {
+                return q + 4;
+            }
+        }
+        return NULL;
+    }
+
+    std::string root_;
+    FileSendMode mode_;
+    std::vector<Local*> locals_;
+};
+
+#endif  // EPOLL_FILE_HANDLER_H
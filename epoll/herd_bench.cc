@@ -0,0 +1,275 @@
+/**
+ * 惊群对比：多个工作线程等同一个监听端口上的新连接
+ *
+ * 用法: herd_bench [conns=2000] [gap_us=100] [max_workers=64]
+ *   每种方式、每个线程数（2, 4, ... max_workers）各建立 conns 个连接，相邻两次 connect 间隔 gap_us
+ *
+ * 四种方式：
+ *   shared-fd   一个监听套接字，每个线程自己的 epoll 都以水平触发注册它（经典惊群：一个连接唤醒所有线程）
+ *   exclusive   同上，但注册时带 EPOLLEXCLUSIVE（Linux 4.5+），内核只唤醒一个（或少数几个）等待者
+ *   shared-ep   所有线程在同一个 epoll 实例上 epoll_wait
+ *   reuseport   每个线程一个 SO_REUSEPORT 监听套接字和自己的 epoll，内核按四元组哈希分发连接
+ *
+ * 每个唤醒后的线程 accept4 直到 EAGAIN，统计：
+ *   wakeups/acc   epoll_wait 带回事件的次数 / 接受的连接数（1 为理想值）
+ *   empty%        带回事件但一个连接都没抢到的唤醒占比
+ *   cs/acc        工作线程的上下文切换次数（getrusage(RUSAGE_THREAD) 的自愿 + 非自愿）/ 连接数；
+ *                 被唤醒又发现没事可做、重新睡下的线程在 epoll_wait 里不返回，只能从这里看出来
+ *   accept 延迟   客户端 connect 之前记下的时间 → 服务端 accept 返回，按客户端端口对应
+ *
+ * 客户端关闭时用 SO_LINGER 0 直接 RST，避免 TIME_WAIT 占满临时端口。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "reactor.h"
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
+enum HerdMode {
+    kSharedFd,
+    kExclusive,
+    kSharedEpoll,
+    kReuseport,
+};
+
+static const char* mode_name(HerdMode mode) {
+    switch (mode) {
+        case kSharedFd: return "shared-fd";
+        case kExclusive: return "exclusive";
+        case kSharedEpoll: return "shared-ep";
+        case kReuseport: return "reuseport";
+    }
+    return "?";
+}
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 客户端 connect 前的时间，按客户端端口索引
+static std::atomic<int64_t> g_connect_ns[65536];
+
+struct WorkerResult {
+    uint64_t wakeups;
+    uint64_t empty_wakeups;
+    uint64_t accepted;
+    uint64_t csw;
+    LatencyHistogram latency;
+
+    WorkerResult() : wakeups(0), empty_wakeups(0), accepted(0), csw(0) {}
+};
+
+static uint64_t thread_csw() {
+    rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return (uint64_t)(ru.ru_nvcsw + ru.ru_nivcsw);
+}
+
+static void worker(int ep, int listen_fd, const std::atomic<bool>* stop, std::atomic<int>* progress,
+                   WorkerResult* r) {
+    uint64_t csw0 = thread_csw();
+    uint64_t timeouts = 0;
+    epoll_event events[8];
+    while (!stop->load(std::memory_order_relaxed)) {
+        int n = epoll_wait(ep, events, 8, 50);
+        if (n <= 0) {
+            timeouts += n == 0;  // 超时（用来检查 stop）或 EINTR
+            continue;
+        }
+        ++r->wakeups;
+        uint64_t before = r->accepted;
+        for (;;) {
+            sockaddr_in peer;
+            socklen_t len = sizeof(peer);
+            int fd = accept4(listen_fd, (sockaddr*)&peer, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                break;
+            }
+            int64_t sent = g_connect_ns[ntohs(peer.sin_port)].load(std::memory_order_acquire);
+            r->latency.record(sent > 0 ? monotonic_ns() - sent : 0);
+            ++r->accepted;
+            progress->fetch_add(1, std::memory_order_relaxed);
+            close(fd);
+        }
+        if (r->accepted == before) {
+            ++r->empty_wakeups;
+        }
+    }
+    // 每次超时返回也是一次自愿切换，和连接无关，扣掉
+    uint64_t csw = thread_csw() - csw0;
+    r->csw = csw > timeouts ? csw - timeouts : 0;
+}
+
+static int client_connect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // 先绑定拿到本地端口，服务端 accept 时才能按端口找到发起时间
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    sockaddr_in local;
+    socklen_t len = sizeof(local);
+    getsockname(fd, (sockaddr*)&local, &len);
+    addr.sin_port = htons((uint16_t)port);
+    g_connect_ns[ntohs(local.sin_port)].store(monotonic_ns(), std::memory_order_release);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    linger lg = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    return fd;
+}
+
+static int add_listener(int ep, int fd, uint32_t extra) {
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | extra;
+    ev.data.fd = fd;
+    return epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/** 返回 false 表示当前内核不支持这种方式 */
+static bool run_mode(HerdMode mode, int workers, int conns, int64_t gap_ns) {
+    std::vector<int> listeners;
+    std::vector<int> eps;
+    int port = 0;
+    int nlisten = mode == kReuseport ? workers : 1;
+    for (int i = 0; i < nlisten; ++i) {
+        int fd = create_reuseport_listener("127.0.0.1", port, 4096);
+        if (fd < 0) {
+            return false;
+        }
+        if (port == 0) {
+            sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+            getsockname(fd, (sockaddr*)&addr, &len);
+            port = ntohs(addr.sin_port);
+        }
+        listeners.push_back(fd);
+    }
+    bool ok = true;
+    if (mode == kSharedEpoll) {
+        eps.push_back(epoll_create1(EPOLL_CLOEXEC));
+        add_listener(eps[0], listeners[0], 0);
+    } else {
+        for (int i = 0; i < workers && ok; ++i) {
+            eps.push_back(epoll_create1(EPOLL_CLOEXEC));
+            int lfd = listeners[mode == kReuseport ? i : 0];
+            ok = add_listener(eps[i], lfd, mode == kExclusive ? (uint32_t)EPOLLEXCLUSIVE : 0u) == 0;
+        }
+    }
+
+    std::vector<WorkerResult> results(workers);
+    std::atomic<bool> stop(false);
+    std::atomic<int> progress(0);  // 所有线程接受的连接总数
+    std::vector<std::thread> threads;
+    for (int i = 0; ok && i < workers; ++i) {
+        int ep = eps[mode == kSharedEpoll ? 0 : i];
+        int lfd = listeners[mode == kReuseport ? i : 0];
+        threads.push_back(std::thread(worker, ep, lfd, &stop, &progress, &results[i]));
+    }
+
+    int failed = 0;
+    if (ok) {
+        usleep(50000);  // 等所有工作线程睡进 epoll_wait
+        int64_t next = monotonic_ns();
+        for (int i = 0; i < conns; ++i) {
+            next += gap_ns;
+            int64_t now = monotonic_ns();
+            if (next > now) {
+                int64_t wait = next - now;
+                timespec ts = {(time_t)(wait / 1000000000LL), (long)(wait % 1000000000LL)};
+                nanosleep(&ts, NULL);
+            }
+            int fd = client_connect(port);
+            if (fd < 0) {
+                ++failed;
+                continue;
+            }
+            close(fd);
+        }
+        // 等服务端收完（最多 2s）
+        int64_t deadline = monotonic_ns() + 2000000000LL;
+        while (progress.load() < conns - failed && monotonic_ns() < deadline) {
+            usleep(1000);
+        }
+    }
+    stop.store(true);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    for (size_t i = 0; i < eps.size(); ++i) {
+        close(eps[i]);
+    }
+    for (size_t i = 0; i < listeners.size(); ++i) {
+        close(listeners[i]);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    WorkerResult total;
+    int busy = 0;  // 至少接受过一个连接的线程数
+    for (int i = 0; i < workers; ++i) {
+        total.wakeups += results[i].wakeups;
+        total.empty_wakeups += results[i].empty_wakeups;
+        total.accepted += results[i].accepted;
+        total.csw += results[i].csw;
+        total.latency.merge(results[i].latency);
+        busy += results[i].accepted > 0;
+    }
+    double acc = total.accepted ? (double)total.accepted : 1;
+    printf("%-10s %7d %8llu %6d %11.3f %7.1f %9.2f %10.1f %10.1f %10.1f\n", mode_name(mode), workers,
+           (unsigned long long)total.accepted, busy, total.wakeups / acc,
+           total.wakeups ? 100.0 * total.empty_wakeups / total.wakeups : 0, total.csw / acc,
+           total.latency.percentile(50) / 1000.0, total.latency.percentile(99) / 1000.0, total.latency.max() / 1000.0);
+    fflush(stdout);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int conns = argc > 1 ? atoi(argv[1]) : 2000;
+    int64_t gap_ns = (argc > 2 ? atoll(argv[2]) : 100) * 1000;
+    int max_workers = argc > 3 ? atoi(argv[3]) : 64;
+    if (conns <= 0 || max_workers < 2) {
+        fprintf(stderr, "用法: %s [conns] [gap_us] [max_workers>=2]\n", argv[0]);
+        return 1;
+    }
+
+    printf("每组 %d 个连接，间隔 %lld us，CPU 数 %ld\n", conns, (long long)(gap_ns / 1000),
+           sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-10s %7s %8s %6s %11s %7s %9s %10s %10s %10s\n", "mode", "workers", "accepted", "busy", "wakeups/acc",
+           "empty%", "cs/acc", "p50(us)", "p99(us)", "max(us)");
+    static const HerdMode kModes[] = {kSharedFd, kExclusive, kSharedEpoll, kReuseport};
+    for (int workers = 2; workers <= max_workers; workers *= 2) {
+        for (size_t m = 0; m < sizeof(kModes) / sizeof(kModes[0]); ++m) {
+            if (!run_mode(kModes[m], workers, conns, gap_ns)) {
+                printf("%-10s %7d 不支持: %s\n", mode_name(kModes[m]), workers, strerror(errno));
+            }
+        }
+    }
+    return 0;
+}
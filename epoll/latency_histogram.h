@@ -0,0 +1,125 @@
+#ifndef EPOLL_LATENCY_HISTOGRAM_H
+#define EPOLL_LATENCY_HISTOGRAM_H
+
+/**
+ * HDR 风格的对数-线性延迟直方图（单线程记录）
+ *
+ * 每个 2 的幂区间再均分为 128 个子桶，任意值的相对误差不超过 1/128，
+ * 小于 128 的值精确记录。桶数组固定大小（约 36KB），record() 只有一次
+ * clz 和一次自增，没有内存分配和 I/O，可以在热循环里长时间运行。
+ * 数值单位由调用方决定（本目录的工具统一记录纳秒）。
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class LatencyHistogram {
+public:
+    static const int kSubBits = 7;
+    static const int kSubCount = 1 << kSubBits;
+    static const int kMaxBits = 42;  // 2^42 ns ≈ 73 分钟，更大的值记到最后一个桶
+    static const int kBuckets = (kMaxBits - kSubBits + 1) * kSubCount;
+
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        memset(counts_, 0, sizeof(counts_));
+        total_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    void record(uint64_t v) {
+        ++counts_[index_of(v)];
+        ++total_;
+        sum_ += v;
+        if (v < min_) min_ = v;
+        if (v > max_) max_ = v;
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (int i = 0; i < kBuckets; ++i) {
+            counts_[i] += o.counts_[i];
+        }
+        total_ += o.total_;
+        sum_ += o.sum_;
+        if (o.min_ < min_) min_ = o.min_;
+        if (o.max_ > max_) max_ = o.max_;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? (double)sum_ / total_ : 0; }
+
+    /** 第 p 百分位（0~100）的值，返回所在桶的上界，并且不超过实际最大值 */
+    uint64_t percentile(double p) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(p / 100.0 * total_ + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > total_) rank = total_;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t v = upper_of(i);
+                return v < max_ ? v : max_;
+            }
+        }
+        return max_;
+    }
+
+    /** 打印一行摘要，divisor 用于换算单位（例如 1000 把 ns 换成 us） */
+    void print_summary(FILE* out, const char* name, double divisor, const char* unit) const {
+        fprintf(out, "%-12s n=%llu min=%.1f avg=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f (%s)\n", name,
+                (unsigned long long)total_, min() / divisor, mean() / divisor, percentile(50) / divisor,
+                percentile(90) / divisor, percentile(99) / divisor, percentile(99.9) / divisor, max_ / divisor, unit);
+    }
+
+    /** 每个非空桶一行：桶上界,该桶计数,累计百分比 */
+    void write_csv(FILE* out, double divisor) const {
+        fprintf(out, "value,count,cumulative_percent\n");
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            if (counts_[i] == 0) continue;
+            seen += counts_[i];
+            fprintf(out, "%.3f,%llu,%.5f\n", upper_of(i) / divisor, (unsigned long long)counts_[i],
+                    100.0 * seen / total_);
+        }
+    }
+
+    static int index_of(uint64_t v) {
+        if (v < (uint64_t)kSubCount) {
+            return (int)v;
+        }
+        int msb = 63 - __builtin_clzll(v);
+        if (msb >= kMaxBits) {
+            return kBuckets - 1;
+        }
+        int shift = msb - kSubBits;
+        return (shift + 1) * kSubCount + (int)((v >> shift) - kSubCount);
+    }
+
+    /** 下标为 i 的桶能表示的最大值 */
+    static uint64_t upper_of(int i) {
+        if (i < kSubCount) {
+            return (uint64_t)i;
+        }
+        int shift = i / kSubCount - 1;
+        uint64_t sub = (uint64_t)(i % kSubCount + kSubCount);
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    uint64_t counts_[kBuckets];
+    uint64_t total_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+#endif  // EPOLL_LATENCY_HISTOGRAM_H
@@ -0,0 +1,210 @@
+#include "load_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct ClientConn {
+    int fd;
+    int64_t sent_at;
+    std::string in;
+};
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int connect_to(const char* host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, host, &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+/** 响应头里是否有 "Connection: close"（只认这一种写法，测试用的服务端都这么写） */
+static bool wants_close(const std::string& in, size_t len) {
+    size_t pos = in.find("Connection: close");
+    return pos != std::string::npos && pos < len;
+}
+
+/** 缓冲区里是否已经有一个完整响应，是则返回其长度，否则返回0 */
+static size_t complete_response(const std::string& in, bool http, size_t size) {
+    if (!http) {
+        return in.size() >= size ? size : 0;
+    }
+    size_t head_end = in.find("\r\n\r\n");
+    if (head_end == std::string::npos) {
+        return 0;
+    }
+    size_t body = 0;
+    size_t pos = in.find("Content-Length:");
+    if (pos != std::string::npos && pos < head_end) {
+        body = strtoul(in.c_str() + pos + 15, NULL, 10);
+    }
+    size_t total = head_end + 4 + body;
+    return in.size() >= total ? total : 0;
+}
+
+/** 建立连接并发出第一个请求 */
+static bool start_conn(const LoadConfig* cfg, int ep, const std::string& request, ClientConn* c) {
+    c->fd = connect_to(cfg->host.c_str(), cfg->port);
+    if (c->fd < 0) {
+        return false;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+    // 请求很小，阻塞套接字一次 send 就能写完
+    c->sent_at = monotonic_ns();
+    send(c->fd, request.data(), request.size(), MSG_NOSIGNAL);
+    return true;
+}
+
+static void client_thread(const LoadConfig* cfg, int nconns, int64_t start, std::atomic<bool>* stop,
+                          LoadResult* result) {
+    int64_t slot_ns = cfg->slot_ms > 0 ? cfg->slot_ms * 1000000LL : 0;
+    if (slot_ns > 0) {
+        // 多留几格：结束信号到达之前线程还会多跑一会儿
+        size_t slots = (size_t)(cfg->seconds * 1000LL / cfg->slot_ms) + 16;
+        result->slot_requests.assign(slots, 0);
+        result->slot_max_ns.assign(slots, 0);
+    }
+    std::string request;
+    if (cfg->http) {
+        request = "GET / HTTP/1.1\r\nHost: loadgen\r\n\r\n";
+    } else {
+        request.assign(cfg->size, 'x');
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<ClientConn> conns(nconns);
+    for (int i = 0; i < nconns; ++i) {
+        conns[i].fd = -1;
+        if (!start_conn(cfg, ep, request, &conns[i])) {
+            ++result->errors;
+        }
+    }
+
+    std::vector<epoll_event> events(256);
+    char buf[65536];
+    while (!stop->load(std::memory_order_relaxed)) {
+        int n = epoll_wait(ep, events.data(), (int)events.size(), 100);
+        for (int i = 0; i < n; ++i) {
+            ClientConn* c = static_cast<ClientConn*>(events[i].data.ptr);
+            ssize_t r = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (r <= 0) {
+                if (r < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                ++result->errors;
+                epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                c->fd = -1;
+                c->in.clear();
+                if (cfg->reconnect && !start_conn(cfg, ep, request, c)) {
+                    ++result->errors;
+                }
+                continue;
+            }
+            c->in.append(buf, r);
+            size_t len = complete_response(c->in, cfg->http, cfg->size);
+            if (len == 0) {
+                continue;
+            }
+            int64_t now = monotonic_ns();
+            result->latency.record(now - c->sent_at);
+            ++result->requests;
+            if (slot_ns > 0) {
+                size_t slot = (size_t)((now - start) / slot_ns);
+                if (slot < result->slot_requests.size()) {
+                    ++result->slot_requests[slot];
+                    if ((uint64_t)(now - c->sent_at) > result->slot_max_ns[slot]) {
+                        result->slot_max_ns[slot] = now - c->sent_at;
+                    }
+                }
+            }
+            if (cfg->http && wants_close(c->in, len)) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                c->fd = -1;
+                c->in.clear();
+                if (cfg->reconnect && !start_conn(cfg, ep, request, c)) {
+                    ++result->errors;
+                }
+                continue;
+            }
+            c->in.erase(0, len);
+            c->sent_at = now;
+            send(c->fd, request.data(), request.size(), MSG_NOSIGNAL);
+        }
+    }
+
+    for (int i = 0; i < nconns; ++i) {
+        if (conns[i].fd >= 0) {
+            close(conns[i].fd);
+        }
+    }
+    close(ep);
+}
+
+void run_load(const LoadConfig& cfg, LoadResult* total) {
+    std::atomic<bool> stop(false);
+    std::vector<LoadResult*> results;
+    std::vector<std::thread> threads;
+    int64_t start = monotonic_ns();
+    for (int i = 0; i < cfg.threads; ++i) {
+        // 连接数尽量平均分给各个线程
+        int n = cfg.conns / cfg.threads + (i < cfg.conns % cfg.threads ? 1 : 0);
+        LoadResult* r = new LoadResult();
+        results.push_back(r);
+        threads.push_back(std::thread(client_thread, &cfg, n, start, &stop, r));
+    }
+    sleep(cfg.seconds);
+    stop.store(true);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    total->elapsed_s = (monotonic_ns() - start) / 1e9;
+    for (size_t i = 0; i < results.size(); ++i) {
+        total->requests += results[i]->requests;
+        total->errors += results[i]->errors;
+        total->latency.merge(results[i]->latency);
+        const LoadResult& r = *results[i];
+        if (total->slot_requests.size() < r.slot_requests.size()) {
+            total->slot_requests.resize(r.slot_requests.size(), 0);
+            total->slot_max_ns.resize(r.slot_max_ns.size(), 0);
+        }
+        for (size_t j = 0; j < r.slot_requests.size(); ++j) {
+            total->slot_requests[j] += r.slot_requests[j];
+            if (r.slot_max_ns[j] > total->slot_max_ns[j]) {
+                total->slot_max_ns[j] = r.slot_max_ns[j];
+            }
+        }
+        delete results[i];
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef EPOLL_LOAD_CLIENT_H
+#define EPOLL_LOAD_CLIENT_H
+
+/**
+ * 闭环压测客户端，reactor_loadgen 和 co_bench 共用
+ *
+ * 每个客户端线程一个 epoll，负责 conns/threads 条连接；每条连接闭环：发一个请求，
+ * 收齐完整响应后记录延迟，再发下一个。
+ *   echo：请求是 size 字节，响应也是 size 字节
+ *   http：请求是一个最小的 GET，响应按 Content-Length 判断是否收齐
+ * reconnect 为 true 时连接出错（服务端崩溃、重启）后立即重连并继续压，否则这条连接就此作废。
+ * http 响应带 "Connection: close" 时服务端是在有序关闭连接（比如排空），不算错误，reconnect 时同样重连。
+ * slot_ms > 0 时额外按 slot_ms 一格记录每格的完成数和最大延迟，用来看某个时刻（升级、重启）附近的抖动。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "latency_histogram.h"
+
+struct LoadConfig {
+    std::string host;
+    int port;
+    int conns;
+    int threads;
+    int seconds;
+    bool http;
+    size_t size;
+    bool reconnect;
+    int slot_ms;
+
+    LoadConfig() : port(0), conns(1), threads(1), seconds(1), http(false), size(0), reconnect(false), slot_ms(0) {}
+};
+
+struct LoadResult {
+    uint64_t requests;
+    uint64_t errors;
+    double elapsed_s;
+    LatencyHistogram latency;  // 纳秒
+    std::vector<uint64_t> slot_requests;  // slot_ms > 0 时第 i 格 [i*slot_ms, (i+1)*slot_ms) 的完成数
+    std::vector<uint64_t> slot_max_ns;    // 同一格里的最大延迟
+
+    LoadResult() : requests(0), errors(0), elapsed_s(0) {}
+};
+
+/** 对 cfg.host:cfg.port 压 cfg.seconds 秒，结果累加到 total */
+void run_load(const LoadConfig& cfg, LoadResult* total);
+
+#endif  // EPOLL_LOAD_CLIENT_H
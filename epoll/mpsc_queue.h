@@ -0,0 +1,78 @@
+#ifndef EPOLL_MPSC_QUEUE_H
+#define EPOLL_MPSC_QUEUE_H
+
+/**
+ * 侵入式无锁多生产者单消费者队列（Dmitry Vyukov 的 intrusive MPSC 算法）
+ *
+ *  - push：任意线程调用，一次原子 exchange + 一次 store，无等待、不分配内存
+ *  - pop：只能由唯一的消费者线程调用
+ *  - 节点嵌在调用方的对象里（继承 MpscNode），出队后归调用方处理
+ *
+ * 生产者在 exchange 之后、链接 next 之前被抢占时，消费者会暂时看不到后面的节点，
+ * pop 返回 NULL 但 empty() 为 false；消费者应当稍后重试而不是去睡眠。
+ */
+
+#include <stddef.h>
+#include <atomic>
+
+struct MpscNode {
+    std::atomic<MpscNode*> next;
+    MpscNode() : next(NULL) {}
+};
+
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    void push(MpscNode* node) {
+        node->next.store(NULL, std::memory_order_relaxed);
+        // seq_cst 的 exchange 同时充当全屏障，TaskQueue 的睡眠协议依赖这一点
+        MpscNode* prev = head_.exchange(node, std::memory_order_seq_cst);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /** 取出一个节点，暂时没有可取的返回 NULL */
+    MpscNode* pop() {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (next == NULL) {
+                return NULL;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != NULL) {
+            tail_ = next;
+            return tail;
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return NULL;  // 有生产者还没来得及链接 next
+        }
+        // tail 是最后一个节点：放回 stub 作为新的尾巴，tail 才能安全取出
+        push(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != NULL) {
+            tail_ = next;
+            return tail;
+        }
+        return NULL;
+    }
+
+    /** 消费者调用：队列里确实没有任何节点（包括尚未链接完成的） */
+    bool empty() const { return tail_ == &stub_ && head_.load(std::memory_order_seq_cst) == &stub_; }
+
+private:
+    MpscQueue(const MpscQueue&);
+    MpscQueue& operator=(const MpscQueue&);
+
+    // 生产者写 head_，消费者读写 tail_，用填充分开放在不同的缓存行
+    // （不用 alignas(64)：C++11 的 new 不保证超对齐，Reactor 是 new 出来的）
+    std::atomic<MpscNode*> head_;
+    char pad_[64 - sizeof(std::atomic<MpscNode*>)];
+    MpscNode* tail_;
+    MpscNode stub_;
+};
+
+#endif  // EPOLL_MPSC_QUEUE_H
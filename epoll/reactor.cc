@@ -0,0 +1,591 @@
+#include "reactor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+
+int create_reuseport_listener(const char* host, int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "socket 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        fprintf(stderr, "SO_REUSEPORT 失败: %s\n", strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "无效地址 %s\n", host);
+        ::close(fd);
+        return -1;
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        fprintf(stderr, "监听 %s:%d 失败: %s\n", host, port, strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int pin_current_thread(int cpu) {
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % (ncpu > 0 ? ncpu : 1), &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+}
+
+void Connection::send(const char* data, size_t len) {
+    reactor_->send(this, data, len);
+}
+
+void Connection::send_file(int fd, uint64_t offset, size_t len, FileRelease release, void* arg) {
+    reactor_->send_file(this, fd, offset, len, release, arg);
+}
+
+void Connection::close() {
+    reactor_->close(this);
+}
+
+Reactor::Reactor(int id, Handler* handler, const ReactorOptions& opts)
+    : id_(id),
+      handler_(handler),
+      opts_(opts),
+      backend_(opts.backend),
+      uring_(NULL),
+      ep_(-1),
+      stopping_(false),
+      wheel_(1000000, TimerEngine::now_ns()),
+      loop_now_(TimerEngine::now_ns()),
+      wait_(opts.wait_mode),
+      pool_(opts.buffer_size),
+      events_(opts.max_events > 0 ? opts.max_events : 1) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+Reactor::~Reactor() {
+    // 先销毁 io_uring：关闭环会取消所有未完成的请求，之后才能释放连接对象
+    destroy_uring();
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+        ::close(listeners_[i]);
+    }
+    for (size_t i = 0; i < closing_.size(); ++i) {
+        closing_[i]->inflight_ = 0;
+    }
+    flush_closed();
+    for (size_t i = 0; i < free_conns_.size(); ++i) {
+        delete free_conns_[i];
+    }
+    if (ep_ >= 0) {
+        ::close(ep_);
+    }
+}
+
+const char* Reactor::backend_name(ReactorBackend backend) {
+    return backend == kBackendIoUring ? "io_uring" : "epoll";
+}
+
+int Reactor::init() {
+    if (backend_ == kBackendIoUring) {
+        if (init_uring() == 0) {
+            // timerfd 和任务队列的 eventfd 都由 io_uring 的 multishot poll 等待
+            if (tasks_.init(-1) < 0) {
+                return -1;
+            }
+            return timers_.init(-1);
+        }
+        backend_ = kBackendEpoll;
+    }
+
+    ep_ = epoll_create1(EPOLL_CLOEXEC);
+    if (ep_ < 0) {
+        fprintf(stderr, "epoll_create1 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    if (tasks_.init(ep_) < 0) {
+        return -1;
+    }
+    return timers_.init(ep_);
+}
+
+int Reactor::add_listener(int listen_fd) {
+    if (backend_ != kBackendIoUring) {  // io_uring 在 run_uring() 开始时提交 multishot accept
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLET;
+        // 监听套接字用 fd 值打上标记：data.u64 高位置 1，与连接指针区分
+        ev.data.u64 = (1ULL << 63) | (uint64_t)listen_fd;
+        if (epoll_ctl(ep_, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+            return -1;
+        }
+    }
+    // 成功后才归本 Reactor 所有，析构时关闭；失败时由调用方关闭
+    listeners_.push_back(listen_fd);
+    return 0;
+}
+
+void Reactor::stop() {
+    stopping_.store(true, std::memory_order_release);
+    tasks_.notify();
+}
+
+void Reactor::run() {
+    // sendfile 没有 MSG_NOSIGNAL，对端已关闭时会给本线程发 SIGPIPE；在本线程屏蔽它，只拿 EPIPE
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, NULL);
+
+    if (backend_ == kBackendIoUring) {
+        run_uring();
+    } else {
+        run_epoll();
+    }
+
+    // 退出前关闭所有剩余连接
+    while (!live_.empty()) {
+        close(live_.back());
+    }
+    flush_closed();
+}
+
+void Reactor::run_epoll() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int64_t timeout_ns = -1;
+        int64_t deadline = timers_.next_deadline();
+        if (deadline >= 0) {
+            timeout_ns = deadline - TimerEngine::now_ns();
+            if (timeout_ns < 0) timeout_ns = 0;
+        }
+        timeout_ns = wheel_timeout(timeout_ns);
+        if (timeout_ns != 0 && !tasks_.prepare_sleep()) {
+            timeout_ns = 0;  // 已经有投递进来的任务，不睡眠
+        }
+        int n = wait_.wait(ep_, events_.data(), events_.size(), timeout_ns);
+        tasks_.finish_sleep();
+        ++stats_.syscalls;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "reactor %d epoll_wait 失败: %s\n", id_, strerror(errno));
+            break;
+        }
+        ++stats_.wakeups;
+        loop_now_ = TimerEngine::now_ns();
+        stats_.events += n;
+        events_.update(n);
+        // 监听套接字的 data 是 fd 加标记位，不是指针
+        events_.prefetch(n, 2, [](const epoll_event& ev) { return (ev.data.u64 >> 63) != 0; });
+        for (int i = 0; i < n; ++i) {
+            const epoll_event& ev = events_[i];
+            if (ev.data.u64 >> 63) {
+                handle_accept((int)(ev.data.u64 & 0x7fffffff));
+            } else if (ev.data.ptr == &timers_) {
+                timers_.on_readable();
+            } else if (ev.data.ptr == &tasks_) {
+                tasks_.on_readable();
+                ++stats_.syscalls;
+            } else {
+                Connection* conn = static_cast<Connection*>(ev.data.ptr);
+                if (conn->closed_) continue;
+                if (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    handle_read(conn);
+                }
+                if (!conn->closed_ && (ev.events & EPOLLOUT)) {
+                    handle_write(conn);
+                }
+            }
+        }
+        tasks_.run_pending();
+        if (wheel_.size() > 0) {
+            wheel_.advance(loop_now_);
+        }
+        flush_closed();
+    }
+}
+
+Connection* Reactor::new_connection(int fd) {
+    Connection* conn;
+    if (!free_conns_.empty()) {
+        conn = free_conns_.back();
+        free_conns_.pop_back();
+    } else {
+        conn = new Connection();
+    }
+    conn->fd_ = fd;
+    conn->reactor_ = this;
+    conn->closed_ = false;
+    conn->context = NULL;
+    conn->pending_bytes_ = 0;
+    conn->inflight_ = 0;
+    conn->send_inflight_ = false;
+    conn->flush_queued_ = false;
+    return conn;
+}
+
+void Reactor::open_connection(Connection* conn) {
+    int on = 1;
+    setsockopt(conn->fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    ++stats_.syscalls;
+    ++stats_.accepted;
+    conn->slot_ = live_.size();
+    live_.push_back(conn);
+    conn->idle_timer_.callback = on_idle_timeout;
+    conn->idle_timer_.data = conn;
+    touch(conn);
+    handler_->on_open(conn);
+}
+
+void Reactor::touch(Connection* conn) {
+    if (opts_.idle_timeout_ms > 0) {
+        wheel_.schedule(&conn->idle_timer_, loop_now_ + opts_.idle_timeout_ms * 1000000LL);
+    }
+}
+
+void Reactor::on_idle_timeout(WheelTimer* timer) {
+    Connection* conn = static_cast<Connection*>(timer->data);
+    ++conn->reactor_->stats_.timeouts;
+    conn->reactor_->close(conn);
+}
+
+int64_t Reactor::wheel_timeout(int64_t timeout_ns) {
+    if (wheel_.size() == 0) {
+        return timeout_ns;
+    }
+    int64_t t = wheel_.next_timeout_ns(TimerEngine::now_ns());
+    return timeout_ns < 0 || t < timeout_ns ? t : timeout_ns;
+}
+
+void Reactor::handle_accept(int listen_fd) {
+    // 边沿触发：必须一直 accept 到 EAGAIN
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        ++stats_.syscalls;
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "reactor %d accept 失败: %s\n", id_, strerror(errno));
+            }
+            return;
+        }
+        Connection* conn = new_connection(fd);
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+        ++stats_.syscalls;
+        if (epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            ::close(fd);
+            free_conns_.push_back(conn);
+            continue;
+        }
+        open_connection(conn);
+    }
+}
+
+void Reactor::handle_read(Connection* conn) {
+    IoBuffer& in = conn->input_;
+    size_t cap = pool_.block_size();
+    touch(conn);
+    for (;;) {
+        if (in.data == NULL) {
+            in.data = pool_.acquire();
+            in.begin = in.end = 0;
+        } else if (in.end == cap) {
+            if (in.begin == 0) {
+                // 缓冲区满了应用还一个字节都没消费：请求超过缓冲块大小，直接断开
+                close(conn);
+                return;
+            }
+            memmove(in.data, in.read_ptr(), in.readable());
+            in.end -= in.begin;
+            in.begin = 0;
+        }
+
+        ssize_t n = recv(conn->fd_, in.write_ptr(), cap - in.end, 0);
+        ++stats_.syscalls;
+        if (n > 0) {
+            in.end += n;
+            stats_.bytes_in += n;
+            size_t used = handler_->on_data(conn, in.read_ptr(), in.readable());
+            if (conn->closed_) {
+                return;
+            }
+            in.begin += used;
+            if (in.begin == in.end) {
+                in.begin = in.end = 0;
+            }
+            continue;
+        }
+        if (n == 0) {
+            close(conn);  // 对端关闭
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close(conn);
+            return;
+        }
+        break;
+    }
+    // 读空了：输入缓冲区没有残留数据就还给池子
+    if (in.readable() == 0) {
+        pool_.release(in.data);
+        in.data = NULL;
+    }
+}
+
+void Reactor::send(Connection* conn, const char* data, size_t len) {
+    if (conn->closed_ || len == 0) {
+        return;
+    }
+    if (backend_ == kBackendIoUring) {
+        // 只追加到输出队列，本轮完成事件处理完后统一提交 SEND，和等待合并成一次 io_uring_enter
+        queue_output(conn, data, len);
+        if (!conn->flush_queued_) {
+            conn->flush_queued_ = true;
+            uring_flush_.push_back(conn);
+        }
+        return;
+    }
+    // 没有排队的数据时直接写，大部分小响应一次 send 就完成了
+    if (conn->output_.empty()) {
+        ssize_t n = ::send(conn->fd_, data, len, MSG_NOSIGNAL);
+        ++stats_.syscalls;
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                close(conn);
+                return;
+            }
+            n = 0;
+        }
+        stats_.bytes_out += n;
+        data += n;
+        len -= n;
+    }
+    queue_output(conn, data, len);
+}
+
+void Reactor::send_file(Connection* conn, int fd, uint64_t offset, size_t len, FileRelease release, void* arg) {
+    if (conn->closed_ || len == 0) {
+        release(arg);
+        return;
+    }
+    if (backend_ == kBackendEpoll && conn->output_.empty()) {
+        while (len > 0) {
+            off_t off = (off_t)offset;
+            ssize_t n = sendfile(conn->fd_, fd, &off, len);
+            ++stats_.syscalls;
+            if (n > 0) {
+                stats_.bytes_out += n;
+                offset += n;
+                len -= n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            close(conn);  // 出错，或者文件比 len 短
+            release(arg);
+            return;
+        }
+        if (len == 0) {
+            release(arg);
+            return;
+        }
+    }
+    OutputChunk c;
+    c.file_fd = fd;
+    c.begin = offset;
+    c.end = offset + len;
+    c.release = release;
+    c.release_arg = arg;
+    conn->output_.push_back(c);
+    conn->pending_bytes_ += len;
+    if (backend_ == kBackendIoUring && !conn->flush_queued_) {
+        // 和 send() 一样本轮结束时统一提交；文件段到了队头才一块一块地读（uring_read_file）
+        conn->flush_queued_ = true;
+        uring_flush_.push_back(conn);
+    }
+}
+
+void Reactor::queue_output(Connection* conn, const char* data, size_t len) {
+    size_t cap = pool_.block_size();
+    while (len > 0) {
+        if (conn->output_.empty() || conn->output_.back().file_fd >= 0 || conn->output_.back().end == cap) {
+            OutputChunk b;
+            b.data = pool_.acquire();
+            conn->output_.push_back(b);
+        }
+        OutputChunk& b = conn->output_.back();
+        size_t take = cap - b.end < len ? cap - b.end : len;
+        memcpy(b.write_ptr(), data, take);
+        b.end += take;
+        data += take;
+        len -= take;
+        conn->pending_bytes_ += take;
+    }
+}
+
+void Reactor::pop_output(Connection* conn) {
+    OutputChunk& c = conn->output_.front();
+    if (c.file_fd >= 0) {
+        c.release(c.release_arg);
+    } else {
+        pool_.release(c.data);
+    }
+    conn->output_.pop_front();
+}
+
+void Reactor::handle_write(Connection* conn) {
+    if (conn->output_.empty()) {
+        return;
+    }
+    while (!conn->output_.empty()) {
+        OutputChunk& b = conn->output_.front();
+        ssize_t n;
+        if (b.file_fd >= 0) {
+            off_t off = (off_t)b.begin;
+            n = sendfile(conn->fd_, b.file_fd, &off, b.readable());
+            if (n == 0) {
+                close(conn);  // 文件被截短了
+                return;
+            }
+        } else {
+            n = ::send(conn->fd_, b.read_ptr(), b.readable(), MSG_NOSIGNAL);
+        }
+        ++stats_.syscalls;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close(conn);
+            }
+            return;  // EAGAIN：等下一次 EPOLLOUT 边沿
+        }
+        stats_.bytes_out += n;
+        b.begin += n;
+        conn->pending_bytes_ -= n;
+        if (b.readable() == 0) {
+            pop_output(conn);
+        }
+    }
+    handler_->on_drain(conn);
+}
+
+void Reactor::close(Connection* conn) {
+    if (conn->closed_) {
+        return;
+    }
+    conn->closed_ = true;
+    if (backend_ == kBackendIoUring) {
+        // 未完成的 recv/send 持有文件引用，close 不会让它们结束；shutdown 让它们立即完成
+        shutdown(conn->fd_, SHUT_RDWR);
+    } else {
+        epoll_ctl(ep_, EPOLL_CTL_DEL, conn->fd_, NULL);
+    }
+    ::close(conn->fd_);
+    stats_.syscalls += 2;
+    ++stats_.closed;
+    wheel_.cancel(&conn->idle_timer_);
+    // 从存活列表中 O(1) 删除：和最后一个交换
+    live_[conn->slot_] = live_.back();
+    live_[conn->slot_]->slot_ = conn->slot_;
+    live_.pop_back();
+    handler_->on_close(conn);
+    closing_.push_back(conn);
+}
+
+void Reactor::flush_closed() {
+    // 同一批事件里可能还有指向这些连接的 epoll_event，所以等整批处理完再回收；
+    // io_uring 下还要等所有引用它的 SQE 都完成
+    size_t keep = 0;
+    for (size_t i = 0; i < closing_.size(); ++i) {
+        Connection* conn = closing_[i];
+        if (conn->inflight_ > 0) {
+            closing_[keep++] = conn;
+            continue;
+        }
+        if (conn->input_.data != NULL) {
+            pool_.release(conn->input_.data);
+            conn->input_.data = NULL;
+        }
+        while (!conn->output_.empty()) {
+            pop_output(conn);
+        }
+        conn->fd_ = -1;
+        free_conns_.push_back(conn);
+    }
+    closing_.resize(keep);
+}
+
+ReactorGroup::ReactorGroup(Handler* handler, const ReactorOptions& opts)
+    : handler_(handler), opts_(opts), port_(0) {}
+
+ReactorGroup::~ReactorGroup() {
+    stop();
+    for (size_t i = 0; i < reactors_.size(); ++i) {
+        delete reactors_[i];
+    }
+}
+
+int ReactorGroup::start(const char* host, int port) {
+    port_ = port;
+    for (int i = 0; i < opts_.threads; ++i) {
+        Reactor* r = new Reactor(i, handler_, opts_);
+        reactors_.push_back(r);
+        if (r->init() < 0) {
+            return -1;
+        }
+        int fd = create_reuseport_listener(host, port_, opts_.backlog);
+        if (fd < 0) {
+            return -1;
+        }
+        if (port_ == 0) {
+            // 第一个监听套接字拿到内核分配的端口，其余的绑定同一个端口
+            sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+            getsockname(fd, (sockaddr*)&addr, &len);
+            port_ = ntohs(addr.sin_port);
+        }
+        if (r->add_listener(fd) < 0) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < reactors_.size(); ++i) {
+        Reactor* r = reactors_[i];
+        bool pin = opts_.pin_cpu;
+        threads_.push_back(std::thread([r, pin] {
+            if (pin) {
+                pin_current_thread(r->id());
+            }
+            r->run();
+        }));
+    }
+    return 0;
+}
+
+void ReactorGroup::stop() {
+    for (size_t i = 0; i < reactors_.size(); ++i) {
+        reactors_[i]->stop();
+    }
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        threads_[i].join();
+    }
+    threads_.clear();
+}
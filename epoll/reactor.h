@@ -0,0 +1,286 @@
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+
+/**
+ * 多 Reactor（one loop per thread）网络库
+ *
+ *  - 每个工作线程一个 epoll 实例，线程绑定到固定 CPU
+ *  - 每个线程各自持有一个 SO_REUSEPORT 监听套接字，由内核按四元组哈希把新连接
+ *    分散到各个线程，线程之间没有共享的 accept 队列和锁
+ *  - 连接以边沿触发（EPOLLET）注册 EPOLLIN|EPOLLOUT，只注册一次，不再 EPOLL_CTL_MOD
+ *  - 事件成批取回（EventBatch），分发前先预取整批的 Connection 对象
+ *  - 读写缓冲区从每个 Reactor 自己的 BufferPool 借用
+ *  - 空闲超时挂在每个 Reactor 的分层时间轮上（O(1) 刷新），时间轮最近的槽决定 epoll_wait 的超时
+ *  - 事件后端在启动时选择：epoll（默认）或 io_uring（见 reactor_uring.cc），
+ *    内核不支持 io_uring 时 init() 自动回退到 epoll，应用代码不用改
+ *
+ * 应用只需实现 Handler：
+ *   on_data 返回已消费的字节数，未消费的部分留在输入缓冲区，下次和新数据拼在一起再回调
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "event_batch.h"
+#include "task_queue.h"
+#include "timer_engine.h"
+#include "timing_wheel.h"
+#include "wait_strategy.h"
+
+class Reactor;
+
+/** 文件段发完（或连接关闭丢弃）时的回调，通常用来归还文件缓存里的引用 */
+typedef void (*FileRelease)(void* arg);
+
+/**
+ * 输出队列的一段：一块池里借来的内存，或者 file_fd >= 0 时的一段文件，
+ * 此时 [begin, end) 是文件偏移，data 为 NULL，由 sendfile 从页缓存直接发送
+ */
+struct OutputChunk : IoBuffer {
+    int file_fd;
+    FileRelease release;
+    void* release_arg;
+
+    OutputChunk() : file_fd(-1), release(NULL), release_arg(NULL) {}
+};
+
+class Connection {
+public:
+    int fd() const { return fd_; }
+    Reactor* reactor() const { return reactor_; }
+    bool closed() const { return closed_; }
+
+    /** 发送数据，内核发送缓冲区满时剩余部分排队，等 EPOLLOUT 再继续 */
+    void send(const char* data, size_t len);
+
+    /**
+     * 发送文件 fd 的 [offset, offset + len)，不经过用户态拷贝（epoll 后端用 sendfile）
+     * 和 send() 的数据按调用顺序发出；fd 要保持打开，直到 release(arg) 被调用
+     * （发完、出错或连接关闭时调用，可能在 send_file 返回之前）
+     * io_uring 后端没有 sendfile：文件段排到队头时每次 pread 一个缓冲块再 SEND，发完再读下一块，
+     * 每个连接的内存占用和文件大小无关
+     */
+    void send_file(int fd, uint64_t offset, size_t len, FileRelease release, void* arg);
+
+    /** 关闭连接（on_close 会在本次事件处理结束前回调），可以在 on_data 里调用 */
+    void close();
+
+    /** 待发送的字节数 */
+    size_t pending_output() const { return pending_bytes_; }
+
+    void* context;  // 应用自定义的连接状态
+
+private:
+    friend class Reactor;
+    Connection()
+        : context(NULL),
+          fd_(-1),
+          reactor_(NULL),
+          closed_(false),
+          pending_bytes_(0),
+          slot_(0),
+          inflight_(0),
+          send_inflight_(false),
+          flush_queued_(false) {}
+
+    int fd_;
+    Reactor* reactor_;
+    bool closed_;
+    IoBuffer input_;
+    std::deque<OutputChunk> output_;
+    size_t pending_bytes_;
+    size_t slot_;
+    WheelTimer idle_timer_;
+    // 以下只有 io_uring 后端使用
+    int inflight_;          // 尚未完成的 SQE 数，归零后连接对象才能回收
+    bool send_inflight_;    // 输出队列头部的块正在发送
+    bool flush_queued_;     // 已经在本轮待发送列表里
+};
+
+class Handler {
+public:
+    virtual ~Handler() {}
+    virtual void on_open(Connection*) {}
+    /** 返回已消费的字节数 */
+    virtual size_t on_data(Connection* conn, const char* data, size_t len) = 0;
+    /** 排队的输出全部发完时回调（直接发完、没有排队过的不回调），用来做发送端的流控 */
+    virtual void on_drain(Connection*) {}
+    virtual void on_close(Connection*) {}
+};
+
+enum ReactorBackend {
+    kBackendEpoll,
+    kBackendIoUring,
+};
+
+struct ReactorOptions {
+    int threads;
+    bool pin_cpu;          // 第 i 个线程绑定到第 i % ncpu 个 CPU
+    int max_events;        // 一次 epoll_wait 最多取回的事件数，实际批大小在 [1, max_events] 之间随负载调整
+    WaitMode wait_mode;
+    int backlog;
+    size_t buffer_size;
+    ReactorBackend backend;
+    int idle_timeout_ms;   // 连接多久没有收到数据就关闭，0 表示不限
+
+    ReactorOptions()
+        : threads(1),
+          pin_cpu(true),
+          max_events(1024),
+          wait_mode(kWaitBlocking),
+          backlog(1024),
+          buffer_size(16384),
+          backend(kBackendEpoll),
+          idle_timeout_ms(0) {}
+};
+
+struct ReactorStats {
+    uint64_t accepted;
+    uint64_t closed;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t wakeups;      // epoll_wait 返回次数
+    uint64_t events;       // 处理的事件数（io_uring 为完成事件数）
+    uint64_t syscalls;     // 事件循环里发起的系统调用数（不含定时器内部的 timerfd 调用）
+    uint64_t timeouts;     // 因空闲超时关闭的连接数
+};
+
+class Reactor {
+public:
+    Reactor(int id, Handler* handler, const ReactorOptions& opts);
+    ~Reactor();
+
+    /**
+     * 创建 epoll（或 io_uring）、唤醒用的 eventfd；成功返回0，失败返回-1
+     * 选了 io_uring 但内核不支持时打印原因并回退到 epoll，backend() 返回实际使用的后端
+     */
+    int init();
+
+    /** 接管一个已经 listen 的非阻塞套接字；失败返回 -1，套接字仍归调用方 */
+    int add_listener(int listen_fd);
+
+    /** 运行事件循环，直到 stop() */
+    void run();
+
+    /** 可以从任意线程调用 */
+    void stop();
+
+    /**
+     * 从任意线程投递一个任务，在本 Reactor 线程里执行（无锁，事件循环正忙时不发起系统调用）
+     * stop() 之后投递的任务不保证执行
+     */
+    void post(TaskQueue::Task* task) { tasks_.post(task); }
+    TaskQueue& tasks() { return tasks_; }
+
+    int id() const { return id_; }
+    ReactorBackend backend() const { return backend_; }
+    static const char* backend_name(ReactorBackend backend);
+    TimerEngine& timers() { return timers_; }
+    /** 1ms 精度的时间轮，适合大量连接级超时；在本 Reactor 线程里使用 */
+    TimingWheel& wheel() { return wheel_; }
+    /** 本轮事件循环醒来时的 CLOCK_MONOTONIC 时间，给 wheel() 算截止时间用，省一次 clock_gettime */
+    int64_t loop_now() const { return loop_now_; }
+    BufferPool& buffers() { return pool_; }
+    const ReactorStats& stats() const { return stats_; }
+    size_t connections() const { return live_.size(); }
+
+private:
+    friend class Connection;
+    struct UringState;
+
+    void run_epoll();
+    void handle_accept(int listen_fd);
+    void handle_read(Connection* conn);
+    void handle_write(Connection* conn);
+    void send(Connection* conn, const char* data, size_t len);
+    void send_file(Connection* conn, int fd, uint64_t offset, size_t len, FileRelease release, void* arg);
+    void queue_output(Connection* conn, const char* data, size_t len);
+    void pop_output(Connection* conn);
+    void close(Connection* conn);
+    void flush_closed();
+    Connection* new_connection(int fd);
+    void open_connection(Connection* conn);
+    void touch(Connection* conn);
+    int64_t wheel_timeout(int64_t timeout_ns);
+    static void on_idle_timeout(WheelTimer* timer);
+
+    // io_uring 后端，实现在 reactor_uring.cc
+    int init_uring();
+    void destroy_uring();
+    void run_uring();
+    void uring_arm_accept(int listen_fd);
+    void uring_arm_recv(Connection* conn);
+    void uring_arm_poll(int fd, uint64_t tag);
+    void uring_on_accept(int res, uint32_t flags, int listen_fd);
+    void uring_on_recv(Connection* conn, int res, uint32_t flags);
+    void uring_on_send(Connection* conn, int res);
+    void uring_deliver(Connection* conn, const char* data, size_t len);
+    void uring_flush_sends();
+    bool uring_read_file(Connection* conn);
+
+    int id_;
+    Handler* handler_;
+    ReactorOptions opts_;
+    ReactorBackend backend_;
+    UringState* uring_;
+    int ep_;
+    std::vector<int> listeners_;
+    std::atomic<bool> stopping_;
+    TaskQueue tasks_;
+    TimerEngine timers_;
+    TimingWheel wheel_;
+    int64_t loop_now_;
+    WaitStrategy wait_;
+    BufferPool pool_;
+    ReactorStats stats_;
+    std::vector<Connection*> live_;       // 存活连接，Connection::slot_ 为下标
+    EventBatch events_;
+    std::vector<Connection*> closing_;    // 已关闭、等待回收的连接（io_uring 下要等 inflight_ 归零）
+    std::vector<Connection*> free_conns_; // 回收的连接对象
+    std::vector<Connection*> uring_flush_; // io_uring：本轮有新输出、等待提交 SEND 的连接
+};
+
+/**
+ * 一组 Reactor：每个线程一个 Reactor、一个 SO_REUSEPORT 监听套接字
+ */
+class ReactorGroup {
+public:
+    ReactorGroup(Handler* handler, const ReactorOptions& opts);
+    ~ReactorGroup();
+
+    /**
+     * 绑定 host:port（port 为 0 时由内核分配，所有线程共用同一个端口）并启动线程
+     * 返回值：成功返回0，失败返回-1
+     */
+    int start(const char* host, int port);
+
+    /** 实际监听的端口 */
+    int port() const { return port_; }
+
+    /** 停止所有线程并等待退出 */
+    void stop();
+
+    size_t size() const { return reactors_.size(); }
+    Reactor* reactor(size_t i) { return reactors_[i]; }
+
+private:
+    Handler* handler_;
+    ReactorOptions opts_;
+    int port_;
+    std::vector<Reactor*> reactors_;
+    std::vector<std::thread> threads_;
+};
+
+/** 创建非阻塞、SO_REUSEPORT 的 TCP 监听套接字，失败返回-1 */
+int create_reuseport_listener(const char* host, int port, int backlog);
+
+/** 把当前线程绑定到 cpu % ncpu 上 */
+int pin_current_thread(int cpu);
+
+#endif  // EPOLL_REACTOR_H
@@ -0,0 +1,75 @@
+#ifndef EPOLL_REACTOR_HANDLERS_H
+#define EPOLL_REACTOR_HANDLERS_H
+
+/**
+ * 演示用的两个 Handler，reactor_server 和 reactor_loadgen 的进程内压测共用
+ *
+ *  - EchoHandler：收到什么回什么
+ *  - HttpLiteHandler：只认 "\r\n\r\n" 结尾的请求头（忽略请求体），
+ *    每个请求回一个 keep-alive 的 200 响应；支持 pipeline
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "reactor.h"
+
+class EchoHandler : public Handler {
+public:
+    size_t on_data(Connection* conn, const char* data, size_t len) {
+        conn->send(data, len);
+        return len;
+    }
+};
+
+class HttpLiteHandler : public Handler {
+public:
+    HttpLiteHandler() {
+        static const char kBody[] = "hello, reactor\n";
+        char head[160];
+        snprintf(head, sizeof(head),
+                 "HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/plain\r\n"
+                 "Content-Length: %zu\r\n"
+                 "Connection: keep-alive\r\n\r\n",
+                 sizeof(kBody) - 1);
+        response_ = std::string(head) + kBody;
+    }
+
+    size_t on_data(Connection* conn, const char* data, size_t len) {
+        size_t used = 0;
+        for (;;) {
+            const char* end = find_header_end(data + used, len - used);
+            if (end == NULL) {
+                break;  // 请求头不完整，留在缓冲区等下一批数据
+            }
+            conn->send(response_.data(), response_.size());
+            used = end - data;
+        }
+        return used;
+    }
+
+private:
+    /** 返回 "\r\n\r\n" 之后的位置，找不到返回 NULL */
+    static const char* find_header_end(const char* p, size_t len) {
+        if (len < 4) {
+            return NULL;
+        }
+        const char* last = p + len - 3;
+        for (const char* q = p; q < last; ++q) {
+            q = static_cast<const char*>(memchr(q, '\r', last - q));
+            if (q == NULL) {
+                return NULL;
+            }
+            if (q[1] == '\n' && q[2] == '\r' && q[3] == '\n') {
+                return q + 4;
+            }
+        }
+        return NULL;
+    }
+
+    std::string response_;
+};
+
+#endif  // EPOLL_REACTOR_HANDLERS_H
@@ -0,0 +1,118 @@
+/**
+ * 多 Reactor 回环压测客户端
+ *
+ * 用法:
+ *   reactor_loadgen [-H host] [-p port] [-c conns] [-t threads] [-d seconds] [-m echo|http] [-s size]
+ *       压测一个已经在运行的服务器（例如 reactor_server）
+ *   reactor_loadgen -S max_reactors [-b epoll|io_uring|both] [-c conns] [-t threads] [-d seconds] [-m echo|http] [-s size]
+ *       在进程内依次启动 1..max_reactors 个 Reactor 的服务器，每一档跑一轮，输出吞吐随核数的扩展情况；
+ *       -b both 对每一档分别用 epoll 和 io_uring 后端各跑一轮，对比吞吐、尾延迟和
+ *       服务端每个请求的系统调用数（ReactorStats::syscalls / 请求数）；
+ *       speedup 是相对同一后端 1 个 Reactor 那一档的倍数，两个后端之间比较看 req/s
+ *
+ * 客户端的实现见 load_client.h。
+ *
+ * 注意客户端和服务器跑在同一台机器上，会互相抢 CPU；扩展曲线要在核数足够的机器上看。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "load_client.h"
+#include "reactor.h"
+#include "reactor_handlers.h"
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "用法: %s [-H host] [-p port] [-c conns] [-t threads] [-d seconds] [-m echo|http] [-s size] "
+            "[-S max_reactors] [-b epoll|io_uring|both]\n",
+            prog);
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig cfg;
+    cfg.host = "127.0.0.1";
+    cfg.port = 8080;
+    cfg.conns = 64;
+    cfg.threads = 2;
+    cfg.seconds = 5;
+    cfg.http = false;
+    cfg.size = 64;
+    int sweep = 0;
+    const char* backend = "epoll";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:c:t:d:m:s:S:b:")) != -1) {
+        switch (opt) {
+            case 'H': cfg.host = optarg; break;
+            case 'p': cfg.port = atoi(optarg); break;
+            case 'c': cfg.conns = atoi(optarg); break;
+            case 't': cfg.threads = atoi(optarg); break;
+            case 'd': cfg.seconds = atoi(optarg); break;
+            case 'm': cfg.http = strcmp(optarg, "http") == 0; break;
+            case 's': cfg.size = strtoul(optarg, NULL, 10); break;
+            case 'S': sweep = atoi(optarg); break;
+            case 'b': backend = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.conns < cfg.threads) cfg.conns = cfg.threads;
+    if (cfg.size == 0) cfg.size = 1;
+
+    if (sweep <= 0) {
+        LoadResult r;
+        run_load(cfg, &r);
+        printf("%s:%d %s %d 连接 %d 线程 %.1fs: %.0f req/s, 错误 %llu\n", cfg.host.c_str(), cfg.port,
+               cfg.http ? "http" : "echo", cfg.conns, cfg.threads, r.elapsed_s, r.requests / r.elapsed_s,
+               (unsigned long long)r.errors);
+        r.latency.print_summary(stdout, "latency", 1000.0, "us");
+        return 0;
+    }
+
+    std::vector<ReactorBackend> backends;
+    if (strcmp(backend, "both") == 0) {
+        backends.push_back(kBackendEpoll);
+        backends.push_back(kBackendIoUring);
+    } else {
+        backends.push_back(strcmp(backend, "io_uring") == 0 ? kBackendIoUring : kBackendEpoll);
+    }
+
+    EchoHandler echo;
+    HttpLiteHandler http;
+    printf("进程内扩展测试: %s, %d 连接, %d 个客户端线程, 每档 %ds, CPU 数 %ld\n", cfg.http ? "http" : "echo",
+           cfg.conns, cfg.threads, cfg.seconds, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-9s %-9s %12s %8s %10s %10s %10s %10s\n", "backend", "reactors", "req/s", "speedup", "p50(us)",
+           "p99(us)", "p99.9(us)", "sys/req");
+    std::vector<double> base(backends.size(), 0);  // 每个后端各自 1 个 Reactor 时的吞吐
+    for (int n = 1; n <= sweep; ++n) {
+        for (size_t b = 0; b < backends.size(); ++b) {
+            ReactorOptions opts;
+            opts.threads = n;
+            opts.backend = backends[b];
+            ReactorGroup group(cfg.http ? (Handler*)&http : (Handler*)&echo, opts);
+            if (group.start("127.0.0.1", 0) < 0) {
+                return 1;
+            }
+            cfg.host = "127.0.0.1";
+            cfg.port = group.port();
+            LoadResult r;
+            run_load(cfg, &r);
+            group.stop();
+
+            uint64_t syscalls = 0;
+            for (size_t i = 0; i < group.size(); ++i) {
+                syscalls += group.reactor(i)->stats().syscalls;
+            }
+            double rps = r.requests / r.elapsed_s;
+            if (base[b] == 0) base[b] = rps;
+            printf("%-9s %-9d %12.0f %7.2fx %10.1f %10.1f %10.1f %10.2f\n",
+                   Reactor::backend_name(group.reactor(0)->backend()), n, rps, rps / base[b],
+                   r.latency.percentile(50) / 1000.0, r.latency.percentile(99) / 1000.0,
+                   r.latency.percentile(99.9) / 1000.0, r.requests ? (double)syscalls / r.requests : 0);
+        }
+    }
+    return 0;
+}
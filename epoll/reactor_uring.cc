@@ -0,0 +1,403 @@
+/**
+ * Reactor 的 io_uring 后端
+ *
+ * 和 epoll 后端的区别：
+ *  - 每个监听套接字提交一个 multishot accept，每条连接提交一个 multishot recv，
+ *    之后不用再为每次读写单独发起系统调用
+ *  - recv 从提供缓冲区环里取缓冲区，空闲连接不占任何读缓冲区；
+ *    数据交给 Handler 后立即把缓冲区还给内核，没消费完的部分才拷进连接自己的输入块
+ *  - Connection::send 只把数据追加到输出队列，一轮完成事件处理完之后统一提交 SEND，
+ *    和下一次等待合并成一次 io_uring_enter
+ *  - 任务队列的 eventfd 和定时器的 timerfd 用 multishot poll 等待
+ *
+ * 需要 6.0 以上的内核（multishot recv）；不满足时 init_uring 返回 -1，Reactor 回退到 epoll。
+ * 等待方式（WaitStrategy）只对 epoll 后端有效，io_uring 后端总是阻塞在 io_uring_enter 上。
+ */
+#include "reactor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+
+#include "uring.h"
+
+namespace {
+
+const unsigned kUringEntries = 256;
+const unsigned kUringCqEntries = 4096;
+const uint16_t kUringBufGroup = 0;
+const unsigned kUringBufCount = 256;  // 必须是 2 的幂
+
+// user_data 的低 3 位是请求类型：连接请求的高位是 Connection 指针（至少 8 字节对齐），
+// 其余请求的高位是 fd
+enum UringTag {
+    kTagRecv = 0,
+    kTagSend = 1,
+    kTagAccept = 2,
+    kTagWakeup = 3,
+    kTagTimer = 4,
+};
+
+inline uint64_t conn_data(Connection* conn, UringTag tag) {
+    return (uint64_t)(uintptr_t)conn | tag;
+}
+
+inline uint64_t fd_data(int fd, UringTag tag) {
+    return ((uint64_t)fd << 3) | tag;
+}
+
+bool kernel_at_least(int major, int minor) {
+    utsname u;
+    if (uname(&u) < 0) {
+        return false;
+    }
+    int ma = 0, mi = 0;
+    if (sscanf(u.release, "%d.%d", &ma, &mi) != 2) {
+        return false;
+    }
+    return ma > major || (ma == major && mi >= minor);
+}
+
+}  // namespace
+
+struct Reactor::UringState {
+    IoUring ring;
+    bool disabled;  // 以 IORING_SETUP_R_DISABLED 创建，要在工作线程里 enable
+
+    UringState() : disabled(false) {}
+};
+
+int Reactor::init_uring() {
+    if (!kernel_at_least(6, 0)) {
+        fprintf(stderr, "reactor %d: 内核低于 6.0，不支持 multishot recv，回退到 epoll\n", id_);
+        return -1;
+    }
+    uring_ = new UringState();
+    // SINGLE_ISSUER + DEFER_TASKRUN 让完成处理推迟到 io_uring_enter 等待时在本线程执行，
+    // 减少中断上下文里的工作；这两个标志把环绑定到创建它的线程，而 init() 在主线程调用，
+    // 所以先以 R_DISABLED 创建，等工作线程 run() 时再启用
+    int rc = uring_->ring.init(
+        kUringEntries, kUringCqEntries,
+        IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED);
+    if (rc == 0) {
+        uring_->disabled = true;
+    } else if (rc == -EINVAL) {
+        rc = uring_->ring.init(kUringEntries, kUringCqEntries, 0);
+    }
+    if (rc < 0) {
+        fprintf(stderr, "reactor %d: io_uring_setup 失败: %s，回退到 epoll\n", id_, strerror(-rc));
+        destroy_uring();
+        return -1;
+    }
+    rc = uring_->ring.setup_buffers(kUringBufGroup, kUringBufCount, (unsigned)pool_.block_size());
+    if (rc < 0) {
+        fprintf(stderr, "reactor %d: 注册提供缓冲区失败: %s，回退到 epoll\n", id_, strerror(-rc));
+        destroy_uring();
+        return -1;
+    }
+    return 0;
+}
+
+void Reactor::destroy_uring() {
+    delete uring_;
+    uring_ = NULL;
+}
+
+void Reactor::uring_arm_accept(int listen_fd) {
+    io_uring_sqe* sqe = uring_->ring.get_sqe();
+    if (sqe == NULL) {
+        fprintf(stderr, "reactor %d: SQ 已满，无法提交 accept\n", id_);
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = fd_data(listen_fd, kTagAccept);
+}
+
+void Reactor::uring_arm_recv(Connection* conn) {
+    io_uring_sqe* sqe = uring_->ring.get_sqe();
+    if (sqe == NULL) {
+        close(conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd_;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kUringBufGroup;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = conn_data(conn, kTagRecv);
+    ++conn->inflight_;
+}
+
+void Reactor::uring_arm_poll(int fd, uint64_t tag) {
+    io_uring_sqe* sqe = uring_->ring.get_sqe();
+    if (sqe == NULL) {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = fd_data(fd, (UringTag)tag);
+}
+
+void Reactor::run_uring() {
+    IoUring& ring = uring_->ring;
+    if (uring_->disabled) {
+        int rc = ring.enable();
+        if (rc < 0) {
+            fprintf(stderr, "reactor %d: 启用 io_uring 失败: %s\n", id_, strerror(-rc));
+            return;
+        }
+        uring_->disabled = false;
+    }
+    uring_arm_poll(tasks_.fd(), kTagWakeup);
+    uring_arm_poll(timers_.fd(), kTagTimer);
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+        uring_arm_accept(listeners_[i]);
+    }
+
+    // io_uring_enter 全部由 IoUring 计数：除了这里的 submit_and_wait，SQ 满时 get_sqe 也会提交一次
+    uint64_t enter_calls = ring.enter_calls();
+    while (!stopping_.load(std::memory_order_acquire)) {
+        uring_flush_sends();
+        // TimerEngine 的 timerfd 由 poll 等待，这里只需要时间轮的超时
+        int64_t timeout_ns = wheel_timeout(-1);
+        if (timeout_ns != 0 && !tasks_.prepare_sleep()) {
+            timeout_ns = 0;
+        }
+        int ret = ring.submit_and_wait(timeout_ns == 0 ? 0 : 1, timeout_ns);
+        tasks_.finish_sleep();
+        stats_.syscalls += ring.enter_calls() - enter_calls;
+        enter_calls = ring.enter_calls();
+        if (ret < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN && errno != ETIME) {
+            fprintf(stderr, "reactor %d io_uring_enter 失败: %s\n", id_, strerror(errno));
+            break;
+        }
+        ++stats_.wakeups;
+        loop_now_ = TimerEngine::now_ns();
+
+        io_uring_cqe* cqe;
+        while ((cqe = ring.peek_cqe()) != NULL) {
+            uint64_t data = cqe->user_data;
+            int res = cqe->res;
+            uint32_t flags = cqe->flags;
+            ring.cqe_seen();
+            ++stats_.events;
+
+            switch (data & 7) {
+                case kTagRecv:
+                    uring_on_recv(reinterpret_cast<Connection*>(data & ~7ULL), res, flags);
+                    break;
+                case kTagSend:
+                    uring_on_send(reinterpret_cast<Connection*>(data & ~7ULL), res);
+                    break;
+                case kTagAccept:
+                    uring_on_accept(res, flags, (int)(data >> 3));
+                    break;
+                case kTagWakeup:
+                    tasks_.on_readable();
+                    ++stats_.syscalls;
+                    if (!(flags & IORING_CQE_F_MORE)) {
+                        uring_arm_poll(tasks_.fd(), kTagWakeup);
+                    }
+                    break;
+                case kTagTimer:
+                    timers_.on_readable();
+                    if (!(flags & IORING_CQE_F_MORE)) {
+                        uring_arm_poll(timers_.fd(), kTagTimer);
+                    }
+                    break;
+                default:
+                    if (data == IoUring::kProvideBuffersData && res < 0) {
+                        fprintf(stderr, "reactor %d PROVIDE_BUFFERS 失败: %s\n", id_, strerror(-res));
+                    }
+                    break;
+            }
+        }
+        tasks_.run_pending();
+        if (wheel_.size() > 0) {
+            wheel_.advance(loop_now_);
+        }
+        flush_closed();
+    }
+    stats_.syscalls += ring.enter_calls() - enter_calls;
+}
+
+void Reactor::uring_on_accept(int res, uint32_t flags, int listen_fd) {
+    if (res >= 0) {
+        Connection* conn = new_connection(res);
+        open_connection(conn);
+        if (!conn->closed_) {
+            uring_arm_recv(conn);
+        }
+    } else if (res != -ECANCELED && res != -EAGAIN) {
+        fprintf(stderr, "reactor %d accept 失败: %s\n", id_, strerror(-res));
+    }
+    if (!(flags & IORING_CQE_F_MORE) && !stopping_.load(std::memory_order_relaxed)) {
+        uring_arm_accept(listen_fd);
+    }
+}
+
+void Reactor::uring_on_recv(Connection* conn, int res, uint32_t flags) {
+    bool more = (flags & IORING_CQE_F_MORE) != 0;
+    if (!more) {
+        --conn->inflight_;
+    }
+    if (flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (res > 0 && !conn->closed_) {
+            stats_.bytes_in += res;
+            touch(conn);
+            uring_deliver(conn, uring_->ring.buffer(bid), (size_t)res);
+        }
+        uring_->ring.recycle_buffer(bid);
+    }
+    if (conn->closed_) {
+        return;
+    }
+    // -ENOBUFS：提供缓冲区暂时用完，multishot 被终止，重新提交即可
+    if (res == 0 || (res < 0 && res != -ENOBUFS)) {
+        close(conn);
+        return;
+    }
+    if (!more) {
+        uring_arm_recv(conn);
+    }
+}
+
+void Reactor::uring_deliver(Connection* conn, const char* data, size_t len) {
+    IoBuffer& in = conn->input_;
+    size_t cap = pool_.block_size();
+    while (len > 0) {
+        if (in.data == NULL) {
+            // 没有残留数据：直接在提供缓冲区上回调，不拷贝
+            size_t used = handler_->on_data(conn, data, len);
+            if (conn->closed_ || used == len) {
+                return;
+            }
+            if (len - used > cap) {
+                close(conn);
+                return;
+            }
+            in.data = pool_.acquire();
+            in.begin = 0;
+            in.end = len - used;
+            memcpy(in.data, data + used, in.end);
+            return;
+        }
+        // 有残留数据：拼到输入块后面再回调
+        if (in.begin > 0 && cap - in.end < len) {
+            memmove(in.data, in.read_ptr(), in.readable());
+            in.end -= in.begin;
+            in.begin = 0;
+        }
+        size_t take = cap - in.end < len ? cap - in.end : len;
+        if (take == 0) {
+            // 和 epoll 后端一样：缓冲块装满了应用还一个字节都没消费，直接断开
+            close(conn);
+            return;
+        }
+        memcpy(in.write_ptr(), data, take);
+        in.end += take;
+        data += take;
+        len -= take;
+        size_t used = handler_->on_data(conn, in.read_ptr(), in.readable());
+        if (conn->closed_) {
+            return;
+        }
+        in.begin += used;
+        if (in.begin == in.end) {
+            pool_.release(in.data);
+            in.data = NULL;
+            in.begin = in.end = 0;
+        }
+    }
+}
+
+void Reactor::uring_flush_sends() {
+    for (size_t i = 0; i < uring_flush_.size(); ++i) {
+        Connection* conn = uring_flush_[i];
+        conn->flush_queued_ = false;
+        if (conn->closed_ || conn->send_inflight_ || conn->output_.empty()) {
+            continue;
+        }
+        if (conn->output_.front().file_fd >= 0 && !uring_read_file(conn)) {
+            continue;
+        }
+        io_uring_sqe* sqe = uring_->ring.get_sqe();
+        if (sqe == NULL) {
+            close(conn);
+            continue;
+        }
+        // 每条连接同一时间只有一个 SEND 在途，保证字节顺序
+        IoBuffer& b = conn->output_.front();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn->fd_;
+        sqe->addr = (uint64_t)(uintptr_t)b.read_ptr();
+        sqe->len = (uint32_t)b.readable();
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = conn_data(conn, kTagSend);
+        ++conn->inflight_;
+        conn->send_inflight_ = true;
+    }
+    uring_flush_.clear();
+}
+
+/**
+ * 队头是文件段：pread 一个缓冲块插到它前面，文件段前移；读完最后一块时归还文件引用。
+ * 上一块发完（uring_on_send）才会再走到这里，所以一个连接同一时间最多占一块
+ */
+bool Reactor::uring_read_file(Connection* conn) {
+    OutputChunk& f = conn->output_.front();
+    size_t cap = pool_.block_size();
+    size_t want = f.readable() < cap ? f.readable() : cap;
+    OutputChunk b;
+    b.data = pool_.acquire();
+    ssize_t n = pread(f.file_fd, b.data, want, (off_t)f.begin);
+    ++stats_.syscalls;
+    if (n <= 0) {
+        pool_.release(b.data);
+        close(conn);  // 出错，或者文件被截短了
+        return false;
+    }
+    b.end = (size_t)n;
+    f.begin += n;
+    if (f.readable() == 0) {
+        pop_output(conn);
+    }
+    conn->output_.push_front(b);
+    return true;
+}
+
+void Reactor::uring_on_send(Connection* conn, int res) {
+    --conn->inflight_;
+    conn->send_inflight_ = false;
+    if (conn->closed_) {
+        return;
+    }
+    if (res < 0) {
+        close(conn);
+        return;
+    }
+    stats_.bytes_out += res;
+    IoBuffer& b = conn->output_.front();
+    b.begin += res;
+    conn->pending_bytes_ -= res;
+    if (b.readable() == 0) {
+        pop_output(conn);
+    }
+    if (conn->output_.empty()) {
+        handler_->on_drain(conn);
+    } else if (!conn->flush_queued_) {
+        conn->flush_queued_ = true;
+        uring_flush_.push_back(conn);
+    }
+}
@@ -0,0 +1,87 @@
+#include "task_queue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+TaskQueue::TaskQueue() : sleeping_(0), signals_(0), efd_(-1) {}
+
+TaskQueue::~TaskQueue() {
+    if (efd_ >= 0) {
+        close(efd_);
+    }
+}
+
+int TaskQueue::init(int epfd) {
+    efd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd_ < 0) {
+        fprintf(stderr, "eventfd 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    if (epfd < 0) {
+        return 0;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = this;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, efd_, &ev) < 0) {
+        fprintf(stderr, "注册 eventfd 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void TaskQueue::post(Task* task) {
+    queue_.push(task);
+    // push 里的 exchange 是 seq_cst，这里的读不会被重排到入队之前
+    if (sleeping_.load(std::memory_order_seq_cst) != 0 && sleeping_.exchange(0, std::memory_order_acq_rel) != 0) {
+        signals_.fetch_add(1, std::memory_order_relaxed);
+        notify();
+    }
+}
+
+void TaskQueue::notify() {
+    uint64_t one = 1;
+    if (write(efd_, &one, sizeof(one)) < 0) {
+        // 计数溢出才会失败，这时消费者早已被唤醒
+    }
+}
+
+bool TaskQueue::prepare_sleep() {
+    sleeping_.store(1, std::memory_order_seq_cst);
+    if (!queue_.empty()) {
+        sleeping_.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void TaskQueue::on_readable() {
+    uint64_t v;
+    if (read(efd_, &v, sizeof(v)) < 0) {
+        // EAGAIN：计数已经被读走
+    }
+}
+
+size_t TaskQueue::run_pending(size_t max) {
+    size_t n = 0;
+    while (n < max) {
+        MpscNode* node = queue_.pop();
+        if (node == NULL) {
+            if (queue_.empty()) {
+                break;
+            }
+            sched_yield();  // 生产者在 push 中途被抢占，等它链接完
+            continue;
+        }
+        Task* task = static_cast<Task*>(node);
+        task->run(task);
+        ++n;
+    }
+    return n;
+}
@@ -0,0 +1,82 @@
+#ifndef EPOLL_TASK_QUEUE_H
+#define EPOLL_TASK_QUEUE_H
+
+/**
+ * 跨线程向事件循环投递任务：MpscQueue + 一个注册在 epoll 里的 eventfd
+ *
+ * 只有消费者准备睡眠时生产者才写 eventfd：
+ *   消费者：sleeping_ = 1 → 再检查一次队列 → 为空才进入 epoll_wait
+ *   生产者：入队 → 读 sleeping_ → 为 1 且抢到（exchange 成 0）才 write(eventfd)
+ * 两边都是 seq_cst，所以“消费者看到了新任务”和“生产者看到了 sleeping_”至少有一个成立，
+ * 不会丢唤醒；消费者忙着处理事件时投递只是一次原子 exchange，没有系统调用。
+ *
+ * 用法（消费者线程）：
+ *   int timeout = queue.prepare_sleep() ? timeout : 0;
+ *   n = epoll_wait(...);
+ *   queue.finish_sleep();
+ *   ... 事件里有 queue 的 eventfd 时调用 on_readable()
+ *   queue.run_pending();
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "mpsc_queue.h"
+
+class TaskQueue {
+public:
+    struct Task : MpscNode {
+        typedef void (*Func)(Task* task);
+        Func run;  // 在消费者线程里执行，执行前已经出队，可以在里面释放或复用 task
+
+        Task() : run(NULL) {}
+        explicit Task(Func f) : run(f) {}
+    };
+
+    TaskQueue();
+    ~TaskQueue();
+
+    /**
+     * 创建 eventfd，epfd >= 0 时以 EPOLLIN 注册，epoll_event.data.ptr 指向 this
+     * 返回值：成功返回0，失败返回-1
+     */
+    int init(int epfd);
+
+    int fd() const { return efd_; }
+
+    /** 任意线程调用 */
+    void post(Task* task);
+
+    /** 无条件唤醒消费者（例如通知它退出） */
+    void notify();
+
+    /** 消费者睡眠前调用；返回 false 表示已经有任务，不应该睡眠（用 0 超时轮询一次） */
+    bool prepare_sleep();
+
+    /** 消费者醒来后调用 */
+    void finish_sleep() { sleeping_.store(0, std::memory_order_relaxed); }
+
+    /** eventfd 可读时调用，清掉计数 */
+    void on_readable();
+
+    /** 执行最多 max 个任务，返回执行的个数 */
+    size_t run_pending(size_t max = SIZE_MAX);
+
+    bool empty() const { return queue_.empty(); }
+
+    /** 生产者实际写 eventfd 的次数（notify 除外） */
+    uint64_t signals() const { return signals_.load(std::memory_order_relaxed); }
+
+private:
+    TaskQueue(const TaskQueue&);
+    TaskQueue& operator=(const TaskQueue&);
+
+    MpscQueue queue_;
+    char pad_[64];
+    std::atomic<int> sleeping_;
+    std::atomic<uint64_t> signals_;
+    int efd_;
+};
+
+#endif  // EPOLL_TASK_QUEUE_H
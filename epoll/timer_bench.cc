@@ -0,0 +1,243 @@
+/**
+ * 分层时间轮 vs std::priority_queue 的吞吐对比
+ *
+ * 用法: timer_bench [count] [span_ms]
+ *   count    定时器个数，默认 10000000
+ *   span_ms  截止时间均匀分布在 [0, span_ms) 毫秒内，默认 60000
+ *
+ * 四个阶段分别计时：
+ *   insert      插入 count 个定时器
+ *   reschedule  把所有定时器往后推 span_ms/2（模拟每次收到数据刷新空闲超时）
+ *   cancel      取消一半
+ *   expire      以 1ms 为步长推进到最后，让剩下的全部到期
+ *
+ * 最小堆不支持 O(1) 取消和修改，这里用通常的做法：取消只打标记，重设时压入新条目并递增代数，
+ * 旧条目在堆顶被弹出时丢弃（TimerEngine 也是这样，另外在死条目过半时压缩一次），
+ * 所以它的取消/重设成本一部分转移到了 expire 阶段。
+ * 两边都以 1ms 为步长推进。
+ *
+ * 开始前先检查回调重入：同一个 tick 到期的定时器在回调里互相 cancel/schedule，结果不对时退出码为 1。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "timing_wheel.h"
+
+static const int64_t kTickNs = 1000000;
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct PhaseTimes {
+    double insert;
+    double reschedule;
+    double cancel;
+    double expire;
+    uint64_t fired;
+    uint64_t early;  // 提前触发的个数，应为0
+    uint64_t late;   // 晚于截止时间一个 tick 以上才触发的个数，应为0
+};
+
+static int64_t g_now = 0;
+static uint64_t g_fired = 0;
+static uint64_t g_early = 0;
+static uint64_t g_late = 0;
+
+static void on_wheel_timer(WheelTimer* t) {
+    ++g_fired;
+    int64_t deadline = (int64_t)(intptr_t)t->data;
+    if (deadline > g_now) {
+        ++g_early;
+    } else if (g_now - deadline >= kTickNs) {
+        ++g_late;
+    }
+}
+
+struct ReentryCheck {
+    TimingWheel* wheel;
+    WheelTimer timers[4];  // A B C D，截止时间相同
+    std::string fired;
+    int a_runs;
+};
+
+/** A 第一次到期时取消 B、把 C 推到 20ms、把自己重设到 10ms */
+static void on_reentry_timer(WheelTimer* t) {
+    ReentryCheck* c = static_cast<ReentryCheck*>(t->data);
+    int i = (int)(t - c->timers);
+    c->fired += (char)('A' + i);
+    if (i == 0 && c->a_runs++ == 0) {
+        c->wheel->cancel(&c->timers[1]);
+        c->wheel->schedule(&c->timers[2], 20 * kTickNs);
+        c->wheel->schedule(&c->timers[0], 10 * kTickNs);
+    }
+}
+
+static bool check_reentry() {
+    TimingWheel wheel(kTickNs, 0);
+    ReentryCheck c;
+    c.wheel = &wheel;
+    c.a_runs = 0;
+    for (int i = 0; i < 4; ++i) {
+        c.timers[i].callback = on_reentry_timer;
+        c.timers[i].data = &c;
+        wheel.schedule(&c.timers[i], 5 * kTickNs);
+    }
+    size_t first = wheel.advance(5 * kTickNs);
+    bool ok = first == 2 && c.fired == "AD" && c.timers[0].pending() && !c.timers[1].pending() &&
+              c.timers[2].pending() && !c.timers[3].pending() && wheel.size() == 2;
+    size_t second = wheel.advance(20 * kTickNs);
+    ok = ok && second == 2 && c.fired == "ADAC" && wheel.size() == 0;
+    // 回调里重设过的定时器要能正常地再取消、再插入
+    wheel.schedule(&c.timers[0], 30 * kTickNs);
+    wheel.cancel(&c.timers[0]);
+    ok = ok && wheel.size() == 0 && wheel.advance(40 * kTickNs) == 0;
+    printf("回调里 cancel/schedule 同一槽的定时器: 到期顺序 %s（应为 ADAC）, %s\n", c.fired.c_str(),
+           ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static PhaseTimes bench_wheel(const std::vector<int64_t>& deadlines, int64_t span_ns) {
+    PhaseTimes r;
+    size_t n = deadlines.size();
+    std::vector<WheelTimer> timers(n);
+    TimingWheel wheel(kTickNs, 0);
+    g_now = 0;
+    g_fired = g_early = g_late = 0;
+
+    int64_t t0 = monotonic_ns();
+    for (size_t i = 0; i < n; ++i) {
+        timers[i].callback = on_wheel_timer;
+        timers[i].data = (void*)(intptr_t)deadlines[i];
+        wheel.schedule(&timers[i], deadlines[i]);
+    }
+    int64_t t1 = monotonic_ns();
+    for (size_t i = 0; i < n; ++i) {
+        int64_t d = deadlines[i] + span_ns / 2;
+        timers[i].data = (void*)(intptr_t)d;
+        wheel.schedule(&timers[i], d);
+    }
+    int64_t t2 = monotonic_ns();
+    for (size_t i = 1; i < n; i += 2) {
+        wheel.cancel(&timers[i]);
+    }
+    int64_t t3 = monotonic_ns();
+    int64_t end = span_ns + span_ns / 2;
+    for (g_now = 0; g_now <= end; g_now += kTickNs) {
+        wheel.advance(g_now);
+    }
+    int64_t t4 = monotonic_ns();
+
+    r.insert = (t1 - t0) / 1e9;
+    r.reschedule = (t2 - t1) / 1e9;
+    r.cancel = (t3 - t2) / 1e9;
+    r.expire = (t4 - t3) / 1e9;
+    r.fired = g_fired;
+    r.early = g_early;
+    r.late = g_late;
+    return r;
+}
+
+struct HeapEntry {
+    int64_t deadline;
+    uint32_t id;
+    uint32_t gen;
+    bool operator>(const HeapEntry& o) const { return deadline > o.deadline; }
+};
+
+static PhaseTimes bench_heap(const std::vector<int64_t>& deadlines, int64_t span_ns) {
+    PhaseTimes r;
+    size_t n = deadlines.size();
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > heap;
+    std::vector<uint32_t> gen(n, 0);  // 当前有效条目的代数，取消时设为 UINT32_MAX
+    uint64_t fired = 0, early = 0, late = 0;
+
+    int64_t t0 = monotonic_ns();
+    for (size_t i = 0; i < n; ++i) {
+        HeapEntry e = {deadlines[i], (uint32_t)i, 0};
+        heap.push(e);
+    }
+    int64_t t1 = monotonic_ns();
+    for (size_t i = 0; i < n; ++i) {
+        HeapEntry e = {deadlines[i] + span_ns / 2, (uint32_t)i, ++gen[i]};
+        heap.push(e);
+    }
+    int64_t t2 = monotonic_ns();
+    for (size_t i = 1; i < n; i += 2) {
+        gen[i] = UINT32_MAX;
+    }
+    int64_t t3 = monotonic_ns();
+    int64_t end = span_ns + span_ns / 2;
+    for (int64_t now = 0; now <= end; now += kTickNs) {
+        while (!heap.empty() && heap.top().deadline <= now) {
+            HeapEntry e = heap.top();
+            heap.pop();
+            if (gen[e.id] != e.gen) {
+                continue;  // 已取消或已重设
+            }
+            ++fired;
+            if (e.deadline > now) {
+                ++early;
+            } else if (now - e.deadline >= kTickNs) {
+                ++late;
+            }
+        }
+    }
+    int64_t t4 = monotonic_ns();
+
+    r.insert = (t1 - t0) / 1e9;
+    r.reschedule = (t2 - t1) / 1e9;
+    r.cancel = (t3 - t2) / 1e9;
+    r.expire = (t4 - t3) / 1e9;
+    r.fired = fired;
+    r.early = early;
+    r.late = late;
+    return r;
+}
+
+static void print_row(const char* name, const PhaseTimes& r, size_t n) {
+    size_t cancels = n / 2;
+    size_t expires = n - cancels;
+    double total = r.insert + r.reschedule + r.cancel + r.expire;
+    printf("%-14s %10.2f %10.2f %10.2f %10.2f %10.2f %12llu %6llu %6llu\n", name, n / r.insert / 1e6,
+           n / r.reschedule / 1e6, cancels / r.cancel / 1e6, expires / r.expire / 1e6, total,
+           (unsigned long long)r.fired, (unsigned long long)r.early, (unsigned long long)r.late);
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+    int64_t span_ms = argc > 2 ? atoll(argv[2]) : 60000;
+    int64_t span_ns = span_ms * 1000000LL;
+
+    std::vector<int64_t> deadlines(count);
+    srand(12345);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t r = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+        deadlines[i] = (int64_t)(r % (uint64_t)span_ns);
+    }
+
+    if (!check_reentry()) {
+        return 1;
+    }
+    printf("%zu 个定时器，截止时间分布在 %lld ms 内，tick 1ms\n", count, (long long)span_ms);
+    printf("%-14s %10s %10s %10s %10s %10s %12s %6s %6s\n", "", "insert", "resched", "cancel", "expire",
+           "total(s)", "fired", "early", "late");
+    printf("%-14s %10s %10s %10s %10s\n", "", "(Mops/s)", "(Mops/s)", "(Mops/s)", "(Mops/s)");
+    PhaseTimes wheel = bench_wheel(deadlines, span_ns);
+    print_row("timing_wheel", wheel, count);
+    PhaseTimes heap = bench_heap(deadlines, span_ns);
+    print_row("priority_queue", heap, count);
+    if (wheel.fired != heap.fired) {
+        printf("到期个数不一致: wheel=%llu heap=%llu\n", (unsigned long long)wheel.fired,
+               (unsigned long long)heap.fired);
+        return 1;
+    }
+    return 0;
+}
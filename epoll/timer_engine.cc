@@ -0,0 +1,143 @@
+#include "timer_engine.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+
+// 堆很小时不值得压缩
+static const size_t kMinCompactSize = 64;
+
+TimerEngine::TimerEngine() : timer_fd_(-1), next_id_(1), armed_(0) {}
+
+TimerEngine::~TimerEngine() {
+    // close 会自动把 timerfd 从所在的 epoll 集合中移除，不需要 EPOLL_CTL_DEL，
+    // 这样 epoll fd 先于 TimerEngine 关闭也没有问题
+    if (timer_fd_ >= 0) {
+        close(timer_fd_);
+    }
+}
+
+int TimerEngine::init(int epfd) {
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0) {
+        fprintf(stderr, "timerfd_create 失败: %s\n", strerror(errno));
+        return -1;
+    }
+    if (epfd < 0) {
+        return 0;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = this;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, timer_fd_, &ev) < 0) {
+        fprintf(stderr, "注册 timerfd 失败: %s\n", strerror(errno));
+        close(timer_fd_);
+        timer_fd_ = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int64_t TimerEngine::now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+uint64_t TimerEngine::add_at(int64_t deadline_ns, Callback cb) {
+    uint64_t id = next_id_++;
+    Entry e = {deadline_ns, id};
+    heap_.push_back(e);
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+    callbacks_[id] = std::move(cb);
+    if (armed_ == 0 || deadline_ns < armed_) {
+        rearm();
+    }
+    return id;
+}
+
+uint64_t TimerEngine::add_after(int64_t delay_ns, Callback cb) {
+    return add_at(now_ns() + delay_ns, std::move(cb));
+}
+
+bool TimerEngine::cancel(uint64_t id) {
+    // timerfd 不需要立即改：就算提前醒来，on_readable 发现没有到期的也只是重新设置
+    if (callbacks_.erase(id) == 0) {
+        return false;
+    }
+    if (heap_.size() >= kMinCompactSize && heap_.size() > 2 * callbacks_.size()) {
+        compact();
+    }
+    return true;
+}
+
+void TimerEngine::compact() {
+    // 每次压缩前至少发生过 heap_.size()/2 次取消，均摊下来每次取消 O(1)
+    heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                               [this](const Entry& e) { return callbacks_.find(e.id) == callbacks_.end(); }),
+                heap_.end());
+    std::make_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+}
+
+int64_t TimerEngine::next_deadline() const {
+    const_cast<TimerEngine*>(this)->pop_cancelled();
+    return heap_.empty() ? -1 : heap_.front().deadline;
+}
+
+void TimerEngine::pop_cancelled() {
+    while (!heap_.empty() && callbacks_.find(heap_.front().id) == callbacks_.end()) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+        heap_.pop_back();
+    }
+}
+
+void TimerEngine::on_readable() {
+    uint64_t expirations;
+    // 非阻塞读，清掉可读状态；EAGAIN 说明是取消后的提前唤醒
+    if (read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "读取 timerfd 失败: %s\n", strerror(errno));
+    }
+    armed_ = 0;
+
+    int64_t now = now_ns();
+    while (!heap_.empty() && heap_.front().deadline <= now) {
+        Entry e = heap_.front();
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+        heap_.pop_back();
+        std::unordered_map<uint64_t, Callback>::iterator it = callbacks_.find(e.id);
+        if (it == callbacks_.end()) {
+            continue;  // 已取消
+        }
+        Callback cb = std::move(it->second);
+        callbacks_.erase(it);
+        cb();  // 回调里可以继续 add_at / cancel
+    }
+    rearm();
+}
+
+void TimerEngine::rearm() {
+    pop_cancelled();
+    itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (!heap_.empty()) {
+        int64_t deadline = heap_.front().deadline;
+        // it_value 全 0 表示停止定时器，截止时间已过时也至少给 1ns 让它立即触发
+        if (deadline <= 0) {
+            deadline = 1;
+        }
+        its.it_value.tv_sec = deadline / 1000000000LL;
+        its.it_value.tv_nsec = deadline % 1000000000LL;
+        armed_ = deadline;
+    } else {
+        armed_ = 0;
+    }
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        fprintf(stderr, "timerfd_settime 失败: %s\n", strerror(errno));
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef EPOLL_TIMER_ENGINE_H
+#define EPOLL_TIMER_ENGINE_H
+
+/**
+ * 基于 timerfd 的亚毫秒定时器
+ *
+ * epoll_wait 的超时参数以毫秒为单位，并且会被内核向上取整到
+ * max(min_epoll_wait_time, 1) 毫秒；而 timerfd 以纳秒精度在 hrtimer 上到期。
+ * 这里所有定时器共用一个 timerfd，用最小堆维护截止时间，timerfd 始终以
+ * TFD_TIMER_ABSTIME 设置为最近的截止时间（绝对时间，不会因处理耗时而漂移），
+ * timerfd 注册进调用方的 epoll 集合，可读时调用 on_readable() 分发到期回调。
+ *
+ * 注意：普通线程默认有 50us 的 timer slack，需要更精确时用
+ * prctl(PR_SET_TIMERSLACK, 1) 或实时调度策略。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class TimerEngine {
+public:
+    typedef std::function<void()> Callback;
+
+    TimerEngine();
+    ~TimerEngine();
+
+    /**
+     * 创建 timerfd 并以 EPOLLIN 注册到 epfd，epoll_event.data.ptr 指向 this；
+     * epfd 为 -1 时不注册，由调用方自己等待 fd() 可读（例如 io_uring 的 poll）
+     * 返回值：成功返回0，失败返回-1
+     */
+    int init(int epfd);
+
+    int fd() const { return timer_fd_; }
+
+    /** 在 CLOCK_MONOTONIC 绝对时间 deadline_ns 到期，返回定时器 id（从 1 开始） */
+    uint64_t add_at(int64_t deadline_ns, Callback cb);
+
+    /** 从现在起 delay_ns 后到期 */
+    uint64_t add_after(int64_t delay_ns, Callback cb);
+
+    /** 取消尚未到期的定时器，返回是否取消成功 */
+    bool cancel(uint64_t id);
+
+    /** timerfd 可读时调用：执行所有已到期的回调并重新设置 timerfd */
+    void on_readable();
+
+    /** 最近一个截止时间，没有定时器时返回 -1 */
+    int64_t next_deadline() const;
+
+    size_t size() const { return callbacks_.size(); }
+
+    static int64_t now_ns();
+
+private:
+    struct Entry {
+        int64_t deadline;
+        uint64_t id;
+        bool operator>(const Entry& o) const {
+            return deadline != o.deadline ? deadline > o.deadline : id > o.id;
+        }
+    };
+
+    void pop_cancelled();
+    void compact();
+    void rearm();
+
+    int timer_fd_;
+    uint64_t next_id_;
+    int64_t armed_;  // timerfd 当前设置的截止时间，0 表示未设置
+    // 最小堆（std::push_heap/pop_heap + std::greater），用 vector 是为了压缩时能直接遍历
+    std::vector<Entry> heap_;
+    // 取消的定时器只从这里删掉，堆里的条目在到达堆顶时惰性丢弃；
+    // 堆里的死条目超过一半时 compact() 一次性清掉，反复取消/重新添加不会让堆无限增长
+    std::unordered_map<uint64_t, Callback> callbacks_;
+};
+
+#endif  // EPOLL_TIMER_ENGINE_H
@@ -0,0 +1,175 @@
+#include "timing_wheel.h"
+
+TimingWheel::TimingWheel(int64_t tick_ns, int64_t now_ns)
+    : tick_ns_(tick_ns > 0 ? tick_ns : 1), size_(0) {
+    current_ = now_ns > 0 ? (uint64_t)now_ns / tick_ns_ : 0;
+    for (int i = 0; i < kRootSize; ++i) {
+        list_init(&root_[i]);
+    }
+    for (int l = 0; l < kLevels; ++l) {
+        for (int i = 0; i < kLevelSize; ++i) {
+            list_init(&levels_[l][i]);
+        }
+    }
+    for (int i = 0; i < kRootSize / 64; ++i) {
+        root_bitmap_[i] = 0;
+    }
+}
+
+void TimingWheel::schedule(WheelTimer* timer, int64_t deadline_ns) {
+    if (timer->pending()) {
+        cancel(timer);
+    }
+    // 向上取整到 tick，保证不提前触发
+    timer->expires = deadline_ns > 0 ? ((uint64_t)deadline_ns + tick_ns_ - 1) / tick_ns_ : 0;
+    add(timer);
+    ++size_;
+}
+
+void TimingWheel::cancel(WheelTimer* timer) {
+    if (!timer->pending()) {
+        return;
+    }
+    WheelLink* prev = timer->prev;
+    WheelLink* next = timer->next;
+    prev->next = next;
+    next->prev = prev;
+    timer->prev = timer->next = NULL;
+    --size_;
+    // 槽变空时 prev == next == 链表头；链表头在 root_ 数组内说明是第 0 层，要清掉位图
+    if (prev == next && next >= root_ && next < root_ + kRootSize) {
+        int slot = (int)(next - root_);
+        root_bitmap_[slot >> 6] &= ~(1ULL << (slot & 63));
+    }
+}
+
+void TimingWheel::add(WheelTimer* timer) {
+    uint64_t expires = timer->expires;
+    if (expires < current_) {
+        expires = timer->expires = current_;  // 已经过期：放进下一个要处理的槽
+    }
+    uint64_t delta = expires - current_;
+    WheelLink* head;
+    if (delta < (1ULL << kRootBits)) {
+        int slot = (int)(expires & (kRootSize - 1));
+        head = &root_[slot];
+        root_bitmap_[slot >> 6] |= 1ULL << (slot & 63);
+    } else {
+        int level = 0;
+        while (level < kLevels - 1 && delta >= (1ULL << (kRootBits + (level + 1) * kLevelBits))) {
+            ++level;
+        }
+        if (level == kLevels - 1 && delta >= (1ULL << (kRootBits + kLevels * kLevelBits))) {
+            // 超出时间轮范围，按最远处理
+            expires = timer->expires = current_ + (1ULL << (kRootBits + kLevels * kLevelBits)) - 1;
+        }
+        int shift = kRootBits + level * kLevelBits;
+        head = &levels_[level][(expires >> shift) & (kLevelSize - 1)];
+    }
+    timer->next = head;
+    timer->prev = head->prev;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+void TimingWheel::cascade(int level, int index) {
+    // 把上层一个槽整体摘下，按剩余时间重新放进更低的层
+    WheelLink* head = &levels_[level][index];
+    WheelLink* node = head->next;
+    list_init(head);
+    while (node != head) {
+        WheelLink* next = node->next;
+        add(static_cast<WheelTimer*>(node));
+        node = next;
+    }
+}
+
+int TimingWheel::next_root_slot(int from) const {
+    int word = from >> 6;
+    uint64_t bits = root_bitmap_[word] & (~0ULL << (from & 63));
+    for (;;) {
+        if (bits != 0) {
+            return (word << 6) + __builtin_ctzll(bits);
+        }
+        if (++word == kRootSize / 64) {
+            return -1;
+        }
+        bits = root_bitmap_[word];
+    }
+}
+
+size_t TimingWheel::advance(int64_t now_ns) {
+    if (now_ns < 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)now_ns / tick_ns_;
+    size_t fired = 0;
+    while (current_ <= target) {
+        int idx = (int)(current_ & (kRootSize - 1));
+        if (idx == 0) {
+            // 第 0 层转完一圈：从第 1 层取下一个槽下放，第 1 层也转完一圈时继续往上
+            for (int level = 0; level < kLevels; ++level) {
+                int index = (int)((current_ >> (kRootBits + level * kLevelBits)) & (kLevelSize - 1));
+                cascade(level, index);
+                if (index != 0) {
+                    break;
+                }
+            }
+        }
+        if (size_ == 0) {
+            current_ = target + 1;
+            break;
+        }
+        // 跳过空槽，但不越过下一次下放点（下一圈的 0 号槽）和 target
+        int slot = next_root_slot(idx);
+        if (slot < 0) {
+            uint64_t boundary = (current_ | (kRootSize - 1)) + 1;
+            current_ = boundary <= target ? boundary : target + 1;
+            continue;
+        }
+        uint64_t tick = (current_ & ~(uint64_t)(kRootSize - 1)) + slot;
+        if (tick > target) {
+            current_ = target + 1;
+            break;
+        }
+
+        // 整个槽接到局部链表头上，每次从头部摘一个再回调：回调里 cancel/schedule 同一槽里的其他定时器
+        // 只是从这个局部链表上摘下，不会弄断遍历；回调里插入的已过期定时器会进入下一个 tick 的槽
+        WheelLink* head = &root_[slot];
+        WheelLink expired;
+        expired.next = head->next;
+        expired.prev = head->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        list_init(head);
+        root_bitmap_[slot >> 6] &= ~(1ULL << (slot & 63));
+        current_ = tick + 1;
+        while (!list_empty(&expired)) {
+            WheelTimer* timer = static_cast<WheelTimer*>(expired.next);
+            expired.next = timer->next;
+            timer->next->prev = &expired;
+            timer->prev = timer->next = NULL;
+            --size_;
+            ++fired;
+            timer->callback(timer);
+        }
+    }
+    return fired;
+}
+
+int64_t TimingWheel::next_timeout_ns(int64_t now_ns) const {
+    if (size_ == 0) {
+        return -1;
+    }
+    int slot = next_root_slot((int)(current_ & (kRootSize - 1)));
+    uint64_t tick;
+    if (slot >= 0) {
+        tick = (current_ & ~(uint64_t)(kRootSize - 1)) + slot;
+    } else if ((current_ & (kRootSize - 1)) == 0) {
+        tick = current_;  // 停在下放点上，还没有下放
+    } else {
+        tick = (current_ | (kRootSize - 1)) + 1;
+    }
+    int64_t timeout = (int64_t)tick * tick_ns_ - now_ns;
+    return timeout > 0 ? timeout : 0;
+}
@@ -0,0 +1,92 @@
+#ifndef EPOLL_TIMING_WHEEL_H
+#define EPOLL_TIMING_WHEEL_H
+
+/**
+ * 分层时间轮（与 Linux 2.6 的 tv1~tv5 相同的结构），用于海量连接的空闲/请求超时
+ *
+ *  - 第 0 层 256 个槽，每槽 1 个 tick；第 1~4 层各 64 个槽，每槽覆盖下一层一整圈，
+ *    一共 8 + 6 * 4 = 32 位 tick，1ms 的 tick 可以表示约 49 天，更远的截止时间按最远处理
+ *  - 定时器是侵入式双向链表节点（WheelTimer 嵌在连接对象里），插入、取消、重设都是 O(1)，
+ *    不分配内存；TimerEngine 的最小堆每次操作是 O(log n)，还要为每个回调分配 std::function
+ *  - advance(now) 一次性让所有到期的槽过期；第 0 层用位图跳过空槽，
+ *    长时间没有调用 advance 时也只访问非空槽和层间下放点
+ *  - next_timeout_ns() 返回最近一个非空槽（或下一次层间下放）的时间，直接作为 epoll_wait 的超时
+ *
+ * 精度是一个 tick：定时器在 ceil(deadline / tick) 这个 tick 到期，不会提前触发。
+ * 单线程使用。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+class TimingWheel;
+
+struct WheelLink {
+    WheelLink* prev;
+    WheelLink* next;
+};
+
+struct WheelTimer : WheelLink {
+    typedef void (*Callback)(WheelTimer* timer);
+
+    WheelTimer() : expires(0), callback(NULL), data(NULL) {
+        prev = next = NULL;
+    }
+
+    /** 是否在时间轮里等待到期 */
+    bool pending() const { return next != NULL; }
+
+    uint64_t expires;   // 到期的 tick
+    Callback callback;  // 到期时调用，调用前已经从时间轮摘下；回调里可以 schedule/cancel 任何定时器
+    void* data;         // 调用方自用
+};
+
+class TimingWheel {
+public:
+    static const int kRootBits = 8;
+    static const int kRootSize = 1 << kRootBits;
+    static const int kLevelBits = 6;
+    static const int kLevelSize = 1 << kLevelBits;
+    static const int kLevels = 4;  // 第 0 层以外的层数
+
+    /** tick_ns 为时间轮精度，now_ns 为起始时间（与之后传入的时间使用同一个时钟） */
+    explicit TimingWheel(int64_t tick_ns = 1000000, int64_t now_ns = 0);
+
+    /** 在 deadline_ns 到期；已经在时间轮里的定时器会先摘下再重新插入 */
+    void schedule(WheelTimer* timer, int64_t deadline_ns);
+
+    /** 取消，未在时间轮里时什么也不做 */
+    void cancel(WheelTimer* timer);
+
+    /** 推进到 now_ns，执行所有到期的回调，返回执行的个数 */
+    size_t advance(int64_t now_ns);
+
+    /**
+     * 距离下一个可能有定时器到期的 tick 还有多少纳秒（已到期返回0，没有定时器返回-1），
+     * 用作 epoll_wait 的超时；第 0 层为空时返回下一次层间下放的时间
+     */
+    int64_t next_timeout_ns(int64_t now_ns) const;
+
+    size_t size() const { return size_; }
+    int64_t tick_ns() const { return tick_ns_; }
+
+private:
+    TimingWheel(const TimingWheel&);
+    TimingWheel& operator=(const TimingWheel&);
+
+    void add(WheelTimer* timer);
+    void cascade(int level, int index);
+    int next_root_slot(int from) const;
+
+    static void list_init(WheelLink* head) { head->prev = head->next = head; }
+    static bool list_empty(const WheelLink* head) { return head->next == head; }
+
+    int64_t tick_ns_;
+    uint64_t current_;  // 下一个要处理的 tick
+    size_t size_;
+    WheelLink root_[kRootSize];
+    WheelLink levels_[kLevels][kLevelSize];
+    uint64_t root_bitmap_[kRootSize / 64];  // 第 0 层非空槽位图
+};
+
+#endif  // EPOLL_TIMING_WHEEL_H
@@ -0,0 +1,406 @@
+#ifndef EPOLL_URING_H
+#define EPOLL_URING_H
+
+/**
+ * 不依赖 liburing 的最小 io_uring 封装：io_uring_setup / io_uring_enter / io_uring_register
+ * 三个系统调用加上 SQ、CQ 两个共享内存环，以及提供缓冲区环（provided buffer ring）
+ *
+ * 只实现 reactor 用到的部分：
+ *   - get_sqe / submit / submit_and_wait
+ *   - peek_cqe / cqe_seen 逐个取完成事件
+ *   - 注册一组提供缓冲区，内核在 recv 完成时自己挑一块填数据，
+ *     用户处理完后 recycle_buffer 还回去。优先用提供缓冲区环（5.19+，归还只是写一下环尾），
+ *     启动时用一对 socketpair 实测一次，环不可用时退回 IORING_OP_PROVIDE_BUFFERS
+ *     （归还要多提交一个 SQE，但和下一次 io_uring_enter 合并，不额外增加系统调用）
+ *   - enter_calls() 统计所有 io_uring_enter，包括 SQ 满时 get_sqe 内部的那次提交
+ *
+ * 单线程使用；SQ/CQ 的 head/tail 与内核之间用 acquire/release 同步。
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+class IoUring {
+public:
+    /**
+     * 旧式 PROVIDE_BUFFERS 请求的 user_data。内核支持 IOSQE_CQE_SKIP_SUCCESS（5.17+）时只有失败才产生完成事件，
+     * 否则成功也会有一个 res >= 0 的完成事件，调用方忽略即可
+     */
+    static const uint64_t kProvideBuffersData = ~0ULL;
+
+    IoUring()
+        : fd_(-1),
+          features_(0),
+          sq_ptr_(NULL),
+          sq_size_(0),
+          cq_ptr_(NULL),
+          cq_size_(0),
+          sqes_(NULL),
+          sqes_size_(0),
+          sq_head_(NULL),
+          sq_tail_(NULL),
+          sq_mask_(0),
+          sq_entries_(0),
+          sq_local_tail_(0),
+          cq_head_(NULL),
+          cq_tail_(NULL),
+          cq_mask_(0),
+          cqes_(NULL),
+          buf_ring_(NULL),
+          buf_ring_size_(0),
+          buf_base_(NULL),
+          buf_count_(0),
+          buf_size_(0),
+          buf_tail_(0),
+          buf_group_(0),
+          buf_legacy_(false),
+          sq_pending_(0),
+          enter_calls_(0) {}
+
+    ~IoUring() { destroy(); }
+
+    /**
+     * 创建 entries 个 SQ 项、cq_entries 个 CQ 项的环，flags 为 IORING_SETUP_*
+     * 返回值：成功返回0，失败返回 -errno
+     */
+    int init(unsigned entries, unsigned cq_entries, unsigned flags) {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        p.flags = flags | IORING_SETUP_CQSIZE;
+        p.cq_entries = cq_entries;
+        int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) {
+            return -errno;
+        }
+        fd_ = fd;
+        features_ = p.features;
+
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap && cq_size_ > sq_size_) {
+            sq_size_ = cq_size_;
+        }
+        sq_ptr_ = mmap(NULL, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = NULL;
+            return fail();
+        }
+        if (single_mmap) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(NULL, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) {
+                cq_ptr_ = NULL;
+                return fail();
+            }
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return fail();
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        // SQE 按顺序使用，索引数组固定成恒等映射，之后不再改
+        unsigned* array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        for (unsigned i = 0; i < p.sq_entries; ++i) {
+            array[i] = i;
+        }
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        sq_local_tail_ = *sq_tail_;
+        return 0;
+    }
+
+    void destroy() {
+        // 先关闭环：内核取消所有未完成的请求之后，才释放它们可能写入的缓冲区
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        if (sqes_ != NULL) munmap(sqes_, sqes_size_);
+        if (cq_ptr_ != NULL && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_ != NULL) munmap(sq_ptr_, sq_size_);
+        if (buf_ring_ != NULL) munmap(buf_ring_, buf_ring_size_);
+        if (buf_base_ != NULL) munmap(buf_base_, (size_t)buf_count_ * buf_size_);
+        sqes_ = NULL;
+        sq_ptr_ = cq_ptr_ = NULL;
+        buf_ring_ = NULL;
+        buf_base_ = NULL;
+    }
+
+    int fd() const { return fd_; }
+
+    /** 创建时带了 IORING_SETUP_R_DISABLED 的环，要在提交线程里调用一次 */
+    int enable() {
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_ENABLE_RINGS, NULL, 0) < 0) {
+            return -errno;
+        }
+        return 0;
+    }
+
+    /**
+     * 准备 count（2 的幂）块 size 字节的提供缓冲区，组号 bgid
+     * 旧式模式下只是往 SQ 里放一个 PROVIDE_BUFFERS，随第一次 submit 生效，所以可以在环启用前调用
+     * 返回值：成功返回0，失败返回 -errno
+     */
+    int setup_buffers(uint16_t bgid, unsigned count, unsigned size) {
+        void* base = mmap(NULL, (size_t)count * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return -errno;
+        }
+        buf_base_ = static_cast<char*>(base);
+        buf_count_ = count;
+        buf_size_ = size;
+        buf_group_ = bgid;
+        if (buffer_ring_works()) {
+            return register_buffer_ring();
+        }
+        buf_legacy_ = true;
+        return provide_buffers(0, count) ? 0 : -EBUSY;
+    }
+
+    /** 是否在用旧式 PROVIDE_BUFFERS */
+    bool legacy_buffers() const { return buf_legacy_; }
+
+    char* buffer(uint16_t bid) const { return buf_base_ + (size_t)bid * buf_size_; }
+    unsigned buffer_size() const { return buf_size_; }
+
+    /** 把用完的缓冲区还给内核 */
+    void recycle_buffer(uint16_t bid) {
+        if (buf_legacy_) {
+            provide_buffers(bid, 1);
+            return;
+        }
+        put_buffer(bid);
+        __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * 提供缓冲区环在当前内核上能否真正取到缓冲区（进程内只探测一次）
+     * 有的内核注册成功但 recv 一直返回 -ENOBUFS，所以不看注册结果，直接收一个字节试试
+     */
+    static bool buffer_ring_works() {
+        static const bool works = probe_buffer_ring();
+        return works;
+    }
+
+private:
+    IoUring(const IoUring&);
+    IoUring& operator=(const IoUring&);
+
+    static bool probe_buffer_ring() {
+        IoUring probe;
+        if (probe.init(4, 8, 0) < 0) {
+            return false;
+        }
+        void* base = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        probe.buf_base_ = static_cast<char*>(base);
+        probe.buf_count_ = 1;
+        probe.buf_size_ = 4096;
+        if (probe.register_buffer_ring() < 0) {
+            return false;
+        }
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+            return false;
+        }
+        bool ok = false;
+        if (write(sv[1], "x", 1) == 1) {
+            io_uring_sqe* sqe = probe.get_sqe();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = sv[0];
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = 0;
+            if (probe.submit_and_wait(1) >= 0) {
+                io_uring_cqe* cqe = probe.peek_cqe();
+                ok = cqe != NULL && cqe->res == 1 && (cqe->flags & IORING_CQE_F_BUFFER);
+            }
+        }
+        close(sv[0]);
+        close(sv[1]);
+        return ok;
+    }
+
+    int register_buffer_ring() {
+        buf_ring_size_ = buf_count_ * sizeof(io_uring_buf);
+        void* ring = mmap(NULL, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            return -errno;
+        }
+        buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (uint64_t)(uintptr_t)buf_ring_;
+        reg.ring_entries = buf_count_;
+        reg.bgid = buf_group_;
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            return -errno;
+        }
+        buf_tail_ = 0;
+        for (unsigned i = 0; i < buf_count_; ++i) {
+            put_buffer((uint16_t)i);
+        }
+        __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    /**
+     * 旧式：提交一个 PROVIDE_BUFFERS，把从 bid 开始的 n 块交给内核。
+     * 走到这里的多半是没有缓冲区环的老内核（5.19 之前），IOSQE_CQE_SKIP_SUCCESS 要 5.17，
+     * 不支持时带上这个标志整个 SQE 会被 -EINVAL 拒绝，缓冲区就再也还不回去了
+     */
+    bool provide_buffers(uint16_t bid, unsigned n) {
+        io_uring_sqe* sqe = get_sqe();
+        if (sqe == NULL) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        if (features_ & IORING_FEAT_CQE_SKIP) {
+            sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        }
+        sqe->fd = (int)n;
+        sqe->addr = (uint64_t)(uintptr_t)buffer(bid);
+        sqe->len = buf_size_;
+        sqe->off = bid;
+        sqe->buf_group = buf_group_;
+        sqe->user_data = kProvideBuffersData;
+        return true;
+    }
+
+public:
+
+    /** 取一个空闲 SQE（已清零）；SQ 满时先提交一次，仍然满返回 NULL */
+    io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sq_local_tail_ - head >= sq_entries_) {
+            if (submit() < 0) {
+                return NULL;
+            }
+            head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            if (sq_local_tail_ - head >= sq_entries_) {
+                return NULL;
+            }
+        }
+        io_uring_sqe* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+        ++sq_local_tail_;
+        ++sq_pending_;
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /** 提交已准备好的 SQE，不等待完成；返回提交数或 -1 */
+    int submit() { return enter(0, 0, NULL, 0); }
+
+    /**
+     * 提交并至少等到 wait_nr 个完成事件；timeout_ns >= 0 时最多等这么久（5.11+ 的 EXT_ARG），
+     * 超时返回 -1 且 errno 为 ETIME
+     * 返回值：提交数，失败返回 -1（errno 有效）
+     */
+    int submit_and_wait(unsigned wait_nr, int64_t timeout_ns = -1) {
+        if (timeout_ns < 0) {
+            return enter(wait_nr, IORING_ENTER_GETEVENTS, NULL, 0);
+        }
+        __kernel_timespec ts;
+        ts.tv_sec = timeout_ns / 1000000000LL;
+        ts.tv_nsec = timeout_ns % 1000000000LL;
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        return enter(wait_nr, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+
+    /** 取下一个完成事件，没有返回 NULL；处理完调用 cqe_seen */
+    io_uring_cqe* peek_cqe() {
+        unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+        return &cqes_[head & cq_mask_];
+    }
+
+    void cqe_seen() { __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE); }
+
+    /** 本次 io_uring_enter 调用之前还有多少 SQE 没有提交 */
+    unsigned pending() const { return sq_pending_; }
+
+    /** 到目前为止调用 io_uring_enter 的次数 */
+    uint64_t enter_calls() const { return enter_calls_; }
+
+private:
+    int fail() {
+        int err = errno;
+        destroy();
+        return -err;
+    }
+
+    void put_buffer(uint16_t bid) {
+        io_uring_buf* b = &buf_ring_->bufs[buf_tail_ & (buf_count_ - 1)];
+        b->addr = (uint64_t)(uintptr_t)buffer(bid);
+        b->len = buf_size_;
+        b->bid = bid;
+        ++buf_tail_;
+    }
+
+    int enter(unsigned wait_nr, unsigned flags, const void* arg, size_t argsz) {
+        unsigned to_submit = sq_pending_;
+        __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+        int ret = (int)syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr, flags, arg, argsz);
+        ++enter_calls_;
+        if (ret >= 0) {
+            sq_pending_ -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+        }
+        return ret;
+    }
+
+    int fd_;
+    unsigned features_;
+    void* sq_ptr_;
+    size_t sq_size_;
+    void* cq_ptr_;
+    size_t cq_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sq_local_tail_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+
+    io_uring_buf_ring* buf_ring_;
+    size_t buf_ring_size_;
+    char* buf_base_;
+    unsigned buf_count_;
+    unsigned buf_size_;
+    uint16_t buf_tail_;
+    uint16_t buf_group_;
+    bool buf_legacy_;
+    unsigned sq_pending_;
+    uint64_t enter_calls_;
+};
+
+#endif  // EPOLL_URING_H
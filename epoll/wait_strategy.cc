@@ -0,0 +1,112 @@
+#include "wait_strategy.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "epoll_compat.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+WaitStrategy::WaitStrategy(WaitMode mode, int64_t spin_ns, int64_t min_spin_ns, int64_t max_spin_ns)
+    : mode_(mode),
+      spin_ns_(spin_ns),
+      min_spin_ns_(min_spin_ns),
+      max_spin_ns_(max_spin_ns),
+      period_waits_(0),
+      period_hits_(0),
+      period_near_misses_(0) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+const char* WaitStrategy::mode_name(WaitMode mode) {
+    switch (mode) {
+        case kWaitBlocking: return "blocking";
+        case kWaitBusyPoll: return "busy-poll";
+        case kWaitHybrid: return "hybrid";
+    }
+    return "unknown";
+}
+
+int WaitStrategy::wait(int ep, epoll_event* events, int max_events, int64_t timeout_ns) {
+    ++stats_.waits;
+    if (mode_ == kWaitBlocking || timeout_ns == 0) {
+        if (timeout_ns != 0) {
+            ++stats_.blocks;
+        }
+        return epoll_wait_ns(ep, events, max_events, timeout_ns);
+    }
+
+    int64_t start = monotonic_ns();
+    int64_t deadline = timeout_ns < 0 ? INT64_MAX : start + timeout_ns;
+    int64_t spin_end = mode_ == kWaitBusyPoll ? deadline : start + spin_ns_;
+    if (spin_end > deadline) {
+        spin_end = deadline;
+    }
+
+    // 轮询阶段：epoll_wait(0) 只检查就绪链表，不会睡眠
+    int64_t now = start;
+    for (;;) {
+        int n = epoll_wait(ep, events, max_events, 0);
+        if (n != 0) {
+            if (n > 0) {
+                ++stats_.spin_hits;
+                if (mode_ == kWaitHybrid) {
+                    ++period_hits_;
+                    if (++period_waits_ == kAdaptPeriod) adapt();
+                }
+            }
+            return n;
+        }
+        now = monotonic_ns();
+        if (now >= spin_end) {
+            break;
+        }
+        for (int i = 0; i < 16; ++i) {
+            CPU_RELAX();
+        }
+    }
+    if (now >= deadline) {
+        return 0;
+    }
+
+    // 阻塞阶段
+    ++stats_.blocks;
+    int n = epoll_wait_ns(ep, events, max_events, deadline == INT64_MAX ? -1 : deadline - now);
+    if (n > 0 && monotonic_ns() - now <= spin_ns_) {
+        ++stats_.near_misses;
+        ++period_near_misses_;
+    }
+    if (n >= 0 && mode_ == kWaitHybrid && ++period_waits_ == kAdaptPeriod) {
+        adapt();
+    }
+    return n;
+}
+
+void WaitStrategy::adapt() {
+    // 命中 + 差一点命中占多数：事件间隔和窗口同一量级，加大窗口划算
+    // 命中率很低：事件间隔远大于窗口，轮询基本是白烧 CPU
+    int useful = period_hits_ + period_near_misses_;
+    if (useful * 2 >= period_waits_ && spin_ns_ < max_spin_ns_) {
+        spin_ns_ = spin_ns_ * 2 > max_spin_ns_ ? max_spin_ns_ : spin_ns_ * 2;
+        ++stats_.grows;
+    } else if (period_hits_ * 10 < period_waits_ && period_near_misses_ * 4 < period_waits_ &&
+               spin_ns_ > min_spin_ns_) {
+        spin_ns_ = spin_ns_ / 2 < min_spin_ns_ ? min_spin_ns_ : spin_ns_ / 2;
+        ++stats_.shrinks;
+    }
+    period_waits_ = 0;
+    period_hits_ = 0;
+    period_near_misses_ = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef EPOLL_WAIT_STRATEGY_H
+#define EPOLL_WAIT_STRATEGY_H
+
+/**
+ * 事件循环的等待策略
+ *
+ *  kWaitBlocking  直接阻塞在 epoll_wait 上：不耗 CPU，但要付出定时器取整和调度唤醒延迟
+ *  kWaitBusyPoll  一直 epoll_wait(..., 0) 轮询：唤醒延迟最低，独占一个核
+ *  kWaitHybrid    先轮询一个时间窗口，窗口内没有事件再阻塞；窗口大小自适应：
+ *                 轮询经常命中（或阻塞后很快就来了事件）时加倍，轮询大多落空时减半
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+enum WaitMode {
+    kWaitBlocking,
+    kWaitBusyPoll,
+    kWaitHybrid,
+};
+
+struct WaitStats {
+    uint64_t waits;         // wait() 调用次数
+    uint64_t spin_hits;     // 轮询阶段拿到事件的次数
+    uint64_t blocks;        // 进入阻塞等待的次数
+    uint64_t near_misses;   // 阻塞后在一个窗口内就来了事件（窗口再大一点就能命中）
+    uint64_t grows;         // 窗口加倍次数
+    uint64_t shrinks;       // 窗口减半次数
+};
+
+class WaitStrategy {
+public:
+    explicit WaitStrategy(WaitMode mode, int64_t spin_ns = 20000, int64_t min_spin_ns = 1000,
+                          int64_t max_spin_ns = 1000000);
+
+    /** 语义同 epoll_wait，但超时是纳秒，timeout_ns < 0 表示无限等待 */
+    int wait(int ep, epoll_event* events, int max_events, int64_t timeout_ns);
+
+    WaitMode mode() const { return mode_; }
+    int64_t spin_ns() const { return spin_ns_; }
+    const WaitStats& stats() const { return stats_; }
+
+    static const char* mode_name(WaitMode mode);
+
+private:
+    void adapt();
+
+    static const int kAdaptPeriod = 64;  // 每 64 次等待评估一次窗口
+
+    WaitMode mode_;
+    int64_t spin_ns_;
+    int64_t min_spin_ns_;
+    int64_t max_spin_ns_;
+    WaitStats stats_;
+    int period_waits_;
+    int period_hits_;
+    int period_near_misses_;
+};
+
+#endif  // EPOLL_WAIT_STRATEGY_H
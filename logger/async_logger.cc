@@ -0,0 +1,576 @@
+#include "async_logger.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <utility>
+
+static_assert(sizeof(LogRecord) == 64, "LogRecord 应该正好一个缓存行");
+
+namespace {
+
+const size_t kBlockSize = 64 * 1024;
+const size_t kMaxBlocks = 16;     // 一次 writev 最多 1MB
+const size_t kMaxLine = 4096;     // 单行上限，超出部分截断
+const uint64_t kPublishEvery = 256;  // 消费这么多条记录就更新一次 head，让等待中的生产者尽早继续
+
+std::atomic<uint64_t> g_next_logger_id(1);
+
+int64_t clock_ns(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** 线程退出时把它用过的所有环标记为退役，由后台线程排空后回收 */
+struct ThreadRings {
+    std::vector<std::pair<uint64_t, log_detail::Ring*> > rings;
+
+    ~ThreadRings() {
+        for (size_t i = 0; i < rings.size(); ++i) {
+            rings[i].second->retired.store(true, std::memory_order_release);
+            log_detail::release_ring(rings[i].second);
+        }
+    }
+};
+
+thread_local ThreadRings t_rings;
+
+size_t put_uint(char* out, uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+size_t put_int(char* out, int64_t v) {
+    if (v < 0) {
+        out[0] = '-';
+        return 1 + put_uint(out + 1, 0 - (uint64_t)v);
+    }
+    return put_uint(out, (uint64_t)v);
+}
+
+/** 定点小数的快速路径，最多 40 个字符；超出范围返回 0，交给 snprintf（最后一位的舍入可能和 printf 不同） */
+size_t put_fixed(char* out, double v, int prec) {
+    static const uint64_t kPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    if (prec > 9 || !(v > -1e9 && v < 1e9)) {
+        return 0;
+    }
+    size_t n = 0;
+    if (v < 0) {
+        out[n++] = '-';
+        v = -v;
+    }
+    uint64_t scale = kPow10[prec];
+    uint64_t total = (uint64_t)(v * scale + 0.5);
+    n += put_uint(out + n, total / scale);
+    if (prec > 0) {
+        out[n++] = '.';
+        uint64_t frac = total % scale;
+        for (int i = prec - 1; i >= 0; --i) {
+            out[n + i] = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        n += prec;
+    }
+    return n;
+}
+
+/**
+ * 按记录里保存的参数类型重新生成转换说明再交给 snprintf：
+ * 格式串里的长度修饰符（l、ll、z 等）被忽略，整数一律按 64 位输出；%n 不支持
+ */
+size_t format_message(char* out, size_t cap, const char* fmt, const LogRecord& r) {
+    size_t o = 0;
+    int ai = 0;
+    const char* p = fmt;
+    while (*p != '\0' && o + 1 < cap) {
+        if (*p != '%') {
+            out[o++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[o++] = '%';
+            p += 2;
+            continue;
+        }
+        const char* start = p++;
+        char spec[32];
+        size_t n = 0;
+        spec[n++] = '%';
+        while (*p != '\0' && strchr("-+ #0", *p) != NULL && n < 8) spec[n++] = *p++;
+        while (*p >= '0' && *p <= '9' && n < 16) spec[n++] = *p++;
+        if (*p == '.') {
+            spec[n++] = *p++;
+            while (*p >= '0' && *p <= '9' && n < 24) spec[n++] = *p++;
+        }
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL) ++p;
+        char conv = *p;
+        if (conv == '\0') {
+            break;
+        }
+        ++p;
+        if (ai >= r.nargs || conv == 'n') {
+            size_t len = p - start < (ptrdiff_t)(cap - 1 - o) ? (size_t)(p - start) : cap - 1 - o;
+            memcpy(out + o, start, len);
+            o += len;
+            continue;
+        }
+        uint8_t type = r.types[ai];
+        const LogArg& a = r.args[ai++];
+        int64_t as_int = type == kArgDouble ? (int64_t)a.d : a.i;
+        // 常见的无修饰 %d %u %s 和 %f/%.Nf 不经过 snprintf，格式化速度决定了后台线程能跟上的速率
+        if (o + 48 < cap) {
+            size_t fast = 0;
+            if (n == 1 && (conv == 'd' || conv == 'i')) {
+                fast = put_int(out + o, type == kArgUint ? (int64_t)a.u : as_int);
+            } else if (n == 1 && conv == 'u') {
+                fast = put_uint(out + o, (uint64_t)as_int);
+            } else if (conv == 'f' && (n == 1 || (n == 3 && spec[1] == '.' && spec[2] >= '0' && spec[2] <= '9'))) {
+                fast = put_fixed(out + o, type == kArgDouble ? a.d : (double)as_int, n == 1 ? 6 : spec[2] - '0');
+            } else if (n == 1 && conv == 's' && type == kArgString && a.s != NULL) {
+                size_t len = strlen(a.s);
+                fast = len < cap - 1 - o ? len : cap - 1 - o;
+                memcpy(out + o, a.s, fast);
+            }
+            if (fast > 0) {
+                o += fast;
+                continue;
+            }
+        }
+        int w;
+        switch (conv) {
+            case 'd':
+            case 'i':
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = 'd';
+                spec[n] = '\0';
+                w = snprintf(out + o, cap - o, spec, (long long)as_int);
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                w = snprintf(out + o, cap - o, spec, (unsigned long long)as_int);
+                break;
+            case 'c':
+                spec[n++] = 'c';
+                spec[n] = '\0';
+                w = snprintf(out + o, cap - o, spec, (int)as_int);
+                break;
+            case 's':
+                if (type == kArgString) {
+                    spec[n++] = 's';
+                    spec[n] = '\0';
+                    w = snprintf(out + o, cap - o, spec, a.s != NULL ? a.s : "(null)");
+                } else {
+                    w = snprintf(out + o, cap - o, "%lld", (long long)as_int);
+                }
+                break;
+            case 'p':
+                spec[n++] = 'p';
+                spec[n] = '\0';
+                w = snprintf(out + o, cap - o, spec, a.p);
+                break;
+            default:  // e f g a 及其大写
+                spec[n++] = conv;
+                spec[n] = '\0';
+                w = snprintf(out + o, cap - o, spec,
+                             type == kArgDouble ? a.d : type == kArgUint ? (double)a.u : (double)a.i);
+                break;
+        }
+        if (w > 0) {
+            o += (size_t)w < cap - 1 - o ? (size_t)w : cap - 1 - o;
+        }
+    }
+    return o;
+}
+
+}  // namespace
+
+namespace log_detail {
+
+Ring::Ring(size_t capacity, int thread_id)
+    : records(NULL), mask(0), tid(thread_id), head(0), reported_dropped(0), tail(0), cached_head(0), dropped(0),
+      refs(2), retired(false) {
+    size_t n = 1;
+    while (n < capacity) {
+        n <<= 1;
+    }
+    records = new LogRecord[n];
+    mask = n - 1;
+}
+
+Ring::~Ring() { delete[] records; }
+
+void release_ring(Ring* ring) {
+    if (ring->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete ring;
+    }
+}
+
+}  // namespace log_detail
+
+thread_local AsyncLogger::LastRing AsyncLogger::t_last_ = {0, NULL};
+
+AsyncLogger::AsyncLogger(const LoggerOptions& opts)
+    : id_(g_next_logger_id.fetch_add(1)),
+      ring_records_(opts.ring_records),
+      block_when_full_(opts.block_when_full),
+      flush_interval_ms_(opts.flush_interval_ms > 0 ? opts.flush_interval_ms : 1),
+      min_level_(opts.min_level),
+      fd_(-1),
+      own_fd_(false),
+      running_(false),
+      stopping_(false),
+      flush_requested_(0),
+      flush_done_(0),
+      ns_per_tick_(1.0),
+      base_ticks_(0),
+      base_mono_ns_(0),
+      base_real_ns_(0),
+      last_calibrate_ns_(0),
+      cached_sec_(-1),
+      blocks_used_(0),
+      block_len_(0),
+      records_(0),
+      dropped_(0),
+      writevs_(0),
+      bytes_(0) {
+    cached_date_[0] = '\0';
+    for (size_t i = 0; i < kMaxBlocks; ++i) {
+        blocks_.push_back(new char[kBlockSize]);
+    }
+    block_lens_.resize(kMaxBlocks);
+    // 时间基准在构造时就定下来，open 之前写入（然后丢弃或留在环里）的记录也有合理的时间戳
+    base_ticks_ = log_detail::ticks();
+    base_mono_ns_ = clock_ns(CLOCK_MONOTONIC);
+    base_real_ns_ = clock_ns(CLOCK_REALTIME);
+}
+
+AsyncLogger::~AsyncLogger() {
+    close();
+    std::lock_guard<std::mutex> lock(mu_);
+    for (size_t i = 0; i < rings_.size(); ++i) {
+        log_detail::release_ring(rings_[i]);
+    }
+    rings_.clear();
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        delete[] blocks_[i];
+    }
+}
+
+int AsyncLogger::open(const char* path) {
+    if (path == NULL || strcmp(path, "-") == 0) {
+        return open_fd(STDOUT_FILENO);
+    }
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (open_fd(fd) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    own_fd_ = true;
+    return 0;
+}
+
+int AsyncLogger::open_fd(int fd) {
+    if (running_) {
+        return -1;
+    }
+    fd_ = fd;
+    own_fd_ = false;
+    stopping_ = false;
+    // 构造到现在的时间不够长时先等一会，TSC 频率的初值不至于太离谱；之后后台线程每秒修正一次
+    int64_t elapsed = clock_ns(CLOCK_MONOTONIC) - base_mono_ns_;
+    if (elapsed < 10000000) {
+        usleep((useconds_t)((10000000 - elapsed) / 1000));
+    }
+    calibrate();
+    running_ = true;
+    thread_ = std::thread(&AsyncLogger::run, this);
+    return 0;
+}
+
+void AsyncLogger::flush() {
+    if (!running_) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    uint64_t target = ++flush_requested_;
+    cv_.notify_all();
+    cv_.wait(lock, [this, target] { return flush_done_ >= target; });
+}
+
+void AsyncLogger::close() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+        cv_.notify_all();
+    }
+    thread_.join();
+    running_ = false;
+    if (own_fd_) {
+        ::close(fd_);
+        own_fd_ = false;
+    }
+    fd_ = -1;
+}
+
+LoggerStats AsyncLogger::stats() const {
+    LoggerStats s;
+    s.records = records_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.writevs = writevs_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    return s;
+}
+
+log_detail::Ring* AsyncLogger::register_thread() {
+    ThreadRings& local = t_rings;
+    log_detail::Ring* ring = NULL;
+    for (size_t i = 0; i < local.rings.size(); ++i) {
+        if (local.rings[i].first == id_) {
+            ring = local.rings[i].second;
+            break;
+        }
+    }
+    if (ring == NULL) {
+        ring = new log_detail::Ring(ring_records_, (int)syscall(SYS_gettid));
+        local.rings.push_back(std::make_pair(id_, ring));
+        std::lock_guard<std::mutex> lock(mu_);
+        rings_.push_back(ring);
+    }
+    t_last_.id = id_;
+    t_last_.ring = ring;
+    return ring;
+}
+
+void AsyncLogger::run() {
+    std::vector<log_detail::Ring*> rings;
+    for (;;) {
+        uint64_t target;
+        bool stopping;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            rings = rings_;
+            target = flush_requested_;
+            stopping = stopping_;
+        }
+        // flush 请求和 stop 标志先于各环的 tail 读取，所以请求之前写入的记录都在这一轮里
+        size_t n = drain(rings);
+        report_dropped(rings);
+        write_out();
+        reap(rings);
+        if (clock_ns(CLOCK_MONOTONIC) - last_calibrate_ns_ > 1000000000LL) {
+            calibrate();
+        }
+
+        std::unique_lock<std::mutex> lock(mu_);
+        if (target > flush_done_) {
+            flush_done_ = target;
+            cv_.notify_all();
+        }
+        if (stopping) {
+            break;
+        }
+        if (n == 0 && flush_requested_ == flush_done_ && !stopping_) {
+            cv_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms_));
+        }
+    }
+}
+
+/** 取各环当前的快照，按时间戳多路归并格式化；返回处理的记录数 */
+size_t AsyncLogger::drain(const std::vector<log_detail::Ring*>& rings) {
+    size_t k = rings.size();
+    std::vector<uint64_t> heads(k), tails(k);
+    for (size_t i = 0; i < k; ++i) {
+        heads[i] = rings[i]->head.load(std::memory_order_relaxed);
+        tails[i] = rings[i]->tail.load(std::memory_order_acquire);
+    }
+    size_t count = 0;
+    for (;;) {
+        size_t best = k;
+        uint64_t best_ticks = 0;
+        for (size_t i = 0; i < k; ++i) {
+            if (heads[i] == tails[i]) {
+                continue;
+            }
+            uint64_t t = rings[i]->records[heads[i] & rings[i]->mask].ticks;
+            if (best == k || (int64_t)(t - best_ticks) < 0) {
+                best = i;
+                best_ticks = t;
+            }
+        }
+        if (best == k) {
+            break;
+        }
+        log_detail::Ring* ring = rings[best];
+        const LogRecord& r = ring->records[heads[best] & ring->mask];
+        char* line = line_buffer();
+        size_t len = format_prefix(line, r.ticks, r.site->level, ring->tid);
+        len += format_message(line + len, kMaxLine - len, r.site->format, r);
+        line[len++] = '\n';
+        block_len_ += len;
+        ++count;
+        if (++heads[best] % kPublishEvery == 0) {
+            ring->head.store(heads[best], std::memory_order_release);
+        }
+    }
+    for (size_t i = 0; i < k; ++i) {
+        rings[i]->head.store(heads[i], std::memory_order_release);
+    }
+    records_.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void AsyncLogger::report_dropped(const std::vector<log_detail::Ring*>& rings) {
+    for (size_t i = 0; i < rings.size(); ++i) {
+        log_detail::Ring* ring = rings[i];
+        uint64_t d = ring->dropped.load(std::memory_order_relaxed);
+        if (d == ring->reported_dropped) {
+            continue;
+        }
+        char* line = line_buffer();
+        size_t len = format_prefix(line, log_detail::ticks(), kLogWarn, ring->tid);
+        len += snprintf(line + len, kMaxLine - len, "logger: ring full, dropped %llu records\n",
+                        (unsigned long long)(d - ring->reported_dropped));
+        block_len_ += len;
+        dropped_.fetch_add(d - ring->reported_dropped, std::memory_order_relaxed);
+        ring->reported_dropped = d;
+    }
+}
+
+/** 已退役并且排空的环从列表里摘掉，释放日志器持有的引用 */
+void AsyncLogger::reap(const std::vector<log_detail::Ring*>& rings) {
+    for (size_t i = 0; i < rings.size(); ++i) {
+        log_detail::Ring* ring = rings[i];
+        if (!ring->retired.load(std::memory_order_acquire) ||
+            ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_acquire)) {
+            continue;
+        }
+        report_dropped(std::vector<log_detail::Ring*>(1, ring));
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            for (size_t j = 0; j < rings_.size(); ++j) {
+                if (rings_[j] == ring) {
+                    rings_.erase(rings_.begin() + j);
+                    break;
+                }
+            }
+        }
+        log_detail::release_ring(ring);
+    }
+}
+
+/** 用从基准点到现在的整段时间重新估计 TSC 频率，距离越长越准 */
+void AsyncLogger::calibrate() {
+    uint64_t t = log_detail::ticks();
+    int64_t now = clock_ns(CLOCK_MONOTONIC);
+    if (t > base_ticks_ && now > base_mono_ns_) {
+        ns_per_tick_ = (double)(now - base_mono_ns_) / (double)(t - base_ticks_);
+    }
+    last_calibrate_ns_ = now;
+}
+
+size_t AsyncLogger::format_prefix(char* out, uint64_t ticks, LogLevel level, int tid) {
+    static const char kLevels[] = {'D', 'I', 'W', 'E'};
+    int64_t ns = base_real_ns_ + (int64_t)((double)(int64_t)(ticks - base_ticks_) * ns_per_tick_);
+    time_t sec = (time_t)(ns / 1000000000LL);
+    if (sec != cached_sec_) {
+        tm t;
+        localtime_r(&sec, &t);
+        strftime(cached_date_, sizeof(cached_date_), "%Y-%m-%d %H:%M:%S", &t);
+        cached_sec_ = sec;
+    }
+    // "YYYY-mm-dd HH:MM:SS.uuuuuu L tid "，每条记录都要格式化一次，手写代替 snprintf
+    size_t n = strlen(cached_date_);
+    memcpy(out, cached_date_, n);
+    out[n++] = '.';
+    int usec = (int)(ns % 1000000000LL / 1000);
+    for (int i = 5; i >= 0; --i) {
+        out[n + i] = (char)('0' + usec % 10);
+        usec /= 10;
+    }
+    n += 6;
+    out[n++] = ' ';
+    out[n++] = kLevels[level];
+    out[n++] = ' ';
+    n += put_int(out + n, tid);
+    out[n++] = ' ';
+    return n;
+}
+
+/** 返回至少能放下一整行的位置；当前块不够时换下一块，块都用完时先写出 */
+char* AsyncLogger::line_buffer() {
+    if (blocks_used_ == 0 || block_len_ + kMaxLine + 1 > kBlockSize) {
+        if (blocks_used_ == kMaxBlocks) {
+            write_out();
+        }
+        if (blocks_used_ > 0) {
+            block_lens_[blocks_used_ - 1] = block_len_;
+        }
+        ++blocks_used_;
+        block_len_ = 0;
+    }
+    return blocks_[blocks_used_ - 1] + block_len_;
+}
+
+void AsyncLogger::write_out() {
+    if (blocks_used_ == 0) {
+        return;
+    }
+    block_lens_[blocks_used_ - 1] = block_len_;
+    iovec iov[kMaxBlocks];
+    size_t niov = 0;
+    for (size_t i = 0; i < blocks_used_; ++i) {
+        if (block_lens_[i] > 0) {
+            iov[niov].iov_base = blocks_[i];
+            iov[niov].iov_len = block_lens_[i];
+            ++niov;
+        }
+    }
+    blocks_used_ = 0;
+    block_len_ = 0;
+
+    size_t first = 0;
+    while (first < niov) {
+        ssize_t n = writev(fd_, iov + first, (int)(niov - first));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;  // 磁盘满之类的错误：丢掉这一批，不能让日志卡住后台线程
+        }
+        writevs_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(n, std::memory_order_relaxed);
+        while (first < niov && (size_t)n >= iov[first].iov_len) {
+            n -= iov[first].iov_len;
+            ++first;
+        }
+        if (first < niov) {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
+}
@@ -0,0 +1,325 @@
+#ifndef LOGGER_ASYNC_LOGGER_H
+#define LOGGER_ASYNC_LOGGER_H
+
+/**
+ * 异步二进制日志：热路径只写一条定长记录，格式化和 I/O 都在后台线程
+ *
+ *  - 每个线程第一次写日志时分配自己的单生产者环形缓冲区（无锁，只有一次 release store），
+ *    记录是 64 字节定长结构：时间戳（TSC）、调用点指针（格式串/级别/文件行号，相当于格式 id）、
+ *    最多 5 个参数的原始值
+ *  - 后台线程按时间戳归并各线程的记录，格式化到 64KB 的块里，攒满一批用一次 writev 写出
+ *  - 热路径不做任何系统调用：后台线程空闲时按 flush_interval_ms 轮询，flush() 才会唤醒它
+ *  - 环满时默认丢弃并计数（后台会写一行丢弃统计），也可以配置成让生产者等待
+ *
+ * 参数只能是整数、浮点数、指针和 const char*。字符串只保存指针，
+ * 所以必须是字面量或生命周期覆盖到 flush 之后的字符串。
+ * 后台线程不会跟着 fork 走：守护进程要在 daemonize() 之后再 open()。
+ *
+ * 用法:
+ *   AsyncLogger log;
+ *   log.open("/tmp/app.log");
+ *   ALOG_INFO(log, "accepted fd=%d from port %u", fd, port);
+ *   log.flush();  // 可选：等待之前的日志全部写出
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum LogLevel {
+    kLogDebug,
+    kLogInfo,
+    kLogWarn,
+    kLogError,
+};
+
+/** 一个日志调用点，由宏生成为函数内静态变量，记录里只存它的地址 */
+struct LogSite {
+    const char* format;
+    const char* file;
+    int line;
+    LogLevel level;
+};
+
+enum LogArgType {
+    kArgInt,
+    kArgUint,
+    kArgDouble,
+    kArgString,
+    kArgPointer,
+};
+
+union LogArg {
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char* s;
+    const void* p;
+};
+
+/** 环形缓冲区里的一条记录，正好一个缓存行 */
+struct LogRecord {
+    static const int kMaxArgs = 5;
+
+    uint64_t ticks;
+    const LogSite* site;
+    uint8_t nargs;
+    uint8_t types[kMaxArgs];
+    LogArg args[kMaxArgs];
+};
+
+struct LoggerOptions {
+    size_t ring_records;    // 每个线程环形缓冲区的记录数，向上取 2 的幂
+    bool block_when_full;   // true: 环满时生产者让出 CPU 等待；false: 丢弃并计数
+    int flush_interval_ms;  // 后台线程空闲时的轮询间隔
+    LogLevel min_level;
+
+    LoggerOptions() : ring_records(16384), block_when_full(false), flush_interval_ms(1), min_level(kLogDebug) {}
+};
+
+struct LoggerStats {
+    uint64_t records;  // 已写出的记录数
+    uint64_t dropped;  // 因环满丢弃的记录数
+    uint64_t writevs;  // writev 调用次数
+    uint64_t bytes;    // 写出的字节数
+};
+
+namespace log_detail {
+
+inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+template <typename T, typename Enable = void>
+struct ArgTraits;
+
+template <typename T>
+struct ArgTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+    static const uint8_t type = kArgInt;
+    static void store(LogArg* a, T v) { a->i = v; }
+};
+
+template <typename T>
+struct ArgTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type> {
+    static const uint8_t type = kArgUint;
+    static void store(LogArg* a, T v) { a->u = v; }
+};
+
+template <typename T>
+struct ArgTraits<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static const uint8_t type = kArgInt;
+    static void store(LogArg* a, T v) { a->i = (int64_t)v; }
+};
+
+template <typename T>
+struct ArgTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static const uint8_t type = kArgDouble;
+    static void store(LogArg* a, T v) { a->d = v; }
+};
+
+template <>
+struct ArgTraits<const char*> {
+    static const uint8_t type = kArgString;
+    static void store(LogArg* a, const char* v) { a->s = v; }
+};
+
+template <>
+struct ArgTraits<char*> {
+    static const uint8_t type = kArgString;
+    static void store(LogArg* a, const char* v) { a->s = v; }
+};
+
+template <typename T>
+struct ArgTraits<T*, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+    static const uint8_t type = kArgPointer;
+    static void store(LogArg* a, const T* v) { a->p = v; }
+};
+
+inline void store_args(LogRecord*, int) {}
+
+template <typename T, typename... Rest>
+inline void store_args(LogRecord* r, int i, T v, Rest... rest) {
+    typedef typename std::decay<T>::type D;
+    r->types[i] = ArgTraits<D>::type;
+    ArgTraits<D>::store(&r->args[i], v);
+    store_args(r, i + 1, rest...);
+}
+
+/** 单生产者单消费者环：生产者是写日志的线程，消费者是后台线程；三组字段各占一个缓存行 */
+struct Ring {
+    Ring(size_t capacity, int tid);
+    ~Ring();
+
+    LogRecord* records;
+    size_t mask;
+    int tid;
+    char pad0_[64 - sizeof(LogRecord*) - sizeof(size_t) - sizeof(int)];
+
+    std::atomic<uint64_t> head;  // 消费者位置
+    uint64_t reported_dropped;   // 后台已经报告过的丢弃数，只有消费者访问
+    char pad1_[64 - 2 * sizeof(uint64_t)];
+
+    std::atomic<uint64_t> tail;     // 生产者位置
+    uint64_t cached_head;           // 生产者缓存的 head，环看起来满了才重新读
+    std::atomic<uint64_t> dropped;  // 只有生产者写
+    char pad2_[64 - 3 * sizeof(uint64_t)];
+
+    // 线程退出和日志器各持有一个引用，最后一个释放的负责 delete
+    std::atomic<int> refs;
+    std::atomic<bool> retired;  // 生产者线程已退出
+};
+
+void release_ring(Ring* ring);
+
+}  // namespace log_detail
+
+class AsyncLogger {
+public:
+    explicit AsyncLogger(const LoggerOptions& opts = LoggerOptions());
+    ~AsyncLogger();
+
+    /** 打开（追加）日志文件并启动后台线程；path 为 NULL 或 "-" 时写 stdout。失败返回 -1 */
+    int open(const char* path);
+    /** 使用已经打开的 fd（不会关闭它） */
+    int open_fd(int fd);
+
+    /** 等待调用之前写入的所有记录都被写出（各线程环里的都算） */
+    void flush();
+    /** flush 之后停止后台线程；析构时自动调用 */
+    void close();
+
+    void set_level(LogLevel level) { min_level_.store(level, std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= min_level_.load(std::memory_order_relaxed); }
+
+    /** 在后台线程停止后，或容忍近似值时调用 */
+    LoggerStats stats() const;
+
+    template <typename... Args>
+    void log(const LogSite* site, Args... args) {
+        static_assert(sizeof...(Args) <= LogRecord::kMaxArgs, "日志参数最多 5 个");
+        log_detail::Ring* ring = local_ring();
+        LogRecord* r = reserve(ring);
+        if (r == NULL) {
+            return;
+        }
+        r->ticks = log_detail::ticks();
+        r->site = site;
+        r->nargs = sizeof...(Args);
+        log_detail::store_args(r, 0, args...);
+        ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    AsyncLogger(const AsyncLogger&);
+    AsyncLogger& operator=(const AsyncLogger&);
+
+    log_detail::Ring* local_ring() {
+        // 绝大多数线程只用一个日志器，先比较上一次命中的那个
+        if (t_last_.id == id_) {
+            return t_last_.ring;
+        }
+        return register_thread();
+    }
+
+    LogRecord* reserve(log_detail::Ring* ring) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        if (tail - ring->cached_head > ring->mask) {
+            ring->cached_head = ring->head.load(std::memory_order_acquire);
+            while (tail - ring->cached_head > ring->mask) {
+                if (!block_when_full_) {
+                    ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1,
+                                        std::memory_order_relaxed);
+                    return NULL;
+                }
+                std::this_thread::yield();
+                ring->cached_head = ring->head.load(std::memory_order_acquire);
+            }
+        }
+        return &ring->records[tail & ring->mask];
+    }
+
+    log_detail::Ring* register_thread();
+    void run();
+    size_t drain(const std::vector<log_detail::Ring*>& rings);
+    void report_dropped(const std::vector<log_detail::Ring*>& rings);
+    void reap(const std::vector<log_detail::Ring*>& rings);
+    void calibrate();
+    size_t format_prefix(char* out, uint64_t ticks, LogLevel level, int tid);
+    char* line_buffer();
+    void write_out();
+
+    struct LastRing {
+        uint64_t id;
+        log_detail::Ring* ring;
+    };
+    static thread_local LastRing t_last_;
+
+    const uint64_t id_;  // 进程内唯一，不用地址区分日志器（地址可能被复用）
+    const size_t ring_records_;
+    const bool block_when_full_;
+    const int flush_interval_ms_;
+    std::atomic<int> min_level_;
+
+    int fd_;
+    bool own_fd_;
+    std::thread thread_;
+    bool running_;
+
+    std::mutex mu_;  // 保护 rings_、flush 状态；只在注册线程、flush 和后台线程空闲时使用
+    std::condition_variable cv_;
+    std::vector<log_detail::Ring*> rings_;
+    bool stopping_;
+    uint64_t flush_requested_;
+    uint64_t flush_done_;
+
+    // 时间基准在 open() 时确定，之后只由后台线程访问
+    double ns_per_tick_;
+    uint64_t base_ticks_;
+    int64_t base_mono_ns_;
+    int64_t base_real_ns_;
+    int64_t last_calibrate_ns_;
+    time_t cached_sec_;
+    char cached_date_[32];  // "YYYY-mm-dd HH:MM:SS"
+
+    // 输出块：格式化结果依次写进这些块，一次 writev 全部写出
+    std::vector<char*> blocks_;
+    size_t blocks_used_;  // 正在写的是 blocks_[blocks_used_ - 1]
+    size_t block_len_;    // 当前块已用字节数
+    std::vector<size_t> block_lens_;
+
+    std::atomic<uint64_t> records_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> writevs_;
+    std::atomic<uint64_t> bytes_;
+};
+
+#define ALOG(logger, lvl, fmt, ...)                                       \
+    do {                                                                  \
+        if ((logger).enabled(lvl)) {                                      \
+            static const LogSite alog_site_ = {fmt, __FILE__, __LINE__, lvl}; \
+            (logger).log(&alog_site_, ##__VA_ARGS__);                     \
+        }                                                                 \
+    } while (0)
+
+#define ALOG_DEBUG(logger, fmt, ...) ALOG(logger, kLogDebug, fmt, ##__VA_ARGS__)
+#define ALOG_INFO(logger, fmt, ...) ALOG(logger, kLogInfo, fmt, ##__VA_ARGS__)
+#define ALOG_WARN(logger, fmt, ...) ALOG(logger, kLogWarn, fmt, ##__VA_ARGS__)
+#define ALOG_ERROR(logger, fmt, ...) ALOG(logger, kLogError, fmt, ##__VA_ARGS__)
+
+#endif  // LOGGER_ASYNC_LOGGER_H
@@ -0,0 +1,209 @@
+/**
+ * AsyncLogger vs printf/fprintf：每次调用的耗时和最大持续写入速率
+ *
+ * 用法: logger_bench [threads=1,2,4] [count=1000000] [ring_records=65536]
+ *   每个线程写 count 条 "req %d took %.3f ms from %s status %u" 形式的日志，输出写到临时目录里的文件
+ *
+ * 四种方式：
+ *   alog-drop   AsyncLogger，环满时丢弃（默认配置）：热路径耗时，以及后台线程跟得上的比例
+ *   alog-block  AsyncLogger，环满时生产者等待：不丢日志时的最大持续速率
+ *   fprintf     所有线程共用一个带缓冲的 FILE*（stdio 内部加锁）
+ *   printf      stdout 临时重定向到文件
+ *
+ * 输出：
+ *   ns/call     每个线程 count 次调用的平均耗时
+ *   p50/p99/p999 每 16 次调用抽样一次单次调用耗时（rdtsc），单位 ns
+ *   Mrec/s      从开始到全部写进文件（AsyncLogger flush / fflush 返回）的记录速率
+ *   drop%       丢弃的比例；writevs 为后台线程的 writev 次数
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_logger.h"
+
+enum BenchMode {
+    kAlogDrop,
+    kAlogBlock,
+    kFprintf,
+    kPrintf,
+};
+
+static const char* mode_name(BenchMode mode) {
+    switch (mode) {
+        case kAlogDrop: return "alog-drop";
+        case kAlogBlock: return "alog-block";
+        case kFprintf: return "fprintf";
+        case kPrintf: return "printf";
+    }
+    return "?";
+}
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double calibrate_ns_per_tick() {
+    int64_t t0 = monotonic_ns();
+    uint64_t c0 = log_detail::ticks();
+    while (monotonic_ns() - t0 < 50000000) {
+    }
+    return (double)(monotonic_ns() - t0) / (double)(log_detail::ticks() - c0);
+}
+
+static const int kSampleEvery = 16;
+
+struct ThreadResult {
+    int64_t elapsed_ns;
+    std::vector<uint32_t> samples;  // 抽样的单次调用耗时（tick）
+};
+
+static void producer(BenchMode mode, AsyncLogger* log, FILE* file, int count, ThreadResult* r) {
+    r->samples.reserve(count / kSampleEvery + 1);
+    int64_t t0 = monotonic_ns();
+    for (int i = 0; i < count; ++i) {
+        double took = (i & 1023) * 0.001;
+        unsigned status = 200 + (i & 3);
+        bool sample = i % kSampleEvery == 0;
+        uint64_t c0 = sample ? log_detail::ticks() : 0;
+        switch (mode) {
+            case kAlogDrop:
+            case kAlogBlock:
+                ALOG_INFO(*log, "req %d took %.3f ms from %s status %u", i, took, "bench", status);
+                break;
+            case kFprintf:
+                fprintf(file, "req %d took %.3f ms from %s status %u\n", i, took, "bench", status);
+                break;
+            case kPrintf:
+                printf("req %d took %.3f ms from %s status %u\n", i, took, "bench", status);
+                break;
+        }
+        if (sample) {
+            uint64_t d = log_detail::ticks() - c0;
+            r->samples.push_back(d > 0xffffffffULL ? 0xffffffffU : (uint32_t)d);
+        }
+    }
+    r->elapsed_ns = monotonic_ns() - t0;
+}
+
+static void run(BenchMode mode, int threads, int count, size_t ring_records, const std::string& path,
+                double ns_per_tick) {
+    unlink(path.c_str());
+    LoggerOptions opts;
+    opts.ring_records = ring_records;
+    opts.block_when_full = mode == kAlogBlock;
+    AsyncLogger log(opts);
+    FILE* file = NULL;
+    int saved_stdout = -1;
+    if (mode == kAlogDrop || mode == kAlogBlock) {
+        if (log.open(path.c_str()) < 0) {
+            perror("open");
+            return;
+        }
+    } else if (mode == kFprintf) {
+        file = fopen(path.c_str(), "w");
+    } else {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+
+    std::vector<ThreadResult> results(threads);
+    std::vector<std::thread> workers;
+    int64_t t0 = monotonic_ns();
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(std::thread(producer, mode, &log, file, count, &results[i]));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    if (mode == kAlogDrop || mode == kAlogBlock) {
+        log.flush();
+    } else if (mode == kFprintf) {
+        fclose(file);
+    } else {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    int64_t total_ns = monotonic_ns() - t0;
+    log.close();
+
+    std::vector<uint32_t> samples;
+    double per_call = 0;
+    for (int i = 0; i < threads; ++i) {
+        samples.insert(samples.end(), results[i].samples.begin(), results[i].samples.end());
+        per_call += (double)results[i].elapsed_ns / count;
+    }
+    per_call /= threads;
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    double p50 = samples[n / 2] * ns_per_tick;
+    double p99 = samples[std::min(n - 1, n * 99 / 100)] * ns_per_tick;
+    double p999 = samples[std::min(n - 1, n * 999 / 1000)] * ns_per_tick;
+
+    uint64_t calls = (uint64_t)threads * count;
+    uint64_t written = calls;
+    double drop = 0;
+    unsigned long long writevs = 0;
+    if (mode == kAlogDrop || mode == kAlogBlock) {
+        LoggerStats st = log.stats();
+        written = st.records;
+        drop = 100.0 * st.dropped / calls;
+        writevs = st.writevs;
+    }
+    printf("%-10s %7d %10.1f %8.0f %8.0f %8.0f %9.2f %7.2f%% %8llu\n", mode_name(mode), threads, per_call, p50, p99,
+           p999, written / (total_ns / 1e3), drop, writevs);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> thread_counts;
+    const char* list = argc > 1 ? argv[1] : "1,2,4";
+    for (const char* p = list; *p != '\0';) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p) break;
+        if (v > 0) thread_counts.push_back((int)v);
+        p = *end == ',' ? end + 1 : end;
+    }
+    int count = argc > 2 ? atoi(argv[2]) : 1000000;
+    size_t ring_records = argc > 3 ? strtoul(argv[3], NULL, 10) : 65536;
+    if (thread_counts.empty() || count <= 0) {
+        fprintf(stderr, "用法: %s [threads=1,2,4] [count=1000000] [ring_records=65536]\n", argv[0]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/logger_bench.XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string path = std::string(dir) + "/bench.log";
+    double ns_per_tick = calibrate_ns_per_tick();
+
+    printf("每线程 %d 条日志, 环 %zu 条记录, CPU 数 %ld, 输出到 %s\n", count, ring_records,
+           sysconf(_SC_NPROCESSORS_ONLN), path.c_str());
+    printf("%-10s %7s %10s %8s %8s %8s %9s %8s %8s\n", "mode", "threads", "ns/call", "p50", "p99", "p999", "Mrec/s",
+           "drop%", "writevs");
+    static const BenchMode kModes[] = {kAlogDrop, kAlogBlock, kFprintf, kPrintf};
+    for (size_t t = 0; t < thread_counts.size(); ++t) {
+        for (size_t m = 0; m < sizeof(kModes) / sizeof(kModes[0]); ++m) {
+            run(kModes[m], thread_counts[t], count, ring_records, path, ns_per_tick);
+        }
+    }
+    unlink(path.c_str());
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * 父进程 RSS 对子进程启动速度的影响：从 10MB 到 10GB 的父进程里反复启动 /bin/true
+ *
+ * 用法: spawn_bench [-s sizes_mb] [-t seconds] [-n max_spawns] [-H]
+ *   -s  逗号分隔的父进程 RSS（MB），默认 10,100,1000,4000,10000；超过可用内存 80% 的跳过
+ *   -t  每种后端每个 RSS 最多跑多少秒，默认 1
+ *   -n  每种后端每个 RSS 最多启动多少次，默认 2000
+ *   -H  允许透明大页；默认 MADV_NOHUGEPAGE，页表按 4KB 页计，接近长期运行后碎片化的堆
+ *
+ * 每次启动 = spawn_process + waitpid，串行执行，输出每秒启动次数和平均每次的微秒数。
+ * 开始前先对每种后端做正确性检查（退出码、pidfd、exec 失败的 errno、重定向和 close_fds），不通过退出码为 1。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+#include "spawn_process.h"
+
+static const spawn_backend kBackends[] = {SPAWN_FORK, SPAWN_POSIX_SPAWN, SPAWN_VFORK, SPAWN_CLONE3};
+static const int kNumBackends = sizeof(kBackends) / sizeof(kBackends[0]);
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/** /proc/meminfo 里的 MemAvailable，单位 MB */
+static long mem_available_mb() {
+    FILE* f = fopen("/proc/meminfo", "r");
+    char line[256];
+    long kb = -1;
+    while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "MemAvailable: %ld kB", &kb) == 1) {
+            break;
+        }
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    return kb < 0 ? -1 : kb / 1024;
+}
+
+static long rss_mb() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    long size = 0, rss = 0;
+    if (f != NULL) {
+        if (fscanf(f, "%ld %ld", &size, &rss) != 2) {
+            rss = 0;
+        }
+        fclose(f);
+    }
+    return rss * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+static bool check(spawn_backend b) {
+    char sh[] = "/bin/sh", c[] = "-c", cmd[] = "exit 3";
+    char* argv[] = {sh, c, cmd, NULL};
+    int pidfd = -1;
+    pid_t pid = spawn_process(b, sh, argv, NULL, NULL, &pidfd);
+    int status = 0;
+    bool ok = pid > 0 && pidfd >= 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+              WEXITSTATUS(status) == 3;
+    if (pidfd >= 0) {
+        close(pidfd);
+    }
+
+    char missing[] = "/nonexistent/spawn_bench";
+    char* argv2[] = {missing, NULL};
+    errno = 0;
+    pid_t bad = spawn_process(b, missing, argv2, NULL, NULL, NULL);
+    int err = errno;
+    // exec 失败不能留下子进程
+    bool no_child = waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD;
+    ok &= bad == -1 && err == ENOENT && no_child;
+
+    // 重定向 + close_fds：故意留一个没有 CLOEXEC 的 fd，子进程里只应看到 0 1 2 和 ls 自己打开的目录
+    int p[2];
+    if (pipe(p) < 0) {
+        return false;
+    }
+    int leak = dup(p[1]);
+    spawn_attr attr;
+    spawn_attr_init(&attr);
+    attr.stdout_fd = p[1];
+    attr.close_fds = 1;
+    attr.reset_sigmask = 1;
+    char ls_cmd[] = "ls /proc/self/fd";
+    char* argv3[] = {sh, c, ls_cmd, NULL};
+    pid = spawn_process(b, sh, argv3, NULL, &attr, NULL);
+    close(p[1]);
+    close(leak);
+    char out[256] = {0};
+    ssize_t n = pid > 0 ? read(p[0], out, sizeof(out) - 1) : -1;
+    close(p[0]);
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    }
+    int fds = 0;
+    for (char* tok = strtok(out, " \n"); n > 0 && tok != NULL; tok = strtok(NULL, " \n")) {
+        ok &= atoi(tok) <= 3;
+        ++fds;
+    }
+    ok &= fds >= 3;
+    printf("  %-12s %s\n", spawn_backend_name(b), ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::string sizes_arg = "10,100,1000,4000,10000";
+    double seconds = 1;
+    int max_spawns = 2000;
+    bool thp = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:n:H")) != -1) {
+        switch (opt) {
+            case 's': sizes_arg = optarg; break;
+            case 't': seconds = atof(optarg); break;
+            case 'n': max_spawns = atoi(optarg); break;
+            case 'H': thp = true; break;
+            default:
+                fprintf(stderr, "用法: %s [-s sizes_mb] [-t seconds] [-n max_spawns] [-H]\n", argv[0]);
+                return 1;
+        }
+    }
+    std::vector<long> sizes;
+    for (char* tok = strtok(&sizes_arg[0], ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (atol(tok) > 0) {
+            sizes.push_back(atol(tok));
+        }
+    }
+
+    printf("正确性检查:\n");
+    bool all_ok = true;
+    for (int i = 0; i < kNumBackends; ++i) {
+        all_ok &= check(kBackends[i]);
+    }
+
+    char true_path[] = "/bin/true";
+    char* true_argv[] = {true_path, NULL};
+    printf("\n父进程 RSS 对启动 /bin/true 的影响（%s，每格最多 %.1fs / %d 次）\n", thp ? "允许大页" : "4KB 页", seconds,
+           max_spawns);
+    printf("%10s", "RSS(MB)");
+    for (int i = 0; i < kNumBackends; ++i) {
+        printf(" %13s/s %8s", spawn_backend_name(kBackends[i]), "us");
+    }
+    printf("\n");
+    long avail = mem_available_mb();
+    for (size_t si = 0; si < sizes.size(); ++si) {
+        long mb = sizes[si];
+        if (avail > 0 && mb > avail * 8 / 10) {
+            printf("%10ld  跳过：可用内存只有 %ld MB\n", mb, avail);
+            continue;
+        }
+        size_t bytes = (size_t)mb << 20;
+        void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            printf("%10ld  跳过：mmap 失败\n", mb);
+            continue;
+        }
+        madvise(mem, bytes, thp ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+        // 每页写一次，RSS 和页表都是实打实的
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t off = 0; off < bytes; off += page) {
+            static_cast<char*>(mem)[off] = 1;
+        }
+        printf("%10ld", rss_mb());
+        fflush(stdout);
+        for (int i = 0; i < kNumBackends; ++i) {
+            int n = 0;
+            int64_t start = now_ns(), limit = (int64_t)(seconds * 1e9);
+            while (n < max_spawns && now_ns() - start < limit) {
+                pid_t pid = spawn_process(kBackends[i], true_path, true_argv, NULL, NULL, NULL);
+                if (pid < 0) {
+                    perror(spawn_backend_name(kBackends[i]));
+                    return 1;
+                }
+                waitpid(pid, NULL, 0);
+                ++n;
+            }
+            double secs = (now_ns() - start) / 1e9;
+            printf(" %15.0f %8.1f", n / secs, secs * 1e6 / n);
+            fflush(stdout);
+        }
+        printf("\n");
+        munmap(mem, bytes);
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+#define _GNU_SOURCE
+#include "spawn_process.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/sched.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+/* 子进程需要的所有参数；共享内存的后端里子进程把 exec 的 errno 写回 err */
+struct spawn_ctx {
+    const char *path;
+    char *const *argv;
+    char *const *envp;
+    const spawn_attr *attr;
+    const sigset_t *child_mask;
+    int report_fd;     /* SPAWN_FORK：exec 失败时把 errno 写进这个 CLOEXEC 管道 */
+    volatile int err;
+};
+
+void spawn_attr_init(spawn_attr *attr) {
+    attr->stdin_fd = -1;
+    attr->stdout_fd = -1;
+    attr->stderr_fd = -1;
+    attr->close_fds = 0;
+    attr->new_session = 0;
+    attr->reset_sigmask = 0;
+}
+
+const char *spawn_backend_name(spawn_backend backend) {
+    switch (backend) {
+        case SPAWN_FORK: return "fork";
+        case SPAWN_POSIX_SPAWN: return "posix_spawn";
+        case SPAWN_VFORK: return "vfork";
+        case SPAWN_CLONE3: return "clone3";
+    }
+    return "?";
+}
+
+static int redirect(int fd, int target) {
+    if (fd < 0 || fd == target) {
+        /* 同一个 fd 时 dup2 什么也不做，但它可能带着 CLOEXEC，要清掉 */
+        return fd == target ? fcntl(fd, F_SETFD, 0) : 0;
+    }
+    return dup2(fd, target) < 0 ? -1 : 0;
+}
+
+/**
+ * 子进程里 exec 之前的准备，只用系统调用。失败或 exec 返回时记下 errno 并 _exit(127)，不会返回
+ */
+static void child_exec(struct spawn_ctx *ctx) {
+    const spawn_attr *a = ctx->attr;
+    int sig;
+    /* 父进程装了处理函数的信号恢复默认；忽略的信号保持忽略（和 exec 的语义一致） */
+    for (sig = 1; sig < _NSIG; ++sig) {
+        struct sigaction sa;
+        if (sig == SIGKILL || sig == SIGSTOP) {
+            continue;
+        }
+        /* glibc 内部用的两个实时信号会返回 EINVAL，正好跳过 */
+        if (sigaction(sig, NULL, &sa) == 0 && sa.sa_handler != SIG_DFL && sa.sa_handler != SIG_IGN) {
+            sa.sa_handler = SIG_DFL;
+            sa.sa_flags = 0;
+            sigemptyset(&sa.sa_mask);
+            sigaction(sig, &sa, NULL);
+        }
+    }
+    if (a->new_session && setsid() < 0) {
+        goto fail;
+    }
+    if (redirect(a->stdin_fd, 0) < 0 || redirect(a->stdout_fd, 1) < 0 || redirect(a->stderr_fd, 2) < 0) {
+        goto fail;
+    }
+    if (a->close_fds) {
+        /* 标成 CLOEXEC 而不是立即关闭：exec 失败时还要用报告错误的管道，exec 成功时内核一起关掉。
+         * 内核不支持 close_range（5.11 之前没有 CLOEXEC 标志）时退回逐个关，跳过报告管道 */
+        if (syscall(SYS_close_range, 3U, ~0U, CLOSE_RANGE_CLOEXEC) < 0) {
+            int fd, max = (int)sysconf(_SC_OPEN_MAX);
+            for (fd = 3; fd < max; ++fd) {
+                if (fd != ctx->report_fd) {
+                    close(fd);
+                }
+            }
+        }
+    }
+    sigprocmask(SIG_SETMASK, ctx->child_mask, NULL);
+    execve(ctx->path, ctx->argv, ctx->envp);
+fail:
+    ctx->err = errno;
+    if (ctx->report_fd >= 0) {
+        int e = errno;
+        ssize_t n = write(ctx->report_fd, &e, sizeof(e));
+        (void)n;
+    }
+    _exit(127);
+}
+
+#if defined(__x86_64__)
+/*
+ * clone3 的系统调用包装：子进程从新栈上开始执行，不能像 syscall() 那样返回到调用者，
+ * 所以直接在汇编里调用 fn(arg)，fn 不返回（child_exec 总是 exec 或 _exit）。
+ * rdi = args, rsi = size, rdx = fn, rcx = arg；syscall 会破坏 rcx 和 r11，arg 先挪到 r9
+ */
+long spawn_clone3_raw(struct clone_args *args, size_t size, void (*fn)(struct spawn_ctx *), struct spawn_ctx *arg);
+__asm__(
+    ".text\n"
+    ".globl spawn_clone3_raw\n"
+    ".hidden spawn_clone3_raw\n"
+    ".type spawn_clone3_raw, @function\n"
+    "spawn_clone3_raw:\n"
+    "    mov %rcx, %r9\n"
+    "    mov $435, %eax\n"
+    "    syscall\n"
+    "    test %rax, %rax\n"
+    "    jz 1f\n"
+    "    ret\n"
+    "1:  xor %ebp, %ebp\n"
+    "    mov %r9, %rdi\n"
+    "    call *%rdx\n"
+    "    mov $127, %edi\n"
+    "    mov $60, %eax\n"
+    "    syscall\n"
+    "    hlt\n"
+    ".size spawn_clone3_raw, .-spawn_clone3_raw\n");
+
+/* 子进程的栈：父线程在 CLONE_VFORK 返回之前一直挂起，用父线程栈上的一块就够了 */
+#define CLONE3_STACK_SIZE 32768
+
+static pid_t spawn_clone3(struct spawn_ctx *ctx, int *pidfd) {
+    char stack[CLONE3_STACK_SIZE] __attribute__((aligned(16)));
+    struct clone_args args;
+    int fd = -1;
+    long rc;
+    memset(&args, 0, sizeof(args));
+    args.flags = CLONE_VM | CLONE_VFORK | (pidfd != NULL ? CLONE_PIDFD : 0);
+    args.pidfd = (uint64_t)(uintptr_t)&fd;
+    args.exit_signal = SIGCHLD;
+    args.stack = (uint64_t)(uintptr_t)stack;
+    args.stack_size = sizeof(stack);
+    rc = spawn_clone3_raw(&args, sizeof(args), child_exec, ctx);
+    if (rc < 0) {
+        errno = (int)-rc;
+        return -1;
+    }
+    if (pidfd != NULL) {
+        *pidfd = fd;
+    }
+    return (pid_t)rc;
+}
+#else
+static pid_t spawn_clone3(struct spawn_ctx *ctx, int *pidfd) {
+    (void)ctx;
+    (void)pidfd;
+    errno = ENOSYS;
+    return -1;
+}
+#endif
+
+static pid_t spawn_posix(struct spawn_ctx *ctx) {
+    const spawn_attr *a = ctx->attr;
+    posix_spawnattr_t sa;
+    posix_spawn_file_actions_t fa;
+    sigset_t all;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    pid_t pid = -1;
+    int rc;
+    posix_spawnattr_init(&sa);
+    posix_spawn_file_actions_init(&fa);
+    /* glibc 只恢复 sigdefault 里装了处理函数的信号，给全集就是"所有装了处理函数的信号" */
+    sigfillset(&all);
+    posix_spawnattr_setsigdefault(&sa, &all);
+    posix_spawnattr_setsigmask(&sa, ctx->child_mask);
+    if (a->new_session) {
+        flags |= POSIX_SPAWN_SETSID;
+    }
+    posix_spawnattr_setflags(&sa, flags);
+    if (a->stdin_fd >= 0) posix_spawn_file_actions_adddup2(&fa, a->stdin_fd, 0);
+    if (a->stdout_fd >= 0) posix_spawn_file_actions_adddup2(&fa, a->stdout_fd, 1);
+    if (a->stderr_fd >= 0) posix_spawn_file_actions_adddup2(&fa, a->stderr_fd, 2);
+    if (a->close_fds) {
+        posix_spawn_file_actions_addclosefrom_np(&fa, 3);
+    }
+    rc = posix_spawn(&pid, ctx->path, &fa, &sa, ctx->argv, ctx->envp);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&sa);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return pid;
+}
+
+static pid_t spawn_fork(struct spawn_ctx *ctx) {
+    int p[2];
+    pid_t pid;
+    int e = 0;
+    ssize_t n;
+    if (pipe2(p, O_CLOEXEC) < 0) {
+        return -1;
+    }
+    pid = fork();
+    if (pid == 0) {
+        close(p[0]);
+        ctx->report_fd = p[1];
+        child_exec(ctx);
+    }
+    close(p[1]);
+    if (pid < 0) {
+        close(p[0]);
+        return -1;
+    }
+    /* exec 成功时管道随 CLOEXEC 关闭，读到 EOF；失败时读到 errno */
+    do {
+        n = read(p[0], &e, sizeof(e));
+    } while (n < 0 && errno == EINTR);
+    close(p[0]);
+    if (n == (ssize_t)sizeof(e)) {
+        waitpid(pid, NULL, 0);
+        errno = e;
+        return -1;
+    }
+    return pid;
+}
+
+pid_t spawn_process(spawn_backend backend, const char *path, char *const argv[], char *const envp[],
+                    const spawn_attr *attr, int *pidfd) {
+    spawn_attr def;
+    struct spawn_ctx ctx;
+    sigset_t all, old, empty;
+    pid_t pid;
+    int saved;
+    if (attr == NULL) {
+        spawn_attr_init(&def);
+        attr = &def;
+    }
+    if (pidfd != NULL) {
+        *pidfd = -1;
+    }
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.path = path;
+    ctx.argv = argv;
+    ctx.envp = envp != NULL ? envp : environ;
+    ctx.attr = attr;
+    ctx.report_fd = -1;
+
+    /* 屏蔽所有信号，直到子进程恢复了默认处理方式、设置好自己的屏蔽字 */
+    sigfillset(&all);
+    sigemptyset(&empty);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    ctx.child_mask = attr->reset_sigmask ? &empty : &old;
+
+    switch (backend) {
+        case SPAWN_FORK:
+            pid = spawn_fork(&ctx);
+            break;
+        case SPAWN_POSIX_SPAWN:
+            pid = spawn_posix(&ctx);
+            break;
+        case SPAWN_VFORK:
+            pid = vfork();
+            if (pid == 0) {
+                child_exec(&ctx);
+            }
+            break;
+        case SPAWN_CLONE3:
+            pid = spawn_clone3(&ctx, pidfd);
+            break;
+        default:
+            errno = EINVAL;
+            pid = -1;
+            break;
+    }
+    saved = errno;
+    if ((backend == SPAWN_VFORK || backend == SPAWN_CLONE3) && pid > 0 && ctx.err != 0) {
+        /* 子进程 exec 失败后已经 _exit(127)，收掉它 */
+        waitpid(pid, NULL, 0);
+        if (pidfd != NULL && *pidfd >= 0) {
+            close(*pidfd);
+            *pidfd = -1;
+        }
+        saved = ctx.err;
+        pid = -1;
+    }
+    if (pid > 0 && pidfd != NULL && *pidfd < 0) {
+        /*
+         * 只有子进程还没被回收时 pid 才不会被复用。别的线程在 waitpid(-1)（例如 SignalFd::reap_children），
+         * 或者 SIGCHLD 是 SIG_IGN（子进程退出即被回收）时，子进程可能在这之前就退出并被收掉，
+         * pid 被分给别的进程，pidfd_open 会拿到那个进程。这种情况下它不是我们的子进程，
+         * waitid(P_PIDFD) 返回 ECHILD，丢掉这个 pidfd；要完全避免这个窗口用 SPAWN_CLONE3
+         */
+        *pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+        siginfo_t si;
+        if (*pidfd >= 0 && waitid((idtype_t)P_PIDFD, (id_t)*pidfd, &si, WEXITED | WNOHANG | WNOWAIT) < 0 &&
+            errno == ECHILD) {
+            close(*pidfd);
+            *pidfd = -1;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    errno = saved;
+    return pid;
+}
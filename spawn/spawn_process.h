@@ -0,0 +1,70 @@
+#ifndef SPAWN_SPAWN_PROCESS_H
+#define SPAWN_SPAWN_PROCESS_H
+
+/**
+ * 启动子进程执行另一个程序（fork + exec 的替代品）
+ *
+ * fork 要复制父进程的整张页表并把所有可写页标成写时复制，父进程 RSS 越大越慢（GB 级是毫秒级），
+ * 之后子进程马上 exec，复制的东西全部白费。这里的几种后端都不复制地址空间：
+ *
+ *   SPAWN_FORK         fork + exec，作对照；exec 失败的 errno 经 CLOEXEC 管道传回
+ *   SPAWN_POSIX_SPAWN  glibc 的 posix_spawn（内部是 clone(CLONE_VM | CLONE_VFORK)）
+ *   SPAWN_VFORK        vfork + exec：子进程借用父进程的地址空间和栈，父线程挂起到子进程 exec 或退出
+ *   SPAWN_CLONE3       clone3(CLONE_VM | CLONE_VFORK)，子进程跑在父线程栈上划出的一块独立栈上，
+ *                      可以顺带用 CLONE_PIDFD 拿到 pidfd；只实现了 x86_64，其它架构返回 ENOSYS
+ *
+ * 和父进程共享内存的后端（后三种）在子进程里只做 exec 之前必需的系统调用，不碰 malloc/stdio：
+ *  - 父进程先屏蔽所有信号再创建子进程，子进程把父进程装了处理函数的信号恢复成默认，再设置自己的屏蔽字，
+ *    这样不会有信号处理函数在子进程里运行、改坏父进程的内存
+ *  - 标准输入输出重定向用 dup2，其余 fd 用 close_range 一次关掉（不用逐个 close 到 RLIMIT_NOFILE）
+ *  - exec 失败时把 errno 写进父进程能看到的变量（共享内存）然后 _exit(127)，
+ *    spawn_process 返回 -1 并设置 errno，不会留下一个要回收的子进程
+ *
+ * 所有后端都可以在多线程程序里使用。
+ */
+
+#include <signal.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SPAWN_FORK,
+    SPAWN_POSIX_SPAWN,
+    SPAWN_VFORK,
+    SPAWN_CLONE3,
+} spawn_backend;
+
+typedef struct {
+    int stdin_fd;       /* 子进程的标准输入，-1 表示继承 */
+    int stdout_fd;
+    int stderr_fd;
+    int close_fds;      /* 非 0 时关闭子进程里 >= 3 的所有 fd */
+    int new_session;    /* 非 0 时子进程 setsid() */
+    int reset_sigmask;  /* 非 0 时子进程的信号屏蔽字清空，否则继承调用线程的屏蔽字 */
+} spawn_attr;
+
+/** 默认属性：全部继承，不关 fd，不清屏蔽字（和 fork + exec 一样） */
+void spawn_attr_init(spawn_attr *attr);
+
+/**
+ * 用 backend 启动 path（不搜索 PATH），argv/envp 同 execve；envp 为 NULL 时用当前的 environ。
+ * attr 为 NULL 时用默认属性。pidfd 不为 NULL 时返回子进程的 pidfd（CLOEXEC）：
+ * SPAWN_CLONE3 用 CLONE_PIDFD 原子地拿到，其它后端在子进程创建后 pidfd_open；拿不到时为 -1。
+ * 后者要求这期间没有别人回收这个子进程：其它线程不调用 waitpid(-1)/wait()，SIGCHLD 不是 SIG_IGN。
+ * 否则 pid 可能已经被复用，发现拿到的不是自己的子进程时 pidfd 为 -1；需要可靠的 pidfd 时用 SPAWN_CLONE3。
+ * 成功返回子进程 pid；失败返回 -1 并设置 errno（包括 exec 失败）
+ */
+pid_t spawn_process(spawn_backend backend, const char *path, char *const argv[], char *const envp[],
+                    const spawn_attr *attr, int *pidfd);
+
+/** 后端的名字，用于输出 */
+const char *spawn_backend_name(spawn_backend backend);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SPAWN_SPAWN_PROCESS_H */
@@ -0,0 +1,515 @@
+#ifndef STRING_BLAKE3_H
+#define STRING_BLAKE3_H
+
+/**
+ * BLAKE3（普通哈希 + keyed 模式 + derive_key），只输出 32 字节。
+ *
+ * keyed 模式本身就是 MAC，不需要像 HMAC 那样对消息做两遍哈希，短消息时只有一次压缩（7 轮）。
+ * 但它不是在所有长度上都比 HMAC 快：hmac_bench 在 -march=native（SHA-NI + AVX2）下的结果是
+ *   32B     Blake3Mac ~110ns，Hmac<Sha256> ~180ns
+ *   256B~4KB  Blake3Mac 慢 1.1~1.8 倍：单块压缩串行，比不过硬件 SHA-256
+ *   64KB    Blake3Mac ~1.8GB/s，Hmac<Sha256> ~1.2GB/s
+ * 没有 SHA-NI 的机器上 SHA-256 是纯软件实现，BLAKE3 在各个长度上都更快。
+ * 对外接口与 digest.h 中的摘要一致：kBlockSize / kDigestSize / update / final。
+ *
+ * 和 digest.h 一样在编译期选择实现：
+ *   -msse4.1  单次压缩按行放进 4 个 XMM 寄存器（对角化），所有长度都受益
+ *   -mavx2    1KB 的 chunk 互相独立，8 个 chunk 放进 YMM 的 8 个 lane 同时压缩，
+ *             消息超过 3KB 才用得上；更短的消息仍然只能一块一块串行压缩
+ * 不开这些选项时退回可移植的标量实现。
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <array>
+#include <string>
+#if defined(__SSE4_1__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "digest.h"
+
+namespace digest {
+
+class Blake3 {
+public:
+    static constexpr size_t kBlockSize = 64;
+    static constexpr size_t kChunkSize = 1024;
+    static constexpr size_t kDigestSize = 32;
+    static constexpr size_t kKeySize = 32;
+    typedef std::array<uint8_t, kDigestSize> Result;
+
+    /** 普通哈希模式 */
+    Blake3() : flags_(0) {
+        memcpy(key_, kIV, sizeof(key_));
+        reset();
+    }
+
+    /** keyed 模式，key 固定 32 字节 */
+    explicit Blake3(const uint8_t key[kKeySize]) : flags_(kKeyedHash) {
+        for (int i = 0; i < 8; ++i) {
+            key_[i] = load_le<uint32_t>(key + 4 * i);
+        }
+        reset();
+    }
+
+    /**
+     * derive_key 模式：从任意长度的密钥材料派生 32 字节密钥。
+     * context 是写死在代码里、全局唯一的字符串，不同用途用不同 context 得到互不相关的密钥
+     */
+    static void derive_key(const char* context, const void* material, size_t len, uint8_t out[kKeySize]) {
+        Blake3 ctx_hasher(kIV, kDeriveKeyContext);
+        ctx_hasher.update(context, strlen(context));
+        uint8_t context_key[kKeySize];
+        ctx_hasher.final(context_key);
+
+        uint32_t words[8];
+        for (int i = 0; i < 8; ++i) {
+            words[i] = load_le<uint32_t>(context_key + 4 * i);
+        }
+        Blake3 h(words, kDeriveKeyMaterial);
+        h.update(material, len);
+        h.final(out);
+    }
+
+    void reset() {
+        stack_len_ = 0;
+        chunk_counter_ = 0;
+        start_chunk();
+    }
+
+    void update(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (len > 0) {
+            if (chunk_len() == kChunkSize) {
+                uint32_t cv[8];
+                chunk_output().chaining_value(cv);
+                ++chunk_counter_;
+                push_chunk_cv(cv, chunk_counter_);
+                start_chunk();
+            }
+#ifdef __AVX2__
+            // 位于 chunk 边界、后面还有至少 3 个完整 chunk 时成批压缩：一批的耗时和 8 个 chunk 一样，
+            // 只有 2 个时不如串行。最后一个 chunk 必须留给 final()：它可能是根节点，要带 ROOT 标志
+            if (chunk_len() == 0 && len > 3 * kChunkSize) {
+                size_t n = (len - 1) / kChunkSize;
+                n = n < 8 ? n : 8;
+                uint32_t cvs[8][8];
+                hash8_chunks(p, n, chunk_counter_, cvs);
+                for (size_t i = 0; i < n; ++i) {
+                    ++chunk_counter_;
+                    push_chunk_cv(cvs[i], chunk_counter_);
+                }
+                p += n * kChunkSize;
+                len -= n * kChunkSize;
+                continue;
+            }
+#endif
+            if (block_len_ == kBlockSize) {
+                uint32_t out[16];
+                compress(cv_, buf_, chunk_counter_, kBlockSize, flags_ | start_flag(), out);
+                memcpy(cv_, out, sizeof(cv_));
+                ++blocks_compressed_;
+                block_len_ = 0;
+            }
+            // 整块直接从输入压缩，不经过 buf_；chunk 的最后一块和整个消息的最后一块留给 chunk_output()
+            while (block_len_ == 0 && len > kBlockSize && blocks_compressed_ + 1 < kChunkSize / kBlockSize) {
+                uint32_t out[16];
+                compress(cv_, p, chunk_counter_, kBlockSize, flags_ | start_flag(), out);
+                memcpy(cv_, out, sizeof(cv_));
+                ++blocks_compressed_;
+                p += kBlockSize;
+                len -= kBlockSize;
+            }
+            size_t room = kBlockSize - block_len_;
+            size_t take = room < len ? room : len;
+            memcpy(buf_ + block_len_, p, take);
+            block_len_ += take;
+            p += take;
+            len -= take;
+        }
+    }
+
+    void final(uint8_t* out) {
+        Output o = chunk_output();
+        for (size_t i = stack_len_; i > 0; --i) {
+            uint32_t right[8];
+            o.chaining_value(right);
+            o = parent_output(stack_[i - 1], right);
+        }
+        o.root_bytes(out);
+    }
+
+private:
+    enum {
+        kChunkStart = 1 << 0,
+        kChunkEnd = 1 << 1,
+        kParent = 1 << 2,
+        kRoot = 1 << 3,
+        kKeyedHash = 1 << 4,
+        kDeriveKeyContext = 1 << 5,
+        kDeriveKeyMaterial = 1 << 6,
+    };
+
+    Blake3(const uint32_t key[8], uint32_t flags) : flags_(flags) {
+        memcpy(key_, key, sizeof(key_));
+        reset();
+    }
+
+    static constexpr uint32_t kIV[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    static constexpr uint8_t kPermutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+    /** 每一轮使用的消息字顺序，即 kPermutation 反复作用的结果 */
+    static constexpr uint8_t kSchedule[7][16] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+        {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+        {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+        {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+        {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+        {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+        {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+    };
+
+    static void g(uint32_t* s, int a, int b, int c, int d, uint32_t x, uint32_t y) {
+        s[a] = s[a] + s[b] + x;
+        s[d] = rotr32(s[d] ^ s[a], 16);
+        s[c] = s[c] + s[d];
+        s[b] = rotr32(s[b] ^ s[c], 12);
+        s[a] = s[a] + s[b] + y;
+        s[d] = rotr32(s[d] ^ s[a], 8);
+        s[c] = s[c] + s[d];
+        s[b] = rotr32(s[b] ^ s[c], 7);
+    }
+
+#ifdef __SSE4_1__
+    static __m128i rotr16(__m128i x) {
+        return _mm_shuffle_epi8(x, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+    }
+    static __m128i rotr8(__m128i x) {
+        return _mm_shuffle_epi8(x, _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+    }
+
+    /** 一行 4 个 G 同时算：先对列，对角化之后再对对角线 */
+    static void g4(__m128i& a, __m128i& b, __m128i& c, __m128i& d, __m128i x, __m128i y) {
+        a = _mm_add_epi32(_mm_add_epi32(a, b), x);
+        d = rotr16(_mm_xor_si128(d, a));
+        c = _mm_add_epi32(c, d);
+        b = _mm_xor_si128(b, c);
+        b = _mm_or_si128(_mm_srli_epi32(b, 12), _mm_slli_epi32(b, 20));
+        a = _mm_add_epi32(_mm_add_epi32(a, b), y);
+        d = rotr8(_mm_xor_si128(d, a));
+        c = _mm_add_epi32(c, d);
+        b = _mm_xor_si128(b, c);
+        b = _mm_or_si128(_mm_srli_epi32(b, 7), _mm_slli_epi32(b, 25));
+    }
+
+    static __m128i shuffle2(__m128i a, __m128i b, int imm) {
+        return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), imm));
+    }
+
+    static void compress(const uint32_t cv[8], const uint8_t block[kBlockSize], uint64_t counter,
+                         uint32_t block_len, uint32_t flags, uint32_t out[16]) {
+        __m128i a = _mm_loadu_si128((const __m128i*)&cv[0]);
+        __m128i b = _mm_loadu_si128((const __m128i*)&cv[4]);
+        __m128i c = _mm_loadu_si128((const __m128i*)&kIV[0]);
+        __m128i d = _mm_set_epi32((int)flags, (int)block_len, (int)(counter >> 32), (int)counter);
+        __m128i m0 = _mm_loadu_si128((const __m128i*)(block + 0));
+        __m128i m1 = _mm_loadu_si128((const __m128i*)(block + 16));
+        __m128i m2 = _mm_loadu_si128((const __m128i*)(block + 32));
+        __m128i m3 = _mm_loadu_si128((const __m128i*)(block + 48));
+        // 第一轮把消息字从原始顺序排成 4 组，之后每轮对上一轮的 4 组做同一个固定置换（kPermutation），
+        // 全程在寄存器里完成。对角化时转的是 a 而不是 b，所以对角线那两组也相应地转了一个字
+        __m128i t0 = shuffle2(m0, m1, _MM_SHUFFLE(2, 0, 2, 0));                              //  6  4  2  0
+        __m128i t1 = shuffle2(m0, m1, _MM_SHUFFLE(3, 1, 3, 1));                              //  7  5  3  1
+        __m128i t2 = _mm_shuffle_epi32(shuffle2(m2, m3, _MM_SHUFFLE(2, 0, 2, 0)), _MM_SHUFFLE(2, 1, 0, 3));  // 12 10  8 14
+        __m128i t3 = _mm_shuffle_epi32(shuffle2(m2, m3, _MM_SHUFFLE(3, 1, 3, 1)), _MM_SHUFFLE(2, 1, 0, 3));  // 13 11  9 15
+        for (int r = 0; r < 7; ++r) {
+            if (r > 0) {
+                m0 = t0;
+                m1 = t1;
+                m2 = t2;
+                m3 = t3;
+                t0 = _mm_shuffle_epi32(shuffle2(m0, m1, _MM_SHUFFLE(3, 1, 1, 2)), _MM_SHUFFLE(0, 3, 2, 1));
+                t1 = _mm_blend_epi16(_mm_shuffle_epi32(m0, _MM_SHUFFLE(0, 0, 3, 3)),
+                                     shuffle2(m2, m3, _MM_SHUFFLE(3, 3, 2, 2)), 0xCC);
+                t2 = _mm_shuffle_epi32(_mm_blend_epi16(_mm_unpacklo_epi64(m3, m1), m2, 0xC0),
+                                       _MM_SHUFFLE(1, 3, 2, 0));
+                t3 = _mm_shuffle_epi32(_mm_unpacklo_epi32(m2, _mm_unpackhi_epi32(m1, m3)), _MM_SHUFFLE(0, 1, 3, 2));
+            }
+            g4(a, b, c, d, t0, t1);
+            a = _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 1, 0, 3));
+            d = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            c = _mm_shuffle_epi32(c, _MM_SHUFFLE(0, 3, 2, 1));
+            g4(a, b, c, d, t2, t3);
+            a = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 2, 1));
+            d = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            c = _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 1, 0, 3));
+        }
+        _mm_storeu_si128((__m128i*)&out[0], _mm_xor_si128(a, c));
+        _mm_storeu_si128((__m128i*)&out[4], _mm_xor_si128(b, d));
+        _mm_storeu_si128((__m128i*)&out[8], _mm_xor_si128(c, _mm_loadu_si128((const __m128i*)&cv[0])));
+        _mm_storeu_si128((__m128i*)&out[12], _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)&cv[4])));
+    }
+#else
+    static void compress(const uint32_t cv[8], const uint8_t block[kBlockSize], uint64_t counter,
+                         uint32_t block_len, uint32_t flags, uint32_t out[16]) {
+        uint32_t m[16];
+        for (int i = 0; i < 16; ++i) {
+            m[i] = load_le<uint32_t>(block + 4 * i);
+        }
+        uint32_t s[16] = {
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            kIV[0], kIV[1], kIV[2], kIV[3],
+            (uint32_t)counter, (uint32_t)(counter >> 32), block_len, flags,
+        };
+        for (int r = 0; r < 7; ++r) {
+            g(s, 0, 4, 8, 12, m[0], m[1]);
+            g(s, 1, 5, 9, 13, m[2], m[3]);
+            g(s, 2, 6, 10, 14, m[4], m[5]);
+            g(s, 3, 7, 11, 15, m[6], m[7]);
+            g(s, 0, 5, 10, 15, m[8], m[9]);
+            g(s, 1, 6, 11, 12, m[10], m[11]);
+            g(s, 2, 7, 8, 13, m[12], m[13]);
+            g(s, 3, 4, 9, 14, m[14], m[15]);
+            if (r < 6) {
+                uint32_t t[16];
+                for (int i = 0; i < 16; ++i) {
+                    t[i] = m[kPermutation[i]];
+                }
+                memcpy(m, t, sizeof(m));
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            out[i] = s[i] ^ s[i + 8];
+            out[i + 8] = s[i + 8] ^ cv[i];
+        }
+    }
+#endif
+
+#ifdef __AVX2__
+    static __m256i rotr16(__m256i x) {
+        const __m256i mask = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2, 13, 12, 15, 14,
+                                             9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+        return _mm256_shuffle_epi8(x, mask);
+    }
+    static __m256i rotr8(__m256i x) {
+        const __m256i mask = _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1, 12, 15, 14, 13,
+                                             8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1);
+        return _mm256_shuffle_epi8(x, mask);
+    }
+
+    static void g8(__m256i* v, int a, int b, int c, int d, __m256i x, __m256i y) {
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x);
+        v[d] = rotr16(_mm256_xor_si256(v[d], v[a]));
+        v[c] = _mm256_add_epi32(v[c], v[d]);
+        v[b] = _mm256_xor_si256(v[b], v[c]);
+        v[b] = _mm256_or_si256(_mm256_srli_epi32(v[b], 12), _mm256_slli_epi32(v[b], 20));
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y);
+        v[d] = rotr8(_mm256_xor_si256(v[d], v[a]));
+        v[c] = _mm256_add_epi32(v[c], v[d]);
+        v[b] = _mm256_xor_si256(v[b], v[c]);
+        v[b] = _mm256_or_si256(_mm256_srli_epi32(v[b], 7), _mm256_slli_epi32(v[b], 25));
+    }
+
+    /** 8x8 转置：输入第 i 行是第 i 个 lane 的 8 个字，输出第 j 行是 8 个 lane 的第 j 个字 */
+    static void transpose8(__m256i* v) {
+        __m256i ab0 = _mm256_unpacklo_epi32(v[0], v[1]), ab1 = _mm256_unpackhi_epi32(v[0], v[1]);
+        __m256i cd0 = _mm256_unpacklo_epi32(v[2], v[3]), cd1 = _mm256_unpackhi_epi32(v[2], v[3]);
+        __m256i ef0 = _mm256_unpacklo_epi32(v[4], v[5]), ef1 = _mm256_unpackhi_epi32(v[4], v[5]);
+        __m256i gh0 = _mm256_unpacklo_epi32(v[6], v[7]), gh1 = _mm256_unpackhi_epi32(v[6], v[7]);
+        __m256i abcd0 = _mm256_unpacklo_epi64(ab0, cd0), abcd1 = _mm256_unpackhi_epi64(ab0, cd0);
+        __m256i abcd2 = _mm256_unpacklo_epi64(ab1, cd1), abcd3 = _mm256_unpackhi_epi64(ab1, cd1);
+        __m256i efgh0 = _mm256_unpacklo_epi64(ef0, gh0), efgh1 = _mm256_unpackhi_epi64(ef0, gh0);
+        __m256i efgh2 = _mm256_unpacklo_epi64(ef1, gh1), efgh3 = _mm256_unpackhi_epi64(ef1, gh1);
+        v[0] = _mm256_permute2x128_si256(abcd0, efgh0, 0x20);
+        v[1] = _mm256_permute2x128_si256(abcd1, efgh1, 0x20);
+        v[2] = _mm256_permute2x128_si256(abcd2, efgh2, 0x20);
+        v[3] = _mm256_permute2x128_si256(abcd3, efgh3, 0x20);
+        v[4] = _mm256_permute2x128_si256(abcd0, efgh0, 0x31);
+        v[5] = _mm256_permute2x128_si256(abcd1, efgh1, 0x31);
+        v[6] = _mm256_permute2x128_si256(abcd2, efgh2, 0x31);
+        v[7] = _mm256_permute2x128_si256(abcd3, efgh3, 0x31);
+    }
+
+    /**
+     * 同时压缩 n (<= 8) 个连续的完整 chunk，第 i 个的计数器是 counter + i。
+     * 不足 8 个时空闲的 lane 重复算第 0 个 chunk，结果丢弃
+     */
+    void hash8_chunks(const uint8_t* input, size_t n, uint64_t counter, uint32_t cvs[8][8]) const {
+        const uint8_t* in[8];
+        uint32_t lo[8], hi[8];
+        for (size_t i = 0; i < 8; ++i) {
+            size_t lane = i < n ? i : 0;
+            in[i] = input + lane * kChunkSize;
+            lo[i] = (uint32_t)(counter + lane);
+            hi[i] = (uint32_t)((counter + lane) >> 32);
+        }
+        __m256i h[8];
+        for (int i = 0; i < 8; ++i) {
+            h[i] = _mm256_set1_epi32((int)key_[i]);
+        }
+        const __m256i counter_lo = _mm256_loadu_si256((const __m256i*)lo);
+        const __m256i counter_hi = _mm256_loadu_si256((const __m256i*)hi);
+        const size_t blocks = kChunkSize / kBlockSize;
+        for (size_t blk = 0; blk < blocks; ++blk) {
+            __m256i m[16];
+            for (int i = 0; i < 8; ++i) {
+                m[i] = _mm256_loadu_si256((const __m256i*)(in[i] + blk * kBlockSize));
+                m[i + 8] = _mm256_loadu_si256((const __m256i*)(in[i] + blk * kBlockSize + 32));
+            }
+            transpose8(m);
+            transpose8(m + 8);
+            uint32_t flags = flags_ | (blk == 0 ? kChunkStart : 0) | (blk == blocks - 1 ? kChunkEnd : 0);
+            __m256i v[16] = {
+                h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                _mm256_set1_epi32((int)kIV[0]), _mm256_set1_epi32((int)kIV[1]),
+                _mm256_set1_epi32((int)kIV[2]), _mm256_set1_epi32((int)kIV[3]),
+                counter_lo, counter_hi, _mm256_set1_epi32((int)kBlockSize), _mm256_set1_epi32((int)flags),
+            };
+#pragma GCC unroll 7
+            for (int r = 0; r < 7; ++r) {
+                const uint8_t* s = kSchedule[r];
+                g8(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+                g8(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+                g8(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+                g8(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+                g8(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+                g8(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+                g8(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+                g8(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+            }
+            for (int i = 0; i < 8; ++i) {
+                h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+            }
+        }
+        transpose8(h);
+        for (size_t i = 0; i < n; ++i) {
+            _mm256_storeu_si256((__m256i*)cvs[i], h[i]);
+        }
+    }
+#endif
+
+    /** 尚未决定是否为根节点的最后一次压缩的输入 */
+    struct Output {
+        uint32_t cv[8];
+        uint8_t block[kBlockSize];
+        uint64_t counter;
+        uint32_t block_len;
+        uint32_t flags;
+
+        void chaining_value(uint32_t out[8]) const {
+            uint32_t full[16];
+            compress(cv, block, counter, block_len, flags, full);
+            memcpy(out, full, 8 * sizeof(uint32_t));
+        }
+        void root_bytes(uint8_t out[kDigestSize]) const {
+            uint32_t full[16];
+            compress(cv, block, 0, block_len, flags | kRoot, full);
+            for (int i = 0; i < 8; ++i) {
+                store_le<uint32_t>(out + 4 * i, full[i]);
+            }
+        }
+    };
+
+    size_t chunk_len() const { return blocks_compressed_ * kBlockSize + block_len_; }
+    uint32_t start_flag() const { return blocks_compressed_ == 0 ? kChunkStart : 0; }
+
+    void start_chunk() {
+        memcpy(cv_, key_, sizeof(cv_));
+        block_len_ = 0;
+        blocks_compressed_ = 0;
+    }
+
+    Output chunk_output() const {
+        Output o;
+        memcpy(o.cv, cv_, sizeof(o.cv));
+        memcpy(o.block, buf_, block_len_);
+        memset(o.block + block_len_, 0, kBlockSize - block_len_);
+        o.counter = chunk_counter_;
+        o.block_len = (uint32_t)block_len_;
+        o.flags = flags_ | start_flag() | kChunkEnd;
+        return o;
+    }
+
+    Output parent_output(const uint32_t left[8], const uint32_t right[8]) const {
+        Output o;
+        memcpy(o.cv, key_, sizeof(o.cv));
+        for (int i = 0; i < 8; ++i) {
+            store_le<uint32_t>(o.block + 4 * i, left[i]);
+            store_le<uint32_t>(o.block + 32 + 4 * i, right[i]);
+        }
+        o.counter = 0;
+        o.block_len = kBlockSize;
+        o.flags = flags_ | kParent;
+        return o;
+    }
+
+    /** total_chunks 末尾有几个 0，就向上合并几次（惰性合并，保证最后一个 chunk 不会被提前合并） */
+    void push_chunk_cv(uint32_t cv[8], uint64_t total_chunks) {
+        while ((total_chunks & 1) == 0) {
+            parent_output(stack_[--stack_len_], cv).chaining_value(cv);
+            total_chunks >>= 1;
+        }
+        memcpy(stack_[stack_len_++], cv, 8 * sizeof(uint32_t));
+    }
+
+    uint32_t key_[8];
+    uint32_t flags_;
+    uint32_t cv_[8];
+    uint8_t buf_[kBlockSize];
+    size_t block_len_;
+    size_t blocks_compressed_;
+    uint64_t chunk_counter_;
+    uint32_t stack_[54][8];
+    size_t stack_len_;
+};
+
+/**
+ * BLAKE3 keyed 模式 MAC，构造函数和 sign/verify 与 Hmac<Digest> 相同
+ *
+ * keyed 模式要求正好 32 字节的均匀随机密钥。(key, len) / std::string 构造函数接受任意长度的密钥，
+ * 先用 derive_key 把它派生成 32 字节再用；所以同样 32 字节的密钥，两种构造函数得到的 MAC 不同。
+ * 和 HMAC 一样，派生不会让弱口令变强，密钥本身仍应是随机的。
+ */
+class Blake3Mac {
+public:
+    static constexpr size_t kDigestSize = Blake3::kDigestSize;
+    typedef Blake3::Result Result;
+
+    /** 原始 32 字节密钥，直接作为 keyed 模式的密钥 */
+    explicit Blake3Mac(const uint8_t key[Blake3::kKeySize]) {
+        memcpy(key_, key, sizeof(key_));
+    }
+
+    /** 任意长度的密钥，经 derive_key 派生 */
+    Blake3Mac(const void* key, size_t key_len) {
+        Blake3::derive_key("digest::Blake3Mac 2026-10 key derivation", key, key_len, key_);
+    }
+
+    explicit Blake3Mac(const std::string& key) : Blake3Mac(key.data(), key.size()) {}
+
+    // 每次现构造而不是拷贝预先建好的 Blake3：后者带着 1.7KB 的 CV 栈
+    Result sign(const void* msg, size_t len) const {
+        Blake3 h(key_);
+        h.update(msg, len);
+        Result r;
+        h.final(r.data());
+        return r;
+    }
+
+    Result sign(const std::string& msg) const { return sign(msg.data(), msg.size()); }
+
+    bool verify(const void* msg, size_t len, const Result& mac) const {
+        return constant_time_equal(sign(msg, len).data(), mac.data(), kDigestSize);
+    }
+
+private:
+    uint8_t key_[Blake3::kKeySize];
+};
+
+}  // namespace digest
+
+#endif  // STRING_BLAKE3_H
@@ -0,0 +1,455 @@
+#ifndef STRING_DIGEST_H
+#define STRING_DIGEST_H
+
+/**
+ * 编译期确定参数的摘要算法：SHA-256 / SHA-512 / BLAKE2s / BLAKE2b
+ *
+ * 与 EVP_MD 指针在运行期选择算法不同，这里分组长度、摘要长度、压缩函数
+ * 都是模板参数里的常量/静态函数，调用方（例如 Hmac<Digest>）实例化后
+ * 压缩函数可以被完全内联，上下文也是可平凡拷贝的普通结构体。
+ *
+ * 统一接口：
+ *   kBlockSize / kDigestSize
+ *   void reset();
+ *   void update(const void* data, size_t len);
+ *   void final(uint8_t* out);            // 写出 kDigestSize 字节
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <array>
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+#define DIGEST_HAVE_SHA_NI 1
+#endif
+
+namespace digest {
+
+inline uint32_t rotr32(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+inline uint64_t rotr64(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+inline uint32_t load_be(const uint8_t* p, uint32_t) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+inline uint64_t load_be(const uint8_t* p, uint64_t) {
+    return (uint64_t)load_be(p, uint32_t()) << 32 | load_be(p + 4, uint32_t());
+}
+template <typename Word>
+inline void store_be(uint8_t* p, Word v) {
+    for (size_t i = 0; i < sizeof(Word); ++i) {
+        p[i] = (uint8_t)(v >> (8 * (sizeof(Word) - 1 - i)));
+    }
+}
+
+template <typename Word>
+inline Word load_le(const uint8_t* p) {
+    Word v;
+    memcpy(&v, p, sizeof(v));  // x86/ARM 小端，直接拷贝
+    return v;
+}
+template <typename Word>
+inline void store_le(uint8_t* p, Word v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+/**
+ * 定长比较，耗时与第一个不同字节的位置无关，校验 MAC 时防止计时侧信道
+ */
+inline bool constant_time_equal(const uint8_t* a, const uint8_t* b, size_t len) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * Merkle–Damgård 结构的通用缓冲/填充逻辑，压缩函数由 Traits 提供
+ */
+template <class Traits>
+class MdHash {
+public:
+    typedef typename Traits::Word Word;
+    static constexpr size_t kBlockSize = Traits::kBlockSize;
+    static constexpr size_t kDigestSize = Traits::kDigestSize;
+    typedef std::array<uint8_t, kDigestSize> Result;
+
+    MdHash() { reset(); }
+
+    void reset() {
+        memcpy(h_, Traits::kInit, sizeof(h_));
+        total_ = 0;
+        used_ = 0;
+    }
+
+    void update(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        total_ += len;
+        if (used_ > 0) {
+            size_t take = kBlockSize - used_ < len ? kBlockSize - used_ : len;
+            memcpy(buf_ + used_, p, take);
+            used_ += take;
+            p += take;
+            len -= take;
+            if (used_ < kBlockSize) {
+                return;
+            }
+            Traits::compress(h_, buf_);
+            used_ = 0;
+        }
+        // 整块直接从输入压缩，不经过缓冲区
+        for (; len >= kBlockSize; p += kBlockSize, len -= kBlockSize) {
+            Traits::compress(h_, p);
+        }
+        memcpy(buf_, p, len);
+        used_ = len;
+    }
+
+    void final(uint8_t* out) {
+        uint64_t bits = total_ * 8;
+        buf_[used_++] = 0x80;
+        if (used_ > kBlockSize - Traits::kLengthSize) {
+            memset(buf_ + used_, 0, kBlockSize - used_);
+            Traits::compress(h_, buf_);
+            used_ = 0;
+        }
+        // 长度字段只用到低 64 位，SHA-512 的高 64 位恒为 0
+        memset(buf_ + used_, 0, kBlockSize - 8 - used_);
+        store_be<uint64_t>(buf_ + kBlockSize - 8, bits);
+        Traits::compress(h_, buf_);
+        for (size_t i = 0; i < kDigestSize / sizeof(Word); ++i) {
+            store_be<Word>(out + i * sizeof(Word), h_[i]);
+        }
+    }
+
+private:
+    Word h_[8];
+    uint64_t total_;
+    size_t used_;
+    uint8_t buf_[kBlockSize];
+};
+
+struct Sha256Traits {
+    typedef uint32_t Word;
+    static constexpr size_t kBlockSize = 64;
+    static constexpr size_t kDigestSize = 32;
+    static constexpr size_t kLengthSize = 8;
+    static constexpr Word kInit[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    static constexpr Word kK[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    static Word s0(Word x) { return rotr32(x, 2) ^ rotr32(x, 13) ^ rotr32(x, 22); }
+    static Word s1(Word x) { return rotr32(x, 6) ^ rotr32(x, 11) ^ rotr32(x, 25); }
+    static Word g0(Word x) { return rotr32(x, 7) ^ rotr32(x, 18) ^ (x >> 3); }
+    static Word g1(Word x) { return rotr32(x, 17) ^ rotr32(x, 19) ^ (x >> 10); }
+    static constexpr int kRounds = 64;
+
+    static void compress(Word h[8], const uint8_t* block);
+};
+
+struct Sha512Traits {
+    typedef uint64_t Word;
+    static constexpr size_t kBlockSize = 128;
+    static constexpr size_t kDigestSize = 64;
+    static constexpr size_t kLengthSize = 16;
+    static constexpr Word kInit[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+    };
+    static constexpr Word kK[80] = {
+        0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+        0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+        0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+        0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+        0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+        0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+        0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+        0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+        0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+        0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+        0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+        0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+        0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+        0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+        0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+        0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+        0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+        0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+        0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+        0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+    };
+
+    static Word s0(Word x) { return rotr64(x, 28) ^ rotr64(x, 34) ^ rotr64(x, 39); }
+    static Word s1(Word x) { return rotr64(x, 14) ^ rotr64(x, 18) ^ rotr64(x, 41); }
+    static Word g0(Word x) { return rotr64(x, 1) ^ rotr64(x, 8) ^ (x >> 7); }
+    static Word g1(Word x) { return rotr64(x, 19) ^ rotr64(x, 61) ^ (x >> 6); }
+    static constexpr int kRounds = 80;
+
+    static void compress(Word h[8], const uint8_t* block);
+};
+
+/**
+ * SHA-2 压缩函数：16 个字的滚动消息调度 + 每次循环展开 8 轮，
+ * 通过轮换变量名代替 a..h 的整体搬移
+ */
+template <class T>
+inline void sha2_compress(typename T::Word h[8], const uint8_t* block) {
+    typedef typename T::Word Word;
+    Word w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = load_be(block + i * sizeof(Word), Word());
+    }
+    Word a = h[0], b = h[1], c = h[2], d = h[3];
+    Word e = h[4], f = h[5], g = h[6], hh = h[7];
+
+#define SHA2_ROUND(a, b, c, d, e, f, g, h, i, wi)                                \
+    do {                                                                         \
+        Word t1 = h + T::s1(e) + ((e & f) ^ (~e & g)) + T::kK[i] + (wi);         \
+        Word t2 = T::s0(a) + ((a & b) ^ (a & c) ^ (b & c));                      \
+        d += t1;                                                                 \
+        h = t1 + t2;                                                             \
+    } while (0)
+#define SHA2_W(i) (w[(i) & 15] += T::g1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + T::g0(w[((i) - 15) & 15]))
+#define SHA2_8ROUNDS(i, W)                                   \
+    do {                                                     \
+        SHA2_ROUND(a, b, c, d, e, f, g, hh, i + 0, W(i + 0)); \
+        SHA2_ROUND(hh, a, b, c, d, e, f, g, i + 1, W(i + 1)); \
+        SHA2_ROUND(g, hh, a, b, c, d, e, f, i + 2, W(i + 2)); \
+        SHA2_ROUND(f, g, hh, a, b, c, d, e, i + 3, W(i + 3)); \
+        SHA2_ROUND(e, f, g, hh, a, b, c, d, i + 4, W(i + 4)); \
+        SHA2_ROUND(d, e, f, g, hh, a, b, c, i + 5, W(i + 5)); \
+        SHA2_ROUND(c, d, e, f, g, hh, a, b, i + 6, W(i + 6)); \
+        SHA2_ROUND(b, c, d, e, f, g, hh, a, i + 7, W(i + 7)); \
+    } while (0)
+#define SHA2_W0(i) w[i]
+
+    // 前 16 轮直接使用消息字，之后才需要滚动扩展
+    SHA2_8ROUNDS(0, SHA2_W0);
+    SHA2_8ROUNDS(8, SHA2_W0);
+    for (int i = 16; i < T::kRounds; i += 8) {
+        SHA2_8ROUNDS(i, SHA2_W);
+    }
+#undef SHA2_W0
+#undef SHA2_8ROUNDS
+#undef SHA2_W
+#undef SHA2_ROUND
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+#ifdef DIGEST_HAVE_SHA_NI
+/**
+ * 编译时开启了 SHA 扩展（-msha / -march=native）时直接用 SHA-NI 指令，
+ * 与 OpenSSL 运行期探测 CPU 特性不同，这里在编译期就确定了
+ */
+inline void Sha256Traits::compress(Word h[8], const uint8_t* block) {
+#ifdef __AVX__
+    // sha256rnds2 只有传统 SSE 编码，高位 YMM 脏时混用会有严重的切换惩罚
+    _mm256_zeroupper();
+#endif
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);  // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B);  // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);        // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);             // CDGH
+    const __m128i abef_save = state0;
+    const __m128i cdgh_save = state1;
+
+    __m128i w[4];
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+        if (g < 4) {
+            w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16 * g)), mask);
+        }
+        __m128i msg = _mm_add_epi32(w[g & 3], _mm_loadu_si128((const __m128i*)&kK[4 * g]));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        if (g >= 3 && g <= 14) {
+            tmp = _mm_alignr_epi8(w[g & 3], w[(g - 1) & 3], 4);
+            w[(g + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(g + 1) & 3], tmp), w[g & 3]);
+        }
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        if (g >= 1 && g <= 12) {
+            w[(g - 1) & 3] = _mm_sha256msg1_epu32(w[(g - 1) & 3], w[g & 3]);
+        }
+    }
+
+    state0 = _mm_add_epi32(state0, abef_save);
+    state1 = _mm_add_epi32(state1, cdgh_save);
+    tmp = _mm_shuffle_epi32(state0, 0x1B);                   // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);                // DCHG
+    _mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(tmp, state1, 0xF0));  // DCBA
+    _mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(state1, tmp, 8));     // HGFE
+}
+#else
+inline void Sha256Traits::compress(Word h[8], const uint8_t* block) {
+    sha2_compress<Sha256Traits>(h, block);
+}
+#endif
+inline void Sha512Traits::compress(Word h[8], const uint8_t* block) {
+    sha2_compress<Sha512Traits>(h, block);
+}
+
+typedef MdHash<Sha256Traits> Sha256;
+typedef MdHash<Sha512Traits> Sha512;
+
+/**
+ * BLAKE2 的消息置换表，BLAKE2b 的 12 轮循环使用 sigma[r % 10]
+ */
+constexpr uint8_t kBlake2Sigma[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+};
+
+struct Blake2sTraits {
+    typedef uint32_t Word;
+    static constexpr int kRounds = 10;
+    static constexpr int kR1 = 16, kR2 = 12, kR3 = 8, kR4 = 7;
+    static constexpr Word kIV[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    static Word rotr(Word x, int n) { return rotr32(x, n); }
+};
+
+struct Blake2bTraits {
+    typedef uint64_t Word;
+    static constexpr int kRounds = 12;
+    static constexpr int kR1 = 32, kR2 = 24, kR3 = 16, kR4 = 63;
+    static constexpr Word kIV[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+    };
+    static Word rotr(Word x, int n) { return rotr64(x, n); }
+};
+
+/**
+ * BLAKE2s-256 / BLAKE2b-512（无密钥、满长度输出，与 OpenSSL 的
+ * EVP_blake2s256 / EVP_blake2b512 一致）。
+ * 注意最后一个分组要等到 final 时带着结束标志压缩，所以缓冲区满了也先不压。
+ */
+template <class Traits>
+class Blake2 {
+public:
+    typedef typename Traits::Word Word;
+    static constexpr size_t kBlockSize = 16 * sizeof(Word);
+    static constexpr size_t kDigestSize = 8 * sizeof(Word);
+    typedef std::array<uint8_t, kDigestSize> Result;
+
+    Blake2() { reset(); }
+
+    void reset() {
+        memcpy(h_, Traits::kIV, sizeof(h_));
+        h_[0] ^= 0x01010000 ^ (Word)kDigestSize;
+        total_ = 0;
+        used_ = 0;
+    }
+
+    void update(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (len > 0) {
+            if (used_ == kBlockSize) {
+                total_ += kBlockSize;
+                compress(buf_, false);
+                used_ = 0;
+            }
+            // 缓冲区为空且后面还有数据时，整块直接压缩
+            while (used_ == 0 && len > kBlockSize) {
+                total_ += kBlockSize;
+                compress(p, false);
+                p += kBlockSize;
+                len -= kBlockSize;
+            }
+            size_t take = kBlockSize - used_ < len ? kBlockSize - used_ : len;
+            memcpy(buf_ + used_, p, take);
+            used_ += take;
+            p += take;
+            len -= take;
+        }
+    }
+
+    void final(uint8_t* out) {
+        total_ += used_;
+        memset(buf_ + used_, 0, kBlockSize - used_);
+        compress(buf_, true);
+        for (size_t i = 0; i < 8; ++i) {
+            store_le<Word>(out + i * sizeof(Word), h_[i]);
+        }
+    }
+
+private:
+    static void g(Word* v, int a, int b, int c, int d, Word x, Word y) {
+        v[a] = v[a] + v[b] + x;
+        v[d] = Traits::rotr(v[d] ^ v[a], Traits::kR1);
+        v[c] = v[c] + v[d];
+        v[b] = Traits::rotr(v[b] ^ v[c], Traits::kR2);
+        v[a] = v[a] + v[b] + y;
+        v[d] = Traits::rotr(v[d] ^ v[a], Traits::kR3);
+        v[c] = v[c] + v[d];
+        v[b] = Traits::rotr(v[b] ^ v[c], Traits::kR4);
+    }
+
+    void compress(const uint8_t* block, bool last) {
+        Word m[16];
+        Word v[16];
+        for (int i = 0; i < 16; ++i) {
+            m[i] = load_le<Word>(block + i * sizeof(Word));
+        }
+        for (int i = 0; i < 8; ++i) {
+            v[i] = h_[i];
+            v[i + 8] = Traits::kIV[i];
+        }
+        v[12] ^= (Word)total_;
+        v[13] ^= (Word)(sizeof(Word) == 4 ? total_ >> 16 >> 16 : 0);
+        if (last) {
+            v[14] = ~v[14];
+        }
+        for (int r = 0; r < Traits::kRounds; ++r) {
+            const uint8_t* s = kBlake2Sigma[r % 10];
+            g(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            g(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            g(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            g(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            g(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            g(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            g(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            g(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            h_[i] ^= v[i] ^ v[i + 8];
+        }
+    }
+
+    Word h_[8];
+    uint64_t total_;
+    size_t used_;
+    uint8_t buf_[kBlockSize];
+};
+
+typedef Blake2<Blake2sTraits> Blake2s;
+typedef Blake2<Blake2bTraits> Blake2b;
+
+}  // namespace digest
+
+#endif  // STRING_DIGEST_H
@@ -6,6 +6,8 @@
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 
+#include "hmac.h"
+
 using namespace std;
 
 /**
@@ -57,5 +59,13 @@ int main()
     string hexResult = HMAC256EncodeHex(data, key);
     cout << "Hex编码结果:   " << hexResult << endl;
 
+    // 编译期模板版本：结果是定长的 std::array，而不是 string
+    digest::Hmac<digest::Sha256>::Result arr = digest::Hmac<digest::Sha256>::mac(key, data);
+    cout << "Hmac<Sha256>:  ";
+    for (unsigned char c : arr) {
+        cout << hex << setw(2) << setfill('0') << (int)c;
+    }
+    cout << endl;
+
     return 0;
 }
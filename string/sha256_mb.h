@@ -0,0 +1,155 @@
+#ifndef STRING_SHA256_MB_H
+#define STRING_SHA256_MB_H
+
+/**
+ * 多缓冲（multi-buffer）HMAC-SHA256：8 条相互独立的消息放在 8 个 lane 里，
+ * 用 GCC 向量扩展一次压缩 8 个分组（开启 AVX2 时就是一条 ymm 指令做 8 路）。
+ *
+ * 适合同一个密钥下一批短消息的签名：
+ *   - 外层哈希对所有 lane 都是恰好 1 个分组，完全对齐
+ *   - 内层不同长度的消息用掩码让已经结束的 lane 保持状态不变
+ * 单条消息的延迟比 Hmac<Sha256> 高，批量吞吐更高；SHA-NI 可用时两者差距会缩小，
+ * 以 sign_bench 的实测结果为准。
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <array>
+
+#include "digest.h"
+
+namespace digest {
+
+class HmacSha256Batch {
+public:
+    static constexpr size_t kLanes = 8;
+    static constexpr size_t kBlockSize = 64;
+    static constexpr size_t kDigestSize = 32;
+    typedef std::array<uint8_t, kDigestSize> Result;
+
+    HmacSha256Batch(const void* key, size_t key_len) {
+        uint8_t block[kBlockSize] = {0};
+        if (key_len > kBlockSize) {
+            Sha256 d;
+            d.update(key, key_len);
+            d.final(block);
+        } else {
+            memcpy(block, key, key_len);
+        }
+        uint8_t pad[kBlockSize];
+        for (size_t i = 0; i < kBlockSize; ++i) pad[i] = block[i] ^ 0x36;
+        memcpy(inner_, Sha256Traits::kInit, sizeof(inner_));
+        sha2_compress<Sha256Traits>(inner_, pad);
+        for (size_t i = 0; i < kBlockSize; ++i) pad[i] = block[i] ^ 0x5c;
+        memcpy(outer_, Sha256Traits::kInit, sizeof(outer_));
+        sha2_compress<Sha256Traits>(outer_, pad);
+        memset(block, 0, sizeof(block));
+        memset(pad, 0, sizeof(pad));
+    }
+
+    /**
+     * 对 n 条消息签名，内部按 8 条一组处理
+     */
+    void sign(const uint8_t* const* msgs, const size_t* lens, size_t n, Result* out) const {
+        for (size_t i = 0; i < n; i += kLanes) {
+            sign_group(msgs + i, lens + i, n - i < kLanes ? n - i : kLanes, out + i);
+        }
+    }
+
+private:
+    typedef uint32_t V __attribute__((vector_size(kLanes * sizeof(uint32_t))));
+
+    static V rotr(V x, int n) { return (x >> n) | (x << (32 - n)); }
+    static V splat(uint32_t x) {
+        V v;
+        for (size_t l = 0; l < kLanes; ++l) v[l] = x;
+        return v;
+    }
+
+    static void compress(V h[8], V w[16]) {
+        V a = h[0], b = h[1], c = h[2], d = h[3];
+        V e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i) {
+            V wi;
+            if (i < 16) {
+                wi = w[i];
+            } else {
+                V w2 = w[(i - 2) & 15], w15 = w[(i - 15) & 15];
+                V s0 = rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3);
+                V s1 = rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10);
+                wi = w[i & 15] += s1 + w[(i - 7) & 15] + s0;
+            }
+            V t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                   Sha256Traits::kK[i] + wi;
+            V t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+
+    void sign_group(const uint8_t* const* msgs, const size_t* lens, size_t n, Result* out) const {
+        // 每个 lane 的尾部（最后 1~2 个分组）需要填充，单独放在 tail 里
+        uint8_t tail[kLanes][2 * kBlockSize];
+        size_t full_blocks[kLanes];
+        size_t total_blocks[kLanes];
+        size_t max_blocks = 0;
+        for (size_t l = 0; l < kLanes; ++l) {
+            size_t len = l < n ? lens[l] : 0;
+            size_t rest = len % kBlockSize;
+            full_blocks[l] = len / kBlockSize;
+            total_blocks[l] = full_blocks[l] + (rest + 9 > kBlockSize ? 2 : 1);
+            memset(tail[l], 0, sizeof(tail[l]));
+            if (l < n) memcpy(tail[l], msgs[l] + full_blocks[l] * kBlockSize, rest);
+            tail[l][rest] = 0x80;
+            uint64_t bits = (uint64_t)(kBlockSize + len) * 8;  // 包含 ipad 分组
+            store_be<uint64_t>(tail[l] + (total_blocks[l] - full_blocks[l]) * kBlockSize - 8, bits);
+            if (total_blocks[l] > max_blocks) max_blocks = total_blocks[l];
+        }
+
+        V h[8];
+        for (int i = 0; i < 8; ++i) h[i] = splat(inner_[i]);
+        for (size_t blk = 0; blk < max_blocks; ++blk) {
+            V w[16];
+            V active;
+            for (size_t l = 0; l < kLanes; ++l) {
+                const uint8_t* p;
+                if (blk < full_blocks[l]) {
+                    p = msgs[l] + blk * kBlockSize;
+                } else if (blk < total_blocks[l]) {
+                    p = tail[l] + (blk - full_blocks[l]) * kBlockSize;
+                } else {
+                    p = tail[l];  // 已结束的 lane 随便喂一块，结果会被掩码丢弃
+                }
+                for (int i = 0; i < 16; ++i) w[i][l] = load_be(p + 4 * i, uint32_t());
+                active[l] = blk < total_blocks[l] ? 0xffffffffu : 0;
+            }
+            V saved[8];
+            memcpy(saved, h, sizeof(h));
+            compress(h, w);
+            for (int i = 0; i < 8; ++i) h[i] = (h[i] & active) | (saved[i] & ~active);
+        }
+
+        // 外层：32 字节内层摘要 + 填充，所有 lane 都是一个分组
+        V w[16];
+        for (int i = 0; i < 8; ++i) w[i] = h[i];
+        w[8] = splat(0x80000000u);
+        for (int i = 9; i < 15; ++i) w[i] = splat(0);
+        w[15] = splat((kBlockSize + kDigestSize) * 8);
+        for (int i = 0; i < 8; ++i) h[i] = splat(outer_[i]);
+        compress(h, w);
+
+        for (size_t l = 0; l < n; ++l) {
+            for (int i = 0; i < 8; ++i) store_be<uint32_t>(out[l].data() + 4 * i, h[i][l]);
+        }
+    }
+
+    uint32_t inner_[8];  // 已吸收 key ^ ipad 的中间状态
+    uint32_t outer_[8];  // 已吸收 key ^ opad 的中间状态
+};
+
+}  // namespace digest
+
+#endif  // STRING_SHA256_MB_H
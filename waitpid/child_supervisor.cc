@@ -0,0 +1,135 @@
+#include "child_supervisor.h"
+
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "spawn_process.h"
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+ChildSupervisor::ChildSupervisor() : epfd_(-1), reaped_(0) {}
+
+ChildSupervisor::~ChildSupervisor() {
+    // 还在运行的子进程不杀也不等，只是不再监督；它们退出后由调用者自己 waitpid，或者本进程退出后由 init 收养回收
+    for (std::unordered_map<int, Child>::iterator it = children_.begin(); it != children_.end(); ++it) {
+        close(it->first);
+    }
+}
+
+int ChildSupervisor::init(int epfd, ExitFn on_exit) {
+    epfd_ = epfd;
+    on_exit_ = on_exit;
+    return 0;
+}
+
+int ChildSupervisor::watch(pid_t pid, int pidfd) {
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = pidfd;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, pidfd, &ev) < 0) {
+        return -1;
+    }
+    Child c = {pid, now_ns()};
+    children_[pidfd] = c;
+    by_pid_[pid] = pidfd;
+    return 0;
+}
+
+pid_t ChildSupervisor::spawn(const std::vector<std::string>& argv) {
+    if (argv.empty()) {
+        errno = EINVAL;
+        return -1;
+    }
+    std::vector<char*> args;
+    for (size_t i = 0; i < argv.size(); ++i) {
+        args.push_back(const_cast<char*>(argv[i].c_str()));
+    }
+    args.push_back(NULL);
+    int pidfd = -1;
+    pid_t pid = spawn_process(SPAWN_CLONE3, args[0], &args[0], NULL, NULL, &pidfd);
+    if (pid < 0 && errno == ENOSYS) {
+        // 不支持 clone3 的架构或内核，退回 posix_spawn + pidfd_open
+        pid = spawn_process(SPAWN_POSIX_SPAWN, args[0], &args[0], NULL, NULL, &pidfd);
+    }
+    if (pid < 0) {
+        return -1;
+    }
+    if (pidfd < 0 || watch(pid, pidfd) < 0) {
+        // 没有 pidfd 就没法监督，不能留下一个没人回收的子进程
+        int err = errno;
+        ::kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+int ChildSupervisor::adopt(pid_t pid) {
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0) {
+        return -1;
+    }
+    // pidfd_open 返回的 fd 自带 CLOEXEC
+    if (watch(pid, pidfd) < 0) {
+        close(pidfd);
+        return -1;
+    }
+    return 0;
+}
+
+bool ChildSupervisor::handle(int fd) {
+    std::unordered_map<int, Child>::iterator it = children_.find(fd);
+    if (it == children_.end()) {
+        return false;
+    }
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    int rc = waitid((idtype_t)P_PIDFD, (id_t)fd, &info, WEXITED | WNOHANG);
+    if (rc == 0 && info.si_pid == 0) {
+        return true;  // 还没退出；pidfd 只在进程退出后可读，正常不会走到这里
+    }
+    ChildExit e;
+    e.pid = it->second.pid;
+    // rc < 0 是 ECHILD：子进程被别处的 waitpid(-1) 抢先回收了，退出状态已经丢失
+    e.code = rc == 0 ? info.si_code : 0;
+    e.status = rc == 0 ? info.si_status : -1;
+    e.started_ns = it->second.started_ns;
+    e.reaped_ns = now_ns();
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    by_pid_.erase(e.pid);
+    children_.erase(it);
+    ++reaped_;
+    if (on_exit_) {
+        on_exit_(e);
+    }
+    return true;
+}
+
+int ChildSupervisor::kill(pid_t pid, int sig) {
+    std::unordered_map<pid_t, int>::iterator it = by_pid_.find(pid);
+    if (it == by_pid_.end()) {
+        errno = ESRCH;
+        return -1;
+    }
+    return (int)syscall(SYS_pidfd_send_signal, it->second, sig, NULL, 0);
+}
@@ -0,0 +1,76 @@
+#ifndef WAITPID_CHILD_SUPERVISOR_H
+#define WAITPID_CHILD_SUPERVISOR_H
+
+/**
+ * 用 pidfd 在 epoll 主循环里异步管理子进程，替代阻塞的 wait()/waitpid(-1, ...)
+ *
+ *  - 每个子进程一个 pidfd：spawn() 用 clone3(CLONE_PIDFD) 在创建时原子地拿到（见 ../spawn/spawn_process.h），
+ *    别处 fork 出来的子进程用 adopt() 交给 pidfd_open；pidfd 注册到 epoll，子进程退出时可读
+ *  - handle(fd) 对可读的 pidfd 调 waitid(P_PIDFD, fd, WEXITED | WNOHANG) 只回收这一个子进程，
+ *    再回调 on_exit。不依赖 SIGCHLD：不需要信号处理函数，也没有"多个 SIGCHLD 合并成一个"的问题，
+ *    网络 fd 和上千个子进程在同一个 epoll_wait 里等
+ *  - kill() 用 pidfd_send_signal：pidfd 指向的进程不会被换成复用了同一个 pid 的别的进程
+ *  - 不要在同一个进程里再用 waitpid(-1, ...) 或 SIGCHLD 自动回收（SIG_IGN），它们会抢走这里的子进程
+ *
+ * 和 Scheduler/SignalFd 一样：init(epfd) 注册，handle(fd) 处理，所有接口只能在主循环线程调用。
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ChildExit {
+    pid_t pid;
+    int code;            // CLD_EXITED / CLD_KILLED / CLD_DUMPED；被别处抢先回收时为 0
+    int status;          // 退出码或者终止信号
+    int64_t started_ns;  // spawn/adopt 的时间，CLOCK_MONOTONIC
+    int64_t reaped_ns;   // waitid 回收的时间
+};
+
+class ChildSupervisor {
+public:
+    typedef std::function<void(const ChildExit& e)> ExitFn;
+
+    ChildSupervisor();
+    ~ChildSupervisor();
+
+    /** on_exit 在 handle() 里回收子进程之后调用 */
+    int init(int epfd, ExitFn on_exit);
+
+    /** 启动 argv[0]（不搜索 PATH）并开始监督；失败返回 -1 并设置 errno */
+    pid_t spawn(const std::vector<std::string>& argv);
+
+    /** 监督一个已经存在、还没被回收的子进程；失败返回 -1 */
+    int adopt(pid_t pid);
+
+    /** 主循环拿到的 fd 是某个子进程的 pidfd 时回收它并返回 true */
+    bool handle(int fd);
+
+    /** 给还在监督中的子进程发信号；已经回收或者不认识的 pid 返回 -1（ESRCH） */
+    int kill(pid_t pid, int sig);
+
+    size_t running() const { return children_.size(); }
+    uint64_t reaped() const { return reaped_; }
+
+private:
+    ChildSupervisor(const ChildSupervisor&);
+    ChildSupervisor& operator=(const ChildSupervisor&);
+
+    struct Child {
+        pid_t pid;
+        int64_t started_ns;
+    };
+
+    int watch(pid_t pid, int pidfd);
+
+    int epfd_;
+    ExitFn on_exit_;
+    std::unordered_map<int, Child> children_;  // pidfd -> 子进程
+    std::unordered_map<pid_t, int> by_pid_;    // pid -> pidfd
+    uint64_t reaped_;
+};
+
+#endif  // WAITPID_CHILD_SUPERVISOR_H
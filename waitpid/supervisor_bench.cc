@@ -0,0 +1,209 @@
+/**
+ * 大量短命子进程的回收延迟和吞吐：pidfd + epoll 对比 SIGCHLD + waitpid(-1, WNOHANG)
+ *
+ * 用法: supervisor_bench [-n children] [-c concurrent] [-w max_work_us]
+ *
+ * 主循环保持 concurrent 个子进程同时存活，一共启动 children 个；每轮最多补 16 个，然后处理一次事件：
+ *   pidfd    fork 出子进程后 ChildSupervisor::adopt()，pidfd 可读时 waitid(P_PIDFD) 回收这一个
+ *   sigchld  SIGCHLD 经 signalfd 进 epoll，每次读到信号就循环 waitpid(-1, WNOHANG) 直到没有
+ *   spawn    ChildSupervisor::spawn("/bin/true")：clone3(CLONE_PIDFD) 启动，含 exec 的完整开销
+ * 前两种的子进程 usleep [0, max_work_us) 后把 CLOCK_MONOTONIC 写进共享内存再 _exit(序号 & 0xff)，
+ * 回收延迟 = 父进程回收的时间 - 子进程写下的退出时间。spawn 只统计吞吐。
+ * 每个子进程必须恰好被回收一次、退出码正确，否则退出码为 1。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unordered_map>
+#include <vector>
+
+#include "child_supervisor.h"
+#include "latency_histogram.h"
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct RunResult {
+    uint64_t reaped;
+    uint64_t wrong;       // 退出码不对、重复回收或者不认识的 pid
+    uint64_t wakeups;     // epoll_wait 返回次数
+    double elapsed_s;
+    LatencyHistogram latency;
+
+    RunResult() : reaped(0), wrong(0), wakeups(0), elapsed_s(0) {}
+};
+
+/** 子进程：干一会儿活，记下退出时间，退出码是序号的低 8 位 */
+static void child_main(int index, int max_work_us, volatile int64_t* exit_ns) {
+    if (max_work_us > 0) {
+        usleep((useconds_t)(index * 7919 % max_work_us));
+    }
+    exit_ns[index] = now_ns();
+    _exit(index & 0xff);
+}
+
+enum Mode { kPidfd, kSigchld, kSpawn };
+
+static const int kSpawnBatch = 16;
+
+static void run(Mode mode, int children, int concurrent, int max_work_us, volatile int64_t* exit_ns,
+                RunResult* r) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    std::unordered_map<pid_t, int> index_of;  // pid -> 序号，回收后删除
+    auto on_reaped = [&](pid_t pid, bool exited, int status, int64_t reaped_ns) {
+        std::unordered_map<pid_t, int>::iterator it = index_of.find(pid);
+        if (it == index_of.end()) {
+            ++r->wrong;
+            return;
+        }
+        int idx = it->second;
+        index_of.erase(it);
+        ++r->reaped;
+        if (mode == kSpawn) {
+            r->wrong += !exited || status != 0;
+            return;
+        }
+        r->wrong += !exited || status != (idx & 0xff);
+        r->latency.record(reaped_ns > exit_ns[idx] ? reaped_ns - exit_ns[idx] : 0);
+    };
+
+    ChildSupervisor sup;
+    sup.init(ep, [&](const ChildExit& e) { on_reaped(e.pid, e.code == CLD_EXITED, e.status, e.reaped_ns); });
+
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    int sfd = -1;
+    if (mode == kSigchld) {
+        sigprocmask(SIG_BLOCK, &chld, NULL);
+        sfd = signalfd(-1, &chld, SFD_NONBLOCK | SFD_CLOEXEC);
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = sfd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev);
+    }
+
+    std::vector<std::string> true_argv(1, "/bin/true");
+    int64_t start = now_ns();
+    int spawned = 0;
+    epoll_event events[256];
+    while (r->reaped + r->wrong < (uint64_t)children) {
+        // 一轮最多补 kSpawnBatch 个，补不满就不等，保证回收不会被一长串 fork 挡住
+        for (int b = 0; b < kSpawnBatch && (int)index_of.size() < concurrent && spawned < children; ++b) {
+            int idx = spawned++;
+            pid_t pid;
+            if (mode == kSpawn) {
+                pid = sup.spawn(true_argv);
+            } else {
+                pid = fork();
+                if (pid == 0) {
+                    child_main(idx, max_work_us, exit_ns);
+                }
+                if (pid > 0 && mode == kPidfd && sup.adopt(pid) < 0) {
+                    perror("pidfd_open");
+                    exit(1);
+                }
+            }
+            if (pid < 0) {
+                perror("spawn");
+                exit(1);
+            }
+            index_of[pid] = idx;
+        }
+        bool refill = (int)index_of.size() < concurrent && spawned < children;
+        int n = epoll_wait(ep, events, 256, refill ? 0 : 5000);
+        if (n == 0 && refill) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            fprintf(stderr, "5s 没有子进程退出，还剩 %zu 个\n", index_of.size());
+            break;
+        }
+        ++r->wakeups;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == sfd) {
+                signalfd_siginfo si[32];
+                while (read(sfd, si, sizeof(si)) > 0) {
+                }
+                // 多个 SIGCHLD 会合并，读到一个就要把所有已退出的都收掉
+                int status;
+                pid_t pid;
+                while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                    on_reaped(pid, WIFEXITED(status), WEXITSTATUS(status), now_ns());
+                }
+            } else {
+                sup.handle(fd);
+            }
+        }
+    }
+    r->elapsed_s = (now_ns() - start) / 1e9;
+    if (sfd >= 0) {
+        close(sfd);
+        sigprocmask(SIG_UNBLOCK, &chld, NULL);
+    }
+    close(ep);
+}
+
+int main(int argc, char** argv) {
+    int children = 10000;
+    int concurrent = 1000;
+    int max_work_us = 2000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:w:")) != -1) {
+        switch (opt) {
+            case 'n': children = atoi(optarg); break;
+            case 'c': concurrent = atoi(optarg); break;
+            case 'w': max_work_us = atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-n children] [-c concurrent] [-w max_work_us]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (children < 1 || concurrent < 1 || max_work_us < 0) {
+        return 1;
+    }
+    void* mem = mmap(NULL, sizeof(int64_t) * children, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    volatile int64_t* exit_ns = static_cast<volatile int64_t*>(mem);
+
+    printf("%d 个子进程, 同时存活 %d 个, 子进程工作 [0, %d) us\n", children, concurrent, max_work_us);
+    printf("%8s %8s %6s %10s %10s %10s %10s %10s %10s\n", "mode", "reaped", "wrong", "children/s", "wakeups",
+           "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+    bool ok = true;
+    const Mode modes[] = {kPidfd, kSigchld, kSpawn};
+    const char* names[] = {"pidfd", "sigchld", "spawn"};
+    for (int m = 0; m < 3; ++m) {
+        RunResult r;
+        run(modes[m], children, concurrent, max_work_us, exit_ns, &r);
+        ok &= r.reaped == (uint64_t)children && r.wrong == 0;
+        printf("%8s %8llu %6llu %10.0f %10llu", names[m], (unsigned long long)r.reaped, (unsigned long long)r.wrong,
+               r.reaped / r.elapsed_s, (unsigned long long)r.wakeups);
+        if (modes[m] == kSpawn) {
+            printf(" %10s %10s %10s %10s\n", "-", "-", "-", "-");
+        } else {
+            printf(" %10.1f %10.1f %10.1f %10.1f\n", r.latency.percentile(50) / 1000.0,
+                   r.latency.percentile(99) / 1000.0, r.latency.percentile(99.9) / 1000.0, r.latency.max() / 1000.0);
+        }
+        fflush(stdout);
+    }
+    // 所有子进程都应该已经被回收
+    ok &= waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD;
+    return ok ? 0 : 1;
+}